@@ -0,0 +1,664 @@
+#include "AssetCooker.hpp"
+#include "JobGraph.hpp"
+#include "ImportUtilities.hpp"
+#include "MeshCache.hpp"
+#include "MeshSerialization.hpp"
+#include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    using cook_database_t = std::unordered_map<std::string, uint64_t>;
+    using clock_t = std::chrono::steady_clock;
+
+    struct mesh_job_state_t {
+        std::string source;
+        AssetDependencies dependencies;
+        uint64_t key{ 0 };
+        bool upToDate{ false };
+        std::unique_ptr<MeshData, decltype(&MeshData::DestroyMeshData)> mesh{ nullptr, MeshData::DestroyMeshData };
+        size_t reportIndex{ 0 };
+        size_t firstJob{ 0 };
+        size_t lastJob{ 0 };
+    };
+
+    struct texture_job_state_t {
+        std::string texture;
+        uint64_t key{ 0 };
+        size_t reportIndex{ 0 };
+        size_t job{ 0 };
+    };
+
+    std::string lowercase_extension(const std::string& fname) {
+        std::string result = fs::path(fname).extension().string();
+        std::transform(result.begin(), result.end(), result.begin(), [](const char c) { return static_cast<char>(::tolower(c)); });
+        return result;
+    }
+
+    bool is_mesh_source(const std::string& fname) {
+        const std::string extension = lowercase_extension(fname);
+        return (extension == ".obj") || (extension == ".gltf") || (extension == ".glb");
+    }
+
+    bool is_image(const std::string& fname) {
+        static const char* const image_extensions[]{ ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".dds", ".ktx", ".ktx2", ".webp", ".hdr" };
+        const std::string extension = lowercase_extension(fname);
+        return std::any_of(std::begin(image_extensions), std::end(image_extensions), [&](const char* e) { return extension == e; });
+    }
+
+    // Outputs go to the same relative path under the output directory, so inputs can't be outside the input one
+    bool outside_root(const std::string& path) {
+        const fs::path relative(path);
+        return relative.has_root_path() || (!relative.empty() && (*relative.begin() == ".."));
+    }
+
+    // Path of relative_to_file (as written inside file, which is relative to root) relative to root
+    std::string resolve_reference(const std::string& file, const std::string& reference) {
+        fs::path result = (fs::path(file).parent_path() / fs::path(reference)).lexically_normal();
+        return result.generic_string();
+    }
+
+    std::string trim(const std::string& s) {
+        const size_t begin = s.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos) {
+            return std::string();
+        }
+        return s.substr(begin, s.find_last_not_of(" \t\r\n") - begin + 1);
+    }
+
+    std::vector<std::string> read_lines_starting_with(const std::string& fname, const std::vector<std::string>& keywords) {
+        std::vector<std::string> result;
+        std::unique_ptr<MappedFile, decltype(&UnmapFile)> file(MapFile(fname.c_str()), UnmapFile);
+        if (!file) {
+            return result;
+        }
+
+        const char* p = file->Data;
+        const char* const end = file->Data + file->Size;
+        while (p < end) {
+            const char* newline = reinterpret_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+            const char* line_end = newline ? newline : end;
+            while ((p < line_end) && ((*p == ' ') || (*p == '\t'))) {
+                ++p;
+            }
+            for (const std::string& keyword : keywords) {
+                const size_t length = keyword.size();
+                if ((static_cast<size_t>(line_end - p) > length) && (strncmp(p, keyword.c_str(), length) == 0) && ((p[length] == ' ') || (p[length] == '\t'))) {
+                    result.emplace_back(trim(std::string(p + length, line_end)));
+                    break;
+                }
+            }
+            p = newline ? newline + 1 : end;
+        }
+        return result;
+    }
+
+    // Material libraries can be named with spaces, so only split the statement if the whole doesn't exist
+    std::vector<std::string> split_library_names(const std::string& root, const std::string& source, const std::string& statement) {
+        if (fs::exists(fs::path(root) / resolve_reference(source, statement))) {
+            return { statement };
+        }
+        std::vector<std::string> result;
+        std::istringstream names(statement);
+        for (std::string name; names >> name;) {
+            result.emplace_back(name);
+        }
+        return result;
+    }
+
+    void find_obj_dependencies(const std::string& root, const std::string& source, AssetDependencies& result) {
+        static const std::vector<std::string> texture_statements{
+            "map_Ka", "map_Kd", "map_Ks", "map_Ke", "map_Ns", "map_d", "map_bump", "map_Bump", "bump", "disp", "decal", "norm",
+            "map_Pr", "map_Pm", "map_Ps", "map_Kn", "refl"
+        };
+
+        for (const std::string& statement : read_lines_starting_with((fs::path(root) / source).string(), { "mtllib" })) {
+            for (const std::string& library : split_library_names(root, source, statement)) {
+                const std::string mtl = resolve_reference(source, library);
+                for (const std::string& texture_statement : read_lines_starting_with((fs::path(root) / mtl).string(), texture_statements)) {
+                    // Options like "-bm 0.5" come before the file name, which is the last token
+                    const size_t name_begin = texture_statement.find_last_of(" \t");
+                    const std::string name = (name_begin == std::string::npos) ? texture_statement : texture_statement.substr(name_begin + 1);
+                    if (!name.empty()) {
+                        result.Textures.emplace_back(resolve_reference(mtl, name));
+                    }
+                }
+            }
+        }
+    }
+
+    std::string decode_uri(const std::string& uri) {
+        std::string result;
+        for (size_t i = 0; i < uri.size(); ++i) {
+            if ((uri[i] == '%') && (i + 2 < uri.size()) && isxdigit(uri[i + 1]) && isxdigit(uri[i + 2])) {
+                result.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+                i += 2;
+            }
+            else {
+                result.push_back(uri[i]);
+            }
+        }
+        return result;
+    }
+
+    // External buffers are part of the mesh, external images are textures. Embedded (data:) URIs are skipped.
+    void find_gltf_dependencies(const std::string& root, const std::string& source, AssetDependencies& result) {
+        std::ifstream input(fs::path(root) / source, std::ios::binary);
+        const std::string json{ std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
+
+        for (size_t key = json.find("\"uri\""); key != std::string::npos; key = json.find("\"uri\"", key + 5)) {
+            const size_t colon = json.find_first_not_of(" \t\r\n", key + 5);
+            if ((colon == std::string::npos) || (json[colon] != ':')) {
+                continue;
+            }
+            const size_t open_quote = json.find_first_not_of(" \t\r\n", colon + 1);
+            if ((open_quote == std::string::npos) || (json[open_quote] != '"')) {
+                continue;
+            }
+            const size_t close_quote = json.find('"', open_quote + 1);
+            if (close_quote == std::string::npos) {
+                break;
+            }
+
+            const std::string uri = json.substr(open_quote + 1, close_quote - open_quote - 1);
+            if (uri.compare(0, 5, "data:") == 0) {
+                continue;
+            }
+
+            const std::string path = resolve_reference(source, decode_uri(uri));
+            if (is_image(path)) {
+                result.Textures.emplace_back(path);
+            }
+            else {
+                result.Inputs.emplace_back(path);
+            }
+        }
+    }
+
+    cook_database_t read_database(const std::string& output_directory) {
+        cook_database_t result;
+        std::ifstream input(fs::path(output_directory) / CookDatabaseName);
+        for (std::string line; std::getline(input, line);) {
+            if ((line.size() > 17) && (line[16] == ' ')) {
+                result[line.substr(17)] = std::stoull(line.substr(0, 16), nullptr, 16);
+            }
+        }
+        return result;
+    }
+
+    bool write_database(const std::string& output_directory, const cook_database_t& database) {
+        std::vector<std::pair<std::string, uint64_t>> entries(database.begin(), database.end());
+        std::sort(entries.begin(), entries.end());
+
+        const fs::path path = fs::path(output_directory) / CookDatabaseName;
+        const fs::path temporary = fs::path(path.string() + ".tmp");
+        {
+            std::ofstream output(temporary, std::ios::trunc);
+            for (const auto& entry : entries) {
+                output << std::hex << std::setw(16) << std::setfill('0') << entry.second << ' ' << entry.first << '\n';
+            }
+            if (!output.good()) {
+                return false;
+            }
+        }
+
+        std::error_code error;
+        fs::rename(temporary, path, error);
+        return !error;
+    }
+
+    uint64_t hash_file(const fs::path& path, uint64_t& size) {
+        std::unique_ptr<MappedFile, decltype(&UnmapFile)> file(MapFile(path.string().c_str()), UnmapFile);
+        if (!file) {
+            // Empty files can't be mapped, but are still valid inputs
+            std::error_code error;
+            if (fs::is_regular_file(path, error) && (fs::file_size(path, error) == 0)) {
+                size = 0;
+                return HashBytes(nullptr, 0);
+            }
+            throw std::runtime_error("Couldn't read " + path.generic_string());
+        }
+        size = file->Size;
+        return HashBytes(file->Data, static_cast<size_t>(file->Size));
+    }
+
+    // Mesh keys cover the contents and names of every input, and the settings part of the cache key
+    uint64_t hash_mesh_inputs(const std::string& root, const mesh_job_state_t& state, const MeshProcessingOptions& options, uint64_t& input_bytes) {
+        MeshCacheKey key;
+        if (!ComputeMeshCacheKey((fs::path(root) / state.source).string().c_str(), options, key)) {
+            throw std::runtime_error("Couldn't read " + state.source);
+        }
+
+        std::vector<uint64_t> record{ key.Source, key.Settings };
+        input_bytes = fs::file_size(fs::path(root) / state.source);
+        for (const std::string& input : state.dependencies.Inputs) {
+            if (input == state.source) {
+                continue;
+            }
+            uint64_t size = 0;
+            record.emplace_back(hash_file(fs::path(root) / input, size));
+            record.emplace_back(HashBytes(input.data(), input.size()));
+            input_bytes += size;
+        }
+        return HashBytes(record.data(), record.size() * sizeof(uint64_t));
+    }
+
+    bool output_current(const cook_database_t& database, const std::string& output_directory, const std::string& output, const uint64_t key) {
+        auto entry = database.find(output);
+        std::error_code error;
+        return (entry != database.end()) && (entry->second == key) && fs::exists(fs::path(output_directory) / output, error);
+    }
+
+    // Times a job, adding to the report entry of its asset: jobs of an asset never run concurrently
+    template<typename Fn>
+    void timed(CookReportEntry& entry, Fn&& fn) {
+        const auto start = clock_t::now();
+        fn();
+        entry.Milliseconds += std::chrono::duration<double, std::milli>(clock_t::now() - start).count();
+    }
+
+    std::string format_bytes(const uint64_t bytes) {
+        std::ostringstream result;
+        result << std::fixed << std::setprecision(1);
+        if (bytes >= (uint64_t(1) << 20)) {
+            result << double(bytes) / double(1 << 20) << " MiB";
+        }
+        else if (bytes >= (uint64_t(1) << 10)) {
+            result << double(bytes) / double(1 << 10) << " KiB";
+        }
+        else {
+            result << bytes << " B";
+        }
+        return result.str();
+    }
+
+}
+
+bool GatherCookSources(const std::string& input, std::string& root, std::vector<std::string>& sources) {
+    std::error_code error;
+    if (fs::is_directory(input, error)) {
+        root = input;
+        for (fs::recursive_directory_iterator iter(input, error), end; !error && (iter != end); iter.increment(error)) {
+            if (iter->is_regular_file(error) && is_mesh_source(iter->path().string())) {
+                sources.emplace_back(iter->path().lexically_relative(input).generic_string());
+            }
+        }
+        std::sort(sources.begin(), sources.end());
+        return !error;
+    }
+
+    std::ifstream manifest(input);
+    if (!manifest.is_open()) {
+        LOG(ERROR) << "Couldn't open " << input << " as a directory or a manifest.";
+        return false;
+    }
+
+    root = fs::path(input).parent_path().string();
+    if (root.empty()) {
+        root = ".";
+    }
+    for (std::string line; std::getline(manifest, line);) {
+        line = trim(line);
+        if (!line.empty() && (line[0] != '#')) {
+            sources.emplace_back(fs::path(line).lexically_normal().generic_string());
+        }
+    }
+    return true;
+}
+
+AssetDependencies FindAssetDependencies(const std::string& root, const std::string& source) {
+    AssetDependencies result;
+    result.Inputs.emplace_back(source);
+
+    const std::string extension = lowercase_extension(source);
+    if (extension == ".obj") {
+        find_obj_dependencies(root, source, result);
+    }
+    else if (extension == ".gltf") {
+        find_gltf_dependencies(root, source, result);
+    }
+
+    for (std::vector<std::string>* paths : { &result.Inputs, &result.Textures }) {
+        std::sort(paths->begin() + (paths == &result.Inputs ? 1 : 0), paths->end());
+        paths->erase(std::unique(paths->begin(), paths->end()), paths->end());
+    }
+    return result;
+}
+
+std::vector<CookReportEntry> CookAssets(const CookOptions& options) {
+    const std::string& root = options.InputRoot;
+    const std::string& output_directory = options.OutputDirectory;
+    const cook_database_t database = options.Force ? cook_database_t() : read_database(output_directory);
+
+    std::vector<mesh_job_state_t> meshes(options.Sources.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        meshes[i].source = options.Sources[i];
+    }
+    ForEachChunk(meshes.size(), [&](const size_t i) {
+        if (!outside_root(meshes[i].source)) {
+            meshes[i].dependencies = FindAssetDependencies(root, meshes[i].source);
+        }
+    });
+
+    std::vector<texture_job_state_t> textures;
+    {
+        std::unordered_set<std::string> seen;
+        for (const mesh_job_state_t& mesh : meshes) {
+            for (const std::string& texture : mesh.dependencies.Textures) {
+                if (seen.insert(texture).second) {
+                    textures.emplace_back();
+                    textures.back().texture = texture;
+                }
+            }
+        }
+    }
+
+    std::vector<CookReportEntry> report(meshes.size() + textures.size());
+    JobGraph graph;
+
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        mesh_job_state_t& mesh = meshes[i];
+        mesh.reportIndex = i;
+        CookReportEntry& entry = report[i];
+        entry.Output = mesh.source + ".hmesh";
+
+        const size_t hash_job = graph.AddJob([&]() {
+            timed(entry, [&]() {
+                if (outside_root(mesh.source)) {
+                    throw std::runtime_error("Mesh is outside the input directory");
+                }
+                mesh.key = hash_mesh_inputs(root, mesh, options.Processing, entry.InputBytes);
+                mesh.upToDate = output_current(database, output_directory, entry.Output, mesh.key);
+            });
+        });
+
+        const size_t import_job = graph.AddJob([&]() {
+            if (mesh.upToDate) {
+                return;
+            }
+            timed(entry, [&]() {
+                MeshProcessingOptions processing = options.Processing;
+                mesh.mesh.reset(ImportMeshData((fs::path(root) / mesh.source).string().c_str(), &processing));
+                if (!mesh.mesh) {
+                    throw std::runtime_error("Import failed");
+                }
+            });
+        });
+        graph.AddDependency(import_job, hash_job);
+
+        const size_t write_job = graph.AddJob([&]() {
+            timed(entry, [&]() {
+                const fs::path output = fs::path(output_directory) / entry.Output;
+                if (!mesh.upToDate) {
+                    fs::create_directories(output.parent_path());
+                    if (!WriteMeshDataFileAtomic(output.string().c_str(), mesh.mesh.get())) {
+                        throw std::runtime_error("Couldn't write " + output.generic_string());
+                    }
+                    mesh.mesh.reset();
+                }
+                entry.OutputBytes = fs::file_size(output);
+            });
+        });
+        graph.AddDependency(write_job, import_job);
+
+        mesh.firstJob = hash_job;
+        mesh.lastJob = write_job;
+    }
+
+    for (size_t i = 0; i < textures.size(); ++i) {
+        texture_job_state_t& texture = textures[i];
+        texture.reportIndex = meshes.size() + i;
+        CookReportEntry& entry = report[texture.reportIndex];
+        entry.Output = texture.texture;
+        entry.IsTexture = true;
+
+        // Textures are copied as they are: compressing them is up to the loaders
+        texture.job = graph.AddJob([&]() {
+            timed(entry, [&]() {
+                if (outside_root(texture.texture)) {
+                    throw std::runtime_error("Texture is outside the input directory");
+                }
+
+                const fs::path source = fs::path(root) / texture.texture;
+                const fs::path output = fs::path(output_directory) / texture.texture;
+                texture.key = hash_file(source, entry.InputBytes);
+                if (!output_current(database, output_directory, entry.Output, texture.key)) {
+                    fs::create_directories(output.parent_path());
+                    const fs::path temporary = fs::path(output.string() + ".tmp");
+                    fs::copy_file(source, temporary, fs::copy_options::overwrite_existing);
+                    fs::rename(temporary, output);
+                    entry.Status = CookStatus::Cooked;
+                }
+                else {
+                    entry.Status = CookStatus::UpToDate;
+                }
+                entry.OutputBytes = fs::file_size(output);
+            });
+        });
+    }
+
+    graph.Run(options.NumThreads);
+
+    // Failed outputs are dropped from the database, so they're retried next time whatever their inputs
+    cook_database_t new_database = database;
+    for (const mesh_job_state_t& mesh : meshes) {
+        CookReportEntry& entry = report[mesh.reportIndex];
+        entry.Status = mesh.upToDate ? CookStatus::UpToDate : CookStatus::Cooked;
+        for (size_t job = mesh.firstJob; job <= mesh.lastJob; ++job) {
+            if (graph.JobStatus(job) == JobGraph::Status::Failed) {
+                entry.Status = CookStatus::Failed;
+                entry.Error = graph.JobError(job);
+                break;
+            }
+        }
+
+        if (entry.Status == CookStatus::Failed) {
+            new_database.erase(entry.Output);
+        }
+        else {
+            new_database[entry.Output] = mesh.key;
+        }
+    }
+
+    for (const texture_job_state_t& texture : textures) {
+        CookReportEntry& entry = report[texture.reportIndex];
+        if (graph.JobStatus(texture.job) == JobGraph::Status::Failed) {
+            entry.Status = CookStatus::Failed;
+            entry.Error = graph.JobError(texture.job);
+            new_database.erase(entry.Output);
+        }
+        else {
+            new_database[entry.Output] = texture.key;
+        }
+    }
+
+    std::error_code error;
+    fs::create_directories(output_directory, error);
+    if (!write_database(output_directory, new_database)) {
+        LOG(WARNING) << "Couldn't write the cook database to " << output_directory << ": everything will be rebuilt next time.";
+    }
+
+    return report;
+}
+
+void PrintCookReport(std::ostream& output, const std::vector<CookReportEntry>& report, const double total_seconds) {
+    size_t name_width = 5;
+    for (const CookReportEntry& entry : report) {
+        name_width = std::max(name_width, entry.Output.size());
+    }
+
+    output << std::left << std::setw(name_width + 2) << "Asset" << std::setw(9) << "Kind" << std::setw(12) << "Status"
+        << std::right << std::setw(12) << "Time (ms)" << std::setw(14) << "Input" << std::setw(14) << "Output" << '\n';
+
+    size_t counts[3]{ 0, 0, 0 };
+    uint64_t total_output = 0;
+    for (const CookReportEntry& entry : report) {
+        static const char* const status_names[]{ "cooked", "up to date", "FAILED" };
+        ++counts[size_t(entry.Status)];
+        total_output += entry.OutputBytes;
+        output << std::left << std::setw(name_width + 2) << entry.Output << std::setw(9) << (entry.IsTexture ? "texture" : "mesh")
+            << std::setw(12) << status_names[size_t(entry.Status)] << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+            << entry.Milliseconds << std::setw(14) << format_bytes(entry.InputBytes) << std::setw(14) << format_bytes(entry.OutputBytes) << '\n';
+        if (entry.Status == CookStatus::Failed) {
+            output << "    " << entry.Error << '\n';
+        }
+    }
+
+    output << counts[size_t(CookStatus::Cooked)] << " cooked, " << counts[size_t(CookStatus::UpToDate)] << " up to date, "
+        << counts[size_t(CookStatus::Failed)] << " failed in " << std::setprecision(2) << total_seconds << " s (" << format_bytes(total_output)
+        << " of output)\n";
+}
+
+#ifdef VPSK_TESTING_ENABLED
+
+namespace {
+
+    void write_test_file(const fs::path& path, const std::string& contents) {
+        fs::create_directories(path.parent_path());
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+        output << contents;
+    }
+
+    const CookReportEntry* find_entry(const std::vector<CookReportEntry>& report, const std::string& output) {
+        for (const CookReportEntry& entry : report) {
+            if (entry.Output == output) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    constexpr const char* const CookTestObj =
+        "mtllib materials.mtl\n"
+        "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvt 1 0\nvt 0 1\nvn 0 0 1\n"
+        "usemtl stone\nf 1/1/1 2/2/1 3/3/1\n";
+
+}
+
+TEST_SUITE("AssetCooker") {
+    TEST_CASE("FindsObjAndGltfDependencies") {
+        const fs::path root = fs::path("asset_cooker_test_dependencies");
+        write_test_file(root / "models/crate.obj", "mtllib crate.mtl\nv 0 0 0\n");
+        write_test_file(root / "models/crate.mtl", "newmtl wood\nmap_Kd ../textures/wood.png\nmap_bump -bm 0.5 wood_normal.png\n");
+        write_test_file(root / "models/scene.gltf",
+            "{ \"buffers\": [ { \"uri\": \"scene.bin\" }, { \"uri\": \"data:application/octet-stream;base64,AAAA\" } ],\n"
+            "  \"images\": [ { \"uri\" : \"textures/rock%20albedo.png\" } ] }");
+
+        const AssetDependencies obj = FindAssetDependencies(root.string(), "models/crate.obj");
+        REQUIRE(obj.Inputs.size() == 1);
+        REQUIRE(obj.Textures.size() == 2);
+        CHECK(obj.Textures[0] == "models/wood_normal.png");
+        CHECK(obj.Textures[1] == "textures/wood.png");
+
+        const AssetDependencies gltf = FindAssetDependencies(root.string(), "models/scene.gltf");
+        REQUIRE(gltf.Inputs.size() == 2);
+        CHECK(gltf.Inputs[1] == "models/scene.bin");
+        REQUIRE(gltf.Textures.size() == 1);
+        CHECK(gltf.Textures[0] == "models/textures/rock albedo.png");
+
+        fs::remove_all(root);
+    }
+
+    TEST_CASE("RebuildsOnlyWhatChanged") {
+        const fs::path root = fs::path("asset_cooker_test_input");
+        const fs::path output = fs::path("asset_cooker_test_output");
+        write_test_file(root / "a.obj", CookTestObj);
+        write_test_file(root / "sub/b.obj", CookTestObj);
+        write_test_file(root / "materials.mtl", "newmtl stone\nmap_Kd stone.png\n");
+        write_test_file(root / "sub/materials.mtl", "newmtl stone\nmap_Kd ../stone.png\n");
+        write_test_file(root / "stone.png", "not really a png");
+
+        CookOptions options;
+        REQUIRE(GatherCookSources(root.string(), options.InputRoot, options.Sources));
+        REQUIRE(options.Sources.size() == 2);
+        options.OutputDirectory = output.string();
+        options.NumThreads = 4;
+
+        std::vector<CookReportEntry> report = CookAssets(options);
+        // Both meshes share one texture
+        REQUIRE(report.size() == 3);
+        for (const CookReportEntry& entry : report) {
+            CHECK(entry.Status == CookStatus::Cooked);
+            CHECK(fs::exists(output / entry.Output));
+        }
+        MeshData* cooked = LoadMeshDataFile((output / "sub/b.obj.hmesh").string().c_str());
+        REQUIRE(cooked != nullptr);
+        CHECK(cooked->Header.IndexCount == 3);
+        MeshData::DestroyMeshData(cooked);
+
+        report = CookAssets(options);
+        for (const CookReportEntry& entry : report) {
+            CHECK(entry.Status == CookStatus::UpToDate);
+        }
+
+        write_test_file(root / "stone.png", "a different texture");
+        write_test_file(root / "sub/b.obj", std::string(CookTestObj) + "f 1/1/1 3/3/1 2/2/1\n");
+        report = CookAssets(options);
+        CHECK(find_entry(report, "a.obj.hmesh")->Status == CookStatus::UpToDate);
+        CHECK(find_entry(report, "sub/b.obj.hmesh")->Status == CookStatus::Cooked);
+        CHECK(find_entry(report, "stone.png")->Status == CookStatus::Cooked);
+
+        // Missing outputs are rebuilt, and failures are reported without stopping the other assets
+        fs::remove(output / "a.obj.hmesh");
+        write_test_file(root / "sub/b.obj", "v 0 0 0\nf 1 2 3\n");
+        report = CookAssets(options);
+        CHECK(find_entry(report, "a.obj.hmesh")->Status == CookStatus::Cooked);
+        CHECK(find_entry(report, "sub/b.obj.hmesh")->Status == CookStatus::Failed);
+        CHECK(find_entry(report, "stone.png")->Status == CookStatus::UpToDate);
+
+        fs::remove_all(root);
+        fs::remove_all(output);
+    }
+
+    TEST_CASE("RejectsMeshesOutsideTheInputDirectory") {
+        const fs::path root = fs::path("asset_cooker_test_outside/input");
+        const fs::path output = fs::path("asset_cooker_test_outside/output");
+        write_test_file(root / "inside.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+        write_test_file(root.parent_path() / "outside.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+        write_test_file(root / "assets.txt", "inside.obj\n../outside.obj\n" + fs::absolute(root / "inside.obj").generic_string() + "\n");
+
+        CookOptions options;
+        REQUIRE(GatherCookSources((root / "assets.txt").string(), options.InputRoot, options.Sources));
+        REQUIRE(options.Sources.size() == 3);
+        options.OutputDirectory = output.string();
+        const std::vector<CookReportEntry> report = CookAssets(options);
+        REQUIRE(report.size() == 3);
+        CHECK(report[0].Status == CookStatus::Cooked);
+        CHECK(report[1].Status == CookStatus::Failed);
+        CHECK(report[2].Status == CookStatus::Failed);
+        CHECK_FALSE(fs::exists(root.parent_path() / "outside.obj.hmesh"));
+        CHECK_FALSE(fs::exists(root / "inside.obj.hmesh"));
+
+        fs::remove_all(root.parent_path());
+    }
+
+    TEST_CASE("ReadsManifests") {
+        const fs::path root = fs::path("asset_cooker_test_manifest");
+        write_test_file(root / "assets.txt", "# meshes to ship\nmodels/a.obj\n\n  models/../b.gltf  \n");
+        std::string manifest_root;
+        std::vector<std::string> sources;
+        REQUIRE(GatherCookSources((root / "assets.txt").string(), manifest_root, sources));
+        CHECK(fs::path(manifest_root) == root);
+        REQUIRE(sources.size() == 2);
+        CHECK(sources[0] == "models/a.obj");
+        CHECK(sources[1] == "b.gltf");
+        fs::remove_all(root);
+    }
+}
+
+#endif //!VPSK_TESTING_ENABLED
@@ -0,0 +1,70 @@
+#pragma once
+#ifndef CONTENT_COOKER_ASSET_COOKER_HPP
+#define CONTENT_COOKER_ASSET_COOKER_HPP
+#include "MeshData.hpp"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/*
+    Offline version of what LoadMeshFromFileCached does at load time. Every source mesh is compiled into a mesh
+    file at the same relative path in the output directory (with ".hmesh" appended), and the textures its
+    materials reference are copied alongside. Both are jobs in one JobGraph: hashing, importing and writing of
+    each mesh are separate jobs, so imports overlap with other meshes' writes and texture copies.
+    Rebuilds are incremental: each output is recorded in a database in the output directory, along with a
+    hash of everything it was built from, and is only rebuilt when that hash changes or the output is missing.
+*/
+
+// Name of the build database, in the output directory
+constexpr static const char* const CookDatabaseName = ".cook_database";
+
+struct CookOptions {
+    // Directory sources and textures are found relative to, and whose layout the output mirrors
+    std::string InputRoot;
+    // Relative to InputRoot
+    std::vector<std::string> Sources;
+    std::string OutputDirectory;
+    MeshProcessingOptions Processing{ false, false, true };
+    size_t NumThreads{ 1 };
+    // Rebuild everything, ignoring the database
+    bool Force{ false };
+};
+
+enum class CookStatus {
+    Cooked,
+    UpToDate,
+    Failed
+};
+
+struct CookReportEntry {
+    // Relative to the output directory
+    std::string Output;
+    bool IsTexture{ false };
+    CookStatus Status{ CookStatus::Failed };
+    double Milliseconds{ 0.0 };
+    uint64_t InputBytes{ 0 };
+    uint64_t OutputBytes{ 0 };
+    std::string Error;
+};
+
+struct AssetDependencies {
+    // Files the compiled mesh is made from: the source itself, and e.g. the buffers of a .gltf file
+    std::vector<std::string> Inputs;
+    // Textures referenced by the materials, through .mtl files or glTF images
+    std::vector<std::string> Textures;
+};
+
+/*
+    If input is a directory, finds every mesh (.obj, .gltf, .glb) below it. Otherwise input is a manifest: a text
+    file listing one source per line, relative to the manifest, with blank lines and lines starting with '#'
+    skipped. Sets root to the directory sources are relative to. Returns false if input can't be read.
+*/
+bool GatherCookSources(const std::string& input, std::string& root, std::vector<std::string>& sources);
+// Paths are relative to root. Missing .mtl files and textures are left for the cook to report.
+AssetDependencies FindAssetDependencies(const std::string& root, const std::string& source);
+
+std::vector<CookReportEntry> CookAssets(const CookOptions& options);
+void PrintCookReport(std::ostream& output, const std::vector<CookReportEntry>& report, const double total_seconds);
+
+#endif //!CONTENT_COOKER_ASSET_COOKER_HPP
@@ -0,0 +1,179 @@
+#include "JobGraph.hpp"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+size_t JobGraph::AddJob(std::function<void()> job) {
+    jobs.emplace_back();
+    jobs.back().Fn = std::move(job);
+    return jobs.size() - 1;
+}
+
+void JobGraph::AddDependency(const size_t job, const size_t dependency) {
+    if ((job >= jobs.size()) || (dependency >= job)) {
+        throw std::invalid_argument("Jobs can only depend on jobs added before them!");
+    }
+    jobs[dependency].Dependents.emplace_back(job);
+    ++jobs[job].NumDependencies;
+}
+
+void JobGraph::Run(const size_t num_threads) {
+    std::mutex mutex;
+    std::condition_variable job_ready;
+    std::deque<size_t> ready;
+    std::vector<size_t> remaining(jobs.size());
+    std::vector<bool> blocked(jobs.size(), false);
+    size_t num_finished = 0;
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        remaining[i] = jobs[i].NumDependencies;
+        if (remaining[i] == 0) {
+            ready.emplace_back(i);
+        }
+    }
+
+    // Called with the mutex held once a job is done: skipping a job counts as finishing it, so its dependents
+    // are released (and skipped in turn) here too
+    auto finish = [&](const size_t finished_job) {
+        std::vector<size_t> finished{ finished_job };
+        while (!finished.empty()) {
+            const size_t job = finished.back();
+            finished.pop_back();
+            ++num_finished;
+            const bool succeeded = (jobs[job].State == Status::Succeeded);
+            for (const size_t dependent : jobs[job].Dependents) {
+                blocked[dependent] = blocked[dependent] || !succeeded;
+                if (--remaining[dependent] != 0) {
+                    continue;
+                }
+                if (blocked[dependent]) {
+                    jobs[dependent].State = Status::Skipped;
+                    finished.emplace_back(dependent);
+                }
+                else {
+                    ready.emplace_back(dependent);
+                }
+            }
+        }
+        job_ready.notify_all();
+    };
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            job_ready.wait(lock, [&]() { return !ready.empty() || (num_finished == jobs.size()); });
+            if (ready.empty()) {
+                return;
+            }
+
+            const size_t job = ready.front();
+            ready.pop_front();
+            lock.unlock();
+
+            Status status = Status::Succeeded;
+            std::string error;
+            try {
+                if (jobs[job].Fn) {
+                    jobs[job].Fn();
+                }
+            }
+            catch (const std::exception& e) {
+                status = Status::Failed;
+                error = e.what();
+            }
+            catch (...) {
+                status = Status::Failed;
+                error = "Unknown exception";
+            }
+
+            lock.lock();
+            jobs[job].State = status;
+            jobs[job].Error = std::move(error);
+            finish(job);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(std::max<size_t>(num_threads, 1), std::max<size_t>(jobs.size(), 1)); ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+JobGraph::Status JobGraph::JobStatus(const size_t job) const {
+    return jobs.at(job).State;
+}
+
+const std::string& JobGraph::JobError(const size_t job) const {
+    return jobs.at(job).Error;
+}
+
+size_t JobGraph::NumJobs() const noexcept {
+    return jobs.size();
+}
+
+#ifdef VPSK_TESTING_ENABLED
+#include <atomic>
+
+TEST_SUITE("JobGraph") {
+    TEST_CASE("RunsJobsAfterTheirDependencies") {
+        JobGraph graph;
+        std::atomic<int> counter{ 0 };
+        std::vector<int> order(64, -1);
+        std::vector<size_t> ids;
+        for (size_t i = 0; i < order.size(); ++i) {
+            ids.emplace_back(graph.AddJob([&, i]() { order[i] = counter++; }));
+            // A binary tree: every job depends on its parent
+            if (i != 0) {
+                graph.AddDependency(ids[i], ids[(i - 1) / 2]);
+            }
+        }
+        graph.Run(4);
+
+        for (size_t i = 1; i < order.size(); ++i) {
+            CHECK(graph.JobStatus(ids[i]) == JobGraph::Status::Succeeded);
+            CHECK(order[i] > order[(i - 1) / 2]);
+        }
+    }
+
+    TEST_CASE("SkipsDependentsOfFailedJobs") {
+        JobGraph graph;
+        bool ran_dependent = false;
+        const size_t failing = graph.AddJob([]() { throw std::runtime_error("no such file"); });
+        const size_t independent = graph.AddJob([]() {});
+        const size_t dependent = graph.AddJob([&]() { ran_dependent = true; });
+        const size_t indirect = graph.AddJob([&]() { ran_dependent = true; });
+        graph.AddDependency(dependent, failing);
+        graph.AddDependency(dependent, independent);
+        graph.AddDependency(indirect, dependent);
+        graph.Run(2);
+
+        CHECK(graph.JobStatus(failing) == JobGraph::Status::Failed);
+        CHECK(graph.JobError(failing) == "no such file");
+        CHECK(graph.JobStatus(independent) == JobGraph::Status::Succeeded);
+        CHECK(graph.JobStatus(dependent) == JobGraph::Status::Skipped);
+        CHECK(graph.JobStatus(indirect) == JobGraph::Status::Skipped);
+        CHECK(!ran_dependent);
+    }
+
+    TEST_CASE("RejectsForwardDependencies") {
+        JobGraph graph;
+        const size_t first = graph.AddJob([]() {});
+        const size_t second = graph.AddJob([]() {});
+        CHECK_THROWS(graph.AddDependency(first, second));
+        CHECK_THROWS(graph.AddDependency(second, second));
+        graph.Run(1);
+        CHECK(graph.JobStatus(second) == JobGraph::Status::Succeeded);
+    }
+}
+
+#endif //!VPSK_TESTING_ENABLED
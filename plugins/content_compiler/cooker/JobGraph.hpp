@@ -0,0 +1,48 @@
+#pragma once
+#ifndef CONTENT_COOKER_JOB_GRAPH_HPP
+#define CONTENT_COOKER_JOB_GRAPH_HPP
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+    Runs jobs on a pool of threads, each as soon as all of its dependencies have finished. A job that throws
+    fails, and everything depending on it (directly or not) is skipped instead of run. Dependencies can only
+    point at jobs added earlier, so the graph can't have cycles.
+*/
+class JobGraph {
+public:
+
+    enum class Status {
+        Pending,
+        Succeeded,
+        Failed,
+        Skipped
+    };
+
+    size_t AddJob(std::function<void()> job);
+    // job won't start until dependency has succeeded
+    void AddDependency(const size_t job, const size_t dependency);
+    // Blocks until every job has finished or been skipped
+    void Run(const size_t num_threads);
+
+    Status JobStatus(const size_t job) const;
+    // What the job threw, if it failed
+    const std::string& JobError(const size_t job) const;
+    size_t NumJobs() const noexcept;
+
+private:
+
+    struct job_t {
+        std::function<void()> Fn;
+        std::vector<size_t> Dependents;
+        size_t NumDependencies{ 0 };
+        Status State{ Status::Pending };
+        std::string Error;
+    };
+
+    std::vector<job_t> jobs;
+};
+
+#endif //!CONTENT_COOKER_JOB_GRAPH_HPP
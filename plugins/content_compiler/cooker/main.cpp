@@ -0,0 +1,87 @@
+#include "AssetCooker.hpp"
+#include "easylogging++.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+INITIALIZE_EASYLOGGINGPP
+
+static void PrintUsage() {
+    std::cerr <<
+        "Usage: content_cooker <directory|manifest> -o <output directory> [options]\n"
+        "Compiles every mesh below a directory (or listed in a manifest, one per line) into mesh files,\n"
+        "copying the textures their materials use. Only outputs whose inputs changed are rebuilt.\n"
+        "  -o, --output <dir>   Where cooked files are written, mirroring the input layout\n"
+        "  -j, --threads <n>    Jobs to run at once (default: one per hardware thread)\n"
+        "  -f, --force          Rebuild everything\n"
+        "  --interleaved        Interleave vertex attributes\n"
+        "  --fp16               Store positions and UVs as half floats\n"
+        "  --no-optimize        Skip vertex cache, overdraw and fetch optimization\n"
+        "  --no-meshlets        Don't build meshlets\n"
+        "  --lods <n>           Simplified levels of detail per part (default: 3)\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string input;
+    CookOptions options;
+    options.NumThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = (i + 1 < argc);
+        if (((arg == "-o") || (arg == "--output")) && has_value) {
+            options.OutputDirectory = argv[++i];
+        }
+        else if (((arg == "-j") || (arg == "--threads")) && has_value) {
+            options.NumThreads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if ((arg == "-f") || (arg == "--force")) {
+            options.Force = true;
+        }
+        else if (arg == "--interleaved") {
+            options.Processing.Interleaved = true;
+        }
+        else if (arg == "--fp16") {
+            options.Processing.Use_fp16 = true;
+        }
+        else if (arg == "--no-optimize") {
+            options.Processing.Optimize = false;
+        }
+        else if (arg == "--no-meshlets") {
+            options.Processing.BuildMeshlets = false;
+        }
+        else if ((arg == "--lods") && has_value) {
+            options.Processing.LODCount = static_cast<uint32_t>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (input.empty() && (arg[0] != '-')) {
+            input = arg;
+        }
+        else {
+            std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if (input.empty() || options.OutputDirectory.empty()) {
+        PrintUsage();
+        return 2;
+    }
+
+    if (!GatherCookSources(input, options.InputRoot, options.Sources)) {
+        return 2;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<CookReportEntry> report = CookAssets(options);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    PrintCookReport(std::cout, report, seconds);
+
+    for (const CookReportEntry& entry : report) {
+        if (entry.Status == CookStatus::Failed) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -1,7 +1,13 @@
 #pragma once
 #ifndef CONTENT_COMPILER_ASSIMP_MESH_LOADER_HPP
 #define CONTENT_COMPILER_ASSIMP_MESH_LOADER_HPP
+#include <cstdint>
+
+// Written to MeshDataHeader::Version: cached mesh files from other loader versions are re-imported
+constexpr static const uint32_t LOADER_VERSION = 0x00000005;
 
 struct MeshData* AssimpLoadMeshData(const char* fname, MeshProcessingOptions* options);
+// Converts an already imported (triangulated, tangent space generated) scene
+struct MeshData* AssimpConvertScene(const struct aiScene* scene, MeshProcessingOptions* options);
 
 #endif //!CONTENT_COMPILER_ASSIMP_MESH_LOADER_HPP
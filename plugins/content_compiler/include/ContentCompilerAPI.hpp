@@ -11,6 +11,7 @@
 constexpr static unsigned int ASSET_PIPELINE_PLUGIN_API_ID = 0x3e25cf4c;
 
 struct MeshProcessingOptions;
+struct MaterialParameters;
 
 struct ContentCompiler_API {
     // Blocking load
@@ -21,6 +22,20 @@ struct ContentCompiler_API {
     // Generated mesh data will use uninterleaved format
     void (*AsyncLoadMeshFromFileAssimp)(const char* fname, bool interleaved, void* requester, mesh_loaded_signal_t signal, MeshProcessingOptions* opts);
     void (*DestroyMeshData)(struct MeshData* data);
+    // Loads fname from the mesh cache when an entry for its contents and these options exists, without importing it.
+    // Otherwise imports fname (through LoadMeshFromFileObj for .obj files, Assimp for the rest) and adds it to the cache.
+    struct MeshData* (*LoadMeshFromFileCached)(const char* fname, MeshProcessingOptions* options);
+    // Memory-maps a mesh file written by WriteMeshToFile: returns nullptr if it is missing or invalid
+    struct MeshData* (*LoadMeshFromMeshFile)(const char* fname);
+    bool (*WriteMeshToFile)(const char* fname, const struct MeshData* data);
+    // Blocking load of a Wavefront OBJ file, parsed in parallel without going through Assimp
+    struct MeshData* (*LoadMeshFromFileObj)(const char* fname, MeshProcessingOptions* options);
+    // Where LoadMeshFromFileCached (and async loads) keep imported meshes: "MeshCache" in the working directory by default.
+    // Can be shared between processes. Set it before loading anything.
+    void (*SetMeshCacheDirectory)(const char* directory);
+    // Packs materials into per shading model buckets, ready to upload as one buffer per model (see MaterialEncoding.hpp)
+    struct EncodedMaterials* (*EncodeMaterials)(const MaterialParameters* materials, const unsigned int count);
+    void (*DestroyEncodedMaterials)(struct EncodedMaterials* materials);
 };
 
 #endif //!CONTENT_COMPILER_API_HPP
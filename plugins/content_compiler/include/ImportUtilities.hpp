@@ -0,0 +1,81 @@
+#pragma once
+#ifndef ASSET_PIPELINE_IMPORT_UTILITIES_HPP
+#define ASSET_PIPELINE_IMPORT_UTILITIES_HPP
+#include "MeshData.hpp"
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+// Read-only view of a whole file. Handles are only used on Windows.
+struct MappedFile {
+    const char* Data{ nullptr };
+    uint64_t Size{ 0 };
+    void* File{ nullptr };
+    void* Mapping{ nullptr };
+};
+
+// Returns nullptr if the file is missing, empty or can't be mapped
+MappedFile* MapFile(const char* fname);
+void UnmapFile(MappedFile* file);
+
+// Threads pull chunks off a shared counter, so uneven chunk costs balance out
+template<typename Fn>
+void ForEachChunk(const size_t num_chunks, Fn&& fn) {
+    const size_t num_threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), num_chunks);
+    std::atomic<size_t> next_chunk{ 0 };
+    auto worker = [&]() {
+        for (size_t i = next_chunk++; i < num_chunks; i = next_chunk++) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(num_threads > 0 ? num_threads - 1 : 0);
+    for (size_t i = 1; i < num_threads; ++i) {
+        futures.emplace_back(std::async(std::launch::async, worker));
+    }
+    worker();
+
+    for (auto& future : futures) {
+        future.get();
+    }
+}
+
+// Where to write each unquantized attribute of vertex i: base pointer plus i * stride. UV1s is tightly packed, or nullptr.
+struct VertexStreams {
+    fvec4* Positions{ nullptr };
+    size_t PositionStride{ 0 };
+    int16_t* Tangents{ nullptr };
+    size_t TangentStride{ 0 };
+    fvec2* UV0s{ nullptr };
+    size_t UV0Stride{ 0 };
+    fvec2* UV1s{ nullptr };
+};
+
+/*
+    Fills in the header and allocates parts, materials (zeroed), vertices and indices at their final size, in the
+    unquantized layout the options ask for. 16-bit indices are used when allowed and every vertex fits. Bounds,
+    part ranges, material names and the data itself are left to the importer.
+*/
+MeshData* CreateMeshData(const uint32_t num_parts, const uint32_t num_materials, const size_t num_vertices, const size_t num_indices,
+    const bool has_uv1, const MeshProcessingOptions* options);
+VertexStreams GetVertexStreams(MeshData* mesh) noexcept;
+
+/*
+    Packs a tangent frame into four snorm16 quaternion components, with the handedness of the bitangent in the
+    sign: decoded, bitangent = cross(tangent, normal) * sign(w). Vectors are xyz triples, and need not be unit length.
+*/
+void PackTangentFrame(const float* tangent, const float* bitangent, const float* normal, int16_t* dst) noexcept;
+// Packs count frames from tightly packed arrays of xyz triples, writing them dst_stride bytes apart
+void PackTangentFrames(const float* tangents, const float* bitangents, const float* normals, const size_t count, int16_t* dst, const size_t dst_stride) noexcept;
+
+// Imports fname with the importer for its extension: LoadMeshDataFromObj for .obj files, Assimp for everything else
+MeshData* ImportMeshData(const char* fname, MeshProcessingOptions* options);
+
+// Runs the stages every importer finishes with, as configured by options: optimization, LOD generation,
+// quantization and meshlet building
+void RunMeshProcessingStages(MeshData* mesh, const MeshProcessingOptions* options);
+
+#endif //!ASSET_PIPELINE_IMPORT_UTILITIES_HPP
@@ -0,0 +1,105 @@
+#pragma once
+#ifndef ASSET_PIPELINE_MATERIAL_ENCODING_HPP
+#define ASSET_PIPELINE_MATERIAL_ENCODING_HPP
+#include "MaterialParameters.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/*
+    Compact, per shading model encodings of MaterialParameters for GPU material buffers. Each model only stores
+    the parameters it shades with, packed into 16 or 32 bytes (from 132 for MaterialParameters), so every layout
+    is a whole number of vec4s for std430 buffers. Field encodings, decodable with GLSL's unpack functions:
+    - Colors are unorm8x4, x in the lowest byte: rgb is sRGB encoded (as textures are), alpha is linear
+    - Emissive and subsurface power are fp16, as they aren't limited to [0, 1]
+    - Scalar factors are unorm8, anisotropy snorm8, all clamped to their range first
+    - Directions are octahedral encoded unit vectors, snorm16x2 with x in the low half
+    Unused bytes are zero.
+*/
+
+constexpr static uint32_t NumShadingModels = 5;
+
+struct PackedUnlitMaterial {
+    uint32_t BaseColor;
+    uint16_t Emissive[4];
+    uint32_t Padding;
+};
+
+struct PackedLitMaterial {
+    uint32_t BaseColor;
+    uint16_t Emissive[4];
+    // roughness, metallic, reflectance, ambientOcclusion
+    uint32_t RoughnessMetallicReflectanceAO;
+    // clearCoat and clearCoatRoughness as unorm8, anisotropy as snorm8
+    uint32_t ClearCoatAnisotropy;
+    uint32_t AnisotropyDirection;
+    uint32_t Normal;
+    uint32_t Padding;
+};
+
+struct PackedSubsurfaceMaterial {
+    uint32_t BaseColor;
+    uint16_t Emissive[4];
+    uint32_t RoughnessMetallicReflectanceAO;
+    // subsurfaceColor, with thickness in alpha
+    uint32_t SubsurfaceColorThickness;
+    uint16_t SubsurfacePower;
+    uint16_t Padding0;
+    uint32_t Normal;
+    uint32_t Padding1;
+};
+
+struct PackedClothMaterial {
+    uint32_t BaseColor;
+    uint16_t Emissive[4];
+    // metallic is always stored as zero
+    uint32_t RoughnessMetallicReflectanceAO;
+    uint32_t SheenColor;
+    uint32_t SubsurfaceColor;
+    uint32_t Normal;
+    uint32_t Padding;
+};
+
+static_assert(sizeof(PackedUnlitMaterial) == 16, "Packed materials must be whole vec4s");
+static_assert(sizeof(PackedLitMaterial) == 32, "Packed materials must be whole vec4s");
+static_assert(sizeof(PackedSubsurfaceMaterial) == 32, "Packed materials must be whole vec4s");
+static_assert(sizeof(PackedClothMaterial) == 32, "Packed materials must be whole vec4s");
+
+// Handles address a material by bucket and slot: model in the top 8 bits, slot within the bucket below
+constexpr static uint32_t MaterialHandleSlotBits = 24;
+constexpr static uint32_t MaterialHandleSlotMask = (1u << MaterialHandleSlotBits) - 1u;
+
+inline shading_model MaterialHandleModel(const uint32_t handle) noexcept {
+    return static_cast<shading_model>(handle >> MaterialHandleSlotBits);
+}
+
+inline uint32_t MaterialHandleSlot(const uint32_t handle) noexcept {
+    return handle & MaterialHandleSlotMask;
+}
+
+// Packed materials of one shading model, in the order they were given in
+struct MaterialBucket {
+    // Size of one packed material, 0 for the Invalid bucket (which is always empty)
+    uint32_t Stride{ 0 };
+    uint32_t Count{ 0 };
+    // Count * Stride bytes, ready to upload
+    void* Data{ nullptr };
+    // Index into the encoded array of each packed material
+    uint32_t* SourceIndices{ nullptr };
+};
+
+struct EncodedMaterials {
+    static void DestroyEncodedMaterials(EncodedMaterials* materials);
+    // Indexed by shading_model
+    MaterialBucket Buckets[NumShadingModels];
+    uint32_t NumMaterials{ 0 };
+    // Handle of each encoded material, in the order given
+    uint32_t* Handles{ nullptr };
+};
+
+uint32_t PackedMaterialSize(const shading_model model) noexcept;
+// Invalid models are encoded as Lit, with a warning. Returns nullptr if a bucket would overflow the handle slot bits.
+EncodedMaterials* EncodeMaterials(const MaterialParameters* materials, const uint32_t count);
+// Parameters a model doesn't store come back as their defaults
+MaterialParameters DecodeMaterial(const EncodedMaterials* materials, const uint32_t handle);
+
+#endif //!ASSET_PIPELINE_MATERIAL_ENCODING_HPP
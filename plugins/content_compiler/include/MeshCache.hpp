@@ -0,0 +1,32 @@
+#pragma once
+#ifndef ASSET_PIPELINE_MESH_CACHE_HPP
+#define ASSET_PIPELINE_MESH_CACHE_HPP
+#include "MeshData.hpp"
+
+/*
+    Content-addressed cache of imported meshes. Entries are mesh files named after two hashes: one of the
+    source file's contents, and one of everything else the result depends on (processing options, source
+    extension, LOADER_VERSION and MESH_FILE_VERSION). A changed source or setting just misses the cache, and
+    identical sources share an entry wherever they live. Entries are written to a uniquely named temporary
+    file and renamed into place, so readers only ever see complete files and concurrent writers of the same
+    entry simply replace each other with identical data.
+*/
+
+struct MeshCacheKey {
+    uint64_t Source{ 0 };
+    uint64_t Settings{ 0 };
+};
+
+// XXH64, as specified by the reference xxHash implementation
+uint64_t HashBytes(const void* data, const size_t size, const uint64_t seed = 0) noexcept;
+// Hashes the options field by field, so padding and field order changes can't alias
+uint64_t HashProcessingOptions(const MeshProcessingOptions& options) noexcept;
+// Hashes the contents of source_fname: returns false if it can't be read
+bool ComputeMeshCacheKey(const char* source_fname, const MeshProcessingOptions& options, MeshCacheKey& key);
+
+// Returns nullptr on a miss, or if the entry is unreadable
+MeshData* LoadCachedMesh(const char* cache_directory, const MeshCacheKey& key);
+// Creates cache_directory (but not its parents) if needed
+bool StoreCachedMesh(const char* cache_directory, const MeshCacheKey& key, const MeshData* mesh);
+
+#endif //!ASSET_PIPELINE_MESH_CACHE_HPP
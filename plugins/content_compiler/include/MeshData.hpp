@@ -1,12 +1,36 @@
 #pragma once
 #ifndef ASSET_PIPELINE_MESH_DATA_HPP
 #define ASSET_PIPELINE_MESH_DATA_HPP
+#include <cstddef>
 #include <cstdint>
 
+enum class VertexQuantization : uint32_t {
+    // 32-bit floats
+    None = 0,
+    Float16 = 1,
+    // Positions relative to the mesh bounds in the header, UVs in [0, 1] (falls back to Float16 for UVs outside it)
+    Unorm16 = 2
+};
+
 struct MeshProcessingOptions {
     bool Interleaved;
+    // Shorthand for Float16 positions and UVs, when those aren't set explicitly
     bool Use_fp16;
     bool AllowInt16_Indices;
+    // Reorder indices and vertices of each part for the vertex cache, overdraw and vertex fetch
+    bool Optimize{ true };
+    // How much worse (as a factor of ACMR) cache efficiency may get to reduce overdraw
+    float OverdrawThreshold{ 1.05f };
+    VertexQuantization PositionQuantization{ VertexQuantization::None };
+    VertexQuantization UVQuantization{ VertexQuantization::None };
+    // Split parts into meshlets with bounds for cluster culling
+    bool BuildMeshlets{ true };
+    // Simplified levels of detail to generate for each part (at most MaxPartLODs), each aiming for
+    // LODTargetRatio of the triangles of the level before it
+    uint32_t LODCount{ 3 };
+    float LODTargetRatio{ 0.5f };
+    // Simplification stops before the error exceeds this fraction of the mesh's largest half extent
+    float LODMaxError{ 0.02f };
 };
 
 struct MeshDataHeader {
@@ -34,6 +58,9 @@ struct MeshDataHeader {
     uint32_t IndexFormat{ 0xffffffff };
     uint32_t IndexCount{ 0xffffffff };
     uint32_t IndexDataSize{ 0xffffffff };
+    uint32_t NumMeshlets{ 0 };
+    // LODCount the mesh was imported with: parts can have fewer levels if simplification hit the error limit
+    uint32_t LODLevels{ 0 };
 };
 
 struct fvec2 {
@@ -95,19 +122,29 @@ private:
 };
 
 struct Vertex {
-    // data using this type is encoded as 
-    // half-precision floats
+    // Layout of unquantized interleaved vertices: quantized meshes use
+    // the offsets, strides and formats given in the header instead
     fvec4 position;
     int16_t tangents[4];
     fvec2 uv0;
 };
 
+// Element formats of the streams are given by the header: fvec4 positions and fvec2 UVs when unquantized
 struct UninterleavedVertexData {
-    fvec4* Positions{ nullptr };
+    void* Positions{ nullptr };
     int16_t* Tangents{ nullptr };
     uint8_t* Colors{ nullptr };
-    fvec2* UV0s{ nullptr };
-    fvec2* UV1s{ nullptr };
+    void* UV0s{ nullptr };
+    void* UV1s{ nullptr };
+};
+
+constexpr static uint32_t MaxPartLODs = 4;
+
+struct PartLODData {
+    uint32_t IndexOffset{ 0xffffffff };
+    uint32_t IndexCount{ 0xffffffff };
+    // Estimated distance (in mesh units) between this level's surface and the full detail part
+    float Error{ 0.0f };
 };
 
 struct PartData {
@@ -118,6 +155,25 @@ struct PartData {
     uint32_t MaterialID{ 0xffffffff };
     float Center[3]{ 0.0f, 0.0f, 0.0f };
     float HalfExtent[3]{ 0.0f, 0.0f, 0.0f };
+    // Range of this part's full detail meshlets in MeshData::Meshlets, empty if meshlets weren't built
+    uint32_t MeshletOffset{ 0 };
+    uint32_t MeshletCount{ 0 };
+    // Simplified levels, coarsest last. They use the part's vertices, and their indices follow those of every part.
+    uint32_t NumLODs{ 0 };
+    PartLODData LODs[MaxPartLODs]{};
+};
+
+// A run of up to 128 triangles of one part, contiguous in the index buffer and using at most 64 unique vertices
+struct MeshletData {
+    uint32_t IndexOffset{ 0xffffffff };
+    uint32_t IndexCount{ 0xffffffff };
+    float Center[3]{ 0.0f, 0.0f, 0.0f };
+    float Radius{ 0.0f };
+    // All triangles face away from a camera at P if dot(normalize(ConeApex - P), ConeAxis) >= ConeCutoff.
+    // Cones too wide to ever cull have a zero axis and a cutoff of 1.
+    float ConeApex[3]{ 0.0f, 0.0f, 0.0f };
+    float ConeAxis[3]{ 0.0f, 0.0f, 0.0f };
+    float ConeCutoff{ 1.0f };
 };
 
 struct MaterialInfo {
@@ -130,9 +186,14 @@ struct MeshData {
     MeshDataHeader Header{ };
     PartData* Parts{ nullptr };
     MaterialInfo* Materials{ nullptr };
-    // Either an array of Vertex structures, or a poitner to "UninterleavedVertexData"
+    // Either VertexDataSize bytes of interleaved vertices, or a pointer to "UninterleavedVertexData".
+    // Vertex and stream storage is allocated as arrays of bytes.
     void* Vertices{ nullptr };
     void* Indices{ nullptr };
+    // NumMeshlets entries, referenced by the parts, or nullptr
+    MeshletData* Meshlets{ nullptr };
+    // Set when loaded from a mesh file: parts, meshlets, material names, vertices and indices then point into the mapping
+    void* FileMapping{ nullptr };
 };
 
 #endif //!ASSET_PIPELINE_MESH_DATA_HPP
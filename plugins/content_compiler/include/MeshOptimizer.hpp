@@ -0,0 +1,42 @@
+#pragma once
+#ifndef ASSET_PIPELINE_MESH_OPTIMIZER_HPP
+#define ASSET_PIPELINE_MESH_OPTIMIZER_HPP
+#include "MeshData.hpp"
+#include <vector>
+
+/*
+    Optimization of index and vertex order, in the style of meshoptimizer:
+    - Triangles are reordered for post-transform vertex cache hits using Tipsify (Sander et al. 2007)
+    - The cache-ordered triangles are split into clusters, which are sorted so outward facing clusters are drawn
+      first, reducing overdraw. Clusters only split where doing so costs at most OverdrawThreshold times the
+      cluster's cache efficiency.
+    - Vertices are reordered in order of first use, so vertex fetch walks memory linearly
+    Statistics are measured against a FIFO cache of VertexCacheSize entries.
+*/
+
+constexpr static uint32_t VertexCacheSize = 16;
+
+struct VertexCacheStats {
+    // Average cache miss ratio: transformed vertices per triangle. 0.5 is ideal for large regular meshes, 3 is worst case.
+    float ACMR{ 0.0f };
+    // Average transform to vertex ratio: transformed vertices per unique vertex. 1 is ideal.
+    float ATVR{ 0.0f };
+};
+
+struct PartOptimizationStats {
+    VertexCacheStats Before;
+    VertexCacheStats After;
+};
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, const size_t index_count, const size_t vertex_count, const uint32_t cache_size = VertexCacheSize);
+void OptimizeVertexCache(uint32_t* dst, const uint32_t* indices, const size_t index_count, const size_t vertex_count, const uint32_t cache_size = VertexCacheSize);
+// Indices must already be in vertex cache order. Only xyz of the positions are read.
+void OptimizeOverdraw(uint32_t* dst, const uint32_t* indices, const size_t index_count, const fvec4* positions, const size_t positions_stride,
+    const size_t vertex_count, const float threshold, const uint32_t cache_size = VertexCacheSize);
+// Fills remap (of size vertex_count) so remap[old] = new, numbering vertices in order of first use. Unused vertices go last.
+void OptimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, const size_t index_count, const size_t vertex_count);
+
+// Runs all stages on each part of the mesh in place, logging and returning cache statistics per part
+std::vector<PartOptimizationStats> OptimizeMeshData(MeshData* mesh, const float overdraw_threshold);
+
+#endif //!ASSET_PIPELINE_MESH_OPTIMIZER_HPP
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef ASSET_PIPELINE_MESH_QUANTIZATION_HPP
+#define ASSET_PIPELINE_MESH_QUANTIZATION_HPP
+#include "MeshData.hpp"
+#include <vector>
+
+struct PartQuantizationError {
+    // Largest per-axis difference between a source value and its quantized value, over the part's vertices
+    float Position{ 0.0f };
+    float UV{ 0.0f };
+};
+
+// Round to nearest even. Out of range values become infinities, NaNs stay NaNs.
+uint16_t FloatToHalf(const float value) noexcept;
+float HalfToFloat(const uint16_t value) noexcept;
+
+// Vulkan formats used for each quantization mode
+uint32_t QuantizedPositionFormat(const VertexQuantization quantization) noexcept;
+uint32_t QuantizedUVFormat(const VertexQuantization quantization) noexcept;
+// Applies Use_fp16 to whichever of the explicit quantization settings are left at None
+void ResolveQuantization(const MeshProcessingOptions& options, VertexQuantization& positions, VertexQuantization& uvs) noexcept;
+
+/*
+    Rewrites the vertex streams of an unquantized mesh in the requested formats, updating attribute offsets,
+    strides, formats and VertexDataSize in the header. Tangents are already snorm16 quaternions and are kept.
+    Positions keep a w component (1.0), as three-component 16-bit formats are poorly supported for vertex input.
+    Unorm16 positions are relative to the bounds in the header: position = Center + (2 * q - 1) * HalfExtent.
+    Unorm16 UV streams with values outside of [0, 1] are stored as Float16 instead.
+*/
+std::vector<PartQuantizationError> QuantizeMeshData(MeshData* mesh, const VertexQuantization positions, const VertexQuantization uvs);
+// Positions of all vertices as floats with w = 1, whichever of the supported formats they are stored in
+std::vector<fvec4> DecodePositions(const MeshData* mesh);
+
+#endif //!ASSET_PIPELINE_MESH_QUANTIZATION_HPP
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef ASSET_PIPELINE_MESH_SERIALIZATION_HPP
+#define ASSET_PIPELINE_MESH_SERIALIZATION_HPP
+#include "MeshData.hpp"
+
+constexpr static uint32_t MESH_FILE_VERSION = 0x00000003;
+// Every section starts on this boundary, relative to the start of the file
+constexpr static uint32_t MESH_FILE_ALIGNMENT = 64;
+
+/*
+    On-disk layout of a mesh file, in order:
+    - MeshFileHeader
+    - NumParts PartData structures
+    - NumMeshlets MeshletData structures (optional: the section is absent and its offset zero if NumMeshlets is zero)
+    - NumMaterials MeshFileMaterial records, followed by the material name blob
+    - Vertex data, laid out exactly as described by the attribute offsets and strides in MeshDataHeader
+    - Index data, of the format given by MeshDataHeader::IndexFormat
+    Each section is aligned to MESH_FILE_ALIGNMENT and padded with zeroes. Data is written in native byte order.
+*/
+struct MeshFileHeader {
+    MeshDataHeader Header{};
+    uint32_t FileVersion{ MESH_FILE_VERSION };
+    uint32_t Alignment{ MESH_FILE_ALIGNMENT };
+    uint64_t FileSize{ 0 };
+    uint64_t PartsOffset{ 0 };
+    uint64_t MeshletsOffset{ 0 };
+    uint64_t MaterialsOffset{ 0 };
+    uint64_t MaterialNamesOffset{ 0 };
+    uint64_t MaterialNamesSize{ 0 };
+    uint64_t VerticesOffset{ 0 };
+    uint64_t IndicesOffset{ 0 };
+};
+
+struct MeshFileMaterial {
+    // Relative to MaterialNamesOffset. Names are stored null-terminated.
+    uint32_t NameOffset{ 0 };
+    uint32_t NameLength{ 0 };
+};
+
+// Size of the vertex data described by the header, whether interleaved or not
+uint64_t MeshVertexDataSize(const MeshDataHeader& header) noexcept;
+uint64_t MeshIndexDataSize(const MeshDataHeader& header) noexcept;
+
+bool WriteMeshDataFile(const char* fname, const MeshData* mesh);
+// Writes to a temporary file unique to this process and thread, then renames it over fname, so readers never see a
+// partial file. Fails if fname can't be replaced (e.g. while it's mapped, on Windows).
+bool WriteMeshDataFileAtomic(const char* fname, const MeshData* mesh);
+/*
+    Memory-maps the file and returns a MeshData whose parts, meshlets, material names, vertices and indices point
+    straight into the (read-only) mapping: only the small material and uninterleaved stream pointer tables
+    are allocated. Vertex and index data can be copied to staging as-is. Returns nullptr if the file is
+    missing, truncated or was written with a different file version.
+*/
+MeshData* LoadMeshDataFile(const char* fname);
+// Called by MeshData::DestroyMeshData for meshes loaded by LoadMeshDataFile
+void UnmapMeshDataFile(void* file_mapping);
+
+#endif //!ASSET_PIPELINE_MESH_SERIALIZATION_HPP
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef ASSET_PIPELINE_MESH_SIMPLIFIER_HPP
+#define ASSET_PIPELINE_MESH_SIMPLIFIER_HPP
+#include "MeshData.hpp"
+#include <vector>
+
+/*
+    Level of detail generation by edge collapse, using quadric error metrics (Garland and Heckbert 1997).
+    Edges collapse onto one of their existing vertices, so simplified levels index into the original vertex
+    buffer and need no new vertex data. Vertices on UV seams and other attribute borders (several vertices at
+    one position), and on open or non-manifold edges (including borders between parts), are never moved.
+    Collapses are applied in passes, cheapest first, skipping any that would flip a triangle.
+*/
+
+/*
+    Writes at most index_count indices to dst and returns how many were written. Stops at target_index_count,
+    or before a collapse would exceed max_error (in the units of the positions). The error of the result is
+    written to result_error if given.
+*/
+size_t SimplifyIndices(uint32_t* dst, const uint32_t* indices, const size_t index_count, const fvec4* positions, const size_t vertex_count,
+    const size_t target_index_count, const float max_error, float* result_error = nullptr);
+
+/*
+    Generates up to lod_count levels for each part, appending their indices to the index buffer. Each level is
+    simplified from the full detail part and cache optimized. Vertex order must be final, so run this after
+    OptimizeMeshData. max_error is relative to the largest half extent of the mesh.
+*/
+void GeneratePartLODs(MeshData* mesh, const uint32_t lod_count, const float target_ratio, const float max_error);
+
+/*
+    Picks the coarsest level whose error projects to at most max_pixel_error pixels at the given distance.
+    pixels_per_unit is the projection scale at unit distance: viewport_height / (2 * tan(fov_y / 2)).
+    Returns 0 for the full detail part, or N for PartData::LODs[N - 1].
+*/
+inline uint32_t SelectPartLOD(const PartData& part, const float distance, const float pixels_per_unit, const float max_pixel_error) noexcept {
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < part.NumLODs; ++i) {
+        if (part.LODs[i].Error * pixels_per_unit > max_pixel_error * distance) {
+            break;
+        }
+        result = i + 1;
+    }
+    return result;
+}
+
+#endif //!ASSET_PIPELINE_MESH_SIMPLIFIER_HPP
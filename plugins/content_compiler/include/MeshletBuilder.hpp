@@ -0,0 +1,33 @@
+#pragma once
+#ifndef ASSET_PIPELINE_MESHLET_BUILDER_HPP
+#define ASSET_PIPELINE_MESHLET_BUILDER_HPP
+#include "MeshData.hpp"
+#include <vector>
+
+/*
+    Splits parts into meshlets by walking their triangles in index buffer order, starting a new meshlet when
+    adding a triangle would exceed either limit. Run after vertex cache optimization, this order keeps meshlets
+    spatially compact and leaves the index buffer untouched, so a meshlet is drawn as a plain indexed range.
+    Bounds are computed from the positions as stored (i.e. after quantization) so they stay conservative.
+    Front faces wind counter-clockwise.
+*/
+
+constexpr static uint32_t MeshletMaxVertices = 64;
+constexpr static uint32_t MeshletMaxTriangles = 128;
+
+// Appends the meshlets of a run of triangles starting index_offset indices into the mesh's index buffer. indices
+// points at the start of the run and positions must hold every vertex it references.
+void BuildMeshlets(std::vector<MeshletData>& meshlets, const uint32_t* indices, const uint32_t index_offset, const uint32_t index_count,
+    const fvec4* positions);
+// Builds meshlets for all parts, replacing any the mesh already has
+void BuildMeshletData(MeshData* mesh);
+
+inline bool MeshletBackfacing(const MeshletData& meshlet, const float camera_position[3]) noexcept {
+    const float view[3]{ meshlet.ConeApex[0] - camera_position[0], meshlet.ConeApex[1] - camera_position[1], meshlet.ConeApex[2] - camera_position[2] };
+    const float view_dot_axis = view[0] * meshlet.ConeAxis[0] + view[1] * meshlet.ConeAxis[1] + view[2] * meshlet.ConeAxis[2];
+    const float view_length_sq = view[0] * view[0] + view[1] * view[1] + view[2] * view[2];
+    // dot(normalize(view), axis) >= cutoff, without the square root. Cutoff is never negative.
+    return (view_dot_axis > 0.0f) && (view_dot_axis * view_dot_axis >= meshlet.ConeCutoff * meshlet.ConeCutoff * view_length_sq);
+}
+
+#endif //!ASSET_PIPELINE_MESHLET_BUILDER_HPP
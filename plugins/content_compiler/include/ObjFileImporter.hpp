@@ -0,0 +1,14 @@
+#pragma once
+#ifndef ASSET_PIPELINE_OBJ_FILE_IMPORTER_HPP
+#define ASSET_PIPELINE_OBJ_FILE_IMPORTER_HPP
+
+/*
+    Imports Wavefront OBJ files without going through Assimp. The file is memory-mapped and parsed in parallel
+    chunks, then each material's triangles become one part, welded into unique vertices. Normals are generated
+    (smooth, area weighted) for faces that don't have any, and tangents are always generated from the UVs.
+    Polygons are triangulated as fans. Only geometry and usemtl statements are read: material libraries,
+    groups, smoothing groups, lines and points are ignored. Returns nullptr if the file can't be opened.
+*/
+struct MeshData* LoadMeshDataFromObj(const char* fname, struct MeshProcessingOptions* options);
+
+#endif //!ASSET_PIPELINE_OBJ_FILE_IMPORTER_HPP
@@ -1,7 +0,0 @@
-#pragma once
-#ifndef ASSET_PIPELINE_OBJ_FILE_IMPORTER_HPP
-#define ASSET_PIPELINE_OBJ_FILE_IMPORTER_HPP
-
-struct MeshData* LoadMeshDataFromObj(const char* fname, bool interleaved);
-
-#endif //!ASSET_PIPELINE_OBJ_FILE_IMPORTER_HPP
\ No newline at end of file
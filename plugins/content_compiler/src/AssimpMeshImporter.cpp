@@ -1,133 +1,66 @@
 #include "MeshData.hpp"
-#include "glm/vec3.hpp"
-#include "glm/vec4.hpp"
-#include "glm/gtc/quaternion.hpp"
-#include "glm/gtc/type_precision.hpp"
+#include "AssimpMeshImporter.hpp"
+#include "ImportUtilities.hpp"
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/cimport.h"
 #include "assimp/scene.h"
 #include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
 #include <vector>
 #include <stdexcept>
 #include <memory>
+#include <thread>
 #include <vulkan/vulkan.h>
 #include <string>
 
-constexpr static const uint32_t LOADER_VERSION = 0x00000002;
+/*
+    Conversion runs in two passes. The first walks the node tree once, validating meshes and assigning each
+    mesh reference its range of the output vertex and index buffers. Once totals are known the outputs are
+    allocated at their final size and format, and the second pass converts meshes in fixed-size chunks on all
+    cores: chunks write straight into disjoint ranges of the outputs, so no locks or intermediate copies are
+    needed, and a single huge mesh is spread over cores just as well as many small ones.
+*/
 
-glm::i16vec4 packSnorm16(glm::vec4 v) noexcept {
-    auto packSnorm16_single = [](float v)->int16_t {
-        return static_cast<int16_t>(std::roundf(glm::clamp(v, -1.0f, 1.0f) * 32767.0f));
-    };
-    return glm::i16vec4{
-        packSnorm16_single(v.x),
-        packSnorm16_single(v.y),
-        packSnorm16_single(v.z),
-        packSnorm16_single(v.w)
-    };
-}
+namespace {
 
-static glm::quat pack_tangent_frame(const glm::mat3& m, size_t storage_size = sizeof(int16_t)) {
+    constexpr uint32_t ConversionChunkSize = 16384;
 
-    glm::quat q = glm::quat_cast(glm::mat3{ m[0], glm::cross(m[2], m[0]), m[2] });
-    q = glm::normalize(q);
-    q = q.w < 0.0f ? -q : q;
-
-    const float bias = 1.0f / static_cast<float>((1 << (storage_size * CHAR_BIT - 1)) - 1);
-    if (q.w < bias) {
-        q.w = bias;
-        const float factor = std::sqrtf(1.0f - bias * bias);
-        q.x *= factor;
-        q.y *= factor;
-        q.z *= factor;
-    }
+    struct mesh_conversion_job_t {
+        const aiMesh* mesh;
+        uint32_t vertexOffset;
+        uint32_t vertexCount;
+        uint32_t indexOffset;
+        uint32_t indexCount;
+    };
 
-    if (glm::dot(glm::cross(m[0], m[2]), m[1]) < 0.0f) {
-        q = -q;
-    }
+    struct scene_layout_t {
+        std::vector<mesh_conversion_job_t> jobs;
+        size_t numVertices{ 0 };
+        size_t numIndices{ 0 };
+        bool hasUV1{ false };
+    };
 
-    return q;
-}
+    // Either a range of a mesh's vertices or a range of its faces
+    struct conversion_chunk_t {
+        uint32_t job;
+        uint32_t begin;
+        uint32_t end;
+        bool faces;
+    };
 
-struct vertex_t {
-    vertex_t(const glm::vec3& p, const glm::quat& _tangents, const glm::vec3& _uv0) : tangents(packSnorm16(glm::vec4(_tangents.x, _tangents.y, _tangents.z, _tangents.w))) {
-        position = fvec4(p.x, p.y, p.z, 1.0f);
-        uv0 = fvec2(_uv0.x, _uv0.y);
-    }
-    fvec4 position;
-    glm::i16vec4 tangents;
-    fvec2 uv0;
-};
-
-struct uninterleaved_data_t {
-    std::vector<decltype(vertex_t::position)> positions;
-    std::vector<decltype(vertex_t::tangents)> tangents;
-    std::vector<decltype(vertex_t::uv0)> uv0s;
-    std::vector<decltype(vertex_t::uv0)> uv1s;
-};
-
-struct imported_aabb {
-    glm::vec3 center;
-    glm::vec3 half_extent;
-    imported_aabb& set(const glm::vec3& min, const glm::vec3& max) {
-        center = (min + max) * 0.5f;
-        half_extent = (max - min) * 0.5f;
-        return *this;
-    }
-    glm::vec3 min() const noexcept {
-        return center - half_extent;
-    }
-    glm::vec3 max() const noexcept {
-        return center + half_extent;
-    }
-};
-
-template<typename VECTOR, typename INDEX>
-static imported_aabb compute_aabb(VECTOR const* positions, INDEX const* indices, const size_t count, const size_t stride) noexcept {
-    glm::vec3 bmin(std::numeric_limits<float>::max());
-    glm::vec3 bmax(std::numeric_limits<float>::lowest());
-    for (size_t i = 0; i < count; ++i) {
-        VECTOR const* p = reinterpret_cast<VECTOR const*>(
-            (char const*)positions + indices[i] * stride
-        );
-        const glm::vec3 v(p->x(), p->y(), p->z());
-        bmin = glm::min(bmin, v);
-        bmax = glm::max(bmax, v);
-    }
-    return imported_aabb{
-        (bmin + bmax) * 0.5f,
-        (bmax - bmin) * 0.5f
+    struct chunk_bounds_t {
+        float min[3];
+        float max[3];
     };
-}
 
-struct SingleMesh {
-    SingleMesh(uint32_t _offset, uint32_t _count, uint32_t min_index, uint32_t max_index, uint32_t _material,
-        imported_aabb _aabb) : offset(_offset), count(_count), minIndex(min_index), maxIndex(max_index),
-        material(_material), aabb(_aabb) {}
-    uint32_t offset;
-    uint32_t count;
-    uint32_t minIndex;
-    uint32_t maxIndex;
-    uint32_t material;
-    imported_aabb aabb;
-};
-
-struct mesh_conversion_job_data_t {
-    std::vector<vertex_t> g_vertices; 
-    std::vector<uint32_t> g_indices;
-    std::vector<SingleMesh> meshes;
-    uninterleaved_data_t g_data;
-    size_t numVertices{ 0 };
-};
-
-
-template<bool INTERLEAVED>
-void process_ainode(const aiScene* scene, const aiNode* node, mesh_conversion_job_data_t* job_data) {
-    job_data->meshes.reserve(job_data->meshes.size() + node->mNumMeshes);
-
-    for (size_t i = 0; i < node->mNumMeshes; ++i) {
-        const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+    void validate_mesh(const aiMesh* mesh) {
         if (!mesh->HasNormals()) {
             LOG(ERROR) << "Tried to load a mesh that has no normals: these are required for any mesh that will be loaded!";
             throw std::runtime_error("Mesh lacks normals!");
@@ -138,102 +71,147 @@ void process_ainode(const aiScene* scene, const aiNode* node, mesh_conversion_jo
             throw std::runtime_error("Mesh lacks texture coordinates!");
         }
 
-        const glm::vec3* vertices = reinterpret_cast<const glm::vec3*>(mesh->mVertices);
-        const glm::vec3* tangents = reinterpret_cast<const glm::vec3*>(mesh->mTangents);
-        const glm::vec3* bitangents = reinterpret_cast<const glm::vec3*>(mesh->mBitangents);
-        const glm::vec3* normals = reinterpret_cast<const glm::vec3*>(mesh->mNormals);
-        const glm::vec3* uv0 = reinterpret_cast<const glm::vec3*>(mesh->mTextureCoords[0]);
-        const glm::vec3* uv1 = reinterpret_cast<const glm::vec3*>(mesh->mTextureCoords[1]);
+        if (!mesh->HasTangentsAndBitangents()) {
+            LOG(ERROR) << "Tangent space generation failed for a mesh: check that its texture coordinates are valid.";
+            throw std::runtime_error("Mesh lacks tangents!");
+        }
 
         if (mesh->HasVertexColors(0)) {
             LOG(WARNING) << "Mesh uses per-vertex colors, which are unsupported!";
         }
+    }
 
-        if (!mesh->HasTextureCoords(1)) {
-            uv1 = nullptr;
+    uint32_t count_indices(const aiMesh* mesh) noexcept {
+        if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+            return mesh->mNumFaces * 3;
         }
 
-        const size_t num_vertices = mesh->mNumVertices;
-        if (num_vertices > 0) {
-
-            const aiFace* faces = mesh->mFaces;
-            const size_t num_faces = mesh->mNumFaces;
-
-            if (num_faces > 0) {
-
-                const size_t vertex_offset = job_data->numVertices;
-                job_data->numVertices += num_vertices;
-
-                if (INTERLEAVED) {
-                    job_data->g_vertices.reserve(job_data->g_vertices.size() + num_vertices);
-                }
-                else {
-                    job_data->g_data.positions.reserve(job_data->g_data.positions.size() + num_vertices);
-                    job_data->g_data.tangents.reserve(job_data->g_data.tangents.size() + num_vertices);
-                    job_data->g_data.uv0s.reserve(job_data->g_data.uv0s.size() + num_vertices);
-                }
-
-                for (size_t j = 0; j < num_vertices; ++j) {
-                    glm::quat q = pack_tangent_frame(glm::mat3(tangents[j], bitangents[j], normals[j]));
-                    if (INTERLEAVED) {
-                        job_data->g_vertices.emplace_back(vertices[j], q, uv0[j]);
-                    }
-                    else {
-                        vertex_t v(vertices[j], q, uv0[j]);
-                        job_data->g_data.positions.emplace_back(v.position);
-                        job_data->g_data.tangents.emplace_back(v.tangents);
-                        job_data->g_data.uv0s.emplace_back(v.uv0);
-                        if (uv1 != nullptr) {
-                            job_data->g_data.uv1s.emplace_back(uv1[j].x, uv1[j].y);
-                        }
-                    }
-                }
-
-
-                const size_t indices_count = num_faces * faces[0].mNumIndices;
-                const size_t index_buffer_offset = job_data->g_indices.size();
-                job_data->g_indices.reserve(job_data->g_indices.size() + indices_count);
-
-                for (size_t j = 0; j < num_faces; ++j) {
-                    const aiFace& face = faces[j];
-                    for (size_t k = 0; k < face.mNumIndices; ++k) {
-                        job_data->g_indices.emplace_back(uint32_t(face.mIndices[k] + vertex_offset));
-                    }
-                }
-
-                const size_t stride = INTERLEAVED ? sizeof(vertex_t) : sizeof(vertex_t::position);
-                const decltype(vertex_t::position)* positions = INTERLEAVED ? &job_data->g_vertices.data()->position : job_data->g_data.positions.data();
-                const imported_aabb aabb(compute_aabb(positions, job_data->g_indices.data() + index_buffer_offset, indices_count, stride));
-                job_data->meshes.emplace_back(uint32_t(index_buffer_offset), uint32_t(indices_count), uint32_t(vertex_offset), uint32_t(vertex_offset + indices_count - 1), uint32_t(mesh->mMaterialIndex), aabb);
+        uint32_t result = 0;
+        for (uint32_t i = 0; i < mesh->mNumFaces; ++i) {
+            result += mesh->mFaces[i].mNumIndices;
+        }
+        return result;
+    }
 
+    // First pass: meshes are laid out in the same depth-first order the node tree is visited in
+    void gather_ainode(const aiScene* scene, const aiNode* node, scene_layout_t& layout) {
+        for (uint32_t i = 0; i < node->mNumMeshes; ++i) {
+            const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+            validate_mesh(mesh);
+            if ((mesh->mNumVertices == 0) || (mesh->mNumFaces == 0)) {
+                continue;
             }
+
+            mesh_conversion_job_t job;
+            job.mesh = mesh;
+            job.vertexOffset = static_cast<uint32_t>(layout.numVertices);
+            job.vertexCount = mesh->mNumVertices;
+            job.indexOffset = static_cast<uint32_t>(layout.numIndices);
+            job.indexCount = count_indices(mesh);
+            layout.numVertices += job.vertexCount;
+            layout.numIndices += job.indexCount;
+            layout.hasUV1 |= mesh->HasTextureCoords(1);
+            layout.jobs.emplace_back(job);
+        }
+
+        for (uint32_t i = 0; i < node->mNumChildren; ++i) {
+            gather_ainode(scene, node->mChildren[i], layout);
+        }
+
+        if (layout.numVertices > std::numeric_limits<uint32_t>::max()) {
+            throw std::out_of_range("Scene has more vertices than can be addressed by 32-bit indices!");
         }
     }
 
-    for (size_t i = 0; i < node->mNumChildren; ++i) {
-        process_ainode<INTERLEAVED>(scene, node->mChildren[i], job_data);
+    std::vector<conversion_chunk_t> split_into_chunks(const scene_layout_t& layout) {
+        std::vector<conversion_chunk_t> result;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(layout.jobs.size()); ++i) {
+            const aiMesh* mesh = layout.jobs[i].mesh;
+            for (uint32_t begin = 0; begin < mesh->mNumVertices; begin += ConversionChunkSize) {
+                result.emplace_back(conversion_chunk_t{ i, begin, std::min(begin + ConversionChunkSize, mesh->mNumVertices), false });
+            }
+            for (uint32_t begin = 0; begin < mesh->mNumFaces; begin += ConversionChunkSize) {
+                result.emplace_back(conversion_chunk_t{ i, begin, std::min(begin + ConversionChunkSize, mesh->mNumFaces), true });
+            }
+        }
+        return result;
     }
 
-    job_data->g_vertices.shrink_to_fit();
-    job_data->g_indices.shrink_to_fit();
-    job_data->g_data.positions.shrink_to_fit();
-    job_data->g_data.tangents.shrink_to_fit();
-    job_data->g_data.uv0s.shrink_to_fit();
-    job_data->g_data.uv1s.shrink_to_fit();
-    job_data->meshes.shrink_to_fit();
+    template<typename T>
+    T* strided(T* base, const size_t stride, const size_t idx) noexcept {
+        return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(base) + stride * idx);
+    }
 
-}
+    chunk_bounds_t convert_vertices(const mesh_conversion_job_t& job, const uint32_t begin, const uint32_t end, const VertexStreams& output) {
+        const aiMesh* mesh = job.mesh;
+        const aiVector3D* positions = mesh->mVertices;
+        const aiVector3D* uv0 = mesh->mTextureCoords[0];
+        const aiVector3D* uv1 = mesh->HasTextureCoords(1) ? mesh->mTextureCoords[1] : nullptr;
+
+        chunk_bounds_t bounds{
+            { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() },
+            { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() }
+        };
+
+        for (uint32_t i = begin; i < end; ++i) {
+            const size_t dst_idx = job.vertexOffset + i;
+            const aiVector3D& p = positions[i];
+            *strided(output.Positions, output.PositionStride, dst_idx) = fvec4(p.x, p.y, p.z, 1.0f);
+            *strided(output.UV0s, output.UV0Stride, dst_idx) = fvec2(uv0[i].x, uv0[i].y);
+            if (output.UV1s) {
+                output.UV1s[dst_idx] = uv1 ? fvec2(uv1[i].x, uv1[i].y) : fvec2(0.0f, 0.0f);
+            }
 
-std::unique_ptr<mesh_conversion_job_data_t> loadInterleaved(const aiScene* scene, const aiNode* root_node) { 
-    std::unique_ptr<mesh_conversion_job_data_t> job_data = std::make_unique<mesh_conversion_job_data_t>();
-    process_ainode<true>(scene, root_node, job_data.get());
-    return job_data;
-}
+            bounds.min[0] = std::min(bounds.min[0], p.x);
+            bounds.min[1] = std::min(bounds.min[1], p.y);
+            bounds.min[2] = std::min(bounds.min[2], p.z);
+            bounds.max[0] = std::max(bounds.max[0], p.x);
+            bounds.max[1] = std::max(bounds.max[1], p.y);
+            bounds.max[2] = std::max(bounds.max[2], p.z);
+        }
+
+        PackTangentFrames(&mesh->mTangents[begin].x, &mesh->mBitangents[begin].x, &mesh->mNormals[begin].x, end - begin,
+            strided(output.Tangents, output.TangentStride, job.vertexOffset + begin), output.TangentStride);
+
+        return bounds;
+    }
+
+    template<typename INDEX>
+    void convert_faces(const mesh_conversion_job_t& job, const uint32_t begin, const uint32_t end, INDEX* indices) noexcept {
+        const aiFace* faces = job.mesh->mFaces;
+        // Faces are triangles unless the mesh mixes primitive types: then the offset of a face has to be counted
+        size_t dst_idx = job.indexOffset;
+        if (job.mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+            dst_idx += size_t(begin) * 3;
+        }
+        else {
+            for (uint32_t i = 0; i < begin; ++i) {
+                dst_idx += faces[i].mNumIndices;
+            }
+        }
+
+        for (uint32_t i = begin; i < end; ++i) {
+            const aiFace& face = faces[i];
+            for (uint32_t j = 0; j < face.mNumIndices; ++j) {
+                indices[dst_idx++] = static_cast<INDEX>(face.mIndices[j] + job.vertexOffset);
+            }
+        }
+    }
+
+    void set_part_bounds(PartData& part, const chunk_bounds_t& bounds) noexcept {
+        for (size_t i = 0; i < 3; ++i) {
+            part.Center[i] = (bounds.min[i] + bounds.max[i]) * 0.5f;
+            part.HalfExtent[i] = (bounds.max[i] - bounds.min[i]) * 0.5f;
+        }
+    }
+
+    void merge_bounds(chunk_bounds_t& dst, const chunk_bounds_t& src) noexcept {
+        for (size_t i = 0; i < 3; ++i) {
+            dst.min[i] = std::min(dst.min[i], src.min[i]);
+            dst.max[i] = std::max(dst.max[i], src.max[i]);
+        }
+    }
 
-std::unique_ptr<mesh_conversion_job_data_t> loadUninterleaved(const aiScene* scene, const aiNode* root_node) {
-    std::unique_ptr<mesh_conversion_job_data_t> job_data = std::make_unique<mesh_conversion_job_data_t>();
-    process_ainode<false>(scene, root_node, job_data.get());
-    return job_data;
 }
 
 #ifdef _MSC_VER
@@ -248,94 +226,80 @@ MeshData* AssimpLoadMeshData(const char * fname, MeshProcessingOptions* opts) {
     importer.SetPropertyBool(AI_CONFIG_IMPORT_COLLADA_IGNORE_UP_DIRECTION, true);
     importer.SetPropertyBool(AI_CONFIG_PP_PTV_KEEP_HIERARCHY, true);
 
-    const aiScene* scene = importer.ReadFile(fname,
-        aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace |
-        aiProcess_FindInstances | aiProcess_OptimizeMeshes |
-        aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality |
-        aiProcess_PreTransformVertices | aiProcess_SortByPType | aiProcess_Triangulate
-    );
+    unsigned int flags = aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace |
+        aiProcess_FindInstances | aiProcess_OptimizeMeshes | aiProcess_JoinIdenticalVertices |
+        aiProcess_PreTransformVertices | aiProcess_SortByPType | aiProcess_Triangulate;
+    if (!opts->Optimize) {
+        // Otherwise redundant: our own optimization stage reorders indices after conversion
+        flags |= aiProcess_ImproveCacheLocality;
+    }
+
+    const aiScene* scene = importer.ReadFile(fname, flags);
 
     if (!scene) {
         LOG(ERROR) << "Failed to load scene from file " << fname << "! File either doesn't exist or loading failed in-progress";
         return nullptr;
     }
 
-    std::unique_ptr<mesh_conversion_job_data_t> data = nullptr;
-
-    if (opts->Interleaved) {
-        data = loadInterleaved(scene, scene->mRootNode);
-    }
-    else {
-        data = loadUninterleaved(scene, scene->mRootNode);
-    }
+    return AssimpConvertScene(scene, opts);
+}
 
-    const bool has_uv1 = data->g_data.uv1s.size() > 0;
-    const bool has_index_16 = (data->numVertices < std::numeric_limits<uint16_t>::max()) && (opts->AllowInt16_Indices);
+MeshData* AssimpConvertScene(const aiScene* scene, MeshProcessingOptions* opts) {
 
-    auto union_aabb = [](imported_aabb& dest, const imported_aabb& other) {
-        dest.set(glm::min(dest.min(), other.min()), glm::max(dest.max(), other.max()));
-    };
+    scene_layout_t layout;
+    gather_ainode(scene, scene->mRootNode, layout);
 
-    imported_aabb total_aabb;
-    static const glm::vec3 starting_min(std::numeric_limits<float>::max());
-    static const glm::vec3 starting_max(std::numeric_limits<float>::lowest());
-    total_aabb.set(starting_min, starting_max);
+    const bool has_uv1 = layout.hasUV1 && !opts->Interleaved;
+    std::unique_ptr<MeshData, decltype(&MeshData::DestroyMeshData)> result(
+        CreateMeshData(static_cast<uint32_t>(layout.jobs.size()), scene->mNumMaterials, layout.numVertices, layout.numIndices, has_uv1, opts), MeshData::DestroyMeshData);
+    const VertexStreams output = GetVertexStreams(result.get());
+    const bool has_index_16 = (result->Header.IndexFormat == VK_INDEX_TYPE_UINT16);
 
-    for (auto& mesh : data->meshes) {
-        union_aabb(total_aabb, mesh.aabb);
-    }
+    const std::vector<conversion_chunk_t> chunks = split_into_chunks(layout);
+    std::vector<chunk_bounds_t> chunk_bounds(chunks.size());
+    ForEachChunk(chunks.size(), [&](const size_t i) {
+        const conversion_chunk_t& chunk = chunks[i];
+        const mesh_conversion_job_t& job = layout.jobs[chunk.job];
+        if (!chunk.faces) {
+            chunk_bounds[i] = convert_vertices(job, chunk.begin, chunk.end, output);
+        }
+        else if (has_index_16) {
+            convert_faces(job, chunk.begin, chunk.end, reinterpret_cast<uint16_t*>(result->Indices));
+        }
+        else {
+            convert_faces(job, chunk.begin, chunk.end, reinterpret_cast<uint32_t*>(result->Indices));
+        }
+    });
 
-    MeshDataHeader header = MeshDataHeader();
-    header.Version = LOADER_VERSION;
-    header.Center[0] = total_aabb.center.x;
-    header.Center[1] = total_aabb.center.y;
-    header.Center[2] = total_aabb.center.z;
-    header.HalfExtent[0] = total_aabb.half_extent.x;
-    header.HalfExtent[1] = total_aabb.half_extent.y;
-    header.HalfExtent[2] = total_aabb.half_extent.z;
-    header.NumParts = static_cast<uint32_t>(data->meshes.size());
-    header.Interleaved = uint32_t(opts->Interleaved);
-    header.PositionAttrFormat = uint32_t(VK_FORMAT_R32G32B32A32_SFLOAT);
-    header.TangentAttrFormat = uint32_t(VK_FORMAT_R16G16B16A16_SNORM);
-    header.UV0_Format = uint32_t(VK_FORMAT_R32G32_SFLOAT);
-
-    if (opts->Interleaved) {
-        header.PositionAttrOffset = offsetof(vertex_t, position);
-        header.TangentAttrOffset = offsetof(vertex_t, tangents);
-        header.UV0_Offset = offsetof(vertex_t, uv0);
-        header.PositionAttrStride = sizeof(vertex_t);
-        header.TangentAttrStride = sizeof(vertex_t);
-        header.UV0_Stride = sizeof(vertex_t);
-    }
-    else {
-        header.PositionAttrOffset = 0;
-        header.TangentAttrOffset = static_cast<uint32_t>(data->numVertices * sizeof(vertex_t::position));
-        header.UV0_Offset = static_cast<uint32_t>(header.TangentAttrOffset + data->numVertices * sizeof(vertex_t::tangents));
-        header.PositionAttrStride = sizeof(vertex_t::position);
-        header.TangentAttrStride = sizeof(vertex_t::tangents);
-        header.UV0_Stride = sizeof(vertex_t::uv0);
-        if (has_uv1) {
-            header.UV1_Offset = static_cast<uint32_t>(header.UV0_Offset + data->numVertices * sizeof(vertex_t::uv0));
-            header.UV1_Stride = sizeof(vertex_t::uv0);
-            header.UV1_Format = uint32_t(VK_FORMAT_R32G32_SFLOAT);
+    static const chunk_bounds_t empty_bounds{
+        { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() },
+        { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() }
+    };
+    std::vector<chunk_bounds_t> part_bounds(layout.jobs.size(), empty_bounds);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (!chunks[i].faces) {
+            merge_bounds(part_bounds[chunks[i].job], chunk_bounds[i]);
         }
     }
 
-    header.VertexCount = static_cast<uint32_t>(data->numVertices);
-    header.IndexFormat = has_index_16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
-    header.IndexCount = static_cast<uint32_t>(data->g_indices.size());
-    header.IndexDataSize = static_cast<uint32_t>(data->g_indices.size() * (has_index_16 ? sizeof(uint16_t) : sizeof(uint32_t)));
-
-    MeshData* result = new MeshData();
-    result->Header = header;
+    chunk_bounds_t total_bounds = empty_bounds;
+    for (size_t i = 0; i < layout.jobs.size(); ++i) {
+        const mesh_conversion_job_t& job = layout.jobs[i];
+        PartData& part = result->Parts[i];
+        part.IndexOffset = job.indexOffset;
+        part.IndexCount = job.indexCount;
+        part.MinIndex = job.vertexOffset;
+        part.MaxIndex = job.vertexOffset + job.vertexCount - 1;
+        part.MaterialID = job.mesh->mMaterialIndex;
+        set_part_bounds(part, part_bounds[i]);
+        merge_bounds(total_bounds, part_bounds[i]);
+    }
 
-    result->Parts = new PartData[data->meshes.size()];
-    static_assert(sizeof(PartData) == sizeof(SingleMesh), "Sizes of part data and single mesh must match");
-    // objects are exact same in raw memory
-    memcpy(result->Parts, data->meshes.data(), sizeof(PartData) * data->meshes.size());
+    for (size_t i = 0; i < 3; ++i) {
+        result->Header.Center[i] = (total_bounds.min[i] + total_bounds.max[i]) * 0.5f;
+        result->Header.HalfExtent[i] = (total_bounds.max[i] - total_bounds.min[i]) * 0.5f;
+    }
 
-    result->Header.NumMaterials = scene->mNumMaterials;
-    result->Materials = new MaterialInfo[scene->mNumMaterials];
     for (uint32_t i = 0; i < result->Header.NumMaterials; ++i) {
         const aiMaterial* mat = scene->mMaterials[i];
         aiString name;
@@ -355,41 +319,96 @@ MeshData* AssimpLoadMeshData(const char * fname, MeshProcessingOptions* opts) {
         }
     }
 
-    if (has_index_16) {
-        result->Indices = new uint16_t[data->g_indices.size()];
-        uint16_t* output_indices = reinterpret_cast<uint16_t*>(result->Indices);
-        for (size_t i = 0; i < data->g_indices.size(); ++i) {
-            output_indices[i] = static_cast<uint16_t>(data->g_indices[i]);
+    RunMeshProcessingStages(result.get(), opts);
+
+    return result.release();
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif //!_MSC_VER
+
+#ifdef VPSK_TESTING_ENABLED
+#include <random>
+
+TEST_SUITE("AssimpMeshImporter") {
+
+    struct test_scene_t {
+        std::vector<aiVector3D> positions;
+        std::vector<aiVector3D> normals;
+        std::vector<aiVector3D> tangents;
+        std::vector<aiVector3D> bitangents;
+        std::vector<aiVector3D> uvs;
+        std::vector<aiFace> faces;
+        std::vector<std::vector<unsigned int>> faceIndices;
+    };
+
+    static void random_frame(std::mt19937& rng, aiVector3D& t, aiVector3D& b, aiVector3D& n) {
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        do {
+            n = aiVector3D(dist(rng), dist(rng), dist(rng));
+        } while (n.Length() < 0.1f);
+        n.Normalize();
+        aiVector3D t_raw;
+        do {
+            t_raw = aiVector3D(dist(rng), dist(rng), dist(rng));
+            t = t_raw - n * (n * t_raw);
+        } while (t.Length() < 0.1f);
+        t.Normalize();
+        b = n ^ t;
+        if (dist(rng) < 0.0f) {
+            b = -b;
         }
     }
-    else {
-        result->Indices = new uint32_t[data->g_indices.size()];
-        memcpy(result->Indices, data->g_indices.data(), sizeof(uint32_t) * data->g_indices.size());
-    }
 
-    if (opts->Interleaved) {
-        result->Vertices = new Vertex[data->g_vertices.size()];
-        static_assert(sizeof(vertex_t) == sizeof(Vertex), "Size of vertex_t and public-facing Vertex types must be the same!");
-        memcpy(result->Vertices, data->g_vertices.data(), data->g_vertices.size() * sizeof(vertex_t));
+    static void unpack_frame(const int16_t* packed, float* tangent, float* bitangent, float* normal) {
+        float q[4];
+        for (size_t i = 0; i < 4; ++i) {
+            q[i] = std::max(-1.0f, packed[i] / 32767.0f);
+        }
+        const float x = q[0], y = q[1], z = q[2], w = q[3];
+        tangent[0] = 1.0f - 2.0f * (y * y + z * z); tangent[1] = 2.0f * (x * y + w * z); tangent[2] = 2.0f * (x * z - w * y);
+        normal[0] = 2.0f * (x * z + w * y); normal[1] = 2.0f * (y * z - w * x); normal[2] = 1.0f - 2.0f * (x * x + y * y);
+        const float sign = w < 0.0f ? -1.0f : 1.0f;
+        bitangent[0] = sign * (tangent[1] * normal[2] - tangent[2] * normal[1]);
+        bitangent[1] = sign * (tangent[2] * normal[0] - tangent[0] * normal[2]);
+        bitangent[2] = sign * (tangent[0] * normal[1] - tangent[1] * normal[0]);
     }
-    else {
-        result->Vertices = new UninterleavedVertexData();
-        UninterleavedVertexData* vertex_data = reinterpret_cast<UninterleavedVertexData*>(result->Vertices);
-        vertex_data->Positions = new fvec4[data->g_data.positions.size()];
-        memcpy(vertex_data->Positions, data->g_data.positions.data(), sizeof(fvec4) * data->g_data.positions.size());
-        vertex_data->Tangents = new int16_t[data->g_data.tangents.size() * 4];
-        memcpy(vertex_data->Tangents, data->g_data.tangents.data(), sizeof(glm::i16vec4) * data->g_data.tangents.size());
-        vertex_data->UV0s = new fvec2[data->g_data.uv0s.size()];
-        memcpy(vertex_data->UV0s, data->g_data.uv0s.data(), sizeof(fvec2) * data->g_data.uv0s.size());
-        if (has_uv1) {
-            vertex_data->UV1s = new fvec2[data->g_data.uv1s.size() * 2];
-            memcpy(vertex_data->UV1s, data->g_data.uv1s.data(), sizeof(fvec2) * data->g_data.uv1s.size());
+
+    TEST_CASE("TangentFramesRoundTrip") {
+        std::mt19937 rng(7);
+        const size_t count = 1027;
+        std::vector<aiVector3D> tangents(count), bitangents(count), normals(count);
+        for (size_t i = 0; i < count; ++i) {
+            random_frame(rng, tangents[i], bitangents[i], normals[i]);
+        }
+        // Degenerate frames (aligned with an axis) go through the sqrt(max(0, ...)) clamps
+        tangents[5] = aiVector3D(1.0f, 0.0f, 0.0f);
+        normals[5] = aiVector3D(0.0f, 0.0f, 1.0f);
+        bitangents[5] = aiVector3D(0.0f, -1.0f, 0.0f);
+
+        std::vector<int16_t> packed(count * 4);
+        PackTangentFrames(&tangents[0].x, &bitangents[0].x, &normals[0].x, count, packed.data(), sizeof(int16_t) * 4);
+
+        for (size_t i = 0; i < count; ++i) {
+            float t[3], b[3], n[3];
+            unpack_frame(packed.data() + i * 4, t, b, n);
+            const float t_dot = t[0] * tangents[i].x + t[1] * tangents[i].y + t[2] * tangents[i].z;
+            const float b_dot = b[0] * bitangents[i].x + b[1] * bitangents[i].y + b[2] * bitangents[i].z;
+            const float n_dot = n[0] * normals[i].x + n[1] * normals[i].y + n[2] * normals[i].z;
+            CHECK(t_dot > 0.999f);
+            CHECK(b_dot > 0.999f);
+            CHECK(n_dot > 0.999f);
+
+            // Scalar and SIMD paths must agree to within a quantization step
+            int16_t scalar[4];
+            PackTangentFrame(&tangents[i].x, &bitangents[i].x, &normals[i].x, scalar);
+            for (size_t j = 0; j < 4; ++j) {
+                CHECK(std::abs(int(scalar[j]) - int(packed[i * 4 + j])) <= 1);
+            }
         }
     }
 
-    return result;
 }
 
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif //!_MSC_VER 
+#endif //!VPSK_TESTING_ENABLED
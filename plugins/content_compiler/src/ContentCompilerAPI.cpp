@@ -1,18 +1,31 @@
 #include "ContentCompilerAPI.hpp"
 #include "MeshData.hpp"
 #include "AssimpMeshImporter.hpp"
+#include "ObjFileImporter.hpp"
+#include "MeshSerialization.hpp"
+#include "MeshCache.hpp"
+#include "ImportUtilities.hpp"
+#include "MeshQuantization.hpp"
+#include "MeshSimplifier.hpp"
+#include "MaterialEncoding.hpp"
 #include "CoreAPIs.hpp"
 #include "PluginAPI.hpp"
 #include "resource_context/include/ResourceContextAPI.hpp"
 #include "application_context/include/AppContextAPI.hpp"
+#include <algorithm>
 #include <vector>
 #include <string>
+#include <mutex>
+#include <vulkan/vulkan.h>
 #include "easylogging++.h"
 INITIALIZE_NULL_EASYLOGGINGPP
 
 static ResourceContext_API* resource_api = nullptr;
 static ApplicationContext_API* application_api = nullptr;
 static std::vector<std::string> loadedFiles;
+// Read by loads running on loader threads, so only accessed through meshCacheDirectoryMutex
+static std::string meshCacheDirectory{ "MeshCache" };
+static std::mutex meshCacheDirectoryMutex;
 
 static MeshProcessingOptions opts{
     true,
@@ -20,8 +33,53 @@ static MeshProcessingOptions opts{
     true
 };
 
+static bool cacheMatchesOptions(const MeshData* mesh, const MeshProcessingOptions* options) {
+    VertexQuantization positions, uvs;
+    ResolveQuantization(*options, positions, uvs);
+    // Unorm16 UVs fall back to fp16 when they don't fit in [0, 1], so both are valid for that setting
+    const bool uvs_match = (mesh->Header.UV0_Format == QuantizedUVFormat(uvs)) ||
+        ((uvs == VertexQuantization::Unorm16) && (mesh->Header.UV0_Format == QuantizedUVFormat(VertexQuantization::Float16)));
+    return (mesh->Header.Version == LOADER_VERSION) && (mesh->Header.Interleaved == uint32_t(options->Interleaved)) &&
+        (options->AllowInt16_Indices || (mesh->Header.IndexFormat == VK_INDEX_TYPE_UINT32)) &&
+        (mesh->Header.PositionAttrFormat == QuantizedPositionFormat(positions)) && uvs_match &&
+        (!options->BuildMeshlets || (mesh->Header.NumMeshlets != 0) || (mesh->Header.IndexCount == 0)) &&
+        (mesh->Header.LODLevels == std::min(options->LODCount, MaxPartLODs));
+}
+
+MeshData* LoadMeshDataCached(const char* fname, MeshProcessingOptions* options) {
+    std::string cache_directory;
+    {
+        std::lock_guard<std::mutex> directory_guard(meshCacheDirectoryMutex);
+        cache_directory = meshCacheDirectory;
+    }
+
+    MeshCacheKey key;
+    const bool has_key = ComputeMeshCacheKey(fname, *options, key);
+    if (has_key) {
+        MeshData* cached = LoadCachedMesh(cache_directory.c_str(), key);
+        if (cached && cacheMatchesOptions(cached, options)) {
+            return cached;
+        }
+        else if (cached) {
+            MeshData::DestroyMeshData(cached);
+        }
+    }
+
+    MeshData* result = ImportMeshData(fname, options);
+    if (result && has_key && !StoreCachedMesh(cache_directory.c_str(), key, result)) {
+        LOG(WARNING) << "Failed to add " << fname << " to the mesh cache in " << cache_directory << ", it will be re-imported next time.";
+    }
+
+    return result;
+}
+
+static void SetMeshCacheDirectory(const char* directory) {
+    std::lock_guard<std::mutex> directory_guard(meshCacheDirectoryMutex);
+    meshCacheDirectory = directory;
+}
+
 static void* LoadMeshData_void(const char* fname, void* user_data) {
-    return AssimpLoadMeshData(fname, reinterpret_cast<MeshProcessingOptions*>(user_data));
+    return LoadMeshDataCached(fname, reinterpret_cast<MeshProcessingOptions*>(user_data));
 }
 
 static void DestroyMeshData_void(void* ptr) {
@@ -84,6 +142,13 @@ static ContentCompiler_API* GetAssetAPI() {
     api.LoadMeshFromFileAssimp = AssimpLoadMeshData;
     api.AsyncLoadMeshFromFileAssimp = LoadMeshDataAsync;
     api.DestroyMeshData = MeshData::DestroyMeshData;
+    api.LoadMeshFromFileCached = LoadMeshDataCached;
+    api.LoadMeshFromMeshFile = LoadMeshDataFile;
+    api.WriteMeshToFile = WriteMeshDataFile;
+    api.LoadMeshFromFileObj = LoadMeshDataFromObj;
+    api.SetMeshCacheDirectory = SetMeshCacheDirectory;
+    api.EncodeMaterials = EncodeMaterials;
+    api.DestroyEncodedMaterials = EncodedMaterials::DestroyEncodedMaterials;
     return &api;
 }
 
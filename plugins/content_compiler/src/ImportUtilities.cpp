@@ -0,0 +1,399 @@
+#include "ImportUtilities.hpp"
+#include "AssimpMeshImporter.hpp"
+#include "ObjFileImporter.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshQuantization.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshletBuilder.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+#include <memory>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define CONTENT_COMPILER_SSE_TANGENT_PACKING
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    constexpr float TangentQuaternionBias = 1.0f / 32767.0f;
+
+    struct float3_t {
+        float x, y, z;
+    };
+
+    int16_t pack_snorm16(const float v) noexcept {
+        return static_cast<int16_t>(std::round(std::min(std::max(v, -1.0f), 1.0f) * 32767.0f));
+    }
+
+    /*
+        Tangent frames are stored as a quaternion (|w| >= bias), with the handedness of the bitangent folded into
+        the sign of the whole quaternion: decoded, bitangent = cross(tangent, normal) * sign(w). The tangent is
+        first orthogonalized against the normal, so the frame is a proper rotation: then every quaternion
+        component can be found from the diagonal directly, with signs from the off-diagonal terms, which needs
+        no branches and so maps directly onto SIMD lanes.
+    */
+    void pack_tangent_frame(const float3_t& tangent, const float3_t& bitangent, const float3_t& normal, int16_t* dst) noexcept {
+        float n[3]{ normal.x, normal.y, normal.z };
+        const float n_length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        const float inv_n_length = n_length > 0.0f ? 1.0f / n_length : 0.0f;
+        n[0] *= inv_n_length; n[1] *= inv_n_length; n[2] *= inv_n_length;
+
+        const float n_dot_t = n[0] * tangent.x + n[1] * tangent.y + n[2] * tangent.z;
+        float t[3]{ tangent.x - n[0] * n_dot_t, tangent.y - n[1] * n_dot_t, tangent.z - n[2] * n_dot_t };
+        const float t_length = std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+        const float inv_t_length = t_length > 0.0f ? 1.0f / t_length : 0.0f;
+        t[0] *= inv_t_length; t[1] *= inv_t_length; t[2] *= inv_t_length;
+
+        // b = n x t completes the rotation
+        const float b[3]{ n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+
+        float q[4]{
+            0.5f * std::sqrt(std::max(0.0f, 1.0f + t[0] - b[1] - n[2])),
+            0.5f * std::sqrt(std::max(0.0f, 1.0f - t[0] + b[1] - n[2])),
+            0.5f * std::sqrt(std::max(0.0f, 1.0f - t[0] - b[1] + n[2])),
+            0.5f * std::sqrt(std::max(0.0f, 1.0f + t[0] + b[1] + n[2]))
+        };
+        q[0] = std::copysign(q[0], b[2] - n[1]);
+        q[1] = std::copysign(q[1], n[0] - t[2]);
+        q[2] = std::copysign(q[2], t[1] - b[0]);
+
+        const float q_length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        const float inv_q_length = q_length > 0.0f ? 1.0f / q_length : 0.0f;
+        for (float& c : q) {
+            c *= inv_q_length;
+        }
+
+        // Keep w away from zero, so its sign survives quantization and can carry the handedness
+        if (q[3] < TangentQuaternionBias) {
+            const float factor = std::sqrt(1.0f - TangentQuaternionBias * TangentQuaternionBias);
+            q[0] *= factor; q[1] *= factor; q[2] *= factor;
+            q[3] = TangentQuaternionBias;
+        }
+
+        // Original frame (tangent, bitangent, normal) is left-handed: flip the quaternion
+        const float handedness = (tangent.y * normal.z - tangent.z * normal.y) * bitangent.x +
+            (tangent.z * normal.x - tangent.x * normal.z) * bitangent.y +
+            (tangent.x * normal.y - tangent.y * normal.x) * bitangent.z;
+        const float sign = handedness < 0.0f ? -1.0f : 1.0f;
+
+        for (size_t i = 0; i < 4; ++i) {
+            dst[i] = pack_snorm16(q[i] * sign);
+        }
+    }
+
+#ifdef CONTENT_COMPILER_SSE_TANGENT_PACKING
+    inline __m128 sse_copysign(const __m128 magnitude, const __m128 sign) noexcept {
+        const __m128 sign_mask = _mm_set1_ps(-0.0f);
+        return _mm_or_ps(_mm_andnot_ps(sign_mask, magnitude), _mm_and_ps(sign_mask, sign));
+    }
+
+    inline __m128 sse_safe_rcp_length(const __m128 length_squared) noexcept {
+        const __m128 length = _mm_sqrt_ps(length_squared);
+        const __m128 nonzero = _mm_cmpgt_ps(length, _mm_setzero_ps());
+        return _mm_and_ps(nonzero, _mm_div_ps(_mm_set1_ps(1.0f), length));
+    }
+
+    // Four frames at a time: same math as pack_tangent_frame(), one frame per lane
+    void pack_tangent_frames_x4(const float3_t* tangents, const float3_t* bitangents, const float3_t* normals, int16_t* dst, const size_t dst_stride) noexcept {
+        auto load = [](const float3_t* v, __m128& x, __m128& y, __m128& z) {
+            x = _mm_setr_ps(v[0].x, v[1].x, v[2].x, v[3].x);
+            y = _mm_setr_ps(v[0].y, v[1].y, v[2].y, v[3].y);
+            z = _mm_setr_ps(v[0].z, v[1].z, v[2].z, v[3].z);
+        };
+
+        __m128 tx, ty, tz, bx, by, bz, nx, ny, nz;
+        load(tangents, tx, ty, tz);
+        load(bitangents, bx, by, bz);
+        load(normals, nx, ny, nz);
+
+        // handedness of the original frame: dot(cross(t, n), b)
+        const __m128 handedness = _mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ty, nz), _mm_mul_ps(tz, ny)), bx),
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(tz, nx), _mm_mul_ps(tx, nz)), by)),
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(tx, ny), _mm_mul_ps(ty, nx)), bz));
+
+        const __m128 inv_n_length = sse_safe_rcp_length(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+        nx = _mm_mul_ps(nx, inv_n_length);
+        ny = _mm_mul_ps(ny, inv_n_length);
+        nz = _mm_mul_ps(nz, inv_n_length);
+
+        const __m128 n_dot_t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, tx), _mm_mul_ps(ny, ty)), _mm_mul_ps(nz, tz));
+        tx = _mm_sub_ps(tx, _mm_mul_ps(nx, n_dot_t));
+        ty = _mm_sub_ps(ty, _mm_mul_ps(ny, n_dot_t));
+        tz = _mm_sub_ps(tz, _mm_mul_ps(nz, n_dot_t));
+        const __m128 inv_t_length = sse_safe_rcp_length(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)));
+        tx = _mm_mul_ps(tx, inv_t_length);
+        ty = _mm_mul_ps(ty, inv_t_length);
+        tz = _mm_mul_ps(tz, inv_t_length);
+
+        bx = _mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(nz, ty));
+        by = _mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(nx, tz));
+        bz = _mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(ny, tx));
+
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 qx = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(_mm_sub_ps(_mm_add_ps(one, tx), by), nz))));
+        __m128 qy = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(_mm_add_ps(_mm_sub_ps(one, tx), by), nz))));
+        __m128 qz = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_add_ps(_mm_sub_ps(_mm_sub_ps(one, tx), by), nz))));
+        __m128 qw = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_add_ps(_mm_add_ps(_mm_add_ps(one, tx), by), nz))));
+        qx = sse_copysign(qx, _mm_sub_ps(bz, ny));
+        qy = sse_copysign(qy, _mm_sub_ps(nx, tz));
+        qz = sse_copysign(qz, _mm_sub_ps(ty, bx));
+
+        const __m128 inv_q_length = sse_safe_rcp_length(_mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)),
+            _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw))));
+        qx = _mm_mul_ps(qx, inv_q_length);
+        qy = _mm_mul_ps(qy, inv_q_length);
+        qz = _mm_mul_ps(qz, inv_q_length);
+        qw = _mm_mul_ps(qw, inv_q_length);
+
+        const __m128 bias = _mm_set1_ps(TangentQuaternionBias);
+        const __m128 needs_bias = _mm_cmplt_ps(qw, bias);
+        const __m128 bias_factor = _mm_or_ps(_mm_and_ps(needs_bias, _mm_set1_ps(std::sqrt(1.0f - TangentQuaternionBias * TangentQuaternionBias))),
+            _mm_andnot_ps(needs_bias, one));
+        qx = _mm_mul_ps(qx, bias_factor);
+        qy = _mm_mul_ps(qy, bias_factor);
+        qz = _mm_mul_ps(qz, bias_factor);
+        qw = _mm_or_ps(_mm_and_ps(needs_bias, bias), _mm_andnot_ps(needs_bias, qw));
+
+        // Flip lanes with a left-handed frame, then quantize: clamp and scale, and let packs saturate
+        const __m128 flip = _mm_and_ps(_mm_cmplt_ps(handedness, zero), _mm_set1_ps(-0.0f));
+        const __m128 scale = _mm_set1_ps(32767.0f);
+        auto quantize = [&](const __m128 v) {
+            const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_xor_ps(v, flip), _mm_set1_ps(-1.0f)), one);
+            return _mm_cvtps_epi32(_mm_mul_ps(clamped, scale));
+        };
+
+        // Lanes hold one component for four frames: transpose to four (x, y, z, w) frames
+        const __m128i xy = _mm_packs_epi32(quantize(qx), quantize(qy));
+        const __m128i zw = _mm_packs_epi32(quantize(qz), quantize(qw));
+        const __m128i xz_lo = _mm_unpacklo_epi16(xy, zw);
+        const __m128i yw_lo = _mm_unpackhi_epi16(xy, zw);
+        const __m128i frames01 = _mm_unpacklo_epi16(xz_lo, yw_lo);
+        const __m128i frames23 = _mm_unpackhi_epi16(xz_lo, yw_lo);
+
+        uint8_t* dst_bytes = reinterpret_cast<uint8_t*>(dst);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst_bytes), frames01);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst_bytes + dst_stride), _mm_srli_si128(frames01, 8));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst_bytes + dst_stride * 2), frames23);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst_bytes + dst_stride * 3), _mm_srli_si128(frames23, 8));
+    }
+#endif
+
+    void pack_tangent_frames(const float3_t* tangents, const float3_t* bitangents, const float3_t* normals, const size_t count, int16_t* dst, const size_t dst_stride) noexcept {
+        size_t i = 0;
+        uint8_t* dst_bytes = reinterpret_cast<uint8_t*>(dst);
+#ifdef CONTENT_COMPILER_SSE_TANGENT_PACKING
+        for (; i + 4 <= count; i += 4) {
+            pack_tangent_frames_x4(tangents + i, bitangents + i, normals + i, reinterpret_cast<int16_t*>(dst_bytes + i * dst_stride), dst_stride);
+        }
+#endif
+        for (; i < count; ++i) {
+            pack_tangent_frame(tangents[i], bitangents[i], normals[i], reinterpret_cast<int16_t*>(dst_bytes + i * dst_stride));
+        }
+    }
+
+}
+
+MappedFile* MapFile(const char* fname) {
+    std::unique_ptr<MappedFile, decltype(&UnmapFile)> result(new MappedFile(), UnmapFile);
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    result->File = file;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        return nullptr;
+    }
+    result->Size = static_cast<uint64_t>(file_size.QuadPart);
+
+    result->Mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (result->Mapping == nullptr) {
+        return nullptr;
+    }
+
+    result->Data = reinterpret_cast<const char*>(MapViewOfFile(result->Mapping, FILE_MAP_READ, 0, 0, 0));
+    if (result->Data == nullptr) {
+        return nullptr;
+    }
+#else
+    const int fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat file_stat;
+    if ((fstat(fd, &file_stat) != 0) || (file_stat.st_size == 0)) {
+        close(fd);
+        return nullptr;
+    }
+    result->Size = static_cast<uint64_t>(file_stat.st_size);
+
+    void* data = mmap(nullptr, static_cast<size_t>(result->Size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    result->Data = reinterpret_cast<const char*>(data);
+#endif
+    return result.release();
+}
+
+void UnmapFile(MappedFile* file) {
+    if (!file) {
+        return;
+    }
+#ifdef _WIN32
+    if (file->Data) {
+        UnmapViewOfFile(file->Data);
+    }
+    if (file->Mapping) {
+        CloseHandle(file->Mapping);
+    }
+    if (file->File) {
+        CloseHandle(file->File);
+    }
+#else
+    if (file->Data) {
+        munmap(const_cast<char*>(file->Data), file->Size);
+    }
+#endif
+    delete file;
+}
+
+MeshData* CreateMeshData(const uint32_t num_parts, const uint32_t num_materials, const size_t num_vertices, const size_t num_indices,
+    const bool has_uv1, const MeshProcessingOptions* opts) {
+    if (num_vertices > std::numeric_limits<uint32_t>::max()) {
+        throw std::out_of_range("Mesh has more vertices than can be addressed by 32-bit indices!");
+    }
+
+    const bool has_index_16 = (num_vertices < std::numeric_limits<uint16_t>::max()) && (opts->AllowInt16_Indices);
+
+    MeshDataHeader header = MeshDataHeader();
+    header.Version = LOADER_VERSION;
+    header.NumParts = num_parts;
+    header.NumMaterials = num_materials;
+    header.Interleaved = uint32_t(opts->Interleaved);
+    header.PositionAttrFormat = uint32_t(VK_FORMAT_R32G32B32A32_SFLOAT);
+    header.TangentAttrFormat = uint32_t(VK_FORMAT_R16G16B16A16_SNORM);
+    header.UV0_Format = uint32_t(VK_FORMAT_R32G32_SFLOAT);
+
+    if (opts->Interleaved) {
+        header.PositionAttrOffset = offsetof(Vertex, position);
+        header.TangentAttrOffset = offsetof(Vertex, tangents);
+        header.UV0_Offset = offsetof(Vertex, uv0);
+        header.PositionAttrStride = sizeof(Vertex);
+        header.TangentAttrStride = sizeof(Vertex);
+        header.UV0_Stride = sizeof(Vertex);
+        header.VertexDataSize = static_cast<uint32_t>(num_vertices * sizeof(Vertex));
+    }
+    else {
+        header.PositionAttrOffset = 0;
+        header.TangentAttrOffset = static_cast<uint32_t>(num_vertices * sizeof(fvec4));
+        header.UV0_Offset = static_cast<uint32_t>(header.TangentAttrOffset + num_vertices * sizeof(Vertex::tangents));
+        header.PositionAttrStride = sizeof(fvec4);
+        header.TangentAttrStride = sizeof(Vertex::tangents);
+        header.UV0_Stride = sizeof(fvec2);
+        uint32_t last_offset = header.UV0_Offset;
+        if (has_uv1) {
+            header.UV1_Offset = static_cast<uint32_t>(header.UV0_Offset + num_vertices * sizeof(fvec2));
+            header.UV1_Stride = sizeof(fvec2);
+            header.UV1_Format = uint32_t(VK_FORMAT_R32G32_SFLOAT);
+            last_offset = header.UV1_Offset;
+        }
+        header.VertexDataSize = static_cast<uint32_t>(last_offset + num_vertices * sizeof(fvec2));
+    }
+
+    header.VertexCount = static_cast<uint32_t>(num_vertices);
+    header.IndexFormat = has_index_16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    header.IndexCount = static_cast<uint32_t>(num_indices);
+    header.IndexDataSize = static_cast<uint32_t>(num_indices * (has_index_16 ? sizeof(uint16_t) : sizeof(uint32_t)));
+
+    std::unique_ptr<MeshData, decltype(&MeshData::DestroyMeshData)> result(new MeshData(), MeshData::DestroyMeshData);
+    result->Header = header;
+    result->Parts = new PartData[num_parts];
+    result->Materials = new MaterialInfo[num_materials]{};
+
+    if (opts->Interleaved) {
+        result->Vertices = new uint8_t[num_vertices * sizeof(Vertex)];
+    }
+    else {
+        UninterleavedVertexData* vertices = new UninterleavedVertexData();
+        result->Vertices = vertices;
+        vertices->Positions = new uint8_t[num_vertices * sizeof(fvec4)];
+        vertices->Tangents = new int16_t[num_vertices * 4];
+        vertices->UV0s = new uint8_t[num_vertices * sizeof(fvec2)];
+        vertices->UV1s = has_uv1 ? new uint8_t[num_vertices * sizeof(fvec2)] : nullptr;
+    }
+
+    if (has_index_16) {
+        result->Indices = new uint16_t[num_indices];
+    }
+    else {
+        result->Indices = new uint32_t[num_indices];
+    }
+
+    return result.release();
+}
+
+VertexStreams GetVertexStreams(MeshData* mesh) noexcept {
+    if (mesh->Header.Interleaved) {
+        Vertex* vertices = reinterpret_cast<Vertex*>(mesh->Vertices);
+        return VertexStreams{ &vertices->position, sizeof(Vertex), vertices->tangents, sizeof(Vertex), &vertices->uv0, sizeof(Vertex), nullptr };
+    }
+    else {
+        UninterleavedVertexData* vertices = reinterpret_cast<UninterleavedVertexData*>(mesh->Vertices);
+        return VertexStreams{ reinterpret_cast<fvec4*>(vertices->Positions), sizeof(fvec4), vertices->Tangents, sizeof(Vertex::tangents),
+            reinterpret_cast<fvec2*>(vertices->UV0s), sizeof(fvec2), reinterpret_cast<fvec2*>(vertices->UV1s) };
+    }
+}
+
+void PackTangentFrame(const float* tangent, const float* bitangent, const float* normal, int16_t* dst) noexcept {
+    pack_tangent_frame(*reinterpret_cast<const float3_t*>(tangent), *reinterpret_cast<const float3_t*>(bitangent), *reinterpret_cast<const float3_t*>(normal), dst);
+}
+
+void PackTangentFrames(const float* tangents, const float* bitangents, const float* normals, const size_t count, int16_t* dst, const size_t dst_stride) noexcept {
+    pack_tangent_frames(reinterpret_cast<const float3_t*>(tangents), reinterpret_cast<const float3_t*>(bitangents), reinterpret_cast<const float3_t*>(normals),
+        count, dst, dst_stride);
+}
+
+MeshData* ImportMeshData(const char* fname, MeshProcessingOptions* options) {
+    const char* extension = strrchr(fname, '.');
+    const bool is_obj = extension && (strlen(extension) == 4) && (tolower(extension[1]) == 'o') && (tolower(extension[2]) == 'b') &&
+        (tolower(extension[3]) == 'j');
+    return is_obj ? LoadMeshDataFromObj(fname, options) : AssimpLoadMeshData(fname, options);
+}
+
+void RunMeshProcessingStages(MeshData* mesh, const MeshProcessingOptions* options) {
+    if (options->Optimize) {
+        OptimizeMeshData(mesh, options->OverdrawThreshold);
+    }
+
+    GeneratePartLODs(mesh, options->LODCount, options->LODTargetRatio, options->LODMaxError);
+
+    VertexQuantization position_quantization, uv_quantization;
+    ResolveQuantization(*options, position_quantization, uv_quantization);
+    QuantizeMeshData(mesh, position_quantization, uv_quantization);
+
+    if (options->BuildMeshlets) {
+        BuildMeshletData(mesh);
+    }
+}
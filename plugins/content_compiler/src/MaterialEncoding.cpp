@@ -0,0 +1,391 @@
+#include "MaterialEncoding.hpp"
+#include "MeshQuantization.hpp"
+#include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+    inline float saturate(const float v) noexcept {
+        return std::min(std::max(v, 0.0f), 1.0f);
+    }
+
+    inline uint32_t pack_unorm8(const float v) noexcept {
+        return static_cast<uint32_t>(std::lround(saturate(v) * 255.0f));
+    }
+
+    inline uint32_t pack_snorm8(const float v) noexcept {
+        return static_cast<uint32_t>(static_cast<uint8_t>(static_cast<int8_t>(std::lround(std::min(std::max(v, -1.0f), 1.0f) * 127.0f))));
+    }
+
+    inline uint32_t pack_unorm8x4(const float x, const float y, const float z, const float w) noexcept {
+        return pack_unorm8(x) | (pack_unorm8(y) << 8) | (pack_unorm8(z) << 16) | (pack_unorm8(w) << 24);
+    }
+
+    inline float unpack_unorm8(const uint32_t packed, const uint32_t byte) noexcept {
+        return float((packed >> (byte * 8)) & 0xff) / 255.0f;
+    }
+
+    inline float unpack_snorm8(const uint32_t packed, const uint32_t byte) noexcept {
+        return std::max(float(static_cast<int8_t>((packed >> (byte * 8)) & 0xff)) / 127.0f, -1.0f);
+    }
+
+    float linear_to_srgb(const float v) noexcept {
+        const float c = saturate(v);
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    float srgb_to_linear(const float v) noexcept {
+        return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+    }
+
+    uint32_t pack_color(const float* rgb, const float alpha) noexcept {
+        return pack_unorm8x4(linear_to_srgb(rgb[0]), linear_to_srgb(rgb[1]), linear_to_srgb(rgb[2]), alpha);
+    }
+
+    void unpack_color(const uint32_t packed, float* rgb, float* alpha) noexcept {
+        for (uint32_t i = 0; i < 3; ++i) {
+            rgb[i] = srgb_to_linear(unpack_unorm8(packed, i));
+        }
+        if (alpha) {
+            *alpha = unpack_unorm8(packed, 3);
+        }
+    }
+
+    inline float sign_not_zero(const float v) noexcept {
+        return v >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    // Octahedral encoding (Cigolle et al. 2014): zero vectors encode as +z
+    uint32_t pack_direction(const float* v) noexcept {
+        const float l1 = std::abs(v[0]) + std::abs(v[1]) + std::abs(v[2]);
+        float x = 0.0f, y = 0.0f;
+        if (l1 > 0.0f) {
+            x = v[0] / l1;
+            y = v[1] / l1;
+            if (v[2] < 0.0f) {
+                const float folded_x = (1.0f - std::abs(y)) * sign_not_zero(x);
+                y = (1.0f - std::abs(x)) * sign_not_zero(y);
+                x = folded_x;
+            }
+        }
+        const uint32_t px = static_cast<uint16_t>(static_cast<int16_t>(std::lround(std::min(std::max(x, -1.0f), 1.0f) * 32767.0f)));
+        const uint32_t py = static_cast<uint16_t>(static_cast<int16_t>(std::lround(std::min(std::max(y, -1.0f), 1.0f) * 32767.0f)));
+        return px | (py << 16);
+    }
+
+    void unpack_direction(const uint32_t packed, float* v) noexcept {
+        const float x = std::max(float(static_cast<int16_t>(packed & 0xffff)) / 32767.0f, -1.0f);
+        const float y = std::max(float(static_cast<int16_t>(packed >> 16)) / 32767.0f, -1.0f);
+        float d[3]{ x, y, 1.0f - std::abs(x) - std::abs(y) };
+        if (d[2] < 0.0f) {
+            const float unfolded_x = (1.0f - std::abs(d[1])) * sign_not_zero(d[0]);
+            d[1] = (1.0f - std::abs(d[0])) * sign_not_zero(d[1]);
+            d[0] = unfolded_x;
+        }
+        const float length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        for (uint32_t i = 0; i < 3; ++i) {
+            v[i] = d[i] / length;
+        }
+    }
+
+    void pack_emissive(const float* emissive, uint16_t* dst) noexcept {
+        for (uint32_t i = 0; i < 4; ++i) {
+            dst[i] = FloatToHalf(emissive[i]);
+        }
+    }
+
+    void unpack_emissive(const uint16_t* packed, float* emissive) noexcept {
+        for (uint32_t i = 0; i < 4; ++i) {
+            emissive[i] = HalfToFloat(packed[i]);
+        }
+    }
+
+    uint32_t pack_surface(const MaterialParameters& params, const float metallic) noexcept {
+        return pack_unorm8x4(params.roughness, metallic, params.reflectance, params.ambientOcclusion);
+    }
+
+    void unpack_surface(const uint32_t packed, MaterialParameters& params) noexcept {
+        params.roughness = unpack_unorm8(packed, 0);
+        params.metallic = unpack_unorm8(packed, 1);
+        params.reflectance = unpack_unorm8(packed, 2);
+        params.ambientOcclusion = unpack_unorm8(packed, 3);
+    }
+
+    PackedUnlitMaterial pack_unlit(const MaterialParameters& params) noexcept {
+        PackedUnlitMaterial result{};
+        result.BaseColor = pack_color(params.baseColor, params.baseColor[3]);
+        pack_emissive(params.emissive, result.Emissive);
+        return result;
+    }
+
+    PackedLitMaterial pack_lit(const MaterialParameters& params) noexcept {
+        PackedLitMaterial result{};
+        result.BaseColor = pack_color(params.baseColor, params.baseColor[3]);
+        pack_emissive(params.emissive, result.Emissive);
+        result.RoughnessMetallicReflectanceAO = pack_surface(params, params.metallic);
+        result.ClearCoatAnisotropy = pack_unorm8(params.clearCoat) | (pack_unorm8(params.clearCoatRoughness) << 8) | (pack_snorm8(params.anisotropy) << 16);
+        result.AnisotropyDirection = pack_direction(params.anisotropyDirection);
+        result.Normal = pack_direction(params.normal);
+        return result;
+    }
+
+    PackedSubsurfaceMaterial pack_subsurface(const MaterialParameters& params) noexcept {
+        PackedSubsurfaceMaterial result{};
+        result.BaseColor = pack_color(params.baseColor, params.baseColor[3]);
+        pack_emissive(params.emissive, result.Emissive);
+        result.RoughnessMetallicReflectanceAO = pack_surface(params, params.metallic);
+        result.SubsurfaceColorThickness = pack_color(params.subsurfaceColor, params.thickness);
+        result.SubsurfacePower = FloatToHalf(params.subsurfacePower);
+        result.Normal = pack_direction(params.normal);
+        return result;
+    }
+
+    PackedClothMaterial pack_cloth(const MaterialParameters& params) noexcept {
+        PackedClothMaterial result{};
+        result.BaseColor = pack_color(params.baseColor, params.baseColor[3]);
+        pack_emissive(params.emissive, result.Emissive);
+        result.RoughnessMetallicReflectanceAO = pack_surface(params, 0.0f);
+        result.SheenColor = pack_color(params.sheenColor, 0.0f);
+        result.SubsurfaceColor = pack_color(params.subsurfaceColor, 0.0f);
+        result.Normal = pack_direction(params.normal);
+        return result;
+    }
+
+    template<typename T>
+    const T& packed_at(const MaterialBucket& bucket, const uint32_t slot) noexcept {
+        return reinterpret_cast<const T*>(bucket.Data)[slot];
+    }
+
+}
+
+void EncodedMaterials::DestroyEncodedMaterials(EncodedMaterials* materials) {
+    for (MaterialBucket& bucket : materials->Buckets) {
+        delete[] reinterpret_cast<uint8_t*>(bucket.Data);
+        delete[] bucket.SourceIndices;
+    }
+    delete[] materials->Handles;
+    delete materials;
+}
+
+uint32_t PackedMaterialSize(const shading_model model) noexcept {
+    switch (model) {
+    case shading_model::Lit:
+        return sizeof(PackedLitMaterial);
+    case shading_model::Subsurface:
+        return sizeof(PackedSubsurfaceMaterial);
+    case shading_model::Cloth:
+        return sizeof(PackedClothMaterial);
+    case shading_model::Unlit:
+        return sizeof(PackedUnlitMaterial);
+    default:
+        return 0;
+    }
+}
+
+EncodedMaterials* EncodeMaterials(const MaterialParameters* materials, const uint32_t count) {
+    auto model_of = [&](const uint32_t i) {
+        const shading_model model = materials[i].model;
+        return ((model == shading_model::Invalid) || (static_cast<uint32_t>(model) >= NumShadingModels)) ? shading_model::Lit : model;
+    };
+
+    std::unique_ptr<EncodedMaterials, decltype(&EncodedMaterials::DestroyEncodedMaterials)> result(new EncodedMaterials(), EncodedMaterials::DestroyEncodedMaterials);
+    result->NumMaterials = count;
+    result->Handles = new uint32_t[count];
+
+    uint32_t num_invalid = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        num_invalid += (model_of(i) != materials[i].model) ? 1 : 0;
+        ++result->Buckets[static_cast<uint32_t>(model_of(i))].Count;
+    }
+    if (num_invalid != 0) {
+        LOG(WARNING) << num_invalid << " materials have no valid shading model, and were encoded as Lit.";
+    }
+
+    for (uint32_t model = 0; model < NumShadingModels; ++model) {
+        MaterialBucket& bucket = result->Buckets[model];
+        if (bucket.Count > MaterialHandleSlotMask + 1) {
+            LOG(ERROR) << "Too many materials (" << bucket.Count << ") of one shading model to address with material handles.";
+            return nullptr;
+        }
+        bucket.Stride = PackedMaterialSize(static_cast<shading_model>(model));
+        if (bucket.Count != 0) {
+            bucket.Data = new uint8_t[size_t(bucket.Count) * bucket.Stride]{};
+            bucket.SourceIndices = new uint32_t[bucket.Count];
+            bucket.Count = 0;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const shading_model model = model_of(i);
+        MaterialBucket& bucket = result->Buckets[static_cast<uint32_t>(model)];
+        const uint32_t slot = bucket.Count++;
+        void* dst = reinterpret_cast<uint8_t*>(bucket.Data) + size_t(slot) * bucket.Stride;
+        switch (model) {
+        case shading_model::Subsurface: {
+            const PackedSubsurfaceMaterial packed = pack_subsurface(materials[i]);
+            memcpy(dst, &packed, sizeof(packed));
+            break;
+        }
+        case shading_model::Cloth: {
+            const PackedClothMaterial packed = pack_cloth(materials[i]);
+            memcpy(dst, &packed, sizeof(packed));
+            break;
+        }
+        case shading_model::Unlit: {
+            const PackedUnlitMaterial packed = pack_unlit(materials[i]);
+            memcpy(dst, &packed, sizeof(packed));
+            break;
+        }
+        default: {
+            const PackedLitMaterial packed = pack_lit(materials[i]);
+            memcpy(dst, &packed, sizeof(packed));
+            break;
+        }
+        }
+        bucket.SourceIndices[slot] = i;
+        result->Handles[i] = (static_cast<uint32_t>(model) << MaterialHandleSlotBits) | slot;
+    }
+
+    return result.release();
+}
+
+MaterialParameters DecodeMaterial(const EncodedMaterials* materials, const uint32_t handle) {
+    MaterialParameters result;
+    const shading_model model = MaterialHandleModel(handle);
+    const uint32_t slot = MaterialHandleSlot(handle);
+    result.model = model;
+    if ((static_cast<uint32_t>(model) >= NumShadingModels) || (slot >= materials->Buckets[static_cast<uint32_t>(model)].Count)) {
+        result.model = shading_model::Invalid;
+        return result;
+    }
+
+    const MaterialBucket& bucket = materials->Buckets[static_cast<uint32_t>(model)];
+    switch (model) {
+    case shading_model::Lit: {
+        const PackedLitMaterial& packed = packed_at<PackedLitMaterial>(bucket, slot);
+        unpack_color(packed.BaseColor, result.baseColor, &result.baseColor[3]);
+        unpack_emissive(packed.Emissive, result.emissive);
+        unpack_surface(packed.RoughnessMetallicReflectanceAO, result);
+        result.clearCoat = unpack_unorm8(packed.ClearCoatAnisotropy, 0);
+        result.clearCoatRoughness = unpack_unorm8(packed.ClearCoatAnisotropy, 1);
+        result.anisotropy = unpack_snorm8(packed.ClearCoatAnisotropy, 2);
+        unpack_direction(packed.AnisotropyDirection, result.anisotropyDirection);
+        unpack_direction(packed.Normal, result.normal);
+        break;
+    }
+    case shading_model::Subsurface: {
+        const PackedSubsurfaceMaterial& packed = packed_at<PackedSubsurfaceMaterial>(bucket, slot);
+        unpack_color(packed.BaseColor, result.baseColor, &result.baseColor[3]);
+        unpack_emissive(packed.Emissive, result.emissive);
+        unpack_surface(packed.RoughnessMetallicReflectanceAO, result);
+        unpack_color(packed.SubsurfaceColorThickness, result.subsurfaceColor, &result.thickness);
+        result.subsurfacePower = HalfToFloat(packed.SubsurfacePower);
+        unpack_direction(packed.Normal, result.normal);
+        break;
+    }
+    case shading_model::Cloth: {
+        const PackedClothMaterial& packed = packed_at<PackedClothMaterial>(bucket, slot);
+        unpack_color(packed.BaseColor, result.baseColor, &result.baseColor[3]);
+        unpack_emissive(packed.Emissive, result.emissive);
+        unpack_surface(packed.RoughnessMetallicReflectanceAO, result);
+        unpack_color(packed.SheenColor, result.sheenColor, nullptr);
+        unpack_color(packed.SubsurfaceColor, result.subsurfaceColor, nullptr);
+        unpack_direction(packed.Normal, result.normal);
+        break;
+    }
+    case shading_model::Unlit: {
+        const PackedUnlitMaterial& packed = packed_at<PackedUnlitMaterial>(bucket, slot);
+        unpack_color(packed.BaseColor, result.baseColor, &result.baseColor[3]);
+        unpack_emissive(packed.Emissive, result.emissive);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return result;
+}
+
+#ifdef VPSK_TESTING_ENABLED
+
+TEST_SUITE("MaterialEncoding") {
+    TEST_CASE("DirectionsSurviveOctahedralEncoding") {
+        const float directions[][3]{
+            { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f }, { -0.3f, 0.8f, -0.52f }, { 0.577f, -0.577f, 0.577f }
+        };
+        for (const auto& direction : directions) {
+            const float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+            float decoded[3];
+            unpack_direction(pack_direction(direction), decoded);
+            for (uint32_t i = 0; i < 3; ++i) {
+                CHECK(std::abs(decoded[i] - direction[i] / length) < 1e-4f);
+            }
+        }
+    }
+
+    TEST_CASE("BucketsByShadingModel") {
+        MaterialParameters materials[5];
+        materials[0].model = shading_model::Cloth;
+        materials[1].model = shading_model::Lit;
+        materials[2].model = shading_model::Unlit;
+        materials[3].model = shading_model::Cloth;
+        materials[4].model = shading_model::Invalid;
+
+        EncodedMaterials* encoded = EncodeMaterials(materials, 5);
+        REQUIRE(encoded != nullptr);
+        CHECK(encoded->Buckets[uint32_t(shading_model::Cloth)].Count == 2);
+        CHECK(encoded->Buckets[uint32_t(shading_model::Cloth)].Stride == 32);
+        CHECK(encoded->Buckets[uint32_t(shading_model::Unlit)].Stride == 16);
+        // Invalid materials fall back to Lit
+        CHECK(encoded->Buckets[uint32_t(shading_model::Lit)].Count == 2);
+        CHECK(encoded->Buckets[uint32_t(shading_model::Subsurface)].Count == 0);
+        CHECK(encoded->Buckets[uint32_t(shading_model::Subsurface)].Data == nullptr);
+
+        CHECK(MaterialHandleModel(encoded->Handles[3]) == shading_model::Cloth);
+        CHECK(MaterialHandleSlot(encoded->Handles[3]) == 1);
+        CHECK(encoded->Buckets[uint32_t(shading_model::Cloth)].SourceIndices[1] == 3);
+        CHECK(MaterialHandleModel(encoded->Handles[4]) == shading_model::Lit);
+        CHECK(encoded->Buckets[uint32_t(shading_model::Lit)].SourceIndices[MaterialHandleSlot(encoded->Handles[4])] == 4);
+        EncodedMaterials::DestroyEncodedMaterials(encoded);
+    }
+
+    TEST_CASE("RoundTripsWithinQuantizationError") {
+        MaterialParameters source;
+        source.model = shading_model::Subsurface;
+        source.baseColor[0] = 0.8f; source.baseColor[1] = 0.05f; source.baseColor[2] = 0.2f; source.baseColor[3] = 0.5f;
+        source.emissive[0] = 4.0f; source.emissive[3] = 0.25f;
+        source.roughness = 0.35f;
+        source.metallic = 0.1f;
+        source.thickness = 0.75f;
+        source.subsurfacePower = 12.234f;
+        source.subsurfaceColor[1] = 0.25f;
+        source.normal[0] = 0.6f; source.normal[2] = 0.8f;
+
+        EncodedMaterials* encoded = EncodeMaterials(&source, 1);
+        REQUIRE(encoded != nullptr);
+        const MaterialParameters decoded = DecodeMaterial(encoded, encoded->Handles[0]);
+        CHECK(decoded.model == shading_model::Subsurface);
+        for (uint32_t i = 0; i < 3; ++i) {
+            // sRGB steps are finest in the darks: one step is within 1% of the value there, and within 0.5% of 1.0 at the top
+            CHECK(std::abs(decoded.baseColor[i] - source.baseColor[i]) < 0.01f * std::max(source.baseColor[i], 0.5f));
+            CHECK(std::abs(decoded.subsurfaceColor[i] - source.subsurfaceColor[i]) < 0.005f);
+            CHECK(std::abs(decoded.normal[i] - source.normal[i]) < 1e-4f);
+        }
+        CHECK(std::abs(decoded.baseColor[3] - 0.5f) < 1.0f / 255.0f);
+        CHECK(decoded.emissive[0] == 4.0f);
+        CHECK(decoded.emissive[3] == 0.25f);
+        CHECK(std::abs(decoded.roughness - 0.35f) < 1.0f / 255.0f);
+        CHECK(std::abs(decoded.thickness - 0.75f) < 1.0f / 255.0f);
+        CHECK(std::abs(decoded.subsurfacePower - 12.234f) < 0.01f);
+        // Not part of the subsurface encoding
+        CHECK(decoded.sheenColor[0] == MaterialParameters().sheenColor[0]);
+        CHECK(decoded.clearCoat == MaterialParameters().clearCoat);
+        EncodedMaterials::DestroyEncodedMaterials(encoded);
+    }
+}
+
+#endif //!VPSK_TESTING_ENABLED
@@ -0,0 +1,283 @@
+#include "MeshCache.hpp"
+#include "MeshSerialization.hpp"
+#include "AssimpMeshImporter.hpp"
+#include "ImportUtilities.hpp"
+#include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    constexpr uint64_t Prime64_1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t Prime64_2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t Prime64_3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t Prime64_4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t Prime64_5 = 0x27D4EB2F165667C5ull;
+
+    inline uint64_t rotl64(const uint64_t x, const int r) noexcept {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // Unaligned little-endian reads: mapped files and strings carry no alignment guarantees
+    inline uint64_t read64(const uint8_t* p) noexcept {
+        uint64_t result;
+        memcpy(&result, p, sizeof(result));
+        return result;
+    }
+
+    inline uint32_t read32(const uint8_t* p) noexcept {
+        uint32_t result;
+        memcpy(&result, p, sizeof(result));
+        return result;
+    }
+
+    inline uint64_t xxh64_round(uint64_t acc, const uint64_t input) noexcept {
+        acc += input * Prime64_2;
+        acc = rotl64(acc, 31);
+        return acc * Prime64_1;
+    }
+
+    inline uint64_t xxh64_merge_round(uint64_t acc, const uint64_t val) noexcept {
+        acc ^= xxh64_round(0, val);
+        return acc * Prime64_1 + Prime64_4;
+    }
+
+    // Appends the bytes of a value to a settings record, so the record has no padding
+    template<typename T>
+    void append(std::vector<uint8_t>& record, const T& value) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        record.insert(record.end(), bytes, bytes + sizeof(T));
+    }
+
+    std::string lowercase_extension(const std::string& fname) {
+        const size_t separator = fname.find_last_of("/\\");
+        const size_t extension = fname.find_last_of('.');
+        if ((extension == std::string::npos) || ((separator != std::string::npos) && (extension < separator))) {
+            return std::string();
+        }
+        std::string result = fname.substr(extension + 1);
+        std::transform(result.begin(), result.end(), result.begin(), [](const char c) { return static_cast<char>(::tolower(c)); });
+        return result;
+    }
+
+    std::string entry_path(const char* cache_directory, const MeshCacheKey& key) {
+        char name[2 * 16 + 1];
+        snprintf(name, sizeof(name), "%016llx%016llx", static_cast<unsigned long long>(key.Source), static_cast<unsigned long long>(key.Settings));
+        return std::string(cache_directory) + "/" + name + ".hmesh";
+    }
+
+    bool create_directory(const char* path) {
+#ifdef _WIN32
+        const int result = _mkdir(path);
+#else
+        const int result = mkdir(path, 0755);
+#endif
+        return (result == 0) || (errno == EEXIST);
+    }
+
+}
+
+uint64_t HashBytes(const void* data, const size_t size, const uint64_t seed) noexcept {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* const end = p + size;
+    uint64_t result;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + Prime64_1 + Prime64_2;
+        uint64_t v2 = seed + Prime64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - Prime64_1;
+        const uint8_t* const limit = end - 32;
+        do {
+            v1 = xxh64_round(v1, read64(p));
+            v2 = xxh64_round(v2, read64(p + 8));
+            v3 = xxh64_round(v3, read64(p + 16));
+            v4 = xxh64_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        result = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        result = xxh64_merge_round(result, v1);
+        result = xxh64_merge_round(result, v2);
+        result = xxh64_merge_round(result, v3);
+        result = xxh64_merge_round(result, v4);
+    }
+    else {
+        result = seed + Prime64_5;
+    }
+
+    result += static_cast<uint64_t>(size);
+
+    for (; p + 8 <= end; p += 8) {
+        result ^= xxh64_round(0, read64(p));
+        result = rotl64(result, 27) * Prime64_1 + Prime64_4;
+    }
+    if (p + 4 <= end) {
+        result ^= uint64_t(read32(p)) * Prime64_1;
+        result = rotl64(result, 23) * Prime64_2 + Prime64_3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        result ^= uint64_t(*p) * Prime64_5;
+        result = rotl64(result, 11) * Prime64_1;
+    }
+
+    result ^= result >> 33;
+    result *= Prime64_2;
+    result ^= result >> 29;
+    result *= Prime64_3;
+    result ^= result >> 32;
+    return result;
+}
+
+uint64_t HashProcessingOptions(const MeshProcessingOptions& options) noexcept {
+    // Every field that changes the imported mesh must be in here
+    uint8_t record[]{
+        uint8_t(options.Interleaved), uint8_t(options.Use_fp16), uint8_t(options.AllowInt16_Indices),
+        uint8_t(options.Optimize), uint8_t(options.BuildMeshlets),
+        uint8_t(options.PositionQuantization), uint8_t(options.UVQuantization)
+    };
+    uint64_t result = HashBytes(record, sizeof(record));
+    const float floats[]{ options.OverdrawThreshold, options.LODTargetRatio, options.LODMaxError };
+    result = HashBytes(floats, sizeof(floats), result);
+    return HashBytes(&options.LODCount, sizeof(options.LODCount), result);
+}
+
+bool ComputeMeshCacheKey(const char* source_fname, const MeshProcessingOptions& options, MeshCacheKey& key) {
+    std::unique_ptr<MappedFile, decltype(&UnmapFile)> source(MapFile(source_fname), UnmapFile);
+    if (!source) {
+        return false;
+    }
+    key.Source = HashBytes(source->Data, static_cast<size_t>(source->Size));
+
+    // The extension picks the importer (and Assimp's format), so identical bytes can still import differently
+    std::vector<uint8_t> settings;
+    append(settings, LOADER_VERSION);
+    append(settings, MESH_FILE_VERSION);
+    append(settings, HashProcessingOptions(options));
+    const std::string extension = lowercase_extension(source_fname);
+    settings.insert(settings.end(), extension.begin(), extension.end());
+    key.Settings = HashBytes(settings.data(), settings.size());
+    return true;
+}
+
+MeshData* LoadCachedMesh(const char* cache_directory, const MeshCacheKey& key) {
+    return LoadMeshDataFile(entry_path(cache_directory, key).c_str());
+}
+
+bool StoreCachedMesh(const char* cache_directory, const MeshCacheKey& key, const MeshData* mesh) {
+    if (!create_directory(cache_directory)) {
+        LOG(WARNING) << "Couldn't create mesh cache directory " << cache_directory;
+        return false;
+    }
+
+    const std::string path = entry_path(cache_directory, key);
+    if (!WriteMeshDataFileAtomic(path.c_str(), mesh)) {
+        // Windows can't replace an entry another process has mapped: that entry has the same contents anyway
+        std::unique_ptr<MappedFile, decltype(&UnmapFile)> existing(MapFile(path.c_str()), UnmapFile);
+        return existing != nullptr;
+    }
+
+    return true;
+}
+
+#ifdef VPSK_TESTING_ENABLED
+#include "ObjFileImporter.hpp"
+#include <fstream>
+
+TEST_SUITE("MeshCache") {
+    TEST_CASE("HashBytesMatchesXXH64") {
+        CHECK(HashBytes("", 0) == 0xEF46DB3751D8E999ull);
+        CHECK(HashBytes("a", 1) == 0xD24EC4F1A98C6E5Bull);
+        CHECK(HashBytes("abc", 3) == 0x44BC2CF5AD770999ull);
+        const char long_input[] = "Nobody inspects the spammish repetition";
+        CHECK(HashBytes(long_input, sizeof(long_input) - 1) == 0xFBCEA83C8A378BF1ull);
+    }
+
+    TEST_CASE("KeysFollowContentsAndOptions") {
+        constexpr const char* const source_fname = "mesh_cache_test_source.obj";
+        constexpr const char* const copy_fname = "mesh_cache_test_copy.obj";
+        constexpr const char* const contents = "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvt 1 0\nvt 0 1\nvn 0 0 1\nf 1/1/1 2/2/1 3/3/1\n";
+        for (const char* fname : { source_fname, copy_fname }) {
+            std::ofstream output(fname, std::ios::binary | std::ios::trunc);
+            output << contents;
+        }
+
+        MeshProcessingOptions options{ false, false, true };
+        MeshCacheKey key, copy_key, changed_key;
+        REQUIRE(ComputeMeshCacheKey(source_fname, options, key));
+        REQUIRE(ComputeMeshCacheKey(copy_fname, options, copy_key));
+        // Same contents and settings share an entry, wherever the source is
+        CHECK(key.Source == copy_key.Source);
+        CHECK(key.Settings == copy_key.Settings);
+
+        options.LODCount = 2;
+        REQUIRE(ComputeMeshCacheKey(source_fname, options, changed_key));
+        CHECK(changed_key.Source == key.Source);
+        CHECK(changed_key.Settings != key.Settings);
+        options.LODCount = 3;
+
+        {
+            std::ofstream output(copy_fname, std::ios::binary | std::ios::app);
+            output << "f 1/1/1 3/3/1 2/2/1\n";
+        }
+        REQUIRE(ComputeMeshCacheKey(copy_fname, options, changed_key));
+        CHECK(changed_key.Source != key.Source);
+        CHECK(changed_key.Settings == key.Settings);
+        CHECK(!ComputeMeshCacheKey("mesh_cache_test_missing.obj", options, changed_key));
+
+        std::remove(source_fname);
+        std::remove(copy_fname);
+    }
+
+    TEST_CASE("StoresAndLoadsEntries") {
+        constexpr const char* const cache_directory = "mesh_cache_test";
+        constexpr const char* const source_fname = "mesh_cache_test_entry.obj";
+        {
+            std::ofstream output(source_fname, std::ios::binary | std::ios::trunc);
+            output << "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nvt 0 0\nvt 1 0\nvt 0 1\nvt 1 1\nf 1/1 2/2 4/4 3/3\n";
+        }
+
+        MeshProcessingOptions options{ false, false, true };
+        MeshCacheKey key;
+        REQUIRE(ComputeMeshCacheKey(source_fname, options, key));
+        CHECK(LoadCachedMesh(cache_directory, key) == nullptr);
+
+        MeshData* imported = LoadMeshDataFromObj(source_fname, &options);
+        REQUIRE(imported != nullptr);
+        CHECK(StoreCachedMesh(cache_directory, key, imported));
+        // A second writer of the same entry replaces it
+        CHECK(StoreCachedMesh(cache_directory, key, imported));
+
+        MeshData* cached = LoadCachedMesh(cache_directory, key);
+        REQUIRE(cached != nullptr);
+        CHECK(cached->Header.VertexCount == imported->Header.VertexCount);
+        CHECK(cached->Header.IndexCount == imported->Header.IndexCount);
+        CHECK(memcmp(cached->Indices, imported->Indices, cached->Header.IndexDataSize) == 0);
+        MeshData::DestroyMeshData(cached);
+        MeshData::DestroyMeshData(imported);
+
+        std::remove(entry_path(cache_directory, key).c_str());
+        std::remove(source_fname);
+#ifdef _WIN32
+        _rmdir(cache_directory);
+#else
+        rmdir(cache_directory);
+#endif
+    }
+}
+
+#endif //!VPSK_TESTING_ENABLED
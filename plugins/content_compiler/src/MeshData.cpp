@@ -1,29 +1,40 @@
 #include "MeshData.hpp"
+#include "MeshSerialization.hpp"
 #include <vulkan/vulkan.h>
 
 void MeshData::DestroyMeshData(MeshData * mesh) {
 
+    if (mesh->FileMapping) {
+        // Only the pointer tables were allocated: everything else lives in the mapping
+        delete[] mesh->Materials;
+        if (!mesh->Header.Interleaved) {
+            delete reinterpret_cast<UninterleavedVertexData*>(mesh->Vertices);
+        }
+        UnmapMeshDataFile(mesh->FileMapping);
+        delete mesh;
+        return;
+    }
+
     delete[] mesh->Parts;
+    delete[] mesh->Meshlets;
 
     for (uint32_t i = 0; i < mesh->Header.NumMaterials; ++i) {
-        delete[] mesh->Materials[i].Name;       
+        delete[] mesh->Materials[i].Name;
     }
 
     delete[] mesh->Materials;
 
     if (mesh->Header.Interleaved) {
-        Vertex* vertices = reinterpret_cast<Vertex*>(mesh->Vertices);
-        delete[] vertices;
+        delete[] reinterpret_cast<uint8_t*>(mesh->Vertices);
     }
-    else {
+    else if (mesh->Vertices) {
         UninterleavedVertexData* vertices = reinterpret_cast<UninterleavedVertexData*>(mesh->Vertices);
-        delete[] vertices->Positions;
+        delete[] reinterpret_cast<uint8_t*>(vertices->Positions);
         delete[] vertices->Tangents;
         delete[] vertices->Colors;
-        delete[] vertices->UV0s;
-        if (vertices->UV1s) {
-            delete[] vertices->UV1s;
-        }
+        delete[] reinterpret_cast<uint8_t*>(vertices->UV0s);
+        delete[] reinterpret_cast<uint8_t*>(vertices->UV1s);
+        delete vertices;
     }
 
     if (mesh->Header.IndexFormat == VK_INDEX_TYPE_UINT16) {
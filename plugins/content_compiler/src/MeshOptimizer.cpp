@@ -0,0 +1,582 @@
+#include "MeshOptimizer.hpp"
+#include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+    // FIFO cache simulation: a vertex is resident if fewer than cache_size misses happened since it was loaded.
+    // Bumping the clock by more than cache_size empties the cache without touching every timestamp.
+    struct fifo_cache_t {
+        fifo_cache_t(const size_t vertex_count, const uint32_t cache_size) : timestamps(vertex_count, 0), size(cache_size), time(cache_size + 1) {}
+
+        uint32_t access(const uint32_t v) noexcept {
+            if (time - timestamps[v] > size) {
+                timestamps[v] = time++;
+                return 1;
+            }
+            return 0;
+        }
+
+        uint32_t access_triangle(const uint32_t* tri) noexcept {
+            return access(tri[0]) + access(tri[1]) + access(tri[2]);
+        }
+
+        void reset() noexcept {
+            time += size + 1;
+        }
+
+        std::vector<uint32_t> timestamps;
+        uint32_t size;
+        uint32_t time;
+    };
+
+    // Compressed vertex -> triangle adjacency
+    struct triangle_adjacency_t {
+        triangle_adjacency_t(const uint32_t* indices, const size_t index_count, const size_t vertex_count) : offsets(vertex_count + 1, 0), triangles(index_count) {
+            for (size_t i = 0; i < index_count; ++i) {
+                ++offsets[indices[i] + 1];
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < index_count; ++i) {
+                triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        uint32_t count(const uint32_t v) const noexcept {
+            return offsets[v + 1] - offsets[v];
+        }
+
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+    };
+
+    const float* position_at(const fvec4* positions, const size_t stride, const uint32_t idx) noexcept {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + stride * idx);
+    }
+
+    // Permutes elements [first, first + count) of a stream of stride-sized elements
+    void permute_stream(void* data, const size_t stride, const size_t first, const size_t count, const uint32_t* remap) {
+        uint8_t* bytes = reinterpret_cast<uint8_t*>(data) + first * stride;
+        std::vector<uint8_t> permuted(count * stride);
+        for (size_t i = 0; i < count; ++i) {
+            memcpy(permuted.data() + remap[i] * stride, bytes + i * stride, stride);
+        }
+        memcpy(bytes, permuted.data(), count * stride);
+    }
+
+    void permute_vertices(MeshData* mesh, const size_t first, const size_t count, const uint32_t* remap) {
+        const MeshDataHeader& header = mesh->Header;
+        if (header.Interleaved) {
+            permute_stream(mesh->Vertices, header.PositionAttrStride, first, count, remap);
+            return;
+        }
+
+        UninterleavedVertexData* vertices = reinterpret_cast<UninterleavedVertexData*>(mesh->Vertices);
+        permute_stream(vertices->Positions, header.PositionAttrStride, first, count, remap);
+        permute_stream(vertices->Tangents, header.TangentAttrStride, first, count, remap);
+        permute_stream(vertices->UV0s, header.UV0_Stride, first, count, remap);
+        if (vertices->UV1s) {
+            permute_stream(vertices->UV1s, header.UV1_Stride, first, count, remap);
+        }
+    }
+
+    // Parts can only be reordered independently when none of them share vertices
+    bool part_vertex_ranges_disjoint(const MeshData* mesh) {
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        for (uint32_t i = 0; i < mesh->Header.NumParts; ++i) {
+            ranges.emplace_back(mesh->Parts[i].MinIndex, mesh->Parts[i].MaxIndex);
+        }
+        std::sort(ranges.begin(), ranges.end());
+        for (size_t i = 1; i < ranges.size(); ++i) {
+            if (ranges[i].first <= ranges[i - 1].second) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, const size_t index_count, const size_t vertex_count, const uint32_t cache_size) {
+    VertexCacheStats result;
+    if (index_count < 3) {
+        return result;
+    }
+
+    fifo_cache_t cache(vertex_count, cache_size);
+    std::vector<bool> used(vertex_count, false);
+    size_t misses = 0;
+    size_t unique_vertices = 0;
+    for (size_t i = 0; i < index_count; ++i) {
+        misses += cache.access(indices[i]);
+        if (!used[indices[i]]) {
+            used[indices[i]] = true;
+            ++unique_vertices;
+        }
+    }
+
+    result.ACMR = static_cast<float>(misses) / static_cast<float>(index_count / 3);
+    result.ATVR = static_cast<float>(misses) / static_cast<float>(unique_vertices);
+    return result;
+}
+
+void OptimizeVertexCache(uint32_t* dst, const uint32_t* indices, const size_t index_count, const size_t vertex_count, const uint32_t cache_size) {
+    // Tipsify: fan out from a vertex, emitting all its remaining triangles, then move to the vertex (among those
+    // just touched) that is the oldest in the cache while still being certain to be resident once its remaining
+    // triangles are emitted. Dead ends fall back to recently touched vertices, then to input order.
+    const size_t face_count = index_count / 3;
+    triangle_adjacency_t adjacency(indices, face_count * 3, vertex_count);
+    std::vector<uint32_t> live_triangles(vertex_count);
+    for (uint32_t v = 0; v < static_cast<uint32_t>(vertex_count); ++v) {
+        live_triangles[v] = adjacency.count(v);
+    }
+
+    std::vector<bool> emitted(face_count, false);
+    std::vector<uint32_t> timestamps(vertex_count, 0);
+    std::vector<uint32_t> dead_end_stack;
+    std::vector<uint32_t> candidates;
+    uint32_t time = cache_size + 1;
+    uint32_t cursor = 0;
+    size_t output_count = 0;
+
+    auto skip_dead_end = [&]()->uint32_t {
+        while (!dead_end_stack.empty()) {
+            const uint32_t v = dead_end_stack.back();
+            dead_end_stack.pop_back();
+            if (live_triangles[v] > 0) {
+                return v;
+            }
+        }
+        while (cursor < vertex_count) {
+            if (live_triangles[cursor] > 0) {
+                return cursor;
+            }
+            ++cursor;
+        }
+        return std::numeric_limits<uint32_t>::max();
+    };
+
+    uint32_t fanning_vertex = vertex_count > 0 ? skip_dead_end() : std::numeric_limits<uint32_t>::max();
+    while (fanning_vertex != std::numeric_limits<uint32_t>::max()) {
+        candidates.clear();
+        for (uint32_t i = adjacency.offsets[fanning_vertex]; i < adjacency.offsets[fanning_vertex + 1]; ++i) {
+            const uint32_t face = adjacency.triangles[i];
+            if (emitted[face]) {
+                continue;
+            }
+
+            emitted[face] = true;
+            for (size_t j = 0; j < 3; ++j) {
+                const uint32_t v = indices[face * 3 + j];
+                dst[output_count++] = v;
+                dead_end_stack.emplace_back(v);
+                candidates.emplace_back(v);
+                --live_triangles[v];
+                if (time - timestamps[v] > cache_size) {
+                    timestamps[v] = time++;
+                }
+            }
+        }
+
+        uint32_t best_vertex = std::numeric_limits<uint32_t>::max();
+        int64_t best_priority = -1;
+        for (const uint32_t v : candidates) {
+            if (live_triangles[v] == 0) {
+                continue;
+            }
+            // Vertices that would fall out of the cache before their fan finishes get the lowest priority
+            int64_t priority = 0;
+            if (int64_t(time) - int64_t(timestamps[v]) + 2 * int64_t(live_triangles[v]) <= int64_t(cache_size)) {
+                priority = int64_t(time) - int64_t(timestamps[v]);
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                best_vertex = v;
+            }
+        }
+
+        fanning_vertex = best_vertex != std::numeric_limits<uint32_t>::max() ? best_vertex : skip_dead_end();
+    }
+}
+
+void OptimizeOverdraw(uint32_t* dst, const uint32_t* indices, const size_t index_count, const fvec4* positions, const size_t positions_stride,
+    const size_t vertex_count, const float threshold, const uint32_t cache_size) {
+    const size_t face_count = index_count / 3;
+    if (face_count == 0) {
+        return;
+    }
+
+    // Hard boundaries: triangles sharing no vertex with the cache, where cache order can be broken for free
+    std::vector<uint32_t> hard_clusters;
+    {
+        fifo_cache_t cache(vertex_count, cache_size);
+        for (size_t i = 0; i < face_count; ++i) {
+            if ((cache.access_triangle(indices + i * 3) == 3) || (i == 0)) {
+                hard_clusters.emplace_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
+    hard_clusters.emplace_back(static_cast<uint32_t>(face_count));
+
+    // Soft boundaries: split clusters further wherever the prefix is already within threshold of the whole
+    // cluster's miss ratio, so breaking there gives up little cache efficiency
+    std::vector<uint32_t> clusters;
+    {
+        fifo_cache_t cache(vertex_count, cache_size);
+        for (size_t c = 0; c + 1 < hard_clusters.size(); ++c) {
+            const uint32_t start = hard_clusters[c];
+            const uint32_t end = hard_clusters[c + 1];
+
+            cache.reset();
+            uint32_t cluster_misses = 0;
+            for (uint32_t i = start; i < end; ++i) {
+                cluster_misses += cache.access_triangle(indices + i * 3);
+            }
+            const float cluster_threshold = threshold * static_cast<float>(cluster_misses) / static_cast<float>(end - start);
+
+            cache.reset();
+            clusters.emplace_back(start);
+            uint32_t sub_start = start;
+            uint32_t misses = 0;
+            for (uint32_t i = start; i < end; ++i) {
+                misses += cache.access_triangle(indices + i * 3);
+                if ((i + 1 < end) && (static_cast<float>(misses) / static_cast<float>(i + 1 - sub_start) <= cluster_threshold)) {
+                    clusters.emplace_back(i + 1);
+                    cache.reset();
+                    misses = 0;
+                    sub_start = i + 1;
+                }
+            }
+        }
+    }
+    clusters.emplace_back(static_cast<uint32_t>(face_count));
+
+    // Clusters facing away from the mesh center are likely to occlude the rest, so draw them first
+    double mesh_center[3]{ 0.0, 0.0, 0.0 };
+    for (size_t i = 0; i < vertex_count; ++i) {
+        const float* p = position_at(positions, positions_stride, static_cast<uint32_t>(i));
+        mesh_center[0] += p[0];
+        mesh_center[1] += p[1];
+        mesh_center[2] += p[2];
+    }
+    for (double& c : mesh_center) {
+        c /= static_cast<double>(std::max<size_t>(vertex_count, 1));
+    }
+
+    const size_t num_clusters = clusters.size() - 1;
+    std::vector<float> sort_keys(num_clusters);
+    for (size_t c = 0; c < num_clusters; ++c) {
+        double center[3]{ 0.0, 0.0, 0.0 };
+        double normal[3]{ 0.0, 0.0, 0.0 };
+        double area_sum = 0.0;
+        for (uint32_t i = clusters[c]; i < clusters[c + 1]; ++i) {
+            const float* p0 = position_at(positions, positions_stride, indices[i * 3 + 0]);
+            const float* p1 = position_at(positions, positions_stride, indices[i * 3 + 1]);
+            const float* p2 = position_at(positions, positions_stride, indices[i * 3 + 2]);
+            const double e1[3]{ p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const double e2[3]{ p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const double n[3]{ e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (size_t j = 0; j < 3; ++j) {
+                center[j] += (p0[j] + p1[j] + p2[j]) * (area / 3.0);
+                normal[j] += n[j];
+            }
+            area_sum += area;
+        }
+
+        const double inv_area = area_sum > 0.0 ? 1.0 / area_sum : 0.0;
+        const double normal_length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        const double inv_normal_length = normal_length > 0.0 ? 1.0 / normal_length : 0.0;
+        double key = 0.0;
+        for (size_t j = 0; j < 3; ++j) {
+            key += (center[j] * inv_area - mesh_center[j]) * normal[j] * inv_normal_length;
+        }
+        sort_keys[c] = static_cast<float>(key);
+    }
+
+    std::vector<uint32_t> order(num_clusters);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sort_keys](const uint32_t a, const uint32_t b) {
+        return sort_keys[a] > sort_keys[b];
+    });
+
+    size_t output_count = 0;
+    for (const uint32_t c : order) {
+        const size_t count = (clusters[c + 1] - clusters[c]) * 3;
+        memcpy(dst + output_count, indices + clusters[c] * 3, count * sizeof(uint32_t));
+        output_count += count;
+    }
+}
+
+void OptimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, const size_t index_count, const size_t vertex_count) {
+    constexpr uint32_t unassigned = std::numeric_limits<uint32_t>::max();
+    std::fill(remap, remap + vertex_count, unassigned);
+    uint32_t next_vertex = 0;
+    for (size_t i = 0; i < index_count; ++i) {
+        if (remap[indices[i]] == unassigned) {
+            remap[indices[i]] = next_vertex++;
+        }
+    }
+    for (size_t i = 0; i < vertex_count; ++i) {
+        if (remap[i] == unassigned) {
+            remap[i] = next_vertex++;
+        }
+    }
+}
+
+std::vector<PartOptimizationStats> OptimizeMeshData(MeshData* mesh, const float overdraw_threshold) {
+    const MeshDataHeader& header = mesh->Header;
+    std::vector<PartOptimizationStats> result(header.NumParts);
+    const bool reorder_vertices = part_vertex_ranges_disjoint(mesh);
+    if (!reorder_vertices) {
+        LOG(WARNING) << "Mesh parts share vertices: vertex fetch order will not be optimized.";
+    }
+
+    // Overdraw ordering needs float positions: quantized meshes only get cache and fetch optimization
+    const bool float_positions = header.PositionAttrFormat == VK_FORMAT_R32G32B32A32_SFLOAT;
+    const uint8_t* vertex_data = reinterpret_cast<const uint8_t*>(header.Interleaved ? mesh->Vertices :
+        reinterpret_cast<const UninterleavedVertexData*>(mesh->Vertices)->Positions);
+    const fvec4* positions = reinterpret_cast<const fvec4*>(vertex_data + (header.Interleaved ? header.PositionAttrOffset : 0));
+    const size_t positions_stride = header.PositionAttrStride;
+    uint16_t* indices16 = reinterpret_cast<uint16_t*>(mesh->Indices);
+    uint32_t* indices32 = reinterpret_cast<uint32_t*>(mesh->Indices);
+    const bool index_16 = header.IndexFormat == VK_INDEX_TYPE_UINT16;
+
+    std::vector<uint32_t> local_indices;
+    std::vector<uint32_t> scratch;
+    std::vector<uint32_t> reordered;
+    std::vector<uint32_t> remap;
+    for (uint32_t i = 0; i < header.NumParts; ++i) {
+        const PartData& part = mesh->Parts[i];
+        if ((part.IndexCount % 3 != 0) || (part.MaxIndex < part.MinIndex)) {
+            LOG(WARNING) << "Part " << i << " is not an indexed triangle list, skipping optimization.";
+            continue;
+        }
+
+        const size_t vertex_count = size_t(part.MaxIndex - part.MinIndex) + 1;
+        local_indices.resize(part.IndexCount);
+        bool in_range = true;
+        for (uint32_t j = 0; j < part.IndexCount; ++j) {
+            const uint32_t idx = index_16 ? indices16[part.IndexOffset + j] : indices32[part.IndexOffset + j];
+            in_range &= (idx >= part.MinIndex) && (idx <= part.MaxIndex);
+            local_indices[j] = idx - part.MinIndex;
+        }
+
+        if (!in_range) {
+            LOG(WARNING) << "Part " << i << " references vertices outside of its index range, skipping optimization.";
+            continue;
+        }
+
+        result[i].Before = AnalyzeVertexCache(local_indices.data(), local_indices.size(), vertex_count);
+
+        scratch.resize(local_indices.size());
+        reordered.resize(local_indices.size());
+        if (float_positions) {
+            OptimizeVertexCache(scratch.data(), local_indices.data(), local_indices.size(), vertex_count);
+            const fvec4* part_positions = reinterpret_cast<const fvec4*>(position_at(positions, positions_stride, part.MinIndex));
+            OptimizeOverdraw(reordered.data(), scratch.data(), scratch.size(), part_positions, positions_stride, vertex_count, overdraw_threshold);
+        }
+        else {
+            OptimizeVertexCache(reordered.data(), local_indices.data(), local_indices.size(), vertex_count);
+        }
+
+        // Input that is already well ordered (e.g. small scanline-ordered grids) can beat Tipsify: keep it then
+        if (AnalyzeVertexCache(reordered.data(), reordered.size(), vertex_count).ACMR < result[i].Before.ACMR) {
+            local_indices.swap(reordered);
+        }
+
+        if (reorder_vertices) {
+            remap.resize(vertex_count);
+            OptimizeVertexFetchRemap(remap.data(), local_indices.data(), local_indices.size(), vertex_count);
+            for (uint32_t& idx : local_indices) {
+                idx = remap[idx];
+            }
+            permute_vertices(mesh, part.MinIndex, vertex_count, remap.data());
+        }
+
+        result[i].After = AnalyzeVertexCache(local_indices.data(), local_indices.size(), vertex_count);
+
+        for (uint32_t j = 0; j < part.IndexCount; ++j) {
+            if (index_16) {
+                indices16[part.IndexOffset + j] = static_cast<uint16_t>(local_indices[j] + part.MinIndex);
+            }
+            else {
+                indices32[part.IndexOffset + j] = local_indices[j] + part.MinIndex;
+            }
+        }
+
+        LOG(INFO) << "Optimized part " << i << " (" << part.IndexCount / 3 << " triangles): ACMR " << result[i].Before.ACMR << " -> " <<
+            result[i].After.ACMR << ", ATVR " << result[i].Before.ATVR << " -> " << result[i].After.ATVR;
+    }
+
+    return result;
+}
+
+#ifdef VPSK_TESTING_ENABLED
+#include <random>
+#include <set>
+#include <array>
+
+TEST_SUITE("MeshOptimizer") {
+
+    struct test_grid_t {
+        std::vector<fvec4> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // Grid of quads with triangles in random order, the worst case for the vertex cache
+    static test_grid_t make_shuffled_grid(const uint32_t size, const uint32_t seed) {
+        test_grid_t result;
+        for (uint32_t y = 0; y <= size; ++y) {
+            for (uint32_t x = 0; x <= size; ++x) {
+                result.positions.emplace_back(static_cast<float>(x), static_cast<float>(y), 0.0f, 1.0f);
+            }
+        }
+
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                const uint32_t i = y * (size + 1) + x;
+                triangles.push_back({ i, i + 1, i + size + 1 });
+                triangles.push_back({ i + 1, i + size + 2, i + size + 1 });
+            }
+        }
+
+        std::mt19937 rng(seed);
+        std::shuffle(triangles.begin(), triangles.end(), rng);
+        for (const auto& tri : triangles) {
+            result.indices.insert(result.indices.end(), tri.begin(), tri.end());
+        }
+        return result;
+    }
+
+    // Triangles as rotation-invariant tuples (smallest index first), to compare meshes regardless of order
+    static std::multiset<std::array<uint32_t, 3>> triangle_set(const std::vector<uint32_t>& indices, const std::vector<fvec4>& positions) {
+        std::multiset<std::array<uint32_t, 3>> result;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            std::array<uint32_t, 3> tri;
+            for (size_t j = 0; j < 3; ++j) {
+                // Identify vertices by position, so the check also holds across vertex reordering
+                const fvec4& p = positions[indices[i + j]];
+                tri[j] = static_cast<uint32_t>(p.x()) * 65536u + static_cast<uint32_t>(p.y());
+            }
+            std::rotate(tri.begin(), std::min_element(tri.begin(), tri.end()), tri.end());
+            result.insert(tri);
+        }
+        return result;
+    }
+
+    TEST_CASE("VertexCacheOptimizationImprovesACMR") {
+        const test_grid_t grid = make_shuffled_grid(64, 3);
+        const VertexCacheStats before = AnalyzeVertexCache(grid.indices.data(), grid.indices.size(), grid.positions.size());
+        std::vector<uint32_t> optimized(grid.indices.size());
+        OptimizeVertexCache(optimized.data(), grid.indices.data(), grid.indices.size(), grid.positions.size());
+        const VertexCacheStats after = AnalyzeVertexCache(optimized.data(), optimized.size(), grid.positions.size());
+
+        CHECK(before.ACMR > 2.0f);
+        CHECK(after.ACMR < 0.8f);
+        CHECK(after.ATVR < 1.6f);
+        CHECK(triangle_set(optimized, grid.positions) == triangle_set(grid.indices, grid.positions));
+    }
+
+    TEST_CASE("OverdrawOptimizationKeepsTrianglesAndMostCacheEfficiency") {
+        const test_grid_t grid = make_shuffled_grid(64, 5);
+        std::vector<uint32_t> cache_optimized(grid.indices.size());
+        OptimizeVertexCache(cache_optimized.data(), grid.indices.data(), grid.indices.size(), grid.positions.size());
+        std::vector<uint32_t> optimized(grid.indices.size());
+        OptimizeOverdraw(optimized.data(), cache_optimized.data(), cache_optimized.size(), grid.positions.data(), sizeof(fvec4),
+            grid.positions.size(), 1.05f);
+
+        const VertexCacheStats cache_stats = AnalyzeVertexCache(cache_optimized.data(), cache_optimized.size(), grid.positions.size());
+        const VertexCacheStats overdraw_stats = AnalyzeVertexCache(optimized.data(), optimized.size(), grid.positions.size());
+        CHECK(overdraw_stats.ACMR <= cache_stats.ACMR * 1.25f);
+        CHECK(triangle_set(optimized, grid.positions) == triangle_set(grid.indices, grid.positions));
+    }
+
+    TEST_CASE("VertexFetchRemapFollowsFirstUse") {
+        const std::vector<uint32_t> indices{ 4, 2, 0, 2, 4, 5 };
+        std::vector<uint32_t> remap(7);
+        OptimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), remap.size());
+        const std::vector<uint32_t> expected{ 2, 4, 1, 5, 0, 3, 6 };
+        CHECK(remap == expected);
+    }
+
+    TEST_CASE("OptimizeMeshDataPreservesGeometry") {
+        const test_grid_t first = make_shuffled_grid(8, 11);
+        const test_grid_t second = make_shuffled_grid(16, 13);
+
+        std::vector<fvec4> positions(first.positions);
+        positions.insert(positions.end(), second.positions.begin(), second.positions.end());
+        std::vector<int16_t> tangents(positions.size() * 4);
+        std::vector<fvec2> uvs(positions.size());
+        for (size_t i = 0; i < positions.size(); ++i) {
+            // Tag attributes with their position, so we can check streams are permuted together
+            uvs[i] = fvec2(positions[i].x(), positions[i].y());
+            tangents[i * 4] = static_cast<int16_t>(positions[i].x());
+            tangents[i * 4 + 1] = static_cast<int16_t>(positions[i].y());
+        }
+
+        std::vector<uint32_t> indices(first.indices);
+        for (const uint32_t idx : second.indices) {
+            indices.emplace_back(idx + static_cast<uint32_t>(first.positions.size()));
+        }
+        const std::vector<uint32_t> original_indices(indices);
+        const std::vector<fvec4> original_positions(positions);
+
+        PartData parts[2];
+        parts[0].IndexOffset = 0;
+        parts[0].IndexCount = static_cast<uint32_t>(first.indices.size());
+        parts[0].MinIndex = 0;
+        parts[0].MaxIndex = static_cast<uint32_t>(first.positions.size() - 1);
+        parts[1].IndexOffset = parts[0].IndexCount;
+        parts[1].IndexCount = static_cast<uint32_t>(second.indices.size());
+        parts[1].MinIndex = parts[0].MaxIndex + 1;
+        parts[1].MaxIndex = static_cast<uint32_t>(positions.size() - 1);
+
+        UninterleavedVertexData streams;
+        streams.Positions = positions.data();
+        streams.Tangents = tangents.data();
+        streams.UV0s = uvs.data();
+
+        MeshData mesh;
+        mesh.Header.NumParts = 2;
+        mesh.Header.Interleaved = 0;
+        mesh.Header.IndexFormat = VK_INDEX_TYPE_UINT32;
+        mesh.Header.PositionAttrFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+        mesh.Header.PositionAttrOffset = 0;
+        mesh.Header.PositionAttrStride = sizeof(fvec4);
+        mesh.Header.TangentAttrStride = sizeof(int16_t) * 4;
+        mesh.Header.UV0_Stride = sizeof(fvec2);
+        mesh.Parts = parts;
+        mesh.Vertices = &streams;
+        mesh.Indices = indices.data();
+
+        const std::vector<PartOptimizationStats> stats = OptimizeMeshData(&mesh, 1.05f);
+        REQUIRE(stats.size() == 2);
+        for (const auto& part_stats : stats) {
+            CHECK(part_stats.After.ACMR < part_stats.Before.ACMR);
+            CHECK(part_stats.After.ATVR < part_stats.Before.ATVR);
+        }
+
+        for (size_t i = 0; i < positions.size(); ++i) {
+            CHECK(uvs[i].x() == positions[i].x());
+            CHECK(tangents[i * 4 + 1] == static_cast<int16_t>(positions[i].y()));
+        }
+
+        // Vertices stay within their part, and every triangle is still there
+        for (size_t i = 0; i < parts[0].IndexCount; ++i) {
+            CHECK(indices[i] <= parts[0].MaxIndex);
+        }
+        CHECK(triangle_set(indices, positions) == triangle_set(original_indices, original_positions));
+    }
+
+}
+
+#endif //!VPSK_TESTING_ENABLED
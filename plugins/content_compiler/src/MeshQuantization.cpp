@@ -0,0 +1,477 @@
+#include "MeshQuantization.hpp"
+#include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+    constexpr uint32_t absent_attribute = 0xffffffff;
+    constexpr uint16_t half_one = 0x3c00;
+    constexpr uint16_t unorm16_one = 0xffff;
+
+    uint16_t float_to_unorm16(const float value) noexcept {
+        return static_cast<uint16_t>(std::round(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f));
+    }
+
+    float unorm16_to_float(const uint16_t value) noexcept {
+        return static_cast<float>(value) / 65535.0f;
+    }
+
+    size_t position_size(const VertexQuantization quantization) noexcept {
+        return quantization == VertexQuantization::None ? sizeof(float) * 4 : sizeof(uint16_t) * 4;
+    }
+
+    size_t uv_size(const VertexQuantization quantization) noexcept {
+        return quantization == VertexQuantization::None ? sizeof(float) * 2 : sizeof(uint16_t) * 2;
+    }
+
+    struct stream_view_t {
+        const uint8_t* data;
+        size_t stride;
+        const float* operator[](const size_t idx) const noexcept {
+            return reinterpret_cast<const float*>(data + stride * idx);
+        }
+    };
+
+    // Writes one position and returns the largest error over its components
+    float quantize_position(const float* src, const VertexQuantization quantization, const float* center, const float* half_extent, uint8_t* dst) noexcept {
+        float error = 0.0f;
+        if (quantization == VertexQuantization::None) {
+            memcpy(dst, src, sizeof(float) * 4);
+            return error;
+        }
+
+        uint16_t packed[4];
+        for (size_t i = 0; i < 3; ++i) {
+            float decoded = 0.0f;
+            if (quantization == VertexQuantization::Float16) {
+                packed[i] = FloatToHalf(src[i]);
+                decoded = HalfToFloat(packed[i]);
+            }
+            else {
+                const float normalized = half_extent[i] > 0.0f ? ((src[i] - center[i]) / half_extent[i]) * 0.5f + 0.5f : 0.5f;
+                packed[i] = float_to_unorm16(normalized);
+                decoded = center[i] + (2.0f * unorm16_to_float(packed[i]) - 1.0f) * half_extent[i];
+            }
+            error = std::max(error, std::abs(decoded - src[i]));
+        }
+        packed[3] = quantization == VertexQuantization::Float16 ? half_one : unorm16_one;
+        memcpy(dst, packed, sizeof(packed));
+        return error;
+    }
+
+    float quantize_uv(const float* src, const VertexQuantization quantization, uint8_t* dst) noexcept {
+        float error = 0.0f;
+        if (quantization == VertexQuantization::None) {
+            memcpy(dst, src, sizeof(float) * 2);
+            return error;
+        }
+
+        uint16_t packed[2];
+        for (size_t i = 0; i < 2; ++i) {
+            packed[i] = quantization == VertexQuantization::Float16 ? FloatToHalf(src[i]) : float_to_unorm16(src[i]);
+            const float decoded = quantization == VertexQuantization::Float16 ? HalfToFloat(packed[i]) : unorm16_to_float(packed[i]);
+            error = std::max(error, std::abs(decoded - src[i]));
+        }
+        memcpy(dst, packed, sizeof(packed));
+        return error;
+    }
+
+    VertexQuantization uv_stream_quantization(const stream_view_t& uvs, const size_t count, const VertexQuantization requested) {
+        if (requested != VertexQuantization::Unorm16) {
+            return requested;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            const float* uv = uvs[i];
+            if ((uv[0] < 0.0f) || (uv[0] > 1.0f) || (uv[1] < 0.0f) || (uv[1] > 1.0f)) {
+                LOG(WARNING) << "Texture coordinates outside of [0, 1] can't be stored as unorm16: using fp16 instead.";
+                return VertexQuantization::Float16;
+            }
+        }
+
+        return requested;
+    }
+
+}
+
+uint16_t FloatToHalf(const float value) noexcept {
+    // Based on Fabian Giesen's float_to_half_fast3_rtne
+    constexpr uint32_t float_infinity = 255u << 23;
+    constexpr uint32_t half_overflow = (127u + 16u) << 23;
+    constexpr uint32_t denorm_magic_bits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t result;
+    if (bits >= half_overflow) {
+        result = bits > float_infinity ? 0x7e00 : 0x7c00;
+    }
+    else if (bits < (113u << 23)) {
+        // Result is a half subnormal: let the FPU do the rounding by adding a magic number
+        float denorm_magic;
+        memcpy(&denorm_magic, &denorm_magic_bits, sizeof(float));
+        float shifted;
+        memcpy(&shifted, &bits, sizeof(float));
+        shifted += denorm_magic;
+        memcpy(&bits, &shifted, sizeof(float));
+        result = static_cast<uint16_t>(bits - denorm_magic_bits);
+    }
+    else {
+        const uint32_t mantissa_odd = (bits >> 13) & 1u;
+        bits += (uint32_t(15 - 127) << 23) + 0xfffu;
+        bits += mantissa_odd;
+        result = static_cast<uint16_t>(bits >> 13);
+    }
+
+    return static_cast<uint16_t>(result | (sign >> 16));
+}
+
+float HalfToFloat(const uint16_t value) noexcept {
+    const uint32_t sign = uint32_t(value & 0x8000u) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1fu;
+    const uint32_t mantissa = value & 0x3ffu;
+
+    if (exponent == 0) {
+        const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+
+    const uint32_t bits = exponent == 0x1fu ? (sign | 0x7f800000u | (mantissa << 13)) : (sign | ((exponent + 112u) << 23) | (mantissa << 13));
+    float result;
+    memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+uint32_t QuantizedPositionFormat(const VertexQuantization quantization) noexcept {
+    switch (quantization) {
+    case VertexQuantization::Float16:
+        return uint32_t(VK_FORMAT_R16G16B16A16_SFLOAT);
+    case VertexQuantization::Unorm16:
+        return uint32_t(VK_FORMAT_R16G16B16A16_UNORM);
+    default:
+        return uint32_t(VK_FORMAT_R32G32B32A32_SFLOAT);
+    }
+}
+
+uint32_t QuantizedUVFormat(const VertexQuantization quantization) noexcept {
+    switch (quantization) {
+    case VertexQuantization::Float16:
+        return uint32_t(VK_FORMAT_R16G16_SFLOAT);
+    case VertexQuantization::Unorm16:
+        return uint32_t(VK_FORMAT_R16G16_UNORM);
+    default:
+        return uint32_t(VK_FORMAT_R32G32_SFLOAT);
+    }
+}
+
+void ResolveQuantization(const MeshProcessingOptions& options, VertexQuantization& positions, VertexQuantization& uvs) noexcept {
+    positions = options.PositionQuantization;
+    uvs = options.UVQuantization;
+    if (options.Use_fp16) {
+        positions = positions == VertexQuantization::None ? VertexQuantization::Float16 : positions;
+        uvs = uvs == VertexQuantization::None ? VertexQuantization::Float16 : uvs;
+    }
+}
+
+std::vector<PartQuantizationError> QuantizeMeshData(MeshData* mesh, const VertexQuantization positions, const VertexQuantization uvs) {
+    MeshDataHeader& header = mesh->Header;
+    std::vector<PartQuantizationError> result(header.NumParts);
+    if ((positions == VertexQuantization::None) && (uvs == VertexQuantization::None)) {
+        return result;
+    }
+
+    if ((header.PositionAttrFormat != uint32_t(VK_FORMAT_R32G32B32A32_SFLOAT)) || (header.UV0_Format != uint32_t(VK_FORMAT_R32G32_SFLOAT))) {
+        LOG(WARNING) << "Mesh vertex data is already quantized.";
+        return result;
+    }
+
+    if (mesh->FileMapping) {
+        LOG(ERROR) << "Can't quantize vertex data of a memory-mapped mesh file in place.";
+        return result;
+    }
+
+    const size_t count = header.VertexCount;
+    const bool has_uv1 = !header.Interleaved && (header.UV1_Offset != absent_attribute);
+    UninterleavedVertexData* streams = header.Interleaved ? nullptr : reinterpret_cast<UninterleavedVertexData*>(mesh->Vertices);
+    const uint8_t* interleaved = header.Interleaved ? reinterpret_cast<const uint8_t*>(mesh->Vertices) : nullptr;
+
+    const stream_view_t src_positions{ header.Interleaved ? interleaved + header.PositionAttrOffset : reinterpret_cast<const uint8_t*>(streams->Positions), header.PositionAttrStride };
+    const stream_view_t src_uv0s{ header.Interleaved ? interleaved + header.UV0_Offset : reinterpret_cast<const uint8_t*>(streams->UV0s), header.UV0_Stride };
+    const stream_view_t src_uv1s{ has_uv1 ? reinterpret_cast<const uint8_t*>(streams->UV1s) : nullptr, header.UV1_Stride };
+
+    const VertexQuantization uv0_quantization = uv_stream_quantization(src_uv0s, count, uvs);
+    const VertexQuantization uv1_quantization = has_uv1 ? uv_stream_quantization(src_uv1s, count, uvs) : VertexQuantization::None;
+    const size_t dst_position_size = position_size(positions);
+    const size_t dst_tangent_size = sizeof(int16_t) * 4;
+    const size_t dst_uv0_size = uv_size(uv0_quantization);
+    const size_t dst_uv1_size = uv_size(uv1_quantization);
+
+    // Interleaved output is one buffer with all attributes per vertex, uninterleaved output gets a new buffer
+    // per stream (tangents are left as they are)
+    uint8_t* dst_interleaved = nullptr;
+    uint8_t* dst_positions = nullptr;
+    uint8_t* dst_uv0s = nullptr;
+    uint8_t* dst_uv1s = nullptr;
+    size_t dst_position_stride = dst_position_size;
+    size_t dst_uv0_stride = dst_uv0_size;
+    if (header.Interleaved) {
+        const size_t stride = dst_position_size + dst_tangent_size + dst_uv0_size;
+        dst_interleaved = new uint8_t[count * stride];
+        dst_positions = dst_interleaved;
+        dst_uv0s = dst_interleaved + dst_position_size + dst_tangent_size;
+        dst_position_stride = stride;
+        dst_uv0_stride = stride;
+        const uint8_t* src_tangents = interleaved + header.TangentAttrOffset;
+        for (size_t i = 0; i < count; ++i) {
+            memcpy(dst_interleaved + i * stride + dst_position_size, src_tangents + i * header.TangentAttrStride, dst_tangent_size);
+        }
+    }
+    else {
+        dst_positions = new uint8_t[count * dst_position_size];
+        dst_uv0s = new uint8_t[count * dst_uv0_size];
+        dst_uv1s = has_uv1 ? new uint8_t[count * dst_uv1_size] : nullptr;
+    }
+
+    std::vector<float> position_errors(count);
+    std::vector<float> uv_errors(count);
+    for (size_t i = 0; i < count; ++i) {
+        position_errors[i] = quantize_position(src_positions[i], positions, header.Center, header.HalfExtent, dst_positions + i * dst_position_stride);
+        uv_errors[i] = quantize_uv(src_uv0s[i], uv0_quantization, dst_uv0s + i * dst_uv0_stride);
+        if (has_uv1) {
+            uv_errors[i] = std::max(uv_errors[i], quantize_uv(src_uv1s[i], uv1_quantization, dst_uv1s + i * dst_uv1_size));
+        }
+    }
+
+    if (header.Interleaved) {
+        delete[] reinterpret_cast<uint8_t*>(mesh->Vertices);
+        mesh->Vertices = dst_interleaved;
+        header.PositionAttrOffset = 0;
+        header.TangentAttrOffset = static_cast<uint32_t>(dst_position_size);
+        header.UV0_Offset = static_cast<uint32_t>(dst_position_size + dst_tangent_size);
+        header.PositionAttrStride = static_cast<uint32_t>(dst_position_stride);
+        header.TangentAttrStride = static_cast<uint32_t>(dst_position_stride);
+        header.UV0_Stride = static_cast<uint32_t>(dst_position_stride);
+        header.VertexDataSize = static_cast<uint32_t>(count * dst_position_stride);
+    }
+    else {
+        delete[] reinterpret_cast<uint8_t*>(streams->Positions);
+        delete[] reinterpret_cast<uint8_t*>(streams->UV0s);
+        delete[] reinterpret_cast<uint8_t*>(streams->UV1s);
+        streams->Positions = dst_positions;
+        streams->UV0s = dst_uv0s;
+        streams->UV1s = dst_uv1s;
+        header.PositionAttrOffset = 0;
+        header.PositionAttrStride = static_cast<uint32_t>(dst_position_size);
+        header.TangentAttrOffset = static_cast<uint32_t>(count * dst_position_size);
+        header.TangentAttrStride = static_cast<uint32_t>(dst_tangent_size);
+        header.UV0_Offset = static_cast<uint32_t>(header.TangentAttrOffset + count * dst_tangent_size);
+        header.UV0_Stride = static_cast<uint32_t>(dst_uv0_size);
+        size_t end = header.UV0_Offset + count * dst_uv0_size;
+        if (has_uv1) {
+            header.UV1_Offset = static_cast<uint32_t>(end);
+            header.UV1_Stride = static_cast<uint32_t>(dst_uv1_size);
+            header.UV1_Format = QuantizedUVFormat(uv1_quantization);
+            end += count * dst_uv1_size;
+        }
+        header.VertexDataSize = static_cast<uint32_t>(end);
+    }
+    header.PositionAttrFormat = QuantizedPositionFormat(positions);
+    header.UV0_Format = QuantizedUVFormat(uv0_quantization);
+
+    for (uint32_t i = 0; i < header.NumParts; ++i) {
+        const PartData& part = mesh->Parts[i];
+        const size_t end = std::min<size_t>(size_t(part.MaxIndex) + 1, count);
+        for (size_t j = part.MinIndex; j < end; ++j) {
+            result[i].Position = std::max(result[i].Position, position_errors[j]);
+            result[i].UV = std::max(result[i].UV, uv_errors[j]);
+        }
+        LOG(INFO) << "Quantized part " << i << ": max position error " << result[i].Position << ", max UV error " << result[i].UV;
+    }
+
+    return result;
+}
+
+std::vector<fvec4> DecodePositions(const MeshData* mesh) {
+    const MeshDataHeader& header = mesh->Header;
+    const uint8_t* data = header.Interleaved ? reinterpret_cast<const uint8_t*>(mesh->Vertices) + header.PositionAttrOffset :
+        reinterpret_cast<const uint8_t*>(reinterpret_cast<const UninterleavedVertexData*>(mesh->Vertices)->Positions);
+    std::vector<fvec4> result(header.VertexCount);
+
+    for (size_t i = 0; i < result.size(); ++i) {
+        const uint8_t* src = data + i * header.PositionAttrStride;
+        if (header.PositionAttrFormat == uint32_t(VK_FORMAT_R32G32B32A32_SFLOAT)) {
+            float position[4];
+            memcpy(position, src, sizeof(position));
+            result[i] = fvec4(position[0], position[1], position[2], 1.0f);
+            continue;
+        }
+
+        uint16_t packed[4];
+        memcpy(packed, src, sizeof(packed));
+        for (size_t j = 0; j < 3; ++j) {
+            result[i][j] = header.PositionAttrFormat == uint32_t(VK_FORMAT_R16G16B16A16_SFLOAT) ? HalfToFloat(packed[j]) :
+                header.Center[j] + (2.0f * unorm16_to_float(packed[j]) - 1.0f) * header.HalfExtent[j];
+        }
+        result[i][3] = 1.0f;
+    }
+
+    return result;
+}
+
+#ifdef VPSK_TESTING_ENABLED
+
+TEST_SUITE("MeshQuantization") {
+
+    TEST_CASE("HalfConversion") {
+        CHECK(FloatToHalf(0.0f) == 0x0000);
+        CHECK(FloatToHalf(-0.0f) == 0x8000);
+        CHECK(FloatToHalf(1.0f) == 0x3c00);
+        CHECK(FloatToHalf(-2.0f) == 0xc000);
+        CHECK(FloatToHalf(65504.0f) == 0x7bff);
+        CHECK(FloatToHalf(65520.0f) == 0x7c00);
+        CHECK(FloatToHalf(1e10f) == 0x7c00);
+        CHECK((FloatToHalf(std::nanf("")) & 0x7fff) > 0x7c00);
+        // Smallest subnormal, and a tie between 1 and the next half (1 + 2^-10) that rounds to even
+        CHECK(FloatToHalf(std::ldexp(1.0f, -24)) == 0x0001);
+        CHECK(FloatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3c00);
+        CHECK(FloatToHalf(1.0f + 3.0f * std::ldexp(1.0f, -11)) == 0x3c02);
+
+        // Every finite half survives a round trip
+        for (uint32_t h = 0; h < 0x10000; ++h) {
+            if ((h & 0x7c00) == 0x7c00) {
+                continue;
+            }
+            REQUIRE(FloatToHalf(HalfToFloat(static_cast<uint16_t>(h))) == h);
+        }
+    }
+
+    static std::vector<float> make_interleaved_vertices(const size_t count) {
+        // Matches the layout of Vertex: 4 position floats, 4 snorm16 tangents (2 floats worth), 2 UV floats
+        std::vector<float> result(count * 8);
+        for (size_t i = 0; i < count; ++i) {
+            float* v = result.data() + i * 8;
+            v[0] = -3.0f + 0.37f * static_cast<float>(i);
+            v[1] = 10.0f;
+            v[2] = 0.001f * static_cast<float>(i * i);
+            v[3] = 1.0f;
+            const int16_t tangents[4]{ 1, 2, 3, static_cast<int16_t>(i) };
+            memcpy(v + 4, tangents, sizeof(tangents));
+            v[6] = static_cast<float>(i) / static_cast<float>(count);
+            v[7] = 1.0f - v[6];
+        }
+        return result;
+    }
+
+    static MeshData* make_mesh(const std::vector<float>& vertices, const size_t count) {
+        MeshData* mesh = new MeshData();
+        MeshDataHeader& header = mesh->Header;
+        header.Interleaved = 1;
+        header.NumParts = 1;
+        header.VertexCount = static_cast<uint32_t>(count);
+        header.PositionAttrOffset = offsetof(Vertex, position);
+        header.TangentAttrOffset = offsetof(Vertex, tangents);
+        header.UV0_Offset = offsetof(Vertex, uv0);
+        header.PositionAttrStride = header.TangentAttrStride = header.UV0_Stride = sizeof(Vertex);
+        header.PositionAttrFormat = uint32_t(VK_FORMAT_R32G32B32A32_SFLOAT);
+        header.TangentAttrFormat = uint32_t(VK_FORMAT_R16G16B16A16_SNORM);
+        header.UV0_Format = uint32_t(VK_FORMAT_R32G32_SFLOAT);
+        header.VertexDataSize = static_cast<uint32_t>(count * sizeof(Vertex));
+        header.IndexFormat = VK_INDEX_TYPE_UINT32;
+        header.IndexCount = 0;
+
+        float min[3]{ 1e30f, 1e30f, 1e30f };
+        float max[3]{ -1e30f, -1e30f, -1e30f };
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = 0; j < 3; ++j) {
+                min[j] = std::min(min[j], vertices[i * 8 + j]);
+                max[j] = std::max(max[j], vertices[i * 8 + j]);
+            }
+        }
+        for (size_t j = 0; j < 3; ++j) {
+            header.Center[j] = (min[j] + max[j]) * 0.5f;
+            header.HalfExtent[j] = (max[j] - min[j]) * 0.5f;
+        }
+
+        mesh->Parts = new PartData[1];
+        mesh->Parts[0].MinIndex = 0;
+        mesh->Parts[0].MaxIndex = static_cast<uint32_t>(count - 1);
+        mesh->Materials = new MaterialInfo[1]{};
+        mesh->Vertices = new uint8_t[count * sizeof(Vertex)];
+        memcpy(mesh->Vertices, vertices.data(), count * sizeof(Vertex));
+        mesh->Indices = new uint32_t[1];
+        return mesh;
+    }
+
+    TEST_CASE("Unorm16PositionsAndFloat16UVs") {
+        const size_t count = 100;
+        const std::vector<float> source = make_interleaved_vertices(count);
+        MeshData* mesh = make_mesh(source, count);
+        const std::vector<PartQuantizationError> errors = QuantizeMeshData(mesh, VertexQuantization::Unorm16, VertexQuantization::Float16);
+
+        const MeshDataHeader& header = mesh->Header;
+        CHECK(header.PositionAttrFormat == uint32_t(VK_FORMAT_R16G16B16A16_UNORM));
+        CHECK(header.UV0_Format == uint32_t(VK_FORMAT_R16G16_SFLOAT));
+        CHECK(header.PositionAttrStride == 20);
+        CHECK(header.VertexDataSize == count * 20);
+        REQUIRE(errors.size() == 1);
+        // Half a quantization step of the largest axis extent
+        CHECK(errors[0].Position <= header.HalfExtent[0] / 65535.0f + 1e-5f);
+        CHECK(errors[0].UV <= std::ldexp(1.0f, -12));
+
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(mesh->Vertices);
+        for (size_t i = 0; i < count; ++i) {
+            const uint8_t* v = data + i * header.PositionAttrStride;
+            uint16_t position[4];
+            memcpy(position, v + header.PositionAttrOffset, sizeof(position));
+            const float x = header.Center[0] + (2.0f * position[0] / 65535.0f - 1.0f) * header.HalfExtent[0];
+            CHECK(std::abs(x - source[i * 8]) <= errors[0].Position);
+            CHECK(position[3] == 0xffff);
+
+            int16_t tangents[4];
+            memcpy(tangents, v + header.TangentAttrOffset, sizeof(tangents));
+            CHECK(tangents[3] == static_cast<int16_t>(i));
+
+            uint16_t uv[2];
+            memcpy(uv, v + header.UV0_Offset, sizeof(uv));
+            CHECK(std::abs(HalfToFloat(uv[1]) - source[i * 8 + 7]) <= errors[0].UV);
+        }
+
+        const std::vector<fvec4> decoded = DecodePositions(mesh);
+        for (size_t i = 0; i < count; ++i) {
+            CHECK(std::abs(decoded[i][2] - source[i * 8 + 2]) <= errors[0].Position);
+        }
+
+        MeshData::DestroyMeshData(mesh);
+    }
+
+    TEST_CASE("Unorm16UVsOutsideUnitRangeFallBack") {
+        const size_t count = 10;
+        std::vector<float> source = make_interleaved_vertices(count);
+        source[6] = 2.5f;
+        MeshData* mesh = make_mesh(source, count);
+        QuantizeMeshData(mesh, VertexQuantization::None, VertexQuantization::Unorm16);
+        CHECK(mesh->Header.PositionAttrFormat == uint32_t(VK_FORMAT_R32G32B32A32_SFLOAT));
+        CHECK(mesh->Header.UV0_Format == uint32_t(VK_FORMAT_R16G16_SFLOAT));
+        CHECK(mesh->Header.PositionAttrStride == 28);
+        MeshData::DestroyMeshData(mesh);
+    }
+
+    TEST_CASE("ResolveUseFp16") {
+        MeshProcessingOptions options{ true, true, true };
+        options.UVQuantization = VertexQuantization::Unorm16;
+        VertexQuantization positions, uvs;
+        ResolveQuantization(options, positions, uvs);
+        CHECK(positions == VertexQuantization::Float16);
+        CHECK(uvs == VertexQuantization::Unorm16);
+    }
+
+}
+
+#endif //!VPSK_TESTING_ENABLED
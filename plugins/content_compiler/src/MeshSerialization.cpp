@@ -0,0 +1,469 @@
+#include "MeshSerialization.hpp"
+#include "ImportUtilities.hpp"
+#include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+    constexpr uint32_t absent_attribute = 0xffffffff;
+
+    constexpr uint64_t align_up(const uint64_t offset) noexcept {
+        return (offset + MESH_FILE_ALIGNMENT - 1) & ~uint64_t(MESH_FILE_ALIGNMENT - 1);
+    }
+
+    uint64_t stream_end(const uint32_t offset, const uint32_t stride, const uint64_t count) noexcept {
+        return offset == absent_attribute ? 0 : uint64_t(offset) + uint64_t(stride) * count;
+    }
+
+    // Unique across processes and threads, so concurrent writers never share a temporary file
+    std::string temporary_path(const std::string& path) {
+        static std::atomic<uint32_t> counter{ 0 };
+#ifdef _WIN32
+        const unsigned long long process_id = static_cast<unsigned long long>(_getpid());
+#else
+        const unsigned long long process_id = static_cast<unsigned long long>(getpid());
+#endif
+        return path + "." + std::to_string(process_id) + "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+            "-" + std::to_string(counter++) + ".tmp";
+    }
+
+    // Atomically replaces destination, if present
+    bool rename_over(const std::string& source, const std::string& destination) {
+#ifdef _WIN32
+        return MoveFileExA(source.c_str(), destination.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        return rename(source.c_str(), destination.c_str()) == 0;
+#endif
+    }
+
+    bool section_in_range(const uint64_t offset, const uint64_t size, const uint64_t file_size) noexcept {
+        return (offset % MESH_FILE_ALIGNMENT == 0) && (offset <= file_size) && (size <= file_size - offset);
+    }
+
+}
+
+uint64_t MeshVertexDataSize(const MeshDataHeader& header) noexcept {
+    const uint64_t count = header.VertexCount;
+    if (header.Interleaved) {
+        return count * header.PositionAttrStride;
+    }
+
+    uint64_t result = stream_end(header.PositionAttrOffset, header.PositionAttrStride, count);
+    result = std::max(result, stream_end(header.TangentAttrOffset, header.TangentAttrStride, count));
+    result = std::max(result, stream_end(header.UV0_Offset, header.UV0_Stride, count));
+    result = std::max(result, stream_end(header.UV1_Offset, header.UV1_Stride, count));
+    return result;
+}
+
+uint64_t MeshIndexDataSize(const MeshDataHeader& header) noexcept {
+    const uint64_t index_size = header.IndexFormat == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    return uint64_t(header.IndexCount) * index_size;
+}
+
+bool WriteMeshDataFile(const char* fname, const MeshData* mesh) {
+    const MeshDataHeader& header = mesh->Header;
+    const uint64_t vertex_data_size = MeshVertexDataSize(header);
+    const uint64_t index_data_size = MeshIndexDataSize(header);
+
+    std::vector<MeshFileMaterial> materials(header.NumMaterials);
+    std::vector<char> names;
+    for (uint32_t i = 0; i < header.NumMaterials; ++i) {
+        materials[i].NameOffset = static_cast<uint32_t>(names.size());
+        materials[i].NameLength = mesh->Materials[i].NameLength;
+        names.insert(names.end(), mesh->Materials[i].Name, mesh->Materials[i].Name + mesh->Materials[i].NameLength);
+        names.emplace_back('\0');
+    }
+
+    MeshFileHeader file_header;
+    file_header.Header = header;
+    file_header.Header.VertexDataSize = static_cast<uint32_t>(vertex_data_size);
+    file_header.Header.IndexDataSize = static_cast<uint32_t>(index_data_size);
+    file_header.PartsOffset = align_up(sizeof(MeshFileHeader));
+    uint64_t parts_end = file_header.PartsOffset + sizeof(PartData) * header.NumParts;
+    if (header.NumMeshlets != 0) {
+        file_header.MeshletsOffset = align_up(parts_end);
+        parts_end = file_header.MeshletsOffset + sizeof(MeshletData) * header.NumMeshlets;
+    }
+    file_header.MaterialsOffset = align_up(parts_end);
+    file_header.MaterialNamesOffset = file_header.MaterialsOffset + sizeof(MeshFileMaterial) * materials.size();
+    file_header.MaterialNamesSize = names.size();
+    file_header.VerticesOffset = align_up(file_header.MaterialNamesOffset + names.size());
+    file_header.IndicesOffset = align_up(file_header.VerticesOffset + vertex_data_size);
+    file_header.FileSize = file_header.IndicesOffset + index_data_size;
+
+    std::ofstream output(fname, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        LOG(ERROR) << "Failed to open mesh file " << fname << " for writing.";
+        return false;
+    }
+
+    static const char padding[MESH_FILE_ALIGNMENT]{ 0 };
+    // Sections are written in file order: an offset behind what has already been written would overwrite it
+    auto write_at = [&output](const uint64_t offset, const void* data, const uint64_t size) {
+        if (!output.good()) {
+            return;
+        }
+        uint64_t current = static_cast<uint64_t>(output.tellp());
+        if (current > offset) {
+            LOG(ERROR) << "Mesh file section at offset " << offset << " overlaps data already written up to " << current;
+            output.setstate(std::ios::failbit);
+            return;
+        }
+        while (current < offset) {
+            const uint64_t padding_size = std::min<uint64_t>(offset - current, MESH_FILE_ALIGNMENT);
+            output.write(padding, static_cast<std::streamsize>(padding_size));
+            current += padding_size;
+        }
+        output.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    write_at(0, &file_header, sizeof(MeshFileHeader));
+    write_at(file_header.PartsOffset, mesh->Parts, sizeof(PartData) * header.NumParts);
+    if (header.NumMeshlets != 0) {
+        write_at(file_header.MeshletsOffset, mesh->Meshlets, sizeof(MeshletData) * header.NumMeshlets);
+    }
+    write_at(file_header.MaterialsOffset, materials.data(), sizeof(MeshFileMaterial) * materials.size());
+    write_at(file_header.MaterialNamesOffset, names.data(), names.size());
+
+    if (header.Interleaved) {
+        write_at(file_header.VerticesOffset, mesh->Vertices, vertex_data_size);
+    }
+    else {
+        // Streams are written where the header's offsets say they are, so the section can be copied in one go
+        const UninterleavedVertexData* vertices = reinterpret_cast<const UninterleavedVertexData*>(mesh->Vertices);
+        const uint64_t count = header.VertexCount;
+        write_at(file_header.VerticesOffset + header.PositionAttrOffset, vertices->Positions, uint64_t(header.PositionAttrStride) * count);
+        write_at(file_header.VerticesOffset + header.TangentAttrOffset, vertices->Tangents, uint64_t(header.TangentAttrStride) * count);
+        write_at(file_header.VerticesOffset + header.UV0_Offset, vertices->UV0s, uint64_t(header.UV0_Stride) * count);
+        if (header.UV1_Offset != absent_attribute) {
+            write_at(file_header.VerticesOffset + header.UV1_Offset, vertices->UV1s, uint64_t(header.UV1_Stride) * count);
+        }
+    }
+
+    write_at(file_header.IndicesOffset, mesh->Indices, index_data_size);
+    output.flush();
+
+    if (!output.good()) {
+        LOG(ERROR) << "Failed to write mesh file " << fname;
+        return false;
+    }
+
+    return true;
+}
+
+bool WriteMeshDataFileAtomic(const char* fname, const MeshData* mesh) {
+    const std::string temporary = temporary_path(fname);
+    if (!WriteMeshDataFile(temporary.c_str(), mesh)) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    if (!rename_over(temporary, fname)) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+MeshData* LoadMeshDataFile(const char* fname) {
+    std::unique_ptr<MappedFile, decltype(&UnmapFile)> mapping(MapFile(fname), UnmapFile);
+    if (!mapping) {
+        return nullptr;
+    }
+
+    const char* data = mapping->Data;
+    const uint64_t file_size = mapping->Size;
+    if (file_size < sizeof(MeshFileHeader)) {
+        LOG(WARNING) << "Mesh file " << fname << " is too small to contain a header.";
+        return nullptr;
+    }
+
+    MeshFileHeader file_header;
+    memcpy(&file_header, data, sizeof(MeshFileHeader));
+    const MeshDataHeader& header = file_header.Header;
+
+    if (strncmp(header.Magic, MeshDataHeader().Magic, sizeof(header.Magic)) != 0) {
+        LOG(WARNING) << "File " << fname << " is not a mesh file.";
+        return nullptr;
+    }
+
+    if ((file_header.FileVersion != MESH_FILE_VERSION) || (file_header.Alignment != MESH_FILE_ALIGNMENT)) {
+        LOG(WARNING) << "Mesh file " << fname << " has version " << file_header.FileVersion << ", expected " << MESH_FILE_VERSION;
+        return nullptr;
+    }
+
+    const uint64_t vertex_data_size = MeshVertexDataSize(header);
+    const bool sections_valid = (file_header.FileSize == file_size) &&
+        section_in_range(file_header.PartsOffset, sizeof(PartData) * header.NumParts, file_size) &&
+        ((header.NumMeshlets == 0) || section_in_range(file_header.MeshletsOffset, sizeof(MeshletData) * header.NumMeshlets, file_size)) &&
+        section_in_range(file_header.MaterialsOffset, sizeof(MeshFileMaterial) * header.NumMaterials, file_size) &&
+        (file_header.MaterialNamesOffset == file_header.MaterialsOffset + sizeof(MeshFileMaterial) * header.NumMaterials) &&
+        (file_header.MaterialNamesSize <= file_size - file_header.MaterialNamesOffset) &&
+        section_in_range(file_header.VerticesOffset, vertex_data_size, file_size) &&
+        section_in_range(file_header.IndicesOffset, MeshIndexDataSize(header), file_size) &&
+        (header.VertexDataSize == vertex_data_size);
+    if (!sections_valid) {
+        LOG(WARNING) << "Mesh file " << fname << " is truncated or corrupt.";
+        return nullptr;
+    }
+
+    const MeshFileMaterial* file_materials = reinterpret_cast<const MeshFileMaterial*>(data + file_header.MaterialsOffset);
+    const char* names = data + file_header.MaterialNamesOffset;
+    for (uint32_t i = 0; i < header.NumMaterials; ++i) {
+        const MeshFileMaterial& material = file_materials[i];
+        if ((uint64_t(material.NameOffset) + material.NameLength >= file_header.MaterialNamesSize) ||
+            (names[material.NameOffset + material.NameLength] != '\0')) {
+            LOG(WARNING) << "Mesh file " << fname << " has a corrupt material name table.";
+            return nullptr;
+        }
+    }
+
+    // The mapping is read-only: pointers are only non-const to fit MeshData
+    char* mapped = const_cast<char*>(data);
+    std::unique_ptr<MeshData> result = std::make_unique<MeshData>();
+    result->Header = header;
+    result->Parts = reinterpret_cast<PartData*>(mapped + file_header.PartsOffset);
+    if (header.NumMeshlets != 0) {
+        result->Meshlets = reinterpret_cast<MeshletData*>(mapped + file_header.MeshletsOffset);
+    }
+    result->Indices = mapped + file_header.IndicesOffset;
+
+    result->Materials = new MaterialInfo[header.NumMaterials];
+    for (uint32_t i = 0; i < header.NumMaterials; ++i) {
+        result->Materials[i].NameLength = file_materials[i].NameLength;
+        result->Materials[i].Name = mapped + file_header.MaterialNamesOffset + file_materials[i].NameOffset;
+    }
+
+    char* vertices = mapped + file_header.VerticesOffset;
+    if (header.Interleaved) {
+        result->Vertices = vertices;
+    }
+    else {
+        UninterleavedVertexData* streams = new UninterleavedVertexData();
+        streams->Positions = vertices + header.PositionAttrOffset;
+        streams->Tangents = reinterpret_cast<int16_t*>(vertices + header.TangentAttrOffset);
+        streams->UV0s = vertices + header.UV0_Offset;
+        if (header.UV1_Offset != absent_attribute) {
+            streams->UV1s = vertices + header.UV1_Offset;
+        }
+        result->Vertices = streams;
+    }
+
+    result->FileMapping = mapping.release();
+    return result.release();
+}
+
+void UnmapMeshDataFile(void* file_mapping) {
+    UnmapFile(reinterpret_cast<MappedFile*>(file_mapping));
+}
+
+#ifdef VPSK_TESTING_ENABLED
+#include <cstdio>
+
+TEST_SUITE("MeshSerialization") {
+
+    struct test_mesh_t {
+        std::vector<PartData> parts;
+        std::vector<MaterialInfo> materials;
+        std::vector<fvec4> positions;
+        std::vector<int16_t> tangents;
+        std::vector<fvec2> uv0s;
+        std::vector<fvec2> uv1s;
+        std::vector<uint16_t> indices;
+        std::vector<MeshletData> meshlets;
+        UninterleavedVertexData streams;
+        MeshData mesh;
+    };
+
+    static std::unique_ptr<test_mesh_t> make_test_mesh(const bool with_uv1) {
+        static char name0[] = "Stone";
+        static char name1[] = "Moss";
+        std::unique_ptr<test_mesh_t> result = std::make_unique<test_mesh_t>();
+        const uint32_t num_vertices = 5;
+        for (uint32_t i = 0; i < num_vertices; ++i) {
+            const float f = static_cast<float>(i);
+            result->positions.emplace_back(f, f + 0.5f, -f, 1.0f);
+            result->tangents.insert(result->tangents.end(), { int16_t(i), int16_t(-int(i)), 3, 32767 });
+            result->uv0s.emplace_back(f * 0.25f, 1.0f - f * 0.25f);
+            result->uv1s.emplace_back(f * 0.5f, f);
+        }
+        result->indices = { 0, 1, 2, 2, 3, 4, 4, 1, 0 };
+        result->parts.resize(2);
+        result->parts[0].IndexOffset = 0;
+        result->parts[0].IndexCount = 6;
+        result->parts[0].MaterialID = 0;
+        result->parts[1].IndexOffset = 6;
+        result->parts[1].IndexCount = 3;
+        result->parts[1].MaterialID = 1;
+        result->materials = { MaterialInfo{ 5, name0 }, MaterialInfo{ 4, name1 } };
+
+        result->streams.Positions = result->positions.data();
+        result->streams.Tangents = result->tangents.data();
+        result->streams.UV0s = result->uv0s.data();
+        result->streams.UV1s = with_uv1 ? result->uv1s.data() : nullptr;
+
+        MeshDataHeader& header = result->mesh.Header;
+        header.NumParts = 2;
+        header.NumMaterials = 2;
+        header.Interleaved = 0;
+        header.PositionAttrOffset = 0;
+        header.PositionAttrStride = sizeof(fvec4);
+        header.TangentAttrOffset = num_vertices * sizeof(fvec4);
+        header.TangentAttrStride = sizeof(int16_t) * 4;
+        header.UV0_Offset = header.TangentAttrOffset + num_vertices * sizeof(int16_t) * 4;
+        header.UV0_Stride = sizeof(fvec2);
+        if (with_uv1) {
+            header.UV1_Offset = header.UV0_Offset + num_vertices * sizeof(fvec2);
+            header.UV1_Stride = sizeof(fvec2);
+        }
+        header.VertexCount = num_vertices;
+        header.IndexFormat = VK_INDEX_TYPE_UINT16;
+        header.IndexCount = static_cast<uint32_t>(result->indices.size());
+
+        result->mesh.Parts = result->parts.data();
+        result->mesh.Materials = result->materials.data();
+        result->mesh.Vertices = &result->streams;
+        result->mesh.Indices = result->indices.data();
+        return result;
+    }
+
+    static const char* const test_file = "mesh_serialization_test.hmesh";
+
+    TEST_CASE("RoundTripUninterleaved") {
+        auto source = make_test_mesh(true);
+        source->meshlets.resize(2);
+        source->meshlets[0].IndexOffset = 0;
+        source->meshlets[0].IndexCount = 6;
+        source->meshlets[0].Radius = 2.0f;
+        source->meshlets[1].IndexOffset = 6;
+        source->meshlets[1].IndexCount = 3;
+        source->meshlets[1].ConeAxis[2] = 1.0f;
+        source->meshlets[1].ConeCutoff = 0.5f;
+        source->parts[0].MeshletOffset = 0;
+        source->parts[0].MeshletCount = 1;
+        source->parts[1].MeshletOffset = 1;
+        source->parts[1].MeshletCount = 1;
+        source->mesh.Meshlets = source->meshlets.data();
+        source->mesh.Header.NumMeshlets = 2;
+        REQUIRE(WriteMeshDataFile(test_file, &source->mesh));
+        MeshData* loaded = LoadMeshDataFile(test_file);
+        REQUIRE(loaded != nullptr);
+        CHECK(loaded->FileMapping != nullptr);
+        CHECK(loaded->Header.VertexDataSize == 5 * (16 + 8 + 8 + 8));
+        CHECK(loaded->Header.IndexDataSize == 9 * sizeof(uint16_t));
+        CHECK(memcmp(loaded->Parts, source->parts.data(), sizeof(PartData) * 2) == 0);
+        REQUIRE(loaded->Meshlets != nullptr);
+        CHECK(memcmp(loaded->Meshlets, source->meshlets.data(), sizeof(MeshletData) * 2) == 0);
+        CHECK(reinterpret_cast<uintptr_t>(loaded->Meshlets) % MESH_FILE_ALIGNMENT == 0);
+        CHECK(strcmp(loaded->Materials[0].Name, "Stone") == 0);
+        CHECK(loaded->Materials[1].NameLength == 4);
+        CHECK(strcmp(loaded->Materials[1].Name, "Moss") == 0);
+
+        const UninterleavedVertexData* streams = reinterpret_cast<const UninterleavedVertexData*>(loaded->Vertices);
+        CHECK(memcmp(streams->Positions, source->positions.data(), sizeof(fvec4) * 5) == 0);
+        CHECK(memcmp(streams->Tangents, source->tangents.data(), sizeof(int16_t) * 20) == 0);
+        CHECK(memcmp(streams->UV0s, source->uv0s.data(), sizeof(fvec2) * 5) == 0);
+        REQUIRE(streams->UV1s != nullptr);
+        CHECK(memcmp(streams->UV1s, source->uv1s.data(), sizeof(fvec2) * 5) == 0);
+        CHECK(memcmp(loaded->Indices, source->indices.data(), sizeof(uint16_t) * 9) == 0);
+
+        // Vertex streams are contiguous, so staging can take the whole block starting at the positions
+        CHECK(reinterpret_cast<const char*>(streams->UV0s) - reinterpret_cast<const char*>(streams->Positions) == loaded->Header.UV0_Offset);
+        CHECK(reinterpret_cast<uintptr_t>(streams->Positions) % MESH_FILE_ALIGNMENT == 0);
+        CHECK(reinterpret_cast<uintptr_t>(loaded->Indices) % MESH_FILE_ALIGNMENT == 0);
+        CHECK(reinterpret_cast<uintptr_t>(loaded->Parts) % MESH_FILE_ALIGNMENT == 0);
+
+        MeshData::DestroyMeshData(loaded);
+        std::remove(test_file);
+    }
+
+    TEST_CASE("RoundTripInterleaved") {
+        auto source = make_test_mesh(false);
+        std::vector<Vertex> vertices(5);
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            vertices[i].position = source->positions[i];
+            memcpy(vertices[i].tangents, source->tangents.data() + i * 4, sizeof(vertices[i].tangents));
+            vertices[i].uv0 = source->uv0s[i];
+        }
+        MeshDataHeader& header = source->mesh.Header;
+        header.Interleaved = 1;
+        header.PositionAttrOffset = offsetof(Vertex, position);
+        header.TangentAttrOffset = offsetof(Vertex, tangents);
+        header.UV0_Offset = offsetof(Vertex, uv0);
+        header.PositionAttrStride = sizeof(Vertex);
+        header.TangentAttrStride = sizeof(Vertex);
+        header.UV0_Stride = sizeof(Vertex);
+        source->mesh.Vertices = vertices.data();
+
+        REQUIRE(WriteMeshDataFile(test_file, &source->mesh));
+        MeshData* loaded = LoadMeshDataFile(test_file);
+        REQUIRE(loaded != nullptr);
+        CHECK(loaded->Header.VertexDataSize == sizeof(Vertex) * 5);
+        CHECK(memcmp(loaded->Vertices, vertices.data(), sizeof(Vertex) * 5) == 0);
+        CHECK(loaded->Meshlets == nullptr);
+        MeshData::DestroyMeshData(loaded);
+        std::remove(test_file);
+    }
+
+    TEST_CASE("RejectsInvalidFiles") {
+        CHECK(LoadMeshDataFile("mesh_serialization_missing.hmesh") == nullptr);
+
+        auto source = make_test_mesh(false);
+        REQUIRE(WriteMeshDataFile(test_file, &source->mesh));
+        std::vector<char> contents;
+        {
+            std::ifstream input(test_file, std::ios::binary);
+            contents.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        }
+
+        auto write_contents = [](const std::vector<char>& bytes) {
+            std::ofstream output(test_file, std::ios::binary | std::ios::trunc);
+            output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        };
+
+        std::vector<char> truncated(contents.begin(), contents.end() - 2);
+        write_contents(truncated);
+        CHECK(LoadMeshDataFile(test_file) == nullptr);
+
+        std::vector<char> wrong_version(contents);
+        const uint32_t bad_version = MESH_FILE_VERSION + 1;
+        memcpy(wrong_version.data() + offsetof(MeshFileHeader, FileVersion), &bad_version, sizeof(uint32_t));
+        write_contents(wrong_version);
+        CHECK(LoadMeshDataFile(test_file) == nullptr);
+
+        std::vector<char> wrong_magic(contents);
+        wrong_magic[0] = 'X';
+        write_contents(wrong_magic);
+        CHECK(LoadMeshDataFile(test_file) == nullptr);
+
+        write_contents(contents);
+        MeshData* loaded = LoadMeshDataFile(test_file);
+        CHECK(loaded != nullptr);
+        MeshData::DestroyMeshData(loaded);
+        std::remove(test_file);
+    }
+
+}
+
+#endif //!VPSK_TESTING_ENABLED
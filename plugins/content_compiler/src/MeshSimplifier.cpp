@@ -0,0 +1,592 @@
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshQuantization.hpp"
+#include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+    // Symmetric 4x4 matrix summing squared distances to planes, weighted by triangle area
+    struct quadric_t {
+        double a00{ 0.0 }, a01{ 0.0 }, a02{ 0.0 }, a03{ 0.0 };
+        double a11{ 0.0 }, a12{ 0.0 }, a13{ 0.0 };
+        double a22{ 0.0 }, a23{ 0.0 };
+        double a33{ 0.0 };
+        double weight{ 0.0 };
+
+        void add_plane(const double n[3], const double d, const double w) noexcept {
+            a00 += w * n[0] * n[0]; a01 += w * n[0] * n[1]; a02 += w * n[0] * n[2]; a03 += w * n[0] * d;
+            a11 += w * n[1] * n[1]; a12 += w * n[1] * n[2]; a13 += w * n[1] * d;
+            a22 += w * n[2] * n[2]; a23 += w * n[2] * d;
+            a33 += w * d * d;
+            weight += w;
+        }
+
+        quadric_t& operator+=(const quadric_t& other) noexcept {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+            a11 += other.a11; a12 += other.a12; a13 += other.a13;
+            a22 += other.a22; a23 += other.a23;
+            a33 += other.a33;
+            weight += other.weight;
+            return *this;
+        }
+
+        // Mean squared distance of p to the planes
+        double error_sq(const fvec4& p) const noexcept {
+            const double x = p.x(), y = p.y(), z = p.z();
+            const double sum = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x +
+                a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y +
+                a22 * z * z + 2.0 * a23 * z + a33;
+            return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+        }
+    };
+
+    quadric_t operator+(quadric_t lhs, const quadric_t& rhs) noexcept {
+        lhs += rhs;
+        return lhs;
+    }
+
+    struct position_key_t {
+        uint32_t bits[3];
+        bool operator==(const position_key_t& other) const noexcept {
+            return (bits[0] == other.bits[0]) && (bits[1] == other.bits[1]) && (bits[2] == other.bits[2]);
+        }
+    };
+
+    struct position_key_hash_t {
+        size_t operator()(const position_key_t& key) const noexcept {
+            return (size_t(key.bits[0]) * 73856093u) ^ (size_t(key.bits[1]) * 19349663u) ^ (size_t(key.bits[2]) * 83492791u);
+        }
+    };
+
+    position_key_t make_position_key(const fvec4& p) noexcept {
+        position_key_t result;
+        for (size_t i = 0; i < 3; ++i) {
+            // Adding zero turns -0 into +0, so both weld together
+            const float value = p[i] + 0.0f;
+            memcpy(&result.bits[i], &value, sizeof(float));
+        }
+        return result;
+    }
+
+    void triangle_normal(const fvec4& p0, const fvec4& p1, const fvec4& p2, double n[3]) noexcept {
+        const double e0[3]{ double(p1.x()) - p0.x(), double(p1.y()) - p0.y(), double(p1.z()) - p0.z() };
+        const double e1[3]{ double(p2.x()) - p0.x(), double(p2.y()) - p0.y(), double(p2.z()) - p0.z() };
+        n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+        n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+        n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+    }
+
+    // Vertices that can't move: UV seams and other attribute borders, and open or non-manifold edges
+    std::vector<char> find_locked_vertices(const std::vector<uint32_t>& triangles, const fvec4* positions, const size_t vertex_count) {
+        std::vector<char> used(vertex_count, 0);
+        for (const uint32_t idx : triangles) {
+            used[idx] = 1;
+        }
+
+        std::vector<uint32_t> welded(vertex_count, 0);
+        std::vector<uint32_t> weld_size;
+        std::unordered_map<position_key_t, uint32_t, position_key_hash_t> lookup;
+        lookup.reserve(vertex_count);
+        for (uint32_t v = 0; v < static_cast<uint32_t>(vertex_count); ++v) {
+            if (!used[v]) {
+                continue;
+            }
+            auto emplaced = lookup.emplace(make_position_key(positions[v]), static_cast<uint32_t>(weld_size.size()));
+            if (emplaced.second) {
+                weld_size.emplace_back(0);
+            }
+            welded[v] = emplaced.first->second;
+            ++weld_size[welded[v]];
+        }
+
+        std::vector<char> weld_locked(weld_size.size());
+        for (size_t w = 0; w < weld_size.size(); ++w) {
+            weld_locked[w] = weld_size[w] > 1;
+        }
+
+        std::unordered_map<uint64_t, uint32_t> edge_uses;
+        edge_uses.reserve(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            for (size_t e = 0; e < 3; ++e) {
+                const uint32_t a = welded[triangles[i + e]];
+                const uint32_t b = welded[triangles[i + (e + 1) % 3]];
+                if (a != b) {
+                    ++edge_uses[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)];
+                }
+            }
+        }
+
+        for (const auto& edge : edge_uses) {
+            if (edge.second != 2) {
+                weld_locked[edge.first >> 32] = 1;
+                weld_locked[edge.first & 0xffffffffu] = 1;
+            }
+        }
+
+        std::vector<char> result(vertex_count, 0);
+        for (size_t v = 0; v < vertex_count; ++v) {
+            result[v] = used[v] && weld_locked[welded[v]];
+        }
+        return result;
+    }
+
+    struct collapse_t {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    struct vertex_adjacency_t {
+        vertex_adjacency_t(const std::vector<uint32_t>& triangles, const size_t vertex_count) : offsets(vertex_count + 1, 0), triangles(triangles.size()) {
+            for (const uint32_t idx : triangles) {
+                ++offsets[idx + 1];
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < triangles.size(); ++i) {
+                this->triangles[fill[triangles[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        const uint32_t* begin(const uint32_t v) const noexcept {
+            return triangles.data() + offsets[v];
+        }
+
+        const uint32_t* end(const uint32_t v) const noexcept {
+            return triangles.data() + offsets[v + 1];
+        }
+
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+    };
+
+    bool collapse_flips_triangle(const collapse_t& collapse, const std::vector<uint32_t>& triangles, const vertex_adjacency_t& adjacency, const fvec4* positions) {
+        for (const uint32_t* t = adjacency.begin(collapse.from); t != adjacency.end(collapse.from); ++t) {
+            const uint32_t* tri = triangles.data() + size_t(*t) * 3;
+            if ((tri[0] == collapse.to) || (tri[1] == collapse.to) || (tri[2] == collapse.to)) {
+                // Removed by the collapse
+                continue;
+            }
+
+            double before[3], after[3];
+            triangle_normal(positions[tri[0]], positions[tri[1]], positions[tri[2]], before);
+            const fvec4& p0 = positions[tri[0] == collapse.from ? collapse.to : tri[0]];
+            const fvec4& p1 = positions[tri[1] == collapse.from ? collapse.to : tri[1]];
+            const fvec4& p2 = positions[tri[2] == collapse.from ? collapse.to : tri[2]];
+            triangle_normal(p0, p1, p2, after);
+            const double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+            const double before_sq = before[0] * before[0] + before[1] * before[1] + before[2] * before[2];
+            if ((before_sq > 0.0) && (dot <= 0.0)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+}
+
+size_t SimplifyIndices(uint32_t* dst, const uint32_t* indices, const size_t index_count, const fvec4* positions, const size_t vertex_count,
+    const size_t target_index_count, const float max_error, float* result_error) {
+    std::vector<uint32_t> triangles(indices, indices + (index_count - index_count % 3));
+    const std::vector<char> locked = find_locked_vertices(triangles, positions, vertex_count);
+
+    std::vector<quadric_t> quadrics(vertex_count);
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+        double n[3];
+        triangle_normal(positions[triangles[i]], positions[triangles[i + 1]], positions[triangles[i + 2]], n);
+        const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0) {
+            continue;
+        }
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+        const fvec4& p0 = positions[triangles[i]];
+        const double d = -(n[0] * p0.x() + n[1] * p0.y() + n[2] * p0.z());
+        for (size_t j = 0; j < 3; ++j) {
+            quadrics[triangles[i + j]].add_plane(n, d, length * 0.5);
+        }
+    }
+
+    const double max_error_sq = double(max_error) * double(max_error);
+    const size_t target_triangles = target_index_count / 3;
+    double error_sq = 0.0;
+    std::vector<collapse_t> collapses;
+    std::vector<char> touched(vertex_count);
+    std::vector<uint32_t> remap(vertex_count);
+
+    while (triangles.size() / 3 > target_triangles) {
+        const vertex_adjacency_t adjacency(triangles, vertex_count);
+
+        collapses.clear();
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            for (size_t e = 0; e < 3; ++e) {
+                const uint32_t a = triangles[i + e];
+                const uint32_t b = triangles[i + (e + 1) % 3];
+                // Manifold edges show up in two triangles, in opposite directions. Edges that don't are locked.
+                if (a > b) {
+                    continue;
+                }
+                const quadric_t combined = quadrics[a] + quadrics[b];
+                if (!locked[a]) {
+                    collapses.emplace_back(collapse_t{ a, b, combined.error_sq(positions[b]) });
+                }
+                if (!locked[b]) {
+                    collapses.emplace_back(collapse_t{ b, a, combined.error_sq(positions[a]) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const collapse_t& lhs, const collapse_t& rhs) {
+            return lhs.cost < rhs.cost;
+        });
+
+        // Each collapse changes the triangles around its source vertex: once applied, nothing else in that
+        // neighbourhood collapses this pass, so the flip check of every applied collapse stays valid
+        std::fill(touched.begin(), touched.end(), 0);
+        std::iota(remap.begin(), remap.end(), 0);
+        size_t triangle_count = triangles.size() / 3;
+        size_t applied = 0;
+        for (const collapse_t& collapse : collapses) {
+            if ((collapse.cost > max_error_sq) || (triangle_count <= target_triangles)) {
+                break;
+            }
+
+            if (touched[collapse.from] || touched[collapse.to] || collapse_flips_triangle(collapse, triangles, adjacency, positions)) {
+                continue;
+            }
+
+            for (const uint32_t* t = adjacency.begin(collapse.from); t != adjacency.end(collapse.from); ++t) {
+                const uint32_t* tri = triangles.data() + size_t(*t) * 3;
+                triangle_count -= (tri[0] == collapse.to) || (tri[1] == collapse.to) || (tri[2] == collapse.to);
+                touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            error_sq = std::max(error_sq, collapse.cost);
+            ++applied;
+        }
+
+        if (applied == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            const uint32_t a = remap[triangles[i]];
+            const uint32_t b = remap[triangles[i + 1]];
+            const uint32_t c = remap[triangles[i + 2]];
+            if ((a != b) && (b != c) && (a != c)) {
+                triangles[write++] = a;
+                triangles[write++] = b;
+                triangles[write++] = c;
+            }
+        }
+        triangles.resize(write);
+    }
+
+    std::copy(triangles.begin(), triangles.end(), dst);
+    if (result_error) {
+        *result_error = static_cast<float>(std::sqrt(error_sq));
+    }
+    return triangles.size();
+}
+
+void GeneratePartLODs(MeshData* mesh, uint32_t lod_count, const float target_ratio, const float max_error) {
+    MeshDataHeader& header = mesh->Header;
+    if (mesh->FileMapping) {
+        LOG(ERROR) << "Can't generate levels of detail for a memory-mapped mesh file in place.";
+        return;
+    }
+
+    if (lod_count > MaxPartLODs) {
+        LOG(WARNING) << "Requested " << lod_count << " levels of detail, but parts can have at most " << MaxPartLODs;
+        lod_count = MaxPartLODs;
+    }
+    header.LODLevels = lod_count;
+
+    const std::vector<fvec4> positions = DecodePositions(mesh);
+    const float absolute_max_error = max_error * std::max(header.HalfExtent[0], std::max(header.HalfExtent[1], header.HalfExtent[2]));
+    const uint16_t* indices16 = reinterpret_cast<const uint16_t*>(mesh->Indices);
+    const uint32_t* indices32 = reinterpret_cast<const uint32_t*>(mesh->Indices);
+    const bool index_16 = header.IndexFormat == VK_INDEX_TYPE_UINT16;
+
+    std::vector<uint32_t> lod_indices;
+    std::vector<uint32_t> local_indices;
+    std::vector<uint32_t> simplified;
+    std::vector<uint32_t> ordered;
+    for (uint32_t i = 0; i < header.NumParts; ++i) {
+        PartData& part = mesh->Parts[i];
+        part.NumLODs = 0;
+        if ((lod_count == 0) || (part.IndexCount % 3 != 0) || (part.MaxIndex < part.MinIndex)) {
+            continue;
+        }
+
+        const size_t vertex_count = size_t(part.MaxIndex - part.MinIndex) + 1;
+        local_indices.resize(part.IndexCount);
+        bool in_range = true;
+        for (uint32_t j = 0; j < part.IndexCount; ++j) {
+            const uint32_t idx = index_16 ? indices16[part.IndexOffset + j] : indices32[part.IndexOffset + j];
+            in_range &= (idx >= part.MinIndex) && (idx <= part.MaxIndex);
+            local_indices[j] = idx - part.MinIndex;
+        }
+
+        if (!in_range) {
+            LOG(WARNING) << "Part " << i << " references vertices outside of its index range, no levels of detail will be generated for it.";
+            continue;
+        }
+
+        size_t previous_count = part.IndexCount;
+        for (uint32_t level = 1; level <= lod_count; ++level) {
+            const size_t target = static_cast<size_t>(double(part.IndexCount / 3) * std::pow(double(target_ratio), double(level))) * 3;
+            simplified.resize(local_indices.size());
+            float error = 0.0f;
+            const size_t count = SimplifyIndices(simplified.data(), local_indices.data(), local_indices.size(), positions.data() + part.MinIndex,
+                vertex_count, target, absolute_max_error, &error);
+
+            // Stop once the error limit keeps a level from getting meaningfully smaller than the last
+            if ((count == 0) || (count > previous_count * 9 / 10)) {
+                break;
+            }
+
+            ordered.resize(count);
+            OptimizeVertexCache(ordered.data(), simplified.data(), count, vertex_count);
+
+            PartLODData& lod = part.LODs[part.NumLODs++];
+            lod.IndexOffset = static_cast<uint32_t>(header.IndexCount + lod_indices.size());
+            lod.IndexCount = static_cast<uint32_t>(count);
+            lod.Error = error;
+            for (const uint32_t idx : ordered) {
+                lod_indices.emplace_back(idx + part.MinIndex);
+            }
+            previous_count = count;
+
+            LOG(INFO) << "Part " << i << " LOD " << level << ": " << count / 3 << " of " << part.IndexCount / 3 << " triangles, error " << error;
+        }
+    }
+
+    if (lod_indices.empty()) {
+        return;
+    }
+
+    const size_t total = size_t(header.IndexCount) + lod_indices.size();
+    if (index_16) {
+        uint16_t* indices = new uint16_t[total];
+        std::copy(indices16, indices16 + header.IndexCount, indices);
+        std::transform(lod_indices.begin(), lod_indices.end(), indices + header.IndexCount, [](const uint32_t idx) {
+            return static_cast<uint16_t>(idx);
+        });
+        delete[] indices16;
+        mesh->Indices = indices;
+    }
+    else {
+        uint32_t* indices = new uint32_t[total];
+        std::copy(indices32, indices32 + header.IndexCount, indices);
+        std::copy(lod_indices.begin(), lod_indices.end(), indices + header.IndexCount);
+        delete[] indices32;
+        mesh->Indices = indices;
+    }
+
+    header.IndexCount = static_cast<uint32_t>(total);
+    header.IndexDataSize = static_cast<uint32_t>(total * (index_16 ? sizeof(uint16_t) : sizeof(uint32_t)));
+}
+
+#ifdef VPSK_TESTING_ENABLED
+#include <set>
+
+TEST_SUITE("MeshSimplifier") {
+
+    // Grid in the xy plane, displaced along z by height(x, y), wound counter-clockwise seen from +z.
+    // Vertices with x == seam_column are duplicated for triangles to the right of it, like a UV seam.
+    template<typename HeightFn>
+    static void make_grid(const uint32_t size, HeightFn&& height, const uint32_t seam_column, std::vector<fvec4>& positions, std::vector<uint32_t>& indices) {
+        for (uint32_t y = 0; y <= size; ++y) {
+            for (uint32_t x = 0; x <= size; ++x) {
+                positions.emplace_back(static_cast<float>(x), static_cast<float>(y), height(float(x), float(y)), 1.0f);
+            }
+        }
+
+        const uint32_t base_count = static_cast<uint32_t>(positions.size());
+        for (uint32_t y = 0; (y <= size) && (seam_column <= size); ++y) {
+            positions.emplace_back(positions[y * (size + 1) + seam_column]);
+        }
+
+        auto vertex = [&](const uint32_t x, const uint32_t y, const bool right_of_seam) {
+            return (right_of_seam && (x == seam_column)) ? base_count + y : y * (size + 1) + x;
+        };
+
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                const bool right = x >= seam_column;
+                const uint32_t v0 = vertex(x, y, right);
+                const uint32_t v1 = vertex(x + 1, y, right);
+                const uint32_t v2 = vertex(x, y + 1, right);
+                const uint32_t v3 = vertex(x + 1, y + 1, right);
+                indices.insert(indices.end(), { v0, v1, v3, v0, v3, v2 });
+            }
+        }
+    }
+
+    static float flat(float, float) {
+        return 0.0f;
+    }
+
+    static float hills(float x, float y) {
+        return 2.0f * std::sin(x * 0.4f) * std::cos(y * 0.3f);
+    }
+
+    TEST_CASE("FlatGridSimplifiesWithoutError") {
+        std::vector<fvec4> positions;
+        std::vector<uint32_t> indices;
+        make_grid(32, flat, 64, positions, indices);
+        std::vector<uint32_t> result(indices.size());
+        float error = 1.0f;
+        const size_t count = SimplifyIndices(result.data(), indices.data(), indices.size(), positions.data(), positions.size(), indices.size() / 4, 1e-3f, &error);
+        result.resize(count);
+
+        CHECK(count <= indices.size() / 4);
+        CHECK(count > 0);
+        CHECK(error < 1e-4f);
+
+        // Border vertices are locked, so the outline is unchanged
+        const std::set<uint32_t> used(result.begin(), result.end());
+        for (uint32_t i = 0; i <= 32; ++i) {
+            CHECK(used.count(i) == 1);
+            CHECK(used.count(32 * 33 + i) == 1);
+            CHECK(used.count(i * 33) == 1);
+            CHECK(used.count(i * 33 + 32) == 1);
+        }
+
+        // Still covers the whole grid
+        double area = 0.0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const fvec4& p0 = positions[result[i]];
+            const fvec4& p1 = positions[result[i + 1]];
+            const fvec4& p2 = positions[result[i + 2]];
+            const double signed_area = 0.5 * ((p1.x() - p0.x()) * (p2.y() - p0.y()) - (p2.x() - p0.x()) * (p1.y() - p0.y()));
+            CHECK(signed_area > 0.0);
+            area += signed_area;
+        }
+        CHECK(std::abs(area - 32.0 * 32.0) < 1e-3);
+    }
+
+    TEST_CASE("ErrorBoundLimitsCollapses") {
+        std::vector<fvec4> positions;
+        std::vector<uint32_t> indices;
+        make_grid(32, hills, 64, positions, indices);
+        std::vector<uint32_t> result(indices.size());
+
+        float tight_error = 0.0f;
+        const size_t tight_count = SimplifyIndices(result.data(), indices.data(), indices.size(), positions.data(), positions.size(), 0, 0.05f, &tight_error);
+        float loose_error = 0.0f;
+        const size_t loose_count = SimplifyIndices(result.data(), indices.data(), indices.size(), positions.data(), positions.size(), 0, 0.2f, &loose_error);
+
+        CHECK(tight_error <= 0.05f);
+        CHECK(loose_error <= 0.2f);
+        CHECK(tight_count < indices.size());
+        CHECK(loose_count < tight_count);
+    }
+
+    TEST_CASE("SeamVerticesAreKept") {
+        const uint32_t size = 16;
+        const uint32_t seam = 8;
+        std::vector<fvec4> positions;
+        std::vector<uint32_t> indices;
+        make_grid(size, hills, seam, positions, indices);
+        std::vector<uint32_t> result(indices.size());
+        const size_t count = SimplifyIndices(result.data(), indices.data(), indices.size(), positions.data(), positions.size(), 0, 1.0f);
+        result.resize(count);
+        CHECK(count < indices.size() / 2);
+
+        // Triangles never mix vertices from both sides of the seam
+        const uint32_t base_count = (size + 1) * (size + 1);
+        for (size_t i = 0; i < result.size(); i += 3) {
+            bool left = false;
+            bool right = false;
+            for (size_t j = 0; j < 3; ++j) {
+                const uint32_t v = result[i + j];
+                const float x = positions[v].x();
+                left |= (x < float(seam)) || ((x == float(seam)) && (v < base_count));
+                right |= (x > float(seam)) || (v >= base_count);
+            }
+            CHECK(!(left && right));
+        }
+
+        const std::set<uint32_t> used(result.begin(), result.end());
+        for (uint32_t y = 0; y <= size; ++y) {
+            CHECK(used.count(y * (size + 1) + seam) == 1);
+            CHECK(used.count(base_count + y) == 1);
+        }
+    }
+
+    TEST_CASE("GeneratePartLODsAppendsLevels") {
+        std::vector<fvec4> positions;
+        std::vector<uint32_t> indices;
+        make_grid(32, hills, 64, positions, indices);
+
+        MeshData* mesh = new MeshData();
+        MeshDataHeader& header = mesh->Header;
+        header.Interleaved = 1;
+        header.NumParts = 1;
+        header.VertexCount = static_cast<uint32_t>(positions.size());
+        header.PositionAttrOffset = 0;
+        header.PositionAttrStride = sizeof(fvec4);
+        header.PositionAttrFormat = uint32_t(VK_FORMAT_R32G32B32A32_SFLOAT);
+        header.HalfExtent[0] = header.HalfExtent[1] = 16.0f;
+        header.HalfExtent[2] = 2.0f;
+        header.IndexFormat = VK_INDEX_TYPE_UINT32;
+        header.IndexCount = static_cast<uint32_t>(indices.size());
+        mesh->Vertices = new uint8_t[positions.size() * sizeof(fvec4)];
+        memcpy(mesh->Vertices, positions.data(), positions.size() * sizeof(fvec4));
+        mesh->Indices = new uint32_t[indices.size()];
+        std::copy(indices.begin(), indices.end(), reinterpret_cast<uint32_t*>(mesh->Indices));
+        mesh->Materials = new MaterialInfo[1]{};
+        mesh->Parts = new PartData[1];
+        mesh->Parts[0].IndexOffset = 0;
+        mesh->Parts[0].IndexCount = header.IndexCount;
+        mesh->Parts[0].MinIndex = 0;
+        mesh->Parts[0].MaxIndex = header.VertexCount - 1;
+
+        GeneratePartLODs(mesh, 3, 0.5f, 0.05f);
+        const PartData& part = mesh->Parts[0];
+        REQUIRE(part.NumLODs >= 2);
+        CHECK(header.LODLevels == 3);
+
+        const uint32_t* all_indices = reinterpret_cast<const uint32_t*>(mesh->Indices);
+        CHECK(std::equal(indices.begin(), indices.end(), all_indices));
+        uint32_t expected_offset = static_cast<uint32_t>(indices.size());
+        uint32_t previous_count = part.IndexCount;
+        float previous_error = 0.0f;
+        for (uint32_t i = 0; i < part.NumLODs; ++i) {
+            const PartLODData& lod = part.LODs[i];
+            CHECK(lod.IndexOffset == expected_offset);
+            CHECK(lod.IndexCount < previous_count);
+            CHECK(lod.Error >= previous_error);
+            CHECK(lod.Error <= 0.05f * 16.0f);
+            for (uint32_t j = lod.IndexOffset; j < lod.IndexOffset + lod.IndexCount; ++j) {
+                REQUIRE(all_indices[j] <= part.MaxIndex);
+            }
+            expected_offset += lod.IndexCount;
+            previous_count = lod.IndexCount;
+            previous_error = lod.Error;
+        }
+        CHECK(header.IndexCount == expected_offset);
+        CHECK(header.IndexDataSize == expected_offset * sizeof(uint32_t));
+
+        // 1000 pixels per unit at unit distance, 1 pixel tolerance
+        CHECK(SelectPartLOD(part, 1.0f, 1000.0f, 1.0f) == 0);
+        CHECK(SelectPartLOD(part, 1e6f, 1000.0f, 1.0f) == part.NumLODs);
+
+        MeshData::DestroyMeshData(mesh);
+    }
+
+}
+
+#endif //!VPSK_TESTING_ENABLED
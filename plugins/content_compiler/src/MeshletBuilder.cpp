@@ -0,0 +1,324 @@
+#include "MeshletBuilder.hpp"
+#include "MeshQuantization.hpp"
+#include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+    // Cones with triangles more than ~84 degrees off their axis are almost never culled, and their apex is unstable
+    constexpr float min_cone_dot = 0.1f;
+
+    struct vec3_t {
+        float x, y, z;
+    };
+
+    vec3_t to_vec3(const fvec4& v) noexcept {
+        return vec3_t{ v.x(), v.y(), v.z() };
+    }
+
+    vec3_t operator-(const vec3_t& a, const vec3_t& b) noexcept {
+        return vec3_t{ a.x - b.x, a.y - b.y, a.z - b.z };
+    }
+
+    float dot(const vec3_t& a, const vec3_t& b) noexcept {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    vec3_t cross(const vec3_t& a, const vec3_t& b) noexcept {
+        return vec3_t{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    void compute_bounds(MeshletData& meshlet, const uint32_t* indices, const fvec4* positions) {
+        const uint32_t* first = indices;
+        const uint32_t* last = indices + meshlet.IndexCount;
+
+        vec3_t min{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        vec3_t max{ -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+        for (const uint32_t* idx = first; idx != last; ++idx) {
+            const vec3_t p = to_vec3(positions[*idx]);
+            min = vec3_t{ std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+            max = vec3_t{ std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+        }
+
+        const vec3_t center{ (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f };
+        float radius_sq = 0.0f;
+        for (const uint32_t* idx = first; idx != last; ++idx) {
+            const vec3_t offset = to_vec3(positions[*idx]) - center;
+            radius_sq = std::max(radius_sq, dot(offset, offset));
+        }
+
+        meshlet.Center[0] = center.x;
+        meshlet.Center[1] = center.y;
+        meshlet.Center[2] = center.z;
+        // Nudge outwards so float rounding in the culling test can't reject a vertex on the sphere
+        meshlet.Radius = std::sqrt(radius_sq) * (1.0f + std::numeric_limits<float>::epsilon() * 4.0f);
+        memcpy(meshlet.ConeApex, meshlet.Center, sizeof(meshlet.ConeApex));
+
+        // Degenerate triangles can't be seen from anywhere, so they don't constrain the cone
+        std::vector<vec3_t> normals;
+        normals.reserve(meshlet.IndexCount / 3);
+        vec3_t axis{ 0.0f, 0.0f, 0.0f };
+        for (const uint32_t* tri = first; tri != last; tri += 3) {
+            const vec3_t p0 = to_vec3(positions[tri[0]]);
+            const vec3_t normal = cross(to_vec3(positions[tri[1]]) - p0, to_vec3(positions[tri[2]]) - p0);
+            const float length = std::sqrt(dot(normal, normal));
+            if (length > 0.0f) {
+                normals.emplace_back(vec3_t{ normal.x / length, normal.y / length, normal.z / length });
+                axis = vec3_t{ axis.x + normals.back().x, axis.y + normals.back().y, axis.z + normals.back().z };
+            }
+        }
+
+        const float axis_length = std::sqrt(dot(axis, axis));
+        if (normals.empty() || axis_length <= 0.0f) {
+            return;
+        }
+        axis = vec3_t{ axis.x / axis_length, axis.y / axis_length, axis.z / axis_length };
+
+        float min_dot = 1.0f;
+        for (const vec3_t& normal : normals) {
+            min_dot = std::min(min_dot, dot(axis, normal));
+        }
+
+        if (min_dot <= min_cone_dot) {
+            return;
+        }
+
+        // Move the apex back along the axis until it's behind every triangle's plane: then a camera the cone test
+        // culls is behind all of them too, wherever in the meshlet they are
+        size_t normal_idx = 0;
+        float max_t = 0.0f;
+        for (const uint32_t* tri = first; tri != last; tri += 3) {
+            const vec3_t p0 = to_vec3(positions[tri[0]]);
+            const vec3_t edge_normal = cross(to_vec3(positions[tri[1]]) - p0, to_vec3(positions[tri[2]]) - p0);
+            if (dot(edge_normal, edge_normal) <= 0.0f) {
+                continue;
+            }
+            const vec3_t& normal = normals[normal_idx++];
+            max_t = std::max(max_t, dot(center - p0, normal) / dot(axis, normal));
+        }
+
+        meshlet.ConeApex[0] = center.x - axis.x * max_t;
+        meshlet.ConeApex[1] = center.y - axis.y * max_t;
+        meshlet.ConeApex[2] = center.z - axis.z * max_t;
+        meshlet.ConeAxis[0] = axis.x;
+        meshlet.ConeAxis[1] = axis.y;
+        meshlet.ConeAxis[2] = axis.z;
+        // Normals are within acos(min_dot) of the axis, so every triangle faces away once the view direction is
+        // within 90 - acos(min_dot) degrees of the axis: the cosine of that is sin(acos(min_dot))
+        meshlet.ConeCutoff = std::sqrt(1.0f - min_dot * min_dot);
+    }
+
+}
+
+void BuildMeshlets(std::vector<MeshletData>& meshlets, const uint32_t* indices, const uint32_t index_offset, const uint32_t index_count,
+    const fvec4* positions) {
+    uint32_t meshlet_vertices[MeshletMaxVertices];
+    uint32_t num_vertices = 0;
+    MeshletData current;
+    current.IndexOffset = index_offset;
+    current.IndexCount = 0;
+
+    auto flush = [&]() {
+        if (current.IndexCount != 0) {
+            compute_bounds(current, indices + (current.IndexOffset - index_offset), positions);
+            meshlets.emplace_back(current);
+        }
+        current = MeshletData();
+        current.IndexCount = 0;
+        num_vertices = 0;
+    };
+
+    for (uint32_t i = 0; i + 2 < index_count; i += 3) {
+        const uint32_t* tri = indices + i;
+        uint32_t new_vertices = 0;
+        for (uint32_t j = 0; j < 3; ++j) {
+            const bool repeated = std::find(tri, tri + j, tri[j]) != tri + j;
+            new_vertices += !repeated && (std::find(meshlet_vertices, meshlet_vertices + num_vertices, tri[j]) == meshlet_vertices + num_vertices);
+        }
+
+        if ((num_vertices + new_vertices > MeshletMaxVertices) || (current.IndexCount / 3 + 1 > MeshletMaxTriangles)) {
+            flush();
+            current.IndexOffset = index_offset + i;
+        }
+
+        for (uint32_t j = 0; j < 3; ++j) {
+            if (std::find(meshlet_vertices, meshlet_vertices + num_vertices, tri[j]) == meshlet_vertices + num_vertices) {
+                meshlet_vertices[num_vertices++] = tri[j];
+            }
+        }
+        current.IndexCount += 3;
+    }
+
+    flush();
+}
+
+void BuildMeshletData(MeshData* mesh) {
+    MeshDataHeader& header = mesh->Header;
+    if (mesh->FileMapping) {
+        LOG(ERROR) << "Can't build meshlets for a memory-mapped mesh file in place.";
+        return;
+    }
+
+    const std::vector<fvec4> positions = DecodePositions(mesh);
+    const uint16_t* indices16 = reinterpret_cast<const uint16_t*>(mesh->Indices);
+    const uint32_t* indices32 = reinterpret_cast<const uint32_t*>(mesh->Indices);
+    const bool index_16 = header.IndexFormat == VK_INDEX_TYPE_UINT16;
+
+    std::vector<MeshletData> meshlets;
+    std::vector<uint32_t> part_indices;
+    for (uint32_t i = 0; i < header.NumParts; ++i) {
+        PartData& part = mesh->Parts[i];
+        part.MeshletOffset = static_cast<uint32_t>(meshlets.size());
+        part.MeshletCount = 0;
+        if (part.IndexCount % 3 != 0) {
+            LOG(WARNING) << "Part " << i << " is not an indexed triangle list, no meshlets will be built for it.";
+            continue;
+        }
+
+        part_indices.resize(part.IndexCount);
+        bool in_range = true;
+        for (uint32_t j = 0; j < part.IndexCount; ++j) {
+            part_indices[j] = index_16 ? indices16[part.IndexOffset + j] : indices32[part.IndexOffset + j];
+            in_range &= part_indices[j] < positions.size();
+        }
+
+        if (!in_range) {
+            LOG(WARNING) << "Part " << i << " references vertices outside of the mesh, no meshlets will be built for it.";
+            continue;
+        }
+
+        BuildMeshlets(meshlets, part_indices.data(), part.IndexOffset, part.IndexCount, positions.data());
+        part.MeshletCount = static_cast<uint32_t>(meshlets.size()) - part.MeshletOffset;
+    }
+
+    delete[] mesh->Meshlets;
+    mesh->Meshlets = nullptr;
+    header.NumMeshlets = static_cast<uint32_t>(meshlets.size());
+    if (!meshlets.empty()) {
+        mesh->Meshlets = new MeshletData[meshlets.size()];
+        std::copy(meshlets.begin(), meshlets.end(), mesh->Meshlets);
+        LOG(INFO) << "Built " << meshlets.size() << " meshlets, averaging " << float(header.IndexCount / 3) / float(meshlets.size()) << " triangles each.";
+    }
+}
+
+#ifdef VPSK_TESTING_ENABLED
+#include <set>
+
+TEST_SUITE("MeshletBuilder") {
+
+    // Quads of a flat grid in the z = 0 plane, wound counter-clockwise when seen from +z
+    static void make_grid(const uint32_t size, std::vector<fvec4>& positions, std::vector<uint32_t>& indices) {
+        for (uint32_t y = 0; y <= size; ++y) {
+            for (uint32_t x = 0; x <= size; ++x) {
+                positions.emplace_back(static_cast<float>(x), static_cast<float>(y), 0.0f, 1.0f);
+            }
+        }
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                const uint32_t v0 = y * (size + 1) + x;
+                const uint32_t v1 = v0 + 1;
+                const uint32_t v2 = v0 + size + 1;
+                const uint32_t v3 = v2 + 1;
+                indices.insert(indices.end(), { v0, v1, v3, v0, v3, v2 });
+            }
+        }
+    }
+
+    TEST_CASE("MeshletsCoverGridWithinLimits") {
+        std::vector<fvec4> positions;
+        std::vector<uint32_t> indices;
+        make_grid(32, positions, indices);
+        std::vector<MeshletData> meshlets;
+        BuildMeshlets(meshlets, indices.data(), 0, static_cast<uint32_t>(indices.size()), positions.data());
+
+        REQUIRE(!meshlets.empty());
+        uint32_t next_index = 0;
+        for (const MeshletData& meshlet : meshlets) {
+            CHECK(meshlet.IndexOffset == next_index);
+            next_index = meshlet.IndexOffset + meshlet.IndexCount;
+            CHECK(meshlet.IndexCount / 3 <= MeshletMaxTriangles);
+
+            std::set<uint32_t> unique(indices.begin() + meshlet.IndexOffset, indices.begin() + meshlet.IndexOffset + meshlet.IndexCount);
+            CHECK(unique.size() <= MeshletMaxVertices);
+            for (const uint32_t idx : unique) {
+                const float dx = positions[idx].x() - meshlet.Center[0];
+                const float dy = positions[idx].y() - meshlet.Center[1];
+                const float dz = positions[idx].z() - meshlet.Center[2];
+                CHECK(dx * dx + dy * dy + dz * dz <= meshlet.Radius * meshlet.Radius);
+            }
+
+            // A flat meshlet is backfacing from anywhere below its plane, and only from there
+            const float below[3]{ meshlet.Center[0] + 3.0f, meshlet.Center[1], -0.5f };
+            const float above[3]{ meshlet.Center[0], meshlet.Center[1] - 40.0f, 0.5f };
+            CHECK(MeshletBackfacing(meshlet, below));
+            CHECK(!MeshletBackfacing(meshlet, above));
+        }
+        CHECK(next_index == indices.size());
+    }
+
+    TEST_CASE("ClosedMeshletsAreNeverCulled") {
+        // Tetrahedron: normals point in all directions
+        const std::vector<fvec4> positions{ fvec4(0.0f, 0.0f, 0.0f, 1.0f), fvec4(1.0f, 0.0f, 0.0f, 1.0f), fvec4(0.0f, 1.0f, 0.0f, 1.0f), fvec4(0.0f, 0.0f, 1.0f, 1.0f) };
+        const std::vector<uint32_t> indices{ 0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3 };
+        std::vector<MeshletData> meshlets;
+        BuildMeshlets(meshlets, indices.data(), 0, static_cast<uint32_t>(indices.size()), positions.data());
+        REQUIRE(meshlets.size() == 1);
+        CHECK(meshlets[0].ConeCutoff == 1.0f);
+        const float camera[3]{ 5.0f, -3.0f, 2.0f };
+        CHECK(!MeshletBackfacing(meshlets[0], camera));
+    }
+
+    TEST_CASE("BuildMeshletDataFillsParts") {
+        std::vector<fvec4> positions;
+        std::vector<uint32_t> indices;
+        make_grid(16, positions, indices);
+
+        MeshData* mesh = new MeshData();
+        MeshDataHeader& header = mesh->Header;
+        header.Interleaved = 1;
+        header.NumParts = 2;
+        header.VertexCount = static_cast<uint32_t>(positions.size());
+        header.PositionAttrOffset = 0;
+        header.PositionAttrStride = sizeof(fvec4);
+        header.PositionAttrFormat = uint32_t(VK_FORMAT_R32G32B32A32_SFLOAT);
+        header.IndexFormat = VK_INDEX_TYPE_UINT16;
+        header.IndexCount = static_cast<uint32_t>(indices.size());
+        mesh->Vertices = new uint8_t[positions.size() * sizeof(fvec4)];
+        memcpy(mesh->Vertices, positions.data(), positions.size() * sizeof(fvec4));
+        uint16_t* indices16 = new uint16_t[indices.size()];
+        std::copy(indices.begin(), indices.end(), indices16);
+        mesh->Indices = indices16;
+        mesh->Materials = new MaterialInfo[1]{};
+        mesh->Parts = new PartData[2];
+        mesh->Parts[0].IndexOffset = 0;
+        mesh->Parts[0].IndexCount = 300;
+        mesh->Parts[1].IndexOffset = 300;
+        mesh->Parts[1].IndexCount = header.IndexCount - 300;
+
+        BuildMeshletData(mesh);
+        REQUIRE(header.NumMeshlets > 2);
+        REQUIRE(mesh->Meshlets != nullptr);
+        CHECK(mesh->Parts[0].MeshletOffset == 0);
+        CHECK(mesh->Parts[1].MeshletOffset == mesh->Parts[0].MeshletCount);
+        CHECK(mesh->Parts[0].MeshletCount + mesh->Parts[1].MeshletCount == header.NumMeshlets);
+        for (uint32_t i = 0; i < 2; ++i) {
+            const PartData& part = mesh->Parts[i];
+            uint32_t covered = 0;
+            for (uint32_t j = part.MeshletOffset; j < part.MeshletOffset + part.MeshletCount; ++j) {
+                CHECK(mesh->Meshlets[j].IndexOffset == part.IndexOffset + covered);
+                covered += mesh->Meshlets[j].IndexCount;
+            }
+            CHECK(covered == part.IndexCount);
+        }
+
+        MeshData::DestroyMeshData(mesh);
+    }
+
+}
+
+#endif //!VPSK_TESTING_ENABLED
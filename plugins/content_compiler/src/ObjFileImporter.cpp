@@ -0,0 +1,872 @@
+#include "ObjFileImporter.hpp"
+#include "MeshData.hpp"
+#include "ImportUtilities.hpp"
+#include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+/*
+    Chunks are split at line boundaries and parsed independently. Negative indices count back from the latest
+    attribute, which a chunk can't resolve until it knows how many attributes came before it: they are stored
+    relative to the start of the chunk and fixed up once every chunk's counts have been summed. Triangles are
+    then gathered into one part per material, and each part's corners are welded into vertices with an open
+    addressing table keyed on the raw bits of the vertex, in parallel across parts. Parts are welded separately
+    so that each keeps a disjoint vertex range, as the optimizer and meshlet builder expect.
+    UVs are stored as given, matching what the Assimp importer produced for these files.
+*/
+
+namespace {
+
+    constexpr size_t ObjParseChunkSize = 1u << 20;
+    constexpr int32_t ObjMissingIndex = std::numeric_limits<int32_t>::min();
+    constexpr const char* const ObjDefaultMaterial = "DefaultMaterial";
+
+    struct float2_t {
+        float x, y;
+    };
+
+    struct float3_t {
+        float x, y, z;
+    };
+
+    // Indices are zero based. Flagged components are still relative to the start of their chunk.
+    struct obj_corner_t {
+        int32_t position;
+        int32_t uv;
+        int32_t normal;
+        uint32_t relativeMask;
+    };
+
+    constexpr uint32_t RelativePosition = 0x1;
+    constexpr uint32_t RelativeUV = 0x2;
+    constexpr uint32_t RelativeNormal = 0x4;
+
+    struct obj_material_run_t {
+        // Index into the chunk's corners where this material starts being used
+        size_t firstCorner;
+        std::string material;
+    };
+
+    struct obj_chunk_t {
+        const char* begin;
+        const char* end;
+        std::vector<float3_t> positions;
+        std::vector<float2_t> uvs;
+        std::vector<float3_t> normals;
+        // Three per triangle
+        std::vector<obj_corner_t> corners;
+        // Corners before the first run use the material that was active at the end of the previous chunk
+        std::vector<obj_material_run_t> materialRuns;
+        size_t positionBase{ 0 };
+        size_t uvBase{ 0 };
+        size_t normalBase{ 0 };
+    };
+
+    struct obj_corner_range_t {
+        uint32_t chunk;
+        size_t begin;
+        size_t end;
+    };
+
+    // Packed so that vertices can be hashed and compared as plain bits
+    struct obj_vertex_t {
+        float3_t position;
+        float3_t normal;
+        float2_t uv;
+    };
+    static_assert(sizeof(obj_vertex_t) == 4 * sizeof(uint64_t), "OBJ vertices are hashed as four 64-bit words");
+
+    struct welded_part_t {
+        std::vector<obj_vertex_t> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<obj_corner_range_t> ranges;
+        uint32_t materialID{ 0 };
+    };
+
+    inline bool is_blank(const char c) noexcept {
+        return (c == ' ') || (c == '\t') || (c == '\r');
+    }
+
+    inline bool is_digit(const char c) noexcept {
+        return (c >= '0') && (c <= '9');
+    }
+
+    const char* skip_blanks(const char* p, const char* end) noexcept {
+        while ((p < end) && is_blank(*p)) {
+            ++p;
+        }
+        return p;
+    }
+
+    const char* next_line(const char* p, const char* end) noexcept {
+        const char* newline = reinterpret_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+        return newline ? newline + 1 : end;
+    }
+
+    bool starts_with_keyword(const char* p, const char* end, const char* keyword, const size_t length) noexcept {
+        return (static_cast<size_t>(end - p) > length) && (strncmp(p, keyword, length) == 0) && is_blank(p[length]);
+    }
+
+    // The mapping isn't null terminated, so strtof can't be used: significant digits are gathered into an
+    // integer and scaled once, which is exact for the short decimals exporters write.
+    bool parse_float(const char*& p, const char* end, float& result) noexcept {
+        static const double powers_of_ten[]{
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        const char* s = skip_blanks(p, end);
+        bool negative = false;
+        if ((s < end) && ((*s == '-') || (*s == '+'))) {
+            negative = (*s == '-');
+            ++s;
+        }
+
+        uint64_t mantissa = 0;
+        int32_t exponent = 0;
+        bool any_digits = false;
+        for (; (s < end) && is_digit(*s); ++s, any_digits = true) {
+            if (mantissa < 1000000000000000000ull) {
+                mantissa = mantissa * 10 + uint64_t(*s - '0');
+            }
+            else {
+                ++exponent;
+            }
+        }
+        if ((s < end) && (*s == '.')) {
+            for (++s; (s < end) && is_digit(*s); ++s, any_digits = true) {
+                if (mantissa < 1000000000000000000ull) {
+                    mantissa = mantissa * 10 + uint64_t(*s - '0');
+                    --exponent;
+                }
+            }
+        }
+        if (!any_digits) {
+            return false;
+        }
+
+        if ((s < end) && ((*s == 'e') || (*s == 'E'))) {
+            const char* e = s + 1;
+            bool negative_exponent = false;
+            if ((e < end) && ((*e == '-') || (*e == '+'))) {
+                negative_exponent = (*e == '-');
+                ++e;
+            }
+            if ((e < end) && is_digit(*e)) {
+                int32_t value = 0;
+                for (; (e < end) && is_digit(*e); ++e) {
+                    value = std::min(value * 10 + (*e - '0'), 1000);
+                }
+                exponent += negative_exponent ? -value : value;
+                s = e;
+            }
+        }
+
+        double value = double(mantissa);
+        if ((exponent >= -22) && (exponent <= 22)) {
+            value = (exponent < 0) ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+        }
+        else {
+            value *= std::pow(10.0, double(exponent));
+        }
+
+        result = static_cast<float>(negative ? -value : value);
+        p = s;
+        return true;
+    }
+
+    bool parse_int(const char*& p, const char* end, int32_t& result) noexcept {
+        const char* s = p;
+        bool negative = false;
+        if ((s < end) && ((*s == '-') || (*s == '+'))) {
+            negative = (*s == '-');
+            ++s;
+        }
+        if ((s == end) || !is_digit(*s)) {
+            return false;
+        }
+
+        int64_t value = 0;
+        for (; (s < end) && is_digit(*s); ++s) {
+            value = std::min<int64_t>(value * 10 + (*s - '0'), std::numeric_limits<int32_t>::max());
+        }
+
+        result = static_cast<int32_t>(negative ? -value : value);
+        p = s;
+        return true;
+    }
+
+    // Converts a one based or negative OBJ index into a zero based one, setting relative_flag for negative ones
+    bool convert_index(const int32_t index, const size_t count_so_far, int32_t& result, uint32_t& relative_mask, const uint32_t relative_flag) noexcept {
+        if (index > 0) {
+            result = index - 1;
+        }
+        else if (index < 0) {
+            result = static_cast<int32_t>(int64_t(count_so_far) + index);
+            relative_mask |= relative_flag;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+
+    bool parse_corner(const char*& p, const char* end, const obj_chunk_t& chunk, obj_corner_t& corner) noexcept {
+        corner = obj_corner_t{ ObjMissingIndex, ObjMissingIndex, ObjMissingIndex, 0 };
+
+        int32_t index = 0;
+        if (!parse_int(p, end, index) || !convert_index(index, chunk.positions.size(), corner.position, corner.relativeMask, RelativePosition)) {
+            return false;
+        }
+
+        if ((p < end) && (*p == '/')) {
+            ++p;
+            if ((p < end) && (*p != '/')) {
+                if (!parse_int(p, end, index) || !convert_index(index, chunk.uvs.size(), corner.uv, corner.relativeMask, RelativeUV)) {
+                    return false;
+                }
+            }
+            if ((p < end) && (*p == '/')) {
+                ++p;
+                if (!parse_int(p, end, index) || !convert_index(index, chunk.normals.size(), corner.normal, corner.relativeMask, RelativeNormal)) {
+                    return false;
+                }
+            }
+        }
+
+        return (p == end) || is_blank(*p) || (*p == '\n');
+    }
+
+    void parse_chunk(obj_chunk_t& chunk) {
+        const char* p = chunk.begin;
+        const char* const end = chunk.end;
+        std::vector<obj_corner_t> face;
+
+        while (p < end) {
+            p = skip_blanks(p, end);
+            const char* const line_end = next_line(p, end);
+            if ((p == line_end) || (*p == '#') || (*p == '\n')) {
+                p = line_end;
+                continue;
+            }
+
+            if (starts_with_keyword(p, line_end, "v", 1)) {
+                p += 1;
+                float3_t position{ 0.0f, 0.0f, 0.0f };
+                if (!parse_float(p, line_end, position.x) || !parse_float(p, line_end, position.y) || !parse_float(p, line_end, position.z)) {
+                    LOG(ERROR) << "Malformed vertex position in OBJ file.";
+                    throw std::runtime_error("Malformed vertex position in OBJ file!");
+                }
+                chunk.positions.emplace_back(position);
+            }
+            else if (starts_with_keyword(p, line_end, "vt", 2)) {
+                p += 2;
+                float2_t uv{ 0.0f, 0.0f };
+                if (!parse_float(p, line_end, uv.x)) {
+                    LOG(ERROR) << "Malformed texture coordinate in OBJ file.";
+                    throw std::runtime_error("Malformed texture coordinate in OBJ file!");
+                }
+                // The second coordinate is optional
+                parse_float(p, line_end, uv.y);
+                chunk.uvs.emplace_back(uv);
+            }
+            else if (starts_with_keyword(p, line_end, "vn", 2)) {
+                p += 2;
+                float3_t normal{ 0.0f, 0.0f, 0.0f };
+                if (!parse_float(p, line_end, normal.x) || !parse_float(p, line_end, normal.y) || !parse_float(p, line_end, normal.z)) {
+                    LOG(ERROR) << "Malformed vertex normal in OBJ file.";
+                    throw std::runtime_error("Malformed vertex normal in OBJ file!");
+                }
+                chunk.normals.emplace_back(normal);
+            }
+            else if (starts_with_keyword(p, line_end, "f", 1)) {
+                p += 1;
+                face.clear();
+                for (p = skip_blanks(p, line_end); (p < line_end) && (*p != '\n'); p = skip_blanks(p, line_end)) {
+                    obj_corner_t corner;
+                    if (!parse_corner(p, line_end, chunk, corner)) {
+                        LOG(ERROR) << "Malformed face in OBJ file.";
+                        throw std::runtime_error("Malformed face in OBJ file!");
+                    }
+                    face.emplace_back(corner);
+                }
+
+                // Triangulate as a fan: faces with fewer than three corners are dropped
+                for (size_t i = 2; i < face.size(); ++i) {
+                    chunk.corners.emplace_back(face[0]);
+                    chunk.corners.emplace_back(face[i - 1]);
+                    chunk.corners.emplace_back(face[i]);
+                }
+            }
+            else if (starts_with_keyword(p, line_end, "usemtl", 6)) {
+                const char* name_begin = skip_blanks(p + 6, line_end);
+                const char* name_end = line_end;
+                while ((name_end > name_begin) && (is_blank(name_end[-1]) || (name_end[-1] == '\n'))) {
+                    --name_end;
+                }
+                chunk.materialRuns.emplace_back(obj_material_run_t{ chunk.corners.size(), std::string(name_begin, name_end) });
+            }
+
+            p = line_end;
+        }
+    }
+
+    std::vector<obj_chunk_t> split_into_chunks(const char* data, const size_t size) {
+        const size_t num_chunks = std::max<size_t>(1, size / ObjParseChunkSize);
+        std::vector<obj_chunk_t> result(num_chunks);
+        const char* begin = data;
+        for (size_t i = 0; i < num_chunks; ++i) {
+            const char* end = data + size;
+            if (i + 1 < num_chunks) {
+                end = std::max(begin, data + size / num_chunks * (i + 1));
+                end = (end < data + size) ? next_line(end, data + size) : end;
+            }
+            result[i].begin = begin;
+            result[i].end = end;
+            begin = end;
+        }
+        return result;
+    }
+
+    int32_t resolve_index(const int32_t index, const bool relative, const size_t base, const size_t count) {
+        if (index == ObjMissingIndex) {
+            return ObjMissingIndex;
+        }
+
+        const int64_t result = relative ? int64_t(base) + index : int64_t(index);
+        if ((result < 0) || (result >= int64_t(count))) {
+            LOG(ERROR) << "OBJ file has a face referencing attribute " << result + 1 << " of " << count << ".";
+            throw std::out_of_range("OBJ face index out of range!");
+        }
+        return static_cast<int32_t>(result);
+    }
+
+    void resolve_corners(obj_chunk_t& chunk, const size_t num_positions, const size_t num_uvs, const size_t num_normals) {
+        for (obj_corner_t& corner : chunk.corners) {
+            corner.position = resolve_index(corner.position, corner.relativeMask & RelativePosition, chunk.positionBase, num_positions);
+            corner.uv = resolve_index(corner.uv, corner.relativeMask & RelativeUV, chunk.uvBase, num_uvs);
+            corner.normal = resolve_index(corner.normal, corner.relativeMask & RelativeNormal, chunk.normalBase, num_normals);
+            corner.relativeMask = 0;
+        }
+    }
+
+    inline float3_t sub(const float3_t& a, const float3_t& b) noexcept {
+        return float3_t{ a.x - b.x, a.y - b.y, a.z - b.z };
+    }
+
+    inline float3_t cross(const float3_t& a, const float3_t& b) noexcept {
+        return float3_t{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    inline void accumulate(float3_t& dst, const float3_t& v, const float scale) noexcept {
+        dst.x += v.x * scale;
+        dst.y += v.y * scale;
+        dst.z += v.z * scale;
+    }
+
+    inline float3_t normalize(const float3_t& v) noexcept {
+        const float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        const float inv_length = length > 0.0f ? 1.0f / length : 0.0f;
+        return float3_t{ v.x * inv_length, v.y * inv_length, v.z * inv_length };
+    }
+
+    // Area weighted normals of every position used by a corner without one. Corners can't be told apart by smoothing
+    // group, so all faces sharing a position are smoothed together, as Assimp's GenSmoothNormals does for OBJ files.
+    std::vector<float3_t> generate_smooth_normals(const std::vector<obj_chunk_t>& chunks, const std::vector<float3_t>& positions) {
+        std::vector<float3_t> result(positions.size(), float3_t{ 0.0f, 0.0f, 0.0f });
+        for (const obj_chunk_t& chunk : chunks) {
+            for (size_t i = 0; i + 2 < chunk.corners.size(); i += 3) {
+                const obj_corner_t* tri = &chunk.corners[i];
+                if ((tri[0].normal != ObjMissingIndex) && (tri[1].normal != ObjMissingIndex) && (tri[2].normal != ObjMissingIndex)) {
+                    continue;
+                }
+
+                const float3_t& p0 = positions[tri[0].position];
+                const float3_t face_normal = cross(sub(positions[tri[1].position], p0), sub(positions[tri[2].position], p0));
+                for (size_t j = 0; j < 3; ++j) {
+                    accumulate(result[tri[j].position], face_normal, 1.0f);
+                }
+            }
+        }
+
+        for (float3_t& normal : result) {
+            normal = normalize(normal);
+        }
+        return result;
+    }
+
+    inline uint64_t fmix64(uint64_t k) noexcept {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdull;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ull;
+        k ^= k >> 33;
+        return k;
+    }
+
+    // Every bit of every word reaches every bit of the result, so the table can be indexed by the low bits
+    inline uint64_t hash_vertex(const obj_vertex_t& vertex) noexcept {
+        uint64_t words[4];
+        memcpy(words, &vertex, sizeof(words));
+        uint64_t result = 0x9e3779b97f4a7c15ull;
+        for (const uint64_t word : words) {
+            result = fmix64(result ^ word) + 0x9e3779b97f4a7c15ull;
+        }
+        return result;
+    }
+
+    void weld_part(welded_part_t& part, const std::vector<obj_chunk_t>& chunks, const std::vector<float3_t>& positions, const std::vector<float2_t>& uvs,
+        const std::vector<float3_t>& normals, const std::vector<float3_t>& smooth_normals) {
+        size_t num_corners = 0;
+        for (const obj_corner_range_t& range : part.ranges) {
+            num_corners += range.end - range.begin;
+        }
+
+        // At most half full, even if no corners are shared
+        size_t table_size = 16;
+        while (table_size < num_corners * 2) {
+            table_size *= 2;
+        }
+        const size_t table_mask = table_size - 1;
+        constexpr uint32_t empty_slot = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> table(table_size, empty_slot);
+
+        part.indices.reserve(num_corners);
+        part.vertices.reserve(num_corners / 4);
+
+        for (const obj_corner_range_t& range : part.ranges) {
+            const obj_chunk_t& chunk = chunks[range.chunk];
+            for (size_t i = range.begin; i < range.end; ++i) {
+                const obj_corner_t& corner = chunk.corners[i];
+                obj_vertex_t vertex;
+                // Zero any padding and unused bits, so equal vertices hash equally
+                memset(&vertex, 0, sizeof(vertex));
+                vertex.position = positions[corner.position];
+                vertex.normal = (corner.normal != ObjMissingIndex) ? normals[corner.normal] : smooth_normals[corner.position];
+                vertex.uv = (corner.uv != ObjMissingIndex) ? uvs[corner.uv] : float2_t{ 0.0f, 0.0f };
+
+                size_t slot = static_cast<size_t>(hash_vertex(vertex)) & table_mask;
+                while ((table[slot] != empty_slot) && (memcmp(&part.vertices[table[slot]], &vertex, sizeof(obj_vertex_t)) != 0)) {
+                    slot = (slot + 1) & table_mask;
+                }
+
+                if (table[slot] == empty_slot) {
+                    table[slot] = static_cast<uint32_t>(part.vertices.size());
+                    part.vertices.emplace_back(vertex);
+                }
+                part.indices.emplace_back(table[slot]);
+            }
+        }
+    }
+
+    // Per vertex UV tangents and bitangents (Lengyel's method), accumulated over the triangles using each vertex.
+    // Vertices whose UVs are degenerate get an arbitrary tangent perpendicular to their normal.
+    void generate_tangents(const welded_part_t& part, std::vector<float3_t>& tangents, std::vector<float3_t>& bitangents) {
+        tangents.assign(part.vertices.size(), float3_t{ 0.0f, 0.0f, 0.0f });
+        bitangents.assign(part.vertices.size(), float3_t{ 0.0f, 0.0f, 0.0f });
+
+        for (size_t i = 0; i + 2 < part.indices.size(); i += 3) {
+            const uint32_t i0 = part.indices[i + 0];
+            const uint32_t i1 = part.indices[i + 1];
+            const uint32_t i2 = part.indices[i + 2];
+            const obj_vertex_t& v0 = part.vertices[i0];
+            const float3_t e1 = sub(part.vertices[i1].position, v0.position);
+            const float3_t e2 = sub(part.vertices[i2].position, v0.position);
+            const float du1 = part.vertices[i1].uv.x - v0.uv.x;
+            const float dv1 = part.vertices[i1].uv.y - v0.uv.y;
+            const float du2 = part.vertices[i2].uv.x - v0.uv.x;
+            const float dv2 = part.vertices[i2].uv.y - v0.uv.y;
+
+            const float det = du1 * dv2 - du2 * dv1;
+            if (std::abs(det) < std::numeric_limits<float>::min()) {
+                continue;
+            }
+
+            const float r = 1.0f / det;
+            const float3_t tangent{ (e1.x * dv2 - e2.x * dv1) * r, (e1.y * dv2 - e2.y * dv1) * r, (e1.z * dv2 - e2.z * dv1) * r };
+            const float3_t bitangent{ (e2.x * du1 - e1.x * du2) * r, (e2.y * du1 - e1.y * du2) * r, (e2.z * du1 - e1.z * du2) * r };
+            for (const uint32_t idx : { i0, i1, i2 }) {
+                accumulate(tangents[idx], tangent, 1.0f);
+                accumulate(bitangents[idx], bitangent, 1.0f);
+            }
+        }
+
+        for (size_t i = 0; i < part.vertices.size(); ++i) {
+            // vn entries aren't required to be unit length, which both the projection and the fallback axis rely on
+            const float3_t n = normalize(part.vertices[i].normal);
+            float3_t& t = tangents[i];
+            const float n_dot_t = n.x * t.x + n.y * t.y + n.z * t.z;
+            const float3_t orthogonal{ t.x - n.x * n_dot_t, t.y - n.y * n_dot_t, t.z - n.z * n_dot_t };
+            if (orthogonal.x * orthogonal.x + orthogonal.y * orthogonal.y + orthogonal.z * orthogonal.z > 1e-12f) {
+                continue;
+            }
+
+            const float3_t axis = (std::abs(n.x) < 0.9f) ? float3_t{ 1.0f, 0.0f, 0.0f } : float3_t{ 0.0f, 1.0f, 0.0f };
+            t = normalize(cross(axis, n));
+            bitangents[i] = cross(n, t);
+        }
+    }
+
+    template<typename T>
+    T* strided(T* base, const size_t stride, const size_t idx) noexcept {
+        return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(base) + stride * idx);
+    }
+
+    template<typename INDEX>
+    void write_indices(const welded_part_t& part, const uint32_t vertex_offset, INDEX* dst) noexcept {
+        for (const uint32_t index : part.indices) {
+            *dst++ = static_cast<INDEX>(index + vertex_offset);
+        }
+    }
+
+}
+
+MeshData* LoadMeshDataFromObj(const char* fname, MeshProcessingOptions* opts) {
+    std::unique_ptr<MappedFile, decltype(&UnmapFile)> file(MapFile(fname), UnmapFile);
+    if (!file) {
+        LOG(ERROR) << "Failed to open OBJ file " << fname << "! File either doesn't exist, is empty or couldn't be mapped.";
+        return nullptr;
+    }
+
+    std::vector<obj_chunk_t> chunks = split_into_chunks(file->Data, static_cast<size_t>(file->Size));
+    ForEachChunk(chunks.size(), [&](const size_t i) {
+        parse_chunk(chunks[i]);
+    });
+
+    size_t num_positions = 0, num_uvs = 0, num_normals = 0;
+    for (obj_chunk_t& chunk : chunks) {
+        chunk.positionBase = num_positions;
+        chunk.uvBase = num_uvs;
+        chunk.normalBase = num_normals;
+        num_positions += chunk.positions.size();
+        num_uvs += chunk.uvs.size();
+        num_normals += chunk.normals.size();
+    }
+
+    if (std::max({ num_positions, num_uvs, num_normals }) > size_t(std::numeric_limits<int32_t>::max())) {
+        LOG(ERROR) << "OBJ file " << fname << " has more attributes than can be indexed.";
+        throw std::out_of_range("OBJ file has too many attributes!");
+    }
+
+    std::vector<float3_t> positions(num_positions);
+    std::vector<float2_t> uvs(num_uvs);
+    std::vector<float3_t> normals(num_normals);
+    ForEachChunk(chunks.size(), [&](const size_t i) {
+        obj_chunk_t& chunk = chunks[i];
+        resolve_corners(chunk, num_positions, num_uvs, num_normals);
+        std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase);
+        std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + chunk.uvBase);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase);
+        chunk.positions = std::vector<float3_t>();
+        chunk.uvs = std::vector<float2_t>();
+        chunk.normals = std::vector<float3_t>();
+    });
+
+    // Materials are numbered in order of first use, each getting one part with all its triangles in file order
+    std::vector<std::string> material_names;
+    std::unordered_map<std::string, uint32_t> material_ids;
+    std::vector<welded_part_t> parts;
+    std::vector<uint32_t> material_parts;
+    bool missing_normals = false;
+    bool missing_uvs = false;
+    {
+        std::string current_material = ObjDefaultMaterial;
+        auto add_range = [&](const uint32_t chunk, const size_t begin, const size_t end) {
+            if (begin == end) {
+                return;
+            }
+            auto inserted = material_ids.emplace(current_material, static_cast<uint32_t>(material_names.size()));
+            if (inserted.second) {
+                material_names.emplace_back(current_material);
+                material_parts.emplace_back(static_cast<uint32_t>(parts.size()));
+                parts.emplace_back();
+                parts.back().materialID = inserted.first->second;
+            }
+            parts[material_parts[inserted.first->second]].ranges.emplace_back(obj_corner_range_t{ chunk, begin, end });
+        };
+
+        for (uint32_t i = 0; i < static_cast<uint32_t>(chunks.size()); ++i) {
+            const obj_chunk_t& chunk = chunks[i];
+            size_t begin = 0;
+            for (const obj_material_run_t& run : chunk.materialRuns) {
+                add_range(i, begin, run.firstCorner);
+                begin = run.firstCorner;
+                current_material = run.material;
+            }
+            add_range(i, begin, chunk.corners.size());
+
+            for (const obj_corner_t& corner : chunk.corners) {
+                missing_normals |= (corner.normal == ObjMissingIndex);
+                missing_uvs |= (corner.uv == ObjMissingIndex);
+            }
+        }
+    }
+
+    if (parts.empty()) {
+        LOG(ERROR) << "OBJ file " << fname << " contains no faces.";
+        throw std::runtime_error("OBJ file contains no faces!");
+    }
+
+    if (missing_uvs) {
+        LOG(WARNING) << "OBJ file " << fname << " has faces without texture coordinates: tangents of these will be arbitrary.";
+    }
+
+    const std::vector<float3_t> smooth_normals = missing_normals ? generate_smooth_normals(chunks, positions) : std::vector<float3_t>();
+    ForEachChunk(parts.size(), [&](const size_t i) {
+        weld_part(parts[i], chunks, positions, uvs, normals, smooth_normals);
+    });
+    chunks = std::vector<obj_chunk_t>();
+
+    size_t num_vertices = 0, num_indices = 0;
+    std::vector<uint32_t> vertex_offsets(parts.size()), index_offsets(parts.size());
+    for (size_t i = 0; i < parts.size(); ++i) {
+        vertex_offsets[i] = static_cast<uint32_t>(num_vertices);
+        index_offsets[i] = static_cast<uint32_t>(num_indices);
+        num_vertices += parts[i].vertices.size();
+        num_indices += parts[i].indices.size();
+        if ((num_vertices > std::numeric_limits<uint32_t>::max()) || (num_indices > std::numeric_limits<uint32_t>::max())) {
+            throw std::out_of_range("OBJ file has more vertices than can be addressed by 32-bit indices!");
+        }
+    }
+
+    std::unique_ptr<MeshData, decltype(&MeshData::DestroyMeshData)> result(
+        CreateMeshData(static_cast<uint32_t>(parts.size()), static_cast<uint32_t>(material_names.size()), num_vertices, num_indices, false, opts),
+        MeshData::DestroyMeshData);
+    const VertexStreams output = GetVertexStreams(result.get());
+    const bool has_index_16 = (result->Header.IndexFormat == VK_INDEX_TYPE_UINT16);
+
+    ForEachChunk(parts.size(), [&](const size_t i) {
+        const welded_part_t& part = parts[i];
+        const uint32_t vertex_offset = vertex_offsets[i];
+
+        float min[3]{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        float max[3]{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+        std::vector<float3_t> part_normals(part.vertices.size());
+        for (size_t j = 0; j < part.vertices.size(); ++j) {
+            const obj_vertex_t& vertex = part.vertices[j];
+            *strided(output.Positions, output.PositionStride, vertex_offset + j) = fvec4(vertex.position.x, vertex.position.y, vertex.position.z, 1.0f);
+            *strided(output.UV0s, output.UV0Stride, vertex_offset + j) = fvec2(vertex.uv.x, vertex.uv.y);
+            part_normals[j] = vertex.normal;
+            const float p[3]{ vertex.position.x, vertex.position.y, vertex.position.z };
+            for (size_t k = 0; k < 3; ++k) {
+                min[k] = std::min(min[k], p[k]);
+                max[k] = std::max(max[k], p[k]);
+            }
+        }
+
+        std::vector<float3_t> tangents, bitangents;
+        generate_tangents(part, tangents, bitangents);
+        PackTangentFrames(&tangents[0].x, &bitangents[0].x, &part_normals[0].x, part.vertices.size(),
+            strided(output.Tangents, output.TangentStride, vertex_offset), output.TangentStride);
+
+        if (has_index_16) {
+            write_indices(part, vertex_offset, reinterpret_cast<uint16_t*>(result->Indices) + index_offsets[i]);
+        }
+        else {
+            write_indices(part, vertex_offset, reinterpret_cast<uint32_t*>(result->Indices) + index_offsets[i]);
+        }
+
+        PartData& part_data = result->Parts[i];
+        part_data.IndexOffset = index_offsets[i];
+        part_data.IndexCount = static_cast<uint32_t>(part.indices.size());
+        part_data.MinIndex = vertex_offset;
+        part_data.MaxIndex = vertex_offset + static_cast<uint32_t>(part.vertices.size()) - 1;
+        part_data.MaterialID = part.materialID;
+        for (size_t k = 0; k < 3; ++k) {
+            part_data.Center[k] = (min[k] + max[k]) * 0.5f;
+            part_data.HalfExtent[k] = (max[k] - min[k]) * 0.5f;
+        }
+    });
+
+    float min[3]{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float max[3]{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    for (uint32_t i = 0; i < result->Header.NumParts; ++i) {
+        const PartData& part = result->Parts[i];
+        for (size_t k = 0; k < 3; ++k) {
+            min[k] = std::min(min[k], part.Center[k] - part.HalfExtent[k]);
+            max[k] = std::max(max[k], part.Center[k] + part.HalfExtent[k]);
+        }
+    }
+    for (size_t k = 0; k < 3; ++k) {
+        result->Header.Center[k] = (min[k] + max[k]) * 0.5f;
+        result->Header.HalfExtent[k] = (max[k] - min[k]) * 0.5f;
+    }
+
+    for (uint32_t i = 0; i < result->Header.NumMaterials; ++i) {
+        const std::string& name = material_names[i];
+        result->Materials[i].NameLength = static_cast<uint32_t>(name.size());
+        result->Materials[i].Name = new char[name.size() + 1];
+        memcpy(result->Materials[i].Name, name.c_str(), name.size() + 1);
+    }
+
+    RunMeshProcessingStages(result.get(), opts);
+
+    return result.release();
+}
+
+#ifdef VPSK_TESTING_ENABLED
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+    MeshData* load_obj_string(const char* contents, MeshProcessingOptions& options) {
+        constexpr const char* const fname = "obj_importer_test.obj";
+        {
+            std::ofstream output(fname, std::ios::binary | std::ios::trunc);
+            output << contents;
+        }
+        // Removes the file even if loading throws
+        struct remove_on_exit_t {
+            ~remove_on_exit_t() {
+                std::remove(fname);
+            }
+        } remove_on_exit;
+        return LoadMeshDataFromObj(fname, &options);
+    }
+
+    MeshProcessingOptions obj_test_options() {
+        MeshProcessingOptions options{ false, false, true };
+        options.Optimize = false;
+        options.BuildMeshlets = false;
+        options.LODCount = 0;
+        return options;
+    }
+
+    constexpr const char* const ObjTestQuads =
+        "# two quads sharing an edge\n"
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0 0\nv 2 1 0\n"
+        "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+        "vn 0 0 1\n"
+        "usemtl first\n"
+        "f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+        "usemtl second\n"
+        "f -5/1/-1 5/2/1 6/3/1 -4/4/-1\r\n";
+
+}
+
+TEST_SUITE("ObjFileImporter") {
+    TEST_CASE("ParsesFloats") {
+        const char text[] = "  -1.5e2 0.25 7 .5 x";
+        const char* p = text;
+        const char* end = text + sizeof(text) - 1;
+        float value = 0.0f;
+        CHECK(parse_float(p, end, value));
+        CHECK(value == -150.0f);
+        CHECK(parse_float(p, end, value));
+        CHECK(value == 0.25f);
+        CHECK(parse_float(p, end, value));
+        CHECK(value == 7.0f);
+        CHECK(parse_float(p, end, value));
+        CHECK(value == 0.5f);
+        CHECK(!parse_float(p, end, value));
+    }
+
+    TEST_CASE("TriangulatesAndWeldsPerMaterial") {
+        MeshProcessingOptions options = obj_test_options();
+        MeshData* mesh = load_obj_string(ObjTestQuads, options);
+        REQUIRE(mesh != nullptr);
+        CHECK(mesh->Header.NumParts == 2);
+        CHECK(mesh->Header.NumMaterials == 2);
+        CHECK(std::string(mesh->Materials[0].Name) == "first");
+        CHECK(std::string(mesh->Materials[1].Name) == "second");
+        // Each quad welds to four vertices: the shared edge has different UVs in each, and parts never share vertices
+        CHECK(mesh->Header.VertexCount == 8);
+        CHECK(mesh->Header.IndexCount == 12);
+        CHECK(mesh->Header.IndexFormat == VK_INDEX_TYPE_UINT16);
+        CHECK(mesh->Parts[1].MinIndex == 4);
+        CHECK(mesh->Parts[1].MaxIndex == 7);
+        CHECK(mesh->Header.Center[0] == 1.0f);
+        CHECK(mesh->Header.HalfExtent[0] == 1.0f);
+
+        // Negative indices resolve against the attributes read so far: -5 is position 2, whose x is 1
+        const UninterleavedVertexData* vertices = reinterpret_cast<const UninterleavedVertexData*>(mesh->Vertices);
+        const fvec4* positions = reinterpret_cast<const fvec4*>(vertices->Positions);
+        const uint16_t* indices = reinterpret_cast<const uint16_t*>(mesh->Indices);
+        CHECK(positions[indices[6]].x() == 1.0f);
+        CHECK(positions[indices[6]].y() == 0.0f);
+        CHECK(positions[indices[11]].x() == 1.0f);
+        CHECK(positions[indices[11]].y() == 1.0f);
+        MeshData::DestroyMeshData(mesh);
+    }
+
+    TEST_CASE("GeneratesMissingNormals") {
+        MeshProcessingOptions options = obj_test_options();
+        options.Interleaved = true;
+        MeshData* mesh = load_obj_string("v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nvt 0 0\nvt 1 0\nvt 0 1\nvt 1 1\nf 1/1 2/2 3/3\nf 2/2 4/4 3/3\n", options);
+        REQUIRE(mesh != nullptr);
+        CHECK(mesh->Header.NumMaterials == 1);
+        CHECK(std::string(mesh->Materials[0].Name) == ObjDefaultMaterial);
+        CHECK(mesh->Header.VertexCount == 4);
+        // Tangent frames decode to a normal of +z: for a quaternion (x, y, z, w), n.z = 1 - 2(x^2 + y^2)
+        const Vertex* vertices = reinterpret_cast<const Vertex*>(mesh->Vertices);
+        for (uint32_t i = 0; i < mesh->Header.VertexCount; ++i) {
+            const float x = vertices[i].tangents[0] / 32767.0f;
+            const float y = vertices[i].tangents[1] / 32767.0f;
+            CHECK(1.0f - 2.0f * (x * x + y * y) > 0.999f);
+        }
+        MeshData::DestroyMeshData(mesh);
+    }
+
+    TEST_CASE("TangentsIgnoreNormalLength") {
+        // The UV tangent runs along the normal, so a tangent has to be made up: vn 0 0 4 must behave like vn 0 0 1
+        welded_part_t part;
+        part.vertices = {
+            obj_vertex_t{ float3_t{ 0.0f, 0.0f, 0.0f }, float3_t{ 0.0f, 0.0f, 4.0f }, float2_t{ 0.0f, 0.0f } },
+            obj_vertex_t{ float3_t{ 0.0f, 0.0f, 1.0f }, float3_t{ 0.0f, 0.0f, 4.0f }, float2_t{ 1.0f, 0.0f } },
+            obj_vertex_t{ float3_t{ 0.0f, 1.0f, 0.0f }, float3_t{ 0.0f, 0.0f, 4.0f }, float2_t{ 0.0f, 1.0f } }
+        };
+        part.indices = { 0, 1, 2 };
+        std::vector<float3_t> tangents;
+        std::vector<float3_t> bitangents;
+        generate_tangents(part, tangents, bitangents);
+        for (size_t i = 0; i < part.vertices.size(); ++i) {
+            CHECK(std::abs(tangents[i].z) < 1e-6f);
+            CHECK(std::abs(tangents[i].x * tangents[i].x + tangents[i].y * tangents[i].y - 1.0f) < 1e-5f);
+            const float bitangent_length = bitangents[i].x * bitangents[i].x + bitangents[i].y * bitangents[i].y + bitangents[i].z * bitangents[i].z;
+            CHECK(std::abs(bitangent_length - 1.0f) < 1e-5f);
+        }
+    }
+
+    TEST_CASE("SplitsIntoChunksAtLineBoundaries") {
+        std::string contents;
+        for (uint32_t i = 0; i < 200000; ++i) {
+            contents += "v " + std::to_string(i) + " 0 0\n";
+        }
+        for (uint32_t i = 0; i + 2 < 200000; i += 3) {
+            contents += "f -" + std::to_string(200000 - i) + " -" + std::to_string(200000 - i - 1) + " -" + std::to_string(200000 - i - 2) + "\n";
+        }
+        const std::vector<obj_chunk_t> chunks = split_into_chunks(contents.data(), contents.size());
+        CHECK(chunks.size() > 1);
+        for (size_t i = 1; i < chunks.size(); ++i) {
+            CHECK(chunks[i].begin[-1] == '\n');
+        }
+
+        MeshProcessingOptions options = obj_test_options();
+        MeshData* mesh = load_obj_string(contents.c_str(), options);
+        REQUIRE(mesh != nullptr);
+        CHECK(mesh->Header.VertexCount == 199998);
+        CHECK(mesh->Header.IndexFormat == VK_INDEX_TYPE_UINT32);
+        const fvec4* positions = reinterpret_cast<const fvec4*>(reinterpret_cast<const UninterleavedVertexData*>(mesh->Vertices)->Positions);
+        const uint32_t* indices = reinterpret_cast<const uint32_t*>(mesh->Indices);
+        CHECK(positions[indices[mesh->Header.IndexCount - 1]].x() == 199997.0f);
+        MeshData::DestroyMeshData(mesh);
+    }
+
+    TEST_CASE("RejectsOutOfRangeIndices") {
+        MeshProcessingOptions options = obj_test_options();
+        CHECK_THROWS(load_obj_string("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n", options));
+        CHECK_THROWS(load_obj_string("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 0\n", options));
+    }
+}
+
+#endif //!VPSK_TESTING_ENABLED
@@ -12,6 +12,9 @@ namespace st {
 
 
 class RenderGraph;
+class SubmissionGraph;
+struct pass_barriers_t;
+struct submission_attachments_t;
 
 class PipelineSubmission {
     PipelineSubmission(const PipelineSubmission&) = delete;
@@ -79,13 +82,23 @@ public:
 
 private:
 
-    void traverseDependencies(size_t& stack_count);
-    enum traversal_flags : uint32_t {
+    // Adds every submission this one has to run after to dependencies
+    void addDependencies(SubmissionGraph& dependencies) const;
+    enum dependency_flags : uint32_t {
+        // Resource doesn't need to be written by a submission, e.g. buffers filled from the host
         NoCheck = 0x00000001,
-        IgnoreSelf = 0x00000002,
-        MergeDependency = 0x00000004
+        // Reads attachments at the same pixel, so both submissions could share a render pass
+        MergeDependency = 0x00000002,
+        // Resource is also written by this submission: only submissions added before this one are dependencies
+        InPlace = 0x00000004,
+        // Only read by this submission: depends on the writers added before it, or on every writer if there are none
+        PrecedingWriters = 0x00000008
     };
-    void dependencyTraversalRecursion(const std::unordered_set<size_t>& passes, size_t& stack_count, const uint32_t& flags);
+    void addDependenciesOn(const std::unordered_set<size_t>& submissions, SubmissionGraph& dependencies, const uint32_t flags) const;
+    // Adds the layout, access and stages of every resource this submission uses
+    void addResourceAccesses(pass_barriers_t& barriers) const;
+    // Adds what this submission draws to, if it needs a render pass at all
+    void addRenderPassAttachments(submission_attachments_t& attachments);
 
     std::string name{};
     RenderGraph& graph;
@@ -9,6 +9,9 @@
 #include <variant>
 #include "core/ResourceUsage.hpp"
 #include "PipelineResource.hpp"
+#include "SubmissionGraph.hpp"
+#include "SubmissionBarriers.hpp"
+#include "RenderPassMerging.hpp"
 
 namespace st {
     class ShaderPack;
@@ -50,6 +53,15 @@ public:
     void SetBackbufferDimensions(const resource_dimensions_t& dimensions);
     resource_dimensions_t GetResourceDimensions(const PipelineResource& rsrc);
     size_t NumSubmissions() const noexcept;
+    // Dependencies between submissions, and the order they run in, as of the last Bake()
+    const SubmissionGraph& GetSubmissionGraph() const noexcept;
+    // Render passes of the last Bake(), in order: consecutive submissions that could merge are subpasses of one
+    const std::vector<physical_pass_t>& GetPhysicalPasses() const noexcept;
+    // Barriers to record around each submission, in the order of GetSubmissionGraph().Order(). Barriers for later
+    // subpasses of a physical pass are recorded with its first one, before the pass begins.
+    const std::vector<submission_barriers_t>& GetSubmissionBarriers() const noexcept;
+    // VkEvents the submission barriers need, all reset before recording a frame
+    size_t NumBarrierEvents() const noexcept;
 
     const vpr::Device* GetDevice() const noexcept;
 
@@ -64,19 +76,6 @@ private:
     void addSingleGroup(const std::string& name, const st::Shader* group);
     void addSubmissionsFromPack(const st::ShaderPack* pack);
 
-    struct pipeline_barrier_t {
-        size_t Resource;
-        VkImageLayout Layout{ VK_IMAGE_LAYOUT_UNDEFINED };
-        VkAccessFlags AccessFlags{ VK_ACCESS_FLAG_BITS_MAX_ENUM };
-        VkPipelineStageFlags Stages{ VK_PIPELINE_STAGE_FLAG_BITS_MAX_ENUM };
-        bool History{ false };
-    };
-
-    struct pass_barriers_t {
-        std::vector<pipeline_barrier_t> InvalidateBarriers;
-        std::vector<pipeline_barrier_t> FlushBarriers;
-    };
-
     struct color_clear_request_t {
         PipelineSubmission* Submission;
         VkClearColorValue* Target;
@@ -99,7 +98,8 @@ private:
 
     std::string graphName;
     std::string backbufferSource{ "backbuffer" };
-    std::unordered_map<std::string, pass_barriers_t> passBarriers;
+    // Indexed by submission
+    std::vector<pass_barriers_t> passBarriers;
     std::unordered_map<std::string, size_t> submissionNameMap;
     std::vector<SubmissionPtr> submissions;
     std::unordered_map<std::string, size_t> resourceNameMap;
@@ -110,9 +110,10 @@ private:
     std::unique_ptr<vpsk::ImageResourceCache> imageResources;
     const vpr::Device* device;
 
-    std::vector<std::unordered_set<size_t>> submissionDependencies;
-    std::vector<std::unordered_set<size_t>> submissionMergeDependencies;
-    std::vector<size_t> submissionStack;
+    SubmissionGraph submissionGraph;
+    std::vector<physical_pass_t> physicalPasses;
+    std::vector<submission_barriers_t> submissionBarriers;
+    size_t numBarrierEvents{ 0 };
 };
 
 #endif // !VPSK_RENDERGRAPH_HPP
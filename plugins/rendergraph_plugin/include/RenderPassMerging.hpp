@@ -0,0 +1,71 @@
+#pragma once
+#ifndef VPSK_RENDER_PASS_MERGING_HPP
+#define VPSK_RENDER_PASS_MERGING_HPP
+#include "PipelineResource.hpp"
+#include "SubmissionBarriers.hpp"
+#include <limits>
+#include <vector>
+
+class SubmissionGraph;
+
+/*
+    Groups consecutive submissions of a baked RenderGraph into physical passes: one VkRenderPass, with a subpass
+    per submission. A submission joins the physical pass before it when both draw to the same render area with the
+    same sample count, it doesn't sample or load anything rendered earlier in the pass except through attachments
+    (at the same pixel), any depth attachment is shared, and it reads attachments the pass renders or renders to the
+    same ones. Attachments then stay in tile memory between subpasses: only those used after the pass, or in the
+    next frame, are stored, and only those rendered before it are loaded.
+
+    Dependencies between subpasses become VkSubpassDependencies, by region when both sides only touch the resource
+    as an attachment. Barriers the later subpasses need on work before the pass are recorded before the pass
+    begins instead (see SynthesizeBarriers). Submissions that don't draw get a physical pass with no subpasses.
+*/
+
+// What a submission draws to, as resource indices
+struct submission_attachments_t {
+    constexpr static size_t NoAttachment = std::numeric_limits<size_t>::max();
+    // False for submissions that don't need a render pass, e.g. compute
+    bool RenderPass{ false };
+    // Only the size and sample count are used: submissions with different render areas can't merge
+    image_info_t RenderArea;
+    std::vector<size_t> ColorOutputs;
+    // Clear the matching color output instead of loading or discarding it, if it is first used in this subpass
+    std::vector<bool> ClearColorOutputs;
+    // Empty, or one per color output
+    std::vector<size_t> ResolveOutputs;
+    std::vector<size_t> InputAttachments;
+    size_t DepthStencil{ NoAttachment };
+    bool ClearDepthStencil{ false };
+};
+
+struct subpass_attachments_t {
+    std::vector<VkAttachmentReference> ColorAttachments;
+    std::vector<VkAttachmentReference> ResolveAttachments;
+    std::vector<VkAttachmentReference> InputAttachments;
+    VkAttachmentReference DepthStencilAttachment{ VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED };
+    std::vector<uint32_t> PreserveAttachments;
+};
+
+struct physical_pass_t {
+    // One subpass each, in order
+    std::vector<size_t> Submissions;
+    // Resource of each attachment description
+    std::vector<size_t> Attachments;
+    std::vector<VkAttachmentDescription> AttachmentDescriptions;
+    std::vector<subpass_attachments_t> Subpasses;
+    std::vector<VkSubpassDependency> Dependencies;
+    bool RenderPass() const noexcept;
+    // Fills subpasses, which the result points into along with this pass: both need to outlive it
+    VkRenderPassCreateInfo RenderPassCreateInfo(std::vector<VkSubpassDescription>& subpasses) const;
+};
+
+/*
+    Merges the submissions of graph's baked order. attachments and pass_barriers are indexed by submission,
+    resource_formats and persistent_resources (resources that are always stored, like the backbuffer) by resource.
+*/
+std::vector<physical_pass_t> MergePhysicalPasses(const SubmissionGraph& graph, const std::vector<submission_attachments_t>& attachments,
+    const std::vector<pass_barriers_t>& pass_barriers, const std::vector<VkFormat>& resource_formats, const std::vector<bool>& persistent_resources);
+// Position in the baked order of the first submission of each submission's physical pass, indexed by position
+std::vector<size_t> PhysicalPassBegins(const std::vector<physical_pass_t>& passes);
+
+#endif //!VPSK_RENDER_PASS_MERGING_HPP
@@ -2,6 +2,8 @@
 #ifndef VPSK_SHADER_RESOURCE_PACK_HPP
 #define VPSK_SHADER_RESOURCE_PACK_HPP
 #include "ForwardDecl.hpp"
+#include "systems/NameInterner.hpp"
+#include <limits>
 #include <unordered_map>
 #include <vector>
 #include <memory>
@@ -29,6 +31,16 @@ namespace vpsk {
         ShaderResourcePack& operator=(ShaderResourcePack&& other) noexcept;
         ~ShaderResourcePack();
 
+        constexpr static size_t InvalidGroupIndex = std::numeric_limits<size_t>::max();
+
+        // Resolve names to indices/IDs once (e.g. when setting up a pass), then use the index overloads per-frame
+        size_t GroupIndex(const char* rsrc_group_name) const noexcept;
+        vpr::DescriptorSet* DescriptorSet(const size_t rsrc_group_idx) noexcept;
+        const vpr::DescriptorSet* DescriptorSet(const size_t rsrc_group_idx) const noexcept;
+        // IDs of a group's resources in the rendergraph's resource caches, in the order the group declares them
+        const std::vector<resource_cache_id_t>& GroupResourceIDs(const size_t rsrc_group_idx) const;
+
+        // Slow path wrappers: these hash the group name on every call
         vpr::DescriptorSet* DescriptorSet(const char* rsrc_group_name) noexcept;
         const vpr::DescriptorSet* DescriptorSet(const char* rsrc_group_name) const noexcept;
         vpr::DescriptorPool* DescriptorPool() noexcept;
@@ -37,9 +49,9 @@ namespace vpsk {
 
     private:
 
-        void createResources(const std::vector<const st::ShaderResource*>& resources);
+        void createResources(const size_t group_idx, const std::vector<const st::ShaderResource*>& resources);
         void createDescriptorPool();
-        void createSingleSet(const std::string& name);
+        void createSingleSet(const size_t group_idx);
         void createSets();
 
         void getGroupNames();
@@ -47,6 +59,9 @@ namespace vpsk {
         RenderGraph& graph;
         std::unique_ptr<vpr::DescriptorPool> descriptorPool;
         std::unordered_map<std::string, size_t> rsrcGroupToIdxMap;
+        // Indexed by resource group index
+        std::vector<std::string> rsrcGroupNames;
+        std::vector<std::vector<resource_cache_id_t>> rsrcGroupResourceIDs;
         std::unordered_map<std::string, std::set<size_t>> shaderGroupSetIndices;
         std::vector<std::unique_ptr<vpr::DescriptorSet>> descriptorSets;
         std::vector<std::unique_ptr<vpr::DescriptorSetLayout>> setLayouts;
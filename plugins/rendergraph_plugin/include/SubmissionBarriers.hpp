@@ -0,0 +1,99 @@
+#pragma once
+#ifndef VPSK_SUBMISSION_BARRIERS_HPP
+#define VPSK_SUBMISSION_BARRIERS_HPP
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <vector>
+
+/*
+    Synchronization between the submissions of a baked RenderGraph. Each submission lists how it uses each resource
+    it touches, in pass_barriers_t: everything it reads or writes has to be invalidated (made visible, in the right
+    layout) before it runs, and everything it writes has to be flushed afterwards. SynthesizeBarriers walks those
+    in submission order, tracking the state each resource was left in, and only emits what the state requires:
+    - Read after write: a memory dependency, unless an earlier barrier already made the write visible to the
+      same access and stages
+    - Write after read: an execution dependency on the stages that read, without any memory barrier
+    - Layout transitions, which count as writes for both of the above
+    Reads after reads, in the same layout, need nothing. Everything needed before a submission is merged into one
+    vkCmdPipelineBarrier call. When the writer a submission waits on isn't the submission right before it, the
+    wait is split: the writer sets an event, and the waiter waits on it, so the submissions in between can overlap.
+
+    Resources no submission writes (e.g. textures from disk) are assumed to already be in the layout they are read
+    in, and get no barriers. Resources read before they are written in a frame (history) start the frame in the
+    state the last frame left them in: on the very first frame, treat those transitions as coming from
+    VK_IMAGE_LAYOUT_UNDEFINED.
+*/
+
+struct pipeline_barrier_t {
+    size_t Resource;
+    VkImageLayout Layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+    VkAccessFlags AccessFlags{ VK_ACCESS_FLAG_BITS_MAX_ENUM };
+    VkPipelineStageFlags Stages{ VK_PIPELINE_STAGE_FLAG_BITS_MAX_ENUM };
+    bool History{ false };
+};
+
+struct pass_barriers_t {
+    std::vector<pipeline_barrier_t> InvalidateBarriers;
+    std::vector<pipeline_barrier_t> FlushBarriers;
+};
+
+// Adds one use of a resource to a submission's barriers, merging it with other uses of the same resource: writes
+// are both invalidated and flushed. Uses of one image in different layouts are merged into VK_IMAGE_LAYOUT_GENERAL.
+void AddResourceAccess(pass_barriers_t& barriers, const pipeline_barrier_t& access, const bool write);
+
+// One VkImageMemoryBarrier or VkBufferMemoryBarrier
+struct resource_barrier_t {
+    size_t Resource;
+    bool Image{ false };
+    VkImageLayout OldLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+    VkImageLayout NewLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+    VkAccessFlags SrcAccess{ 0 };
+    VkAccessFlags DstAccess{ 0 };
+};
+
+// One vkCmdPipelineBarrier or vkCmdWaitEvents call. Execution-only dependencies have stages but no Barriers.
+struct barrier_batch_t {
+    VkPipelineStageFlags SrcStages{ 0 };
+    VkPipelineStageFlags DstStages{ 0 };
+    std::vector<resource_barrier_t> Barriers;
+    bool Empty() const noexcept;
+};
+
+struct submission_barriers_t {
+    constexpr static size_t NoEvent = std::numeric_limits<size_t>::max();
+    size_t Submission;
+    // Recorded before the submission
+    barrier_batch_t Barrier;
+    // Recorded before the submission, waiting on WaitEvents
+    barrier_batch_t EventWait;
+    std::vector<size_t> WaitEvents;
+    // Set after the submission, unless NoEvent
+    size_t SignalEvent{ NoEvent };
+    VkPipelineStageFlags SignalStages{ 0 };
+};
+
+/*
+    pass_barriers is indexed by submission, image_resources by resource. Returns the barriers of each submission in
+    order, in the same order. Events are numbered from 0 to num_events: they all need resetting before the frame.
+
+    pass_begins, if not empty, gives the position of the first subpass of each position's render pass (see
+    PhysicalPassBegins). Barriers between subpasses of one render pass are left to its subpass dependencies, and
+    later subpasses' barriers on earlier work are returned with the first subpass, to be recorded before the pass.
+*/
+std::vector<submission_barriers_t> SynthesizeBarriers(const std::vector<pass_barriers_t>& pass_barriers, const std::vector<size_t>& order,
+    const std::vector<bool>& image_resources, size_t& num_events, const std::vector<size_t>& pass_begins = {});
+
+struct barrier_image_t {
+    VkImage Image{ VK_NULL_HANDLE };
+    VkImageSubresourceRange SubresourceRange{};
+};
+
+// Records the barriers before a submission: callers provide the handles resource indices map to.
+void RecordSubmissionBarriers(VkCommandBuffer cmd, const submission_barriers_t& barriers, const VkEvent* events,
+    const std::function<barrier_image_t(size_t)>& get_image, const std::function<VkBuffer(size_t)>& get_buffer);
+// Sets the submission's event, if any, after it has been recorded.
+void RecordSubmissionSignal(VkCommandBuffer cmd, const submission_barriers_t& barriers, const VkEvent* events);
+
+#endif //!VPSK_SUBMISSION_BARRIERS_HPP
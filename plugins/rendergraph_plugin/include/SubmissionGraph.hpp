@@ -0,0 +1,67 @@
+#pragma once
+#ifndef VPSK_SUBMISSION_GRAPH_HPP
+#define VPSK_SUBMISSION_GRAPH_HPP
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+    Dependencies between the submissions of a RenderGraph, as one bit per (submission, dependency) pair: a graph
+    with hundreds of submissions fits in a few kilobytes, and knows nothing about devices or resources, so baking
+    can be tested on its own. RenderGraph::Bake fills it from the resources each submission reads and writes.
+
+    Bake() drops every submission the roots (the submissions writing the backbuffer) don't depend on, then orders
+    the rest. Of the submissions whose dependencies have all been scheduled, the next one is:
+    - One with a merge dependency on the submission just scheduled, as those can become subpasses of one render pass
+    - Otherwise the one whose latest dependency was scheduled furthest back, so producers end up as far from their
+      consumers as possible, giving the GPU independent work to overlap with each wait
+    Remaining ties go to the lowest submission index, so the same graph always bakes to the same order.
+*/
+
+class SubmissionGraph {
+public:
+
+    SubmissionGraph() = default;
+    SubmissionGraph(const size_t num_submissions);
+
+    // Clears all dependencies, and the results of the last bake
+    void Reset(const size_t num_submissions);
+    // Submission has to run after dependency. Merge dependencies are reads of attachments the dependency rendered
+    // to, at the same pixel. Dependencies of a submission on itself are ignored.
+    void AddDependency(const size_t submission, const size_t dependency, const bool merge = false);
+    // Throws std::logic_error if the submissions the roots depend on form a cycle
+    void Bake(const std::vector<size_t>& roots);
+
+    size_t NumSubmissions() const noexcept;
+    // Direct dependencies only
+    bool DependsOn(const size_t submission, const size_t dependency) const noexcept;
+    bool MergeDependsOn(const size_t submission, const size_t dependency) const noexcept;
+    // False for submissions pruned by the last bake
+    bool IsReachable(const size_t submission) const noexcept;
+    // Reachable submissions, in the order they should be recorded and submitted
+    const std::vector<size_t>& Order() const noexcept;
+    // Length of the longest chain of dependencies before a submission. Submissions on the same level don't
+    // depend on each other, so their commands can be recorded in parallel.
+    size_t Level(const size_t submission) const noexcept;
+    size_t NumLevels() const noexcept;
+
+private:
+
+    const uint64_t* row(const std::vector<uint64_t>& bits, const size_t submission) const noexcept;
+    void setBit(std::vector<uint64_t>& bits, const size_t submission, const size_t dependency) noexcept;
+    bool testBit(const std::vector<uint64_t>& bits, const size_t submission, const size_t dependency) const noexcept;
+    void pruneUnreachable(const std::vector<size_t>& roots);
+    void scheduleReachable();
+
+    size_t numSubmissions{ 0 };
+    size_t wordsPerRow{ 0 };
+    // numSubmissions rows of wordsPerRow words: bit j of row i is set if submission i depends on submission j
+    std::vector<uint64_t> dependencies;
+    std::vector<uint64_t> mergeDependencies;
+    std::vector<uint64_t> reachable;
+    std::vector<size_t> order;
+    std::vector<size_t> levels;
+    size_t numLevels{ 0 };
+};
+
+#endif //!VPSK_SUBMISSION_GRAPH_HPP
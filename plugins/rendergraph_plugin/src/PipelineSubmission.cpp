@@ -1,6 +1,10 @@
 #include "PipelineSubmission.hpp"
 #include "RenderGraph.hpp"
+#include "SubmissionGraph.hpp"
+#include "SubmissionBarriers.hpp"
+#include "RenderPassMerging.hpp"
 #include "easylogging++.h"
+#include <algorithm>
 
 PipelineSubmission::PipelineSubmission(RenderGraph& rgraph, std::string _name, size_t _idx, VkPipelineStageFlags _stages) 
     : graph(rgraph), name(std::move(_name)), idx(std::move(_idx)), stages(std::move(_stages)) {}
@@ -396,97 +400,168 @@ void PipelineSubmission::MakeColorInputScaled(const size_t & idx) {
     std::swap(colorInputs[idx], colorScaleInputs[idx]);
 }
 
-void PipelineSubmission::traverseDependencies(size_t& stack_count) {
+void PipelineSubmission::addDependencies(SubmissionGraph& dependencies) const {
     if (depthStencilInput != nullptr) {
-        dependencyTraversalRecursion(depthStencilInput->SubmissionsWrittenIn(), stack_count, IgnoreSelf);
+        addDependenciesOn(depthStencilInput->SubmissionsWrittenIn(), dependencies, 0);
     }
 
     for (auto* input : attachmentInputs) {
-        bool depends_on_self = (depthStencilOutput != nullptr ? depthStencilInput == input : false);
-        if (std::find(std::begin(colorOutputs), std::end(colorOutputs), input) != std::end(colorOutputs)) {
-            depends_on_self = true;
-        }
-        if (!depends_on_self) {
-            dependencyTraversalRecursion(input->SubmissionsWrittenIn(), stack_count, MergeDependency);
-        }
+        addDependenciesOn(input->SubmissionsWrittenIn(), dependencies, MergeDependency);
     }
 
     for (auto* color_input : colorInputs) {
         if (color_input != nullptr) {
-            dependencyTraversalRecursion(color_input->SubmissionsWrittenIn(), stack_count, MergeDependency);
+            addDependenciesOn(color_input->SubmissionsWrittenIn(), dependencies, MergeDependency);
         }
     }
 
-    /*for (auto* texture_input : textureInputs) {
-        dependencyTraversalRecursion(texture_input->SubmissionsWrittenIn(), stack_count, 0);
-    }*/
+    for (auto* texture_input : textureInputs) {
+        // Textures loaded from disk are never written by a submission
+        addDependenciesOn(texture_input->SubmissionsWrittenIn(), dependencies, NoCheck);
+    }
 
-    for (auto* storage_input : storageInputs) {
-        if (storage_input != nullptr) {
-            // might be no writers of this, if it's used in a feedback fashion (meaning what?)
-            dependencyTraversalRecursion(storage_input->SubmissionsWrittenIn(), stack_count, NoCheck);
-            // check for write-after-read hazards, finding if this object is read in other submissions before this one writes to it
-            dependencyTraversalRecursion(storage_input->SubmissionsReadIn(), stack_count, NoCheck | IgnoreSelf);
+    auto add_storage_dependencies = [&](const PipelineResource* storage_input) {
+        if (storage_input == nullptr) {
+            return;
+        }
+        // might be no writers of this, if it's used in a feedback fashion
+        if (storage_input->SubmissionsWrittenIn().count(idx) != 0) {
+            // write-after-read and write-after-write hazards: the order submissions were added in decides who goes first
+            addDependenciesOn(storage_input->SubmissionsWrittenIn(), dependencies, NoCheck | InPlace);
+            addDependenciesOn(storage_input->SubmissionsReadIn(), dependencies, NoCheck | InPlace);
+        }
+        else {
+            addDependenciesOn(storage_input->SubmissionsWrittenIn(), dependencies, NoCheck | PrecedingWriters);
         }
+    };
+
+    for (auto* storage_input : storageInputs) {
+        add_storage_dependencies(storage_input);
+    }
+
+    for (auto* storage_input : storageTextureInputs) {
+        add_storage_dependencies(storage_input);
     }
 
     for (auto* uniform_input : uniformInputs) {
         if (uniform_input != nullptr) {
-            dependencyTraversalRecursion(uniform_input->SubmissionsWrittenIn(), stack_count, NoCheck);
+            addDependenciesOn(uniform_input->SubmissionsWrittenIn(), dependencies, NoCheck);
         }
     }
 
     for (auto* storage_input : storageReadOnlyInputs) {
         if (storage_input != nullptr) {
-            dependencyTraversalRecursion(storage_input->SubmissionsWrittenIn(), stack_count, NoCheck);
+            addDependenciesOn(storage_input->SubmissionsWrittenIn(), dependencies, NoCheck | PrecedingWriters);
         }
     }
 }
 
-void PipelineSubmission::dependencyTraversalRecursion(const std::unordered_set<size_t>& submissions, size_t& stack_count, const uint32_t& flags) {
-    auto no_check = [&]() { return flags & NoCheck; };
-    auto merge_dependency = [&]() { return flags & MergeDependency; };
-    auto ignore_self = [&]() { return flags & IgnoreSelf; };
-
-    if (!no_check() && submissions.empty()) {
-        LOG(ERROR) << "Requested checking of a resource during dependency traversal, but current resource is not written to in any passes!";
+void PipelineSubmission::addDependenciesOn(const std::unordered_set<size_t>& submissions, SubmissionGraph& dependencies, const uint32_t flags) const {
+    if (!(flags & NoCheck) && submissions.empty()) {
+        LOG(ERROR) << "Submission " << name << " reads a resource that is not written to in any passes!";
         throw std::logic_error("Resource is not written to by any passes.");
     }
 
-    if (stack_count > graph.NumSubmissions()) {
-        LOG(ERROR) << "Stuck in dependency traversal recursion loop.";
-        throw std::runtime_error("Stuck in a recursive loop.");
+    const bool preceding_only = (flags & InPlace) ||
+        ((flags & PrecedingWriters) && std::any_of(submissions.cbegin(), submissions.cend(), [this](const size_t submission) { return submission < idx; }));
+    for (const size_t submission : submissions) {
+        if (preceding_only && (submission >= idx)) {
+            continue;
+        }
+        dependencies.AddDependency(idx, submission, (flags & MergeDependency) != 0);
     }
+}
 
-    for (auto& submission : submissions) {
-        if (submission != idx) {
-            graph.submissionDependencies[idx].insert(submission);
+void PipelineSubmission::addResourceAccesses(pass_barriers_t& barriers) const {
+    constexpr VkPipelineStageFlags depth_stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+    auto add_access = [&](const PipelineResource* resource, const VkImageLayout layout, const VkAccessFlags access, const VkPipelineStageFlags access_stages, const bool write) {
+        if (resource != nullptr) {
+            AddResourceAccess(barriers, pipeline_barrier_t{ resource->GetIdx(), layout, access, access_stages, false }, write);
         }
+    };
+
+    // Stages of this submission the resource was bound to
+    auto shader_stages = [&](const PipelineResource* resource) {
+        const VkPipelineStageFlags used_stages = resource->PipelineStages(idx);
+        return used_stages != VK_PIPELINE_STAGE_FLAG_BITS_MAX_ENUM ? used_stages : stages;
+    };
+
+    for (auto* output : colorOutputs) {
+        add_access(output, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, true);
+    }
+    for (auto* input : colorInputs) {
+        // Loaded into the matching color output
+        add_access(input, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, false);
+    }
+    for (auto* output : resolveOutputs) {
+        add_access(output, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, true);
     }
 
-    if (merge_dependency()) {
-        for (auto& submission : submissions) {
-            if (submission != idx) {
-                graph.submissionMergeDependencies[idx].insert(submission);
-            }
-        }
+    if (depthStencilOutput != nullptr) {
+        add_access(depthStencilOutput, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, depth_stages, true);
+        add_access(depthStencilInput, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, depth_stages, false);
+    }
+    else {
+        add_access(depthStencilInput, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, depth_stages, false);
     }
 
-    ++stack_count;
+    for (auto* input : attachmentInputs) {
+        add_access(input, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, false);
+    }
+    for (auto* input : historyInputs) {
+        AddResourceAccess(barriers, pipeline_barrier_t{ input->GetIdx(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, shader_stages(input), true }, false);
+    }
+    for (auto* input : textureInputs) {
+        add_access(input, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, shader_stages(input), false);
+    }
+    for (auto* input : storageTextureInputs) {
+        add_access(input, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, input ? shader_stages(input) : 0, false);
+    }
+    for (auto* output : storageTextureOutputs) {
+        add_access(output, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, output ? shader_stages(output) : 0, true);
+    }
+    for (auto* input : storageInputs) {
+        add_access(input, VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_SHADER_READ_BIT, input ? shader_stages(input) : 0, false);
+    }
+    for (auto* output : storageOutputs) {
+        add_access(output, VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_SHADER_WRITE_BIT, output ? shader_stages(output) : 0, true);
+    }
+    for (auto* input : uniformInputs) {
+        add_access(input, VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_UNIFORM_READ_BIT, input ? shader_stages(input) : 0, false);
+    }
+    for (auto* input : storageReadOnlyInputs) {
+        add_access(input, VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_SHADER_READ_BIT, input ? shader_stages(input) : 0, false);
+    }
+}
 
-    for (auto& pushed_submission : submissions) {
-        if (ignore_self() && (pushed_submission == idx)) {
-            continue;
-        }
-        else if (pushed_submission == idx) {
-            LOG(ERROR) << "Found a submission resource with a cyclic dependency on itself during dependency traversal recursion step.";
-            throw std::logic_error("Submission resource has a self-dependency loop.");
-        }
+void PipelineSubmission::addRenderPassAttachments(submission_attachments_t& attachments) {
+    const PipelineResource* depth_stencil = depthStencilOutput != nullptr ? depthStencilOutput : depthStencilInput;
+    attachments.RenderPass = NeedRenderPass() && (!colorOutputs.empty() || (depth_stencil != nullptr));
+    if (!attachments.RenderPass) {
+        return;
+    }
 
-        graph.submissionStack.push_back(pushed_submission);
-        graph.pipelineSubmissions[pushed_submission]->traverseDependencies(stack_count);
+    // Attachments all have to match in size, so any of them gives the render area
+    const PipelineResource* render_area = !colorOutputs.empty() ? colorOutputs.front() : depth_stencil;
+    if (render_area->IsImage()) {
+        attachments.RenderArea = render_area->GetImageInfo();
     }
 
+    for (size_t i = 0; i < colorOutputs.size(); ++i) {
+        attachments.ColorOutputs.emplace_back(colorOutputs[i]->GetIdx());
+        attachments.ClearColorOutputs.emplace_back(GetClearColor(i));
+    }
+    for (auto* output : resolveOutputs) {
+        attachments.ResolveOutputs.emplace_back(output->GetIdx());
+    }
+    for (auto* input : attachmentInputs) {
+        attachments.InputAttachments.emplace_back(input->GetIdx());
+    }
+    if (depth_stencil != nullptr) {
+        attachments.DepthStencil = depth_stencil->GetIdx();
+        attachments.ClearDepthStencil = (depthStencilOutput != nullptr) && GetClearDepth();
+    }
 }
 
 void PipelineSubmission::RecordCommands(VkCommandBuffer cmd) {
@@ -568,6 +643,24 @@ TEST_SUITE("PipelineSubmission") {
         auto texture_inputs = submission.GetTextureInputs();
         CHECK(std::any_of(texture_inputs.cbegin(), texture_inputs.cend(), [texture](const PipelineResource* rsrc) { return *rsrc == texture; }));
     }
+    TEST_CASE("ReadsBetweenInPlaceWrites") {
+        using namespace vpsk;
+        auto& graph = RenderGraph::GetGlobalGraph();
+        buffer_info_t buffer_info{ 1024, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT };
+        auto& first_update = graph.AddPipelineSubmission("TestFirstParticleUpdate", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        first_update.AddStorageRW("TestParticles", buffer_info);
+        auto& read = graph.AddPipelineSubmission("TestParticleRead", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        read.AddStorageReadOnlyInput("TestParticles");
+        auto& second_update = graph.AddPipelineSubmission("TestSecondParticleUpdate", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        second_update.AddStorageRW("TestParticles", buffer_info);
+        graph.SetBackbufferSource("TestParticles");
+        // The read sees the first update, and the second update waits for the read: no cycle
+        REQUIRE_NOTHROW(graph.Bake());
+        const SubmissionGraph& dependencies = graph.GetSubmissionGraph();
+        CHECK(dependencies.DependsOn(read.GetIdx(), first_update.GetIdx()));
+        CHECK_FALSE(dependencies.DependsOn(read.GetIdx(), second_update.GetIdx()));
+        CHECK(dependencies.DependsOn(second_update.GetIdx(), read.GetIdx()));
+    }
     TEST_CASE("StorageTextureOutputNoInput") {
         using namespace vpsk;
         PipelineSubmission submission(RenderGraph::GetGlobalGraph(), "TestStorageOutput", 0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
@@ -12,6 +12,7 @@
 #include "render/Swapchain.hpp"
 #include "RenderingContext.hpp"
 #include "easylogging++.h"
+#include <algorithm>
 #include <set>
 namespace vpsk {
 
@@ -175,8 +176,10 @@ namespace vpsk {
     }
 
     void RenderGraph::Bake() {
-        for (const auto& submission : pipelineSubmissions) {
-            submission->ValidateSubmission();
+        for (auto& submission : submissions) {
+            if (auto* pipeline_submission = std::get_if<std::unique_ptr<PipelineSubmission>>(&submission)) {
+                (*pipeline_submission)->ValidateSubmission();
+            }
         }
 
         auto backbuffer_iter = resourceNameMap.find(backbufferSource);
@@ -184,11 +187,6 @@ namespace vpsk {
             throw std::logic_error("No backbuffer source set for Rendegraph!");
         }
 
-        submissionDependencies.clear(); submissionDependencies.shrink_to_fit();
-        submissionDependencies.resize(pipelineSubmissions.size());
-        submissionMergeDependencies.clear(); submissionMergeDependencies.shrink_to_fit();
-        submissionMergeDependencies.resize(pipelineSubmissions.size());
-
         auto& backbuffer_resource = *pipelineResources[backbuffer_iter->second];
 
         if (backbuffer_resource.SubmissionsWrittenIn().empty()) {
@@ -196,18 +194,55 @@ namespace vpsk {
             throw std::logic_error("No writes occurred to the backbuffer!");
         }
 
-        for (auto& submission : backbuffer_resource.SubmissionsWrittenIn()) {
-            submissionStack.push_back(submission);
+        submissionGraph.Reset(submissions.size());
+        for (auto& submission : submissions) {
+            if (auto* pipeline_submission = std::get_if<std::unique_ptr<PipelineSubmission>>(&submission)) {
+                (*pipeline_submission)->addDependencies(submissionGraph);
+            }
         }
 
-        std::vector<size_t> temp_submission_stack = submissionStack;
-        for (auto& pushed_submission : submissionStack) {
-            size_t stack_count = 0;
-            pipelineSubmissions[pushed_submission]->traverseDependencies(stack_count);
+        // Sorted, so the baked order doesn't depend on hash set iteration order
+        std::vector<size_t> backbuffer_writers(backbuffer_resource.SubmissionsWrittenIn().cbegin(), backbuffer_resource.SubmissionsWrittenIn().cend());
+        std::sort(backbuffer_writers.begin(), backbuffer_writers.end());
+        submissionGraph.Bake(backbuffer_writers);
+
+        passBarriers.assign(submissions.size(), pass_barriers_t{});
+        for (size_t i = 0; i < submissions.size(); ++i) {
+            auto* pipeline_submission = std::get_if<std::unique_ptr<PipelineSubmission>>(&submissions[i]);
+            if (pipeline_submission && submissionGraph.IsReachable(i)) {
+                (*pipeline_submission)->addResourceAccesses(passBarriers[i]);
+            }
+        }
+
+        std::vector<submission_attachments_t> submission_attachments(submissions.size());
+        for (size_t i = 0; i < submissions.size(); ++i) {
+            auto* pipeline_submission = std::get_if<std::unique_ptr<PipelineSubmission>>(&submissions[i]);
+            if (pipeline_submission && submissionGraph.IsReachable(i)) {
+                (*pipeline_submission)->addRenderPassAttachments(submission_attachments[i]);
+            }
+        }
+
+        std::vector<bool> image_resources(pipelineResources.size());
+        std::vector<VkFormat> resource_formats(pipelineResources.size(), VK_FORMAT_UNDEFINED);
+        std::vector<bool> persistent_resources(pipelineResources.size(), false);
+        for (size_t i = 0; i < pipelineResources.size(); ++i) {
+            image_resources[i] = pipelineResources[i]->IsImage();
+            if (image_resources[i]) {
+                resource_formats[i] = pipelineResources[i]->GetImageInfo().Format;
+            }
         }
+        persistent_resources[backbuffer_iter->second] = true;
 
-        std::reverse(std::begin(submissionStack), std::end(submissionStack));
+        physicalPasses = MergePhysicalPasses(submissionGraph, submission_attachments, passBarriers, resource_formats, persistent_resources);
+        for (size_t i = 0; i < physicalPasses.size(); ++i) {
+            for (const size_t submission : physicalPasses[i].Submissions) {
+                if (auto* pipeline_submission = std::get_if<std::unique_ptr<PipelineSubmission>>(&submissions[submission])) {
+                    (*pipeline_submission)->SetPhysicalPassIdx(i);
+                }
+            }
+        }
 
+        submissionBarriers = SynthesizeBarriers(passBarriers, submissionGraph.Order(), image_resources, numBarrierEvents, PhysicalPassBegins(physicalPasses));
     }
 
     void RenderGraph::SetBackbufferSource(const std::string & name) {
@@ -224,6 +259,22 @@ namespace vpsk {
         return submissions.size();
     }
 
+    const SubmissionGraph& RenderGraph::GetSubmissionGraph() const noexcept {
+        return submissionGraph;
+    }
+
+    const std::vector<physical_pass_t>& RenderGraph::GetPhysicalPasses() const noexcept {
+        return physicalPasses;
+    }
+
+    const std::vector<submission_barriers_t>& RenderGraph::GetSubmissionBarriers() const noexcept {
+        return submissionBarriers;
+    }
+
+    size_t RenderGraph::NumBarrierEvents() const noexcept {
+        return numBarrierEvents;
+    }
+
     const vpr::Device* RenderGraph::GetDevice() const noexcept {
         return device;
     }
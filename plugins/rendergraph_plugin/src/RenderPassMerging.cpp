@@ -0,0 +1,559 @@
+#include "RenderPassMerging.hpp"
+#include "SubmissionGraph.hpp"
+#include "doctest/doctest.h"
+#include <algorithm>
+
+namespace {
+
+    constexpr size_t invalid_position = std::numeric_limits<size_t>::max();
+
+    const pipeline_barrier_t* find_access(const std::vector<pipeline_barrier_t>& barriers, const size_t resource) noexcept {
+        auto iter = std::find_if(barriers.cbegin(), barriers.cend(), [resource](const pipeline_barrier_t& barrier) { return barrier.Resource == resource; });
+        return iter != barriers.cend() ? &(*iter) : nullptr;
+    }
+
+    bool same_render_area(const image_info_t& a, const image_info_t& b) noexcept {
+        return (a.SizeClass == b.SizeClass) && (a.SizeX == b.SizeX) && (a.SizeY == b.SizeY) && (a.SizeRelativeName == b.SizeRelativeName) &&
+            (a.ArrayLayers == b.ArrayLayers) && (a.Samples == b.Samples);
+    }
+
+    template<typename Fn>
+    void for_each_attachment(const submission_attachments_t& attachments, Fn&& fn) {
+        for (const size_t resource : attachments.ColorOutputs) {
+            fn(resource);
+        }
+        for (const size_t resource : attachments.ResolveOutputs) {
+            fn(resource);
+        }
+        for (const size_t resource : attachments.InputAttachments) {
+            fn(resource);
+        }
+        if (attachments.DepthStencil != submission_attachments_t::NoAttachment) {
+            fn(attachments.DepthStencil);
+        }
+    }
+
+    bool uses_as_attachment(const submission_attachments_t& attachments, const size_t resource) {
+        bool result = false;
+        for_each_attachment(attachments, [&result, resource](const size_t attachment) { result |= (attachment == resource); });
+        return result;
+    }
+
+    bool clears(const submission_attachments_t& attachments, const size_t resource) noexcept {
+        for (size_t i = 0; i < attachments.ColorOutputs.size(); ++i) {
+            if (attachments.ColorOutputs[i] == resource) {
+                return (i < attachments.ClearColorOutputs.size()) && attachments.ClearColorOutputs[i];
+            }
+        }
+        return (attachments.DepthStencil == resource) && attachments.ClearDepthStencil;
+    }
+
+    bool has_stencil(const VkFormat format) noexcept {
+        return (format == VK_FORMAT_D16_UNORM_S8_UINT) || (format == VK_FORMAT_D24_UNORM_S8_UINT) || (format == VK_FORMAT_D32_SFLOAT_S8_UINT) ||
+            (format == VK_FORMAT_S8_UINT);
+    }
+
+    // Where each resource is first written and last used in the baked order, and whether it is read before it is written
+    struct resource_uses_t {
+        std::vector<size_t> FirstWrite;
+        std::vector<size_t> LastAccess;
+        std::vector<bool> ReadFirst;
+    };
+
+    resource_uses_t find_resource_uses(const std::vector<size_t>& order, const std::vector<pass_barriers_t>& pass_barriers, const size_t num_resources) {
+        resource_uses_t result{
+            std::vector<size_t>(num_resources, invalid_position),
+            std::vector<size_t>(num_resources, invalid_position),
+            std::vector<bool>(num_resources, false)
+        };
+        for (size_t position = 0; position < order.size(); ++position) {
+            const pass_barriers_t& barriers = pass_barriers[order[position]];
+            for (const pipeline_barrier_t& invalidate : barriers.InvalidateBarriers) {
+                if (result.LastAccess[invalidate.Resource] == invalid_position) {
+                    result.ReadFirst[invalidate.Resource] = invalidate.History || (find_access(barriers.FlushBarriers, invalidate.Resource) == nullptr);
+                }
+                result.LastAccess[invalidate.Resource] = position;
+            }
+            for (const pipeline_barrier_t& flush : barriers.FlushBarriers) {
+                if (result.FirstWrite[flush.Resource] == invalid_position) {
+                    result.FirstWrite[flush.Resource] = position;
+                }
+            }
+        }
+        return result;
+    }
+
+    class physical_pass_builder_t {
+    public:
+        physical_pass_builder_t(const SubmissionGraph& _graph, const std::vector<submission_attachments_t>& _attachments, const std::vector<pass_barriers_t>& _pass_barriers) :
+            graph(_graph), attachments(_attachments), passBarriers(_pass_barriers) {}
+
+        bool canMerge(const physical_pass_t& pass, const size_t submission) const {
+            const submission_attachments_t& next = attachments[submission];
+            const submission_attachments_t& first = attachments[pass.Submissions.front()];
+            if (!next.RenderPass || !first.RenderPass || !same_render_area(next.RenderArea, first.RenderArea)) {
+                return false;
+            }
+
+            // Resources the pass doesn't render are transitioned before it begins, so every subpass has to use them in one layout
+            for (const pipeline_barrier_t& invalidate : passBarriers[submission].InvalidateBarriers) {
+                bool rendered = false;
+                bool relayout = false;
+                for (const size_t subpass : pass.Submissions) {
+                    const pipeline_barrier_t* previous_use = find_access(passBarriers[subpass].InvalidateBarriers, invalidate.Resource);
+                    relayout |= (previous_use != nullptr) && (previous_use->Layout != invalidate.Layout);
+                    rendered |= find_access(passBarriers[subpass].FlushBarriers, invalidate.Resource) != nullptr;
+                }
+                if (relayout && !rendered) {
+                    return false;
+                }
+            }
+
+            bool related = false;
+            for (const size_t subpass : pass.Submissions) {
+                const submission_attachments_t& previous = attachments[subpass];
+                if ((next.DepthStencil != submission_attachments_t::NoAttachment) && (previous.DepthStencil != submission_attachments_t::NoAttachment) &&
+                    (next.DepthStencil != previous.DepthStencil)) {
+                    return false;
+                }
+
+                // Anything rendered earlier in the pass can only be read where it is in tile memory: through attachments
+                for (const pipeline_barrier_t& flush : passBarriers[subpass].FlushBarriers) {
+                    if (find_access(passBarriers[submission].InvalidateBarriers, flush.Resource) == nullptr) {
+                        continue;
+                    }
+                    if (!uses_as_attachment(next, flush.Resource) || !uses_as_attachment(previous, flush.Resource)) {
+                        return false;
+                    }
+                    related = true;
+                }
+
+                related |= graph.MergeDependsOn(submission, subpass);
+                for_each_attachment(previous, [&](const size_t resource) { related |= uses_as_attachment(next, resource); });
+            }
+
+            // Merging unrelated submissions only makes the pass need more tile memory
+            return related;
+        }
+
+        void build(physical_pass_t& pass, const size_t first_position, const resource_uses_t& uses, const std::vector<VkFormat>& resource_formats,
+            const std::vector<bool>& persistent_resources) const {
+            if (!attachments[pass.Submissions.front()].RenderPass) {
+                return;
+            }
+
+            for (const size_t submission : pass.Submissions) {
+                for_each_attachment(attachments[submission], [&pass](const size_t resource) {
+                    if (std::find(pass.Attachments.cbegin(), pass.Attachments.cend(), resource) == pass.Attachments.cend()) {
+                        pass.Attachments.emplace_back(resource);
+                    }
+                });
+            }
+
+            buildSubpasses(pass);
+            buildAttachmentDescriptions(pass, first_position, uses, resource_formats, persistent_resources);
+            buildDependencies(pass);
+        }
+
+    private:
+
+        uint32_t attachmentIndex(const physical_pass_t& pass, const size_t resource) const {
+            return static_cast<uint32_t>(std::distance(pass.Attachments.cbegin(), std::find(pass.Attachments.cbegin(), pass.Attachments.cend(), resource)));
+        }
+
+        // Barriers have already merged different uses of a resource in one submission into one layout
+        VkImageLayout layoutIn(const size_t submission, const size_t resource) const {
+            const pipeline_barrier_t* access = find_access(passBarriers[submission].InvalidateBarriers, resource);
+            return access != nullptr ? access->Layout : VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        VkAttachmentReference reference(const physical_pass_t& pass, const size_t submission, const size_t resource) const {
+            return VkAttachmentReference{ attachmentIndex(pass, resource), layoutIn(submission, resource) };
+        }
+
+        void buildSubpasses(physical_pass_t& pass) const {
+            std::vector<std::vector<bool>> used(pass.Submissions.size(), std::vector<bool>(pass.Attachments.size(), false));
+            for (size_t i = 0; i < pass.Submissions.size(); ++i) {
+                const size_t submission = pass.Submissions[i];
+                const submission_attachments_t& submission_attachments = attachments[submission];
+                subpass_attachments_t subpass;
+                for (const size_t resource : submission_attachments.ColorOutputs) {
+                    subpass.ColorAttachments.emplace_back(reference(pass, submission, resource));
+                }
+                for (const size_t resource : submission_attachments.ResolveOutputs) {
+                    subpass.ResolveAttachments.emplace_back(reference(pass, submission, resource));
+                }
+                for (const size_t resource : submission_attachments.InputAttachments) {
+                    subpass.InputAttachments.emplace_back(reference(pass, submission, resource));
+                }
+                if (submission_attachments.DepthStencil != submission_attachments_t::NoAttachment) {
+                    subpass.DepthStencilAttachment = reference(pass, submission, submission_attachments.DepthStencil);
+                }
+                for_each_attachment(submission_attachments, [&](const size_t resource) { used[i][attachmentIndex(pass, resource)] = true; });
+                pass.Subpasses.emplace_back(std::move(subpass));
+            }
+
+            // Subpasses in between one using an attachment and a later one using it again have to keep its contents
+            for (size_t i = 1; i + 1 < pass.Submissions.size(); ++i) {
+                for (uint32_t attachment = 0; attachment < static_cast<uint32_t>(pass.Attachments.size()); ++attachment) {
+                    if (used[i][attachment]) {
+                        continue;
+                    }
+                    bool used_before = false;
+                    bool used_after = false;
+                    for (size_t j = 0; j < i; ++j) {
+                        used_before |= used[j][attachment];
+                    }
+                    for (size_t j = i + 1; j < pass.Submissions.size(); ++j) {
+                        used_after |= used[j][attachment];
+                    }
+                    if (used_before && used_after) {
+                        pass.Subpasses[i].PreserveAttachments.emplace_back(attachment);
+                    }
+                }
+            }
+        }
+
+        void buildAttachmentDescriptions(physical_pass_t& pass, const size_t first_position, const resource_uses_t& uses, const std::vector<VkFormat>& resource_formats,
+            const std::vector<bool>& persistent_resources) const {
+            const size_t last_position = first_position + pass.Submissions.size() - 1;
+            const VkSampleCountFlagBits samples = static_cast<VkSampleCountFlagBits>(attachments[pass.Submissions.front()].RenderArea.Samples);
+
+            for (const size_t resource : pass.Attachments) {
+                size_t first_subpass = invalid_position;
+                size_t last_subpass = invalid_position;
+                bool resolve = false;
+                for (size_t i = 0; i < pass.Submissions.size(); ++i) {
+                    const submission_attachments_t& submission_attachments = attachments[pass.Submissions[i]];
+                    if (uses_as_attachment(submission_attachments, resource)) {
+                        first_subpass = std::min(first_subpass, i);
+                        last_subpass = i;
+                    }
+                    resolve |= std::find(submission_attachments.ResolveOutputs.cbegin(), submission_attachments.ResolveOutputs.cend(), resource) !=
+                        submission_attachments.ResolveOutputs.cend();
+                }
+
+                // Only load what was rendered before the pass, and only store what is used after it
+                const bool load = uses.ReadFirst[resource] || (uses.FirstWrite[resource] < first_position);
+                const bool store = uses.ReadFirst[resource] || persistent_resources[resource] ||
+                    ((uses.LastAccess[resource] != invalid_position) && (uses.LastAccess[resource] > last_position));
+                const VkAttachmentLoadOp load_op = load ? VK_ATTACHMENT_LOAD_OP_LOAD :
+                    clears(attachments[pass.Submissions[first_subpass]], resource) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                const VkAttachmentStoreOp store_op = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                const VkFormat format = resource_formats[resource];
+                const bool stencil = has_stencil(format);
+
+                pass.AttachmentDescriptions.emplace_back(VkAttachmentDescription{
+                    0, format, resolve ? VK_SAMPLE_COUNT_1_BIT : samples, load_op, store_op,
+                    stencil ? load_op : VK_ATTACHMENT_LOAD_OP_DONT_CARE, stencil ? store_op : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                    // Barriers before the pass have already transitioned attachments to the layout of their first use
+                    layoutIn(pass.Submissions[first_subpass], resource), layoutIn(pass.Submissions[last_subpass], resource)
+                });
+            }
+        }
+
+        void buildDependencies(physical_pass_t& pass) const {
+            for (uint32_t dst = 1; dst < static_cast<uint32_t>(pass.Submissions.size()); ++dst) {
+                const size_t dst_submission = pass.Submissions[dst];
+                const pass_barriers_t& dst_barriers = passBarriers[dst_submission];
+                for (uint32_t src = 0; src < dst; ++src) {
+                    const size_t src_submission = pass.Submissions[src];
+                    const pass_barriers_t& src_barriers = passBarriers[src_submission];
+                    VkSubpassDependency dependency{ src, dst, 0, 0, 0, 0, VK_DEPENDENCY_BY_REGION_BIT };
+
+                    for (const pipeline_barrier_t& invalidate : dst_barriers.InvalidateBarriers) {
+                        const pipeline_barrier_t* src_write = find_access(src_barriers.FlushBarriers, invalidate.Resource);
+                        const pipeline_barrier_t* src_use = find_access(src_barriers.InvalidateBarriers, invalidate.Resource);
+                        const bool dst_writes = find_access(dst_barriers.FlushBarriers, invalidate.Resource) != nullptr;
+                        if (src_write != nullptr) {
+                            dependency.srcStageMask |= src_write->Stages;
+                            dependency.srcAccessMask |= src_write->AccessFlags;
+                        }
+                        else if ((src_use != nullptr) && (dst_writes || (src_use->Layout != invalidate.Layout))) {
+                            dependency.srcStageMask |= src_use->Stages;
+                        }
+                        else {
+                            continue;
+                        }
+
+                        dependency.dstStageMask |= invalidate.Stages;
+                        dependency.dstAccessMask |= invalidate.AccessFlags;
+                        // Only attachments are accessed at the same pixel on both sides
+                        if (!uses_as_attachment(attachments[src_submission], invalidate.Resource) || !uses_as_attachment(attachments[dst_submission], invalidate.Resource)) {
+                            dependency.dependencyFlags = 0;
+                        }
+                    }
+
+                    if (dependency.srcStageMask != 0) {
+                        pass.Dependencies.emplace_back(dependency);
+                    }
+                }
+            }
+        }
+
+        const SubmissionGraph& graph;
+        const std::vector<submission_attachments_t>& attachments;
+        const std::vector<pass_barriers_t>& passBarriers;
+    };
+
+}
+
+bool physical_pass_t::RenderPass() const noexcept {
+    return !Subpasses.empty();
+}
+
+VkRenderPassCreateInfo physical_pass_t::RenderPassCreateInfo(std::vector<VkSubpassDescription>& subpasses) const {
+    subpasses.clear();
+    for (const subpass_attachments_t& subpass : Subpasses) {
+        subpasses.emplace_back(VkSubpassDescription{
+            0, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            static_cast<uint32_t>(subpass.InputAttachments.size()), subpass.InputAttachments.data(),
+            static_cast<uint32_t>(subpass.ColorAttachments.size()), subpass.ColorAttachments.data(),
+            subpass.ResolveAttachments.empty() ? nullptr : subpass.ResolveAttachments.data(),
+            subpass.DepthStencilAttachment.attachment != VK_ATTACHMENT_UNUSED ? &subpass.DepthStencilAttachment : nullptr,
+            static_cast<uint32_t>(subpass.PreserveAttachments.size()), subpass.PreserveAttachments.data()
+        });
+    }
+
+    return VkRenderPassCreateInfo{
+        VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO, nullptr, 0,
+        static_cast<uint32_t>(AttachmentDescriptions.size()), AttachmentDescriptions.data(),
+        static_cast<uint32_t>(subpasses.size()), subpasses.data(),
+        static_cast<uint32_t>(Dependencies.size()), Dependencies.data()
+    };
+}
+
+std::vector<physical_pass_t> MergePhysicalPasses(const SubmissionGraph& graph, const std::vector<submission_attachments_t>& attachments,
+    const std::vector<pass_barriers_t>& pass_barriers, const std::vector<VkFormat>& resource_formats, const std::vector<bool>& persistent_resources) {
+    const std::vector<size_t>& order = graph.Order();
+    const physical_pass_builder_t builder(graph, attachments, pass_barriers);
+
+    std::vector<physical_pass_t> result;
+    std::vector<size_t> first_positions;
+    for (size_t position = 0; position < order.size(); ++position) {
+        if (result.empty() || !builder.canMerge(result.back(), order[position])) {
+            result.emplace_back();
+            first_positions.emplace_back(position);
+        }
+        result.back().Submissions.emplace_back(order[position]);
+    }
+
+    const resource_uses_t uses = find_resource_uses(order, pass_barriers, resource_formats.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+        builder.build(result[i], first_positions[i], uses, resource_formats, persistent_resources);
+    }
+
+    return result;
+}
+
+std::vector<size_t> PhysicalPassBegins(const std::vector<physical_pass_t>& passes) {
+    std::vector<size_t> result;
+    for (const physical_pass_t& pass : passes) {
+        const size_t begin = result.size();
+        result.insert(result.end(), pass.Submissions.size(), begin);
+    }
+    return result;
+}
+
+#ifdef VPSK_TESTING_ENABLED
+TEST_SUITE("RenderPassMerging") {
+
+    namespace {
+
+        constexpr VkPipelineStageFlags depth_stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+        enum resources : size_t {
+            Albedo, Normals, Depth, Lighting, Backbuffer, ShadowMap, NumResources
+        };
+
+        enum submissions : size_t {
+            Shadows, GBuffer, Lights, Tonemap, NumSubmissions
+        };
+
+        void add_color_output(submission_attachments_t& attachments, pass_barriers_t& barriers, const size_t resource, const bool clear) {
+            attachments.ColorOutputs.emplace_back(resource);
+            attachments.ClearColorOutputs.emplace_back(clear);
+            AddResourceAccess(barriers, pipeline_barrier_t{ resource, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT }, true);
+        }
+
+        void add_texture(pass_barriers_t& barriers, const size_t resource) {
+            AddResourceAccess(barriers, pipeline_barrier_t{ resource, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT }, false);
+        }
+
+        // A deferred renderer: shadow map, G-buffer, lighting reading the G-buffer as input attachments, then tonemapping
+        struct deferred_frame_t {
+            deferred_frame_t() : Graph(NumSubmissions), Attachments(NumSubmissions), Barriers(NumSubmissions), Formats(NumResources, VK_FORMAT_R8G8B8A8_UNORM),
+                Persistent(NumResources, false) {
+                Formats[Depth] = VK_FORMAT_D24_UNORM_S8_UINT;
+                Formats[ShadowMap] = VK_FORMAT_D32_SFLOAT;
+                Formats[Lighting] = VK_FORMAT_R16G16B16A16_SFLOAT;
+                Persistent[Backbuffer] = true;
+
+                image_info_t screen;
+                screen.SizeClass = image_info_t::size_class::SwapchainRelative;
+                image_info_t shadow_map;
+                shadow_map.SizeX = 2048.0f;
+                shadow_map.SizeY = 2048.0f;
+                for (auto& attachments : Attachments) {
+                    attachments.RenderPass = true;
+                    attachments.RenderArea = screen;
+                }
+
+                Attachments[Shadows].RenderArea = shadow_map;
+                Attachments[Shadows].DepthStencil = ShadowMap;
+                Attachments[Shadows].ClearDepthStencil = true;
+                AddResourceAccess(Barriers[Shadows], pipeline_barrier_t{ ShadowMap, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, depth_stages }, true);
+
+                add_color_output(Attachments[GBuffer], Barriers[GBuffer], Albedo, true);
+                add_color_output(Attachments[GBuffer], Barriers[GBuffer], Normals, true);
+                Attachments[GBuffer].DepthStencil = Depth;
+                Attachments[GBuffer].ClearDepthStencil = true;
+                AddResourceAccess(Barriers[GBuffer], pipeline_barrier_t{ Depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, depth_stages }, true);
+
+                add_color_output(Attachments[Lights], Barriers[Lights], Lighting, false);
+                Attachments[Lights].InputAttachments = { Albedo, Normals };
+                for (const size_t resource : { Albedo, Normals }) {
+                    AddResourceAccess(Barriers[Lights], pipeline_barrier_t{ resource, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+                        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT }, false);
+                }
+                Attachments[Lights].DepthStencil = Depth;
+                AddResourceAccess(Barriers[Lights], pipeline_barrier_t{ Depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, depth_stages }, false);
+                add_texture(Barriers[Lights], ShadowMap);
+
+                add_color_output(Attachments[Tonemap], Barriers[Tonemap], Backbuffer, false);
+                add_texture(Barriers[Tonemap], Lighting);
+
+                Graph.AddDependency(Lights, GBuffer, true);
+                Graph.AddDependency(Lights, Shadows);
+                Graph.AddDependency(Tonemap, Lights);
+                Graph.Bake({ Tonemap });
+            }
+
+            SubmissionGraph Graph;
+            std::vector<submission_attachments_t> Attachments;
+            std::vector<pass_barriers_t> Barriers;
+            std::vector<VkFormat> Formats;
+            std::vector<bool> Persistent;
+        };
+
+        const VkAttachmentDescription& description_of(const physical_pass_t& pass, const size_t resource) {
+            return pass.AttachmentDescriptions[std::distance(pass.Attachments.cbegin(), std::find(pass.Attachments.cbegin(), pass.Attachments.cend(), resource))];
+        }
+
+    }
+
+    TEST_CASE("MergesLightingIntoGBufferPass") {
+        const deferred_frame_t frame;
+        const std::vector<physical_pass_t> passes = MergePhysicalPasses(frame.Graph, frame.Attachments, frame.Barriers, frame.Formats, frame.Persistent);
+
+        REQUIRE(passes.size() == 3);
+        const auto merged = std::find_if(passes.cbegin(), passes.cend(), [](const physical_pass_t& pass) { return pass.Submissions.size() == 2; });
+        REQUIRE(merged != passes.cend());
+        CHECK(merged->Submissions == std::vector<size_t>{ GBuffer, Lights });
+        // Tonemapping samples the lighting result, which can't be read from tile memory
+        CHECK(passes.back().Submissions == std::vector<size_t>{ Tonemap });
+
+        REQUIRE(merged->Subpasses.size() == 2);
+        CHECK(merged->Attachments.size() == 4);
+        const subpass_attachments_t& lighting = merged->Subpasses[1];
+        REQUIRE(lighting.InputAttachments.size() == 2);
+        CHECK(merged->Attachments[lighting.InputAttachments[0].attachment] == Albedo);
+        CHECK(lighting.InputAttachments[0].layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        CHECK(merged->Attachments[lighting.DepthStencilAttachment.attachment] == Depth);
+        CHECK(lighting.DepthStencilAttachment.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+
+        // The G-buffer never leaves tile memory: cleared, and never stored
+        for (const size_t resource : { Albedo, Normals, Depth }) {
+            const VkAttachmentDescription& description = description_of(*merged, resource);
+            CHECK(description.loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR);
+            CHECK(description.storeOp == VK_ATTACHMENT_STORE_OP_DONT_CARE);
+        }
+        CHECK(description_of(*merged, Depth).stencilLoadOp == VK_ATTACHMENT_LOAD_OP_CLEAR);
+        CHECK(description_of(*merged, Albedo).initialLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        CHECK(description_of(*merged, Albedo).finalLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        CHECK(description_of(*merged, Lighting).loadOp == VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+        CHECK(description_of(*merged, Lighting).storeOp == VK_ATTACHMENT_STORE_OP_STORE);
+        CHECK(description_of(passes.back(), Backbuffer).storeOp == VK_ATTACHMENT_STORE_OP_STORE);
+
+        REQUIRE(merged->Dependencies.size() == 1);
+        const VkSubpassDependency& dependency = merged->Dependencies.front();
+        CHECK(dependency.srcSubpass == 0);
+        CHECK(dependency.dstSubpass == 1);
+        CHECK(dependency.dependencyFlags == VK_DEPENDENCY_BY_REGION_BIT);
+        CHECK((dependency.srcAccessMask & VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT) != 0);
+        CHECK((dependency.dstAccessMask & VK_ACCESS_INPUT_ATTACHMENT_READ_BIT) != 0);
+        CHECK((dependency.dstStageMask & VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT) != 0);
+
+        std::vector<VkSubpassDescription> subpasses;
+        const VkRenderPassCreateInfo create_info = merged->RenderPassCreateInfo(subpasses);
+        CHECK(create_info.subpassCount == 2);
+        CHECK(create_info.attachmentCount == 4);
+        CHECK(subpasses[0].pResolveAttachments == nullptr);
+        CHECK(subpasses[1].inputAttachmentCount == 2);
+    }
+
+    TEST_CASE("HoistsBarriersOutOfMergedPasses") {
+        const deferred_frame_t frame;
+        const std::vector<physical_pass_t> passes = MergePhysicalPasses(frame.Graph, frame.Attachments, frame.Barriers, frame.Formats, frame.Persistent);
+        const std::vector<size_t>& order = frame.Graph.Order();
+        const std::vector<size_t> pass_begins = PhysicalPassBegins(passes);
+        REQUIRE(pass_begins.size() == order.size());
+
+        std::vector<bool> images(NumResources, true);
+        size_t num_events = 0;
+        const std::vector<submission_barriers_t> barriers = SynthesizeBarriers(frame.Barriers, order, images, num_events, pass_begins);
+        const size_t gbuffer = std::distance(order.cbegin(), std::find(order.cbegin(), order.cend(), GBuffer));
+        REQUIRE(gbuffer + 1 < order.size());
+        REQUIRE(order[gbuffer + 1] == Lights);
+
+        // Lighting records nothing inside the pass: its wait on the shadow map moves before the G-buffer subpass
+        CHECK(barriers[gbuffer + 1].Barrier.Empty());
+        CHECK(barriers[gbuffer + 1].EventWait.Empty());
+        bool waits_on_shadows = false;
+        for (const barrier_batch_t* batch : { &barriers[gbuffer].Barrier, &barriers[gbuffer].EventWait }) {
+            for (const resource_barrier_t& barrier : batch->Barriers) {
+                waits_on_shadows |= (barrier.Resource == ShadowMap) && (barrier.NewLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                // Layouts inside the pass are the subpasses' business
+                CHECK(barrier.NewLayout != VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+            }
+        }
+        CHECK(waits_on_shadows);
+
+        // Tonemapping sees the lighting result in the layout the pass left it in
+        const auto tonemap = std::find_if(barriers.cbegin(), barriers.cend(), [](const submission_barriers_t& b) { return b.Submission == Tonemap; });
+        REQUIRE(tonemap != barriers.cend());
+        bool lighting_transition = false;
+        for (const resource_barrier_t& barrier : tonemap->Barrier.Barriers) {
+            if (barrier.Resource == Lighting) {
+                lighting_transition = (barrier.OldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) && (barrier.SrcAccess == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+            }
+        }
+        CHECK(lighting_transition);
+    }
+
+    TEST_CASE("OnlyMergesCompatibleSubmissions") {
+        deferred_frame_t frame;
+        frame.Attachments[Lights].RenderArea.Samples = VK_SAMPLE_COUNT_4_BIT;
+        std::vector<physical_pass_t> passes = MergePhysicalPasses(frame.Graph, frame.Attachments, frame.Barriers, frame.Formats, frame.Persistent);
+        CHECK(passes.size() == NumSubmissions);
+
+        frame.Attachments[Lights].RenderArea.Samples = VK_SAMPLE_COUNT_1_BIT;
+        frame.Attachments[Lights].RenderPass = false;
+        passes = MergePhysicalPasses(frame.Graph, frame.Attachments, frame.Barriers, frame.Formats, frame.Persistent);
+        CHECK(passes.size() == NumSubmissions);
+        for (const physical_pass_t& pass : passes) {
+            CHECK(pass.RenderPass() == (pass.Submissions.front() != Lights));
+        }
+        // Without lighting in its pass, the G-buffer is stored for the submission reading it
+        const auto gbuffer = std::find_if(passes.cbegin(), passes.cend(), [](const physical_pass_t& pass) { return pass.Submissions.front() == GBuffer; });
+        REQUIRE(gbuffer != passes.cend());
+        CHECK(description_of(*gbuffer, Albedo).storeOp == VK_ATTACHMENT_STORE_OP_STORE);
+    }
+
+}
+#endif // VPSK_TESTING_ENABLED
@@ -23,24 +23,29 @@ namespace vpsk {
 
     ShaderResourcePack::~ShaderResourcePack() {}
 
-    vpr::DescriptorSet* ShaderResourcePack::DescriptorSet(const char* group_name) noexcept {
+    size_t ShaderResourcePack::GroupIndex(const char* group_name) const noexcept {
         auto iter = rsrcGroupToIdxMap.find(group_name);
-        if (iter != rsrcGroupToIdxMap.end()) {
-            return descriptorSets[rsrcGroupToIdxMap.at(group_name)].get();
-        }
-        else {
-            return nullptr;
-        }
+        return (iter != rsrcGroupToIdxMap.cend()) ? iter->second : InvalidGroupIndex;
+    }
+
+    vpr::DescriptorSet* ShaderResourcePack::DescriptorSet(const size_t group_idx) noexcept {
+        return (group_idx < descriptorSets.size()) ? descriptorSets[group_idx].get() : nullptr;
+    }
+
+    const vpr::DescriptorSet* ShaderResourcePack::DescriptorSet(const size_t group_idx) const noexcept {
+        return (group_idx < descriptorSets.size()) ? descriptorSets[group_idx].get() : nullptr;
+    }
+
+    const std::vector<resource_cache_id_t>& ShaderResourcePack::GroupResourceIDs(const size_t group_idx) const {
+        return rsrcGroupResourceIDs.at(group_idx);
+    }
+
+    vpr::DescriptorSet* ShaderResourcePack::DescriptorSet(const char* group_name) noexcept {
+        return DescriptorSet(GroupIndex(group_name));
     }
 
     const vpr::DescriptorSet* ShaderResourcePack::DescriptorSet(const char* group_name) const noexcept {
-        auto iter = rsrcGroupToIdxMap.find(group_name);
-        if (iter != rsrcGroupToIdxMap.cend()) {
-            return descriptorSets[rsrcGroupToIdxMap.at(group_name)].get();
-        }
-        else {
-            return nullptr;
-        }
+        return DescriptorSet(GroupIndex(group_name));
     }
 
     vpr::DescriptorPool* ShaderResourcePack::DescriptorPool() noexcept {
@@ -53,7 +58,10 @@ namespace vpsk {
 
     void ShaderResourcePack::getGroupNames() {
         auto names = shaderPack->GetResourceGroupNames();
+        rsrcGroupNames.resize(names.NumStrings);
+        rsrcGroupResourceIDs.resize(names.NumStrings);
         for (size_t i = 0; i < names.NumStrings; ++i) {
+            rsrcGroupNames[i] = names.Strings[i];
             rsrcGroupToIdxMap.emplace(names.Strings[i], i);
         }
     }
@@ -94,36 +102,35 @@ namespace vpsk {
         }
     }
 
-    void ShaderResourcePack::createResources(const std::vector<const st::ShaderResource*>& resources) {
-        std::vector<const st::ShaderResource*> buffer_resources;
-        std::vector<const st::ShaderResource*> image_resources;
+    void ShaderResourcePack::createResources(const size_t group_idx, const std::vector<const st::ShaderResource*>& resources) {
+        // Names are interned by the caches here, once: binding later on only touches the IDs recorded below
+        auto& buffer_cache = graph.GetBufferResourceCache();
+        auto& image_cache = graph.GetImageResourceCache();
+        auto& resource_ids = rsrcGroupResourceIDs[group_idx];
+        resource_ids.clear();
+        resource_ids.reserve(resources.size());
         for (const auto& rsrc : resources) {
             if (is_buffer_type(rsrc->DescriptorType()) || is_texel_buffer(rsrc->DescriptorType())) {
-                buffer_resources.emplace_back(rsrc);
+                resource_ids.emplace_back(buffer_cache.AddResource(rsrc));
             }
             else {
-                image_resources.emplace_back(rsrc);
+                resource_ids.emplace_back(image_cache.AddResource(rsrc));
             }
         }
-
-        auto& buffer_cache = graph.GetBufferResourceCache();
-        buffer_cache.AddResources(buffer_resources);
-        auto& image_cache = graph.GetImageResourceCache();
-        image_cache.AddResources(image_resources);
     }
 
-    void ShaderResourcePack::createSingleSet(const std::string& name) {
+    void ShaderResourcePack::createSingleSet(const size_t group_idx) {
         size_t num_resources = 0;
-        const st::ResourceGroup* resource_group = shaderPack->GetResourceGroup(name.c_str());
+        const st::ResourceGroup* resource_group = shaderPack->GetResourceGroup(rsrcGroupNames[group_idx].c_str());
         resource_group->GetResourcePtrs(&num_resources, nullptr);
         std::vector<const st::ShaderResource*> resources(num_resources);
         resource_group->GetResourcePtrs(&num_resources, resources.data());
-        createResources(resources);
+        createResources(group_idx, resources);
     }
 
     void ShaderResourcePack::createSets() {
-        for (const auto& entry : rsrcGroupToIdxMap) {
-            createSingleSet(entry.first);
+        for (size_t i = 0; i < rsrcGroupNames.size(); ++i) {
+            createSingleSet(i);
         }
     }
 
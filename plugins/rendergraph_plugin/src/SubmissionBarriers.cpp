@@ -0,0 +1,516 @@
+#include "SubmissionBarriers.hpp"
+#include "doctest/doctest.h"
+#include <algorithm>
+
+namespace {
+
+    constexpr VkAccessFlags write_access_flags = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    constexpr size_t invalid_position = std::numeric_limits<size_t>::max();
+
+    // What the last submission touching a resource left it as
+    struct resource_state_t {
+        VkImageLayout Layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+        // Position in order of the last writer: invalid for writes in the previous frame
+        size_t Writer{ invalid_position };
+        // The last write
+        VkPipelineStageFlags WriteStages{ 0 };
+        VkAccessFlags WriteAccess{ 0 };
+        // Reads since the last write, which a write or layout transition has to wait for. Those by the render pass
+        // beginning at ReadPass are kept apart, as its own subpass dependencies wait on them
+        VkPipelineStageFlags ReadStages{ 0 };
+        size_t ReadPass{ invalid_position };
+        VkPipelineStageFlags PassReadStages{ 0 };
+        // Read access and stages the last write has been made visible to
+        VkAccessFlags VisibleAccess{ 0 };
+        VkPipelineStageFlags VisibleStages{ 0 };
+        // Set once a barrier has made the last write available: later barriers only need to chain after that one
+        bool Available{ false };
+        bool Written{ false };
+    };
+
+    pipeline_barrier_t* find_barrier(std::vector<pipeline_barrier_t>& barriers, const size_t resource) noexcept {
+        auto iter = std::find_if(barriers.begin(), barriers.end(), [resource](const pipeline_barrier_t& barrier) { return barrier.Resource == resource; });
+        return iter != barriers.end() ? &(*iter) : nullptr;
+    }
+
+    const pipeline_barrier_t* find_barrier(const std::vector<pipeline_barrier_t>& barriers, const size_t resource) noexcept {
+        auto iter = std::find_if(barriers.cbegin(), barriers.cend(), [resource](const pipeline_barrier_t& barrier) { return barrier.Resource == resource; });
+        return iter != barriers.cend() ? &(*iter) : nullptr;
+    }
+
+    void merge_barrier(std::vector<pipeline_barrier_t>& barriers, const pipeline_barrier_t& access) {
+        pipeline_barrier_t* existing = find_barrier(barriers, access.Resource);
+        if (existing == nullptr) {
+            barriers.emplace_back(access);
+            return;
+        }
+        existing->AccessFlags |= access.AccessFlags;
+        existing->Stages |= access.Stages;
+        existing->History |= access.History;
+        if (existing->Layout != access.Layout) {
+            existing->Layout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+    }
+
+    // Resources read before they are written each frame see what the previous frame left them as
+    std::vector<resource_state_t> initial_resource_states(const std::vector<pass_barriers_t>& pass_barriers, const std::vector<size_t>& order, const size_t num_resources) {
+        std::vector<resource_state_t> frame_end(num_resources);
+        std::vector<bool> read_first(num_resources, false);
+        std::vector<bool> seen(num_resources, false);
+        for (const size_t submission : order) {
+            const pass_barriers_t& barriers = pass_barriers[submission];
+            for (const pipeline_barrier_t& invalidate : barriers.InvalidateBarriers) {
+                if (!seen[invalidate.Resource]) {
+                    seen[invalidate.Resource] = true;
+                    read_first[invalidate.Resource] = invalidate.History || (find_barrier(barriers.FlushBarriers, invalidate.Resource) == nullptr);
+                }
+                frame_end[invalidate.Resource].Layout = invalidate.Layout;
+            }
+            for (const pipeline_barrier_t& flush : barriers.FlushBarriers) {
+                resource_state_t& state = frame_end[flush.Resource];
+                state.Layout = flush.Layout;
+                state.WriteStages = flush.Stages;
+                state.WriteAccess = flush.AccessFlags;
+                state.Written = true;
+            }
+        }
+
+        std::vector<resource_state_t> result(num_resources);
+        for (size_t i = 0; i < num_resources; ++i) {
+            result[i].Written = frame_end[i].Written;
+            if (frame_end[i].Written && read_first[i]) {
+                result[i].Layout = frame_end[i].Layout;
+                result[i].WriteStages = frame_end[i].WriteStages;
+                result[i].WriteAccess = frame_end[i].WriteAccess;
+            }
+        }
+        return result;
+    }
+
+    void record_batch(VkCommandBuffer cmd, const barrier_batch_t& batch, const std::vector<VkEvent>& wait_events,
+        const std::function<barrier_image_t(size_t)>& get_image, const std::function<VkBuffer(size_t)>& get_buffer) {
+        std::vector<VkImageMemoryBarrier> image_barriers;
+        std::vector<VkBufferMemoryBarrier> buffer_barriers;
+        for (const resource_barrier_t& barrier : batch.Barriers) {
+            if (barrier.Image) {
+                const barrier_image_t image = get_image(barrier.Resource);
+                image_barriers.emplace_back(VkImageMemoryBarrier{
+                    VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, nullptr, barrier.SrcAccess, barrier.DstAccess, barrier.OldLayout, barrier.NewLayout,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image.Image, image.SubresourceRange
+                });
+            }
+            else {
+                buffer_barriers.emplace_back(VkBufferMemoryBarrier{
+                    VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER, nullptr, barrier.SrcAccess, barrier.DstAccess,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, get_buffer(barrier.Resource), 0, VK_WHOLE_SIZE
+                });
+            }
+        }
+
+        if (!wait_events.empty()) {
+            vkCmdWaitEvents(cmd, static_cast<uint32_t>(wait_events.size()), wait_events.data(), batch.SrcStages, batch.DstStages, 0, nullptr,
+                static_cast<uint32_t>(buffer_barriers.size()), buffer_barriers.data(), static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+        }
+        else {
+            vkCmdPipelineBarrier(cmd, batch.SrcStages, batch.DstStages, 0, 0, nullptr, static_cast<uint32_t>(buffer_barriers.size()), buffer_barriers.data(),
+                static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+        }
+    }
+
+}
+
+void AddResourceAccess(pass_barriers_t& barriers, const pipeline_barrier_t& access, const bool write) {
+    merge_barrier(barriers.InvalidateBarriers, access);
+    if (write) {
+        pipeline_barrier_t flush = access;
+        flush.AccessFlags &= write_access_flags;
+        merge_barrier(barriers.FlushBarriers, flush);
+    }
+}
+
+bool barrier_batch_t::Empty() const noexcept {
+    return DstStages == 0;
+}
+
+std::vector<submission_barriers_t> SynthesizeBarriers(const std::vector<pass_barriers_t>& pass_barriers, const std::vector<size_t>& order,
+    const std::vector<bool>& image_resources, size_t& num_events, const std::vector<size_t>& pass_begins) {
+    std::vector<resource_state_t> states = initial_resource_states(pass_barriers, order, image_resources.size());
+    std::vector<submission_barriers_t> result(order.size());
+    for (size_t position = 0; position < order.size(); ++position) {
+        result[position].Submission = order[position];
+    }
+    num_events = 0;
+
+    auto pass_begin_of = [&pass_begins](const size_t position) {
+        return pass_begins.empty() ? position : pass_begins[position];
+    };
+    // Events can't be set inside a render pass, only after its last subpass
+    auto ends_pass = [&](const size_t position) {
+        return (position + 1 == order.size()) || (pass_begin_of(position + 1) != pass_begin_of(position));
+    };
+
+    for (size_t position = 0; position < order.size(); ++position) {
+        const pass_barriers_t& barriers = pass_barriers[order[position]];
+        const size_t pass_begin = pass_begin_of(position);
+        // Later subpasses of a render pass wait on work before it before the pass begins
+        submission_barriers_t& submission_barriers = result[pass_begin];
+
+        for (const pipeline_barrier_t& invalidate : barriers.InvalidateBarriers) {
+            resource_state_t& state = states[invalidate.Resource];
+            if (!state.Written) {
+                continue;
+            }
+
+            const bool image = image_resources[invalidate.Resource];
+            const bool writes = find_barrier(barriers.FlushBarriers, invalidate.Resource) != nullptr;
+            const bool transition = image && (state.Layout != invalidate.Layout);
+            const VkAccessFlags read_access = invalidate.AccessFlags & ~write_access_flags;
+            const bool read_after_write = (state.WriteAccess != 0) && (read_access != 0) &&
+                (((read_access & ~state.VisibleAccess) != 0) || ((invalidate.Stages & ~state.VisibleStages) != 0));
+            const bool write_after_write = writes && (state.WriteAccess != 0);
+            const VkPipelineStageFlags earlier_reads = state.ReadStages | ((state.ReadPass != pass_begin) ? state.PassReadStages : 0);
+            const bool write_after_read = (writes || transition) && (earlier_reads != 0);
+            const bool waits_on_write = transition || read_after_write || write_after_write;
+            // Written by an earlier subpass of the same render pass: the subpass dependency and attachment layouts
+            // take care of it, and chain after whatever that subpass waited on
+            const bool in_pass = (state.Writer != invalid_position) && (state.Writer >= pass_begin);
+            // Only read by earlier subpasses, which may already have a barrier on it before the pass: this one joins
+            // it, as a barrier can't chain after another one recorded in the same command
+            barrier_batch_t* pass_batch = nullptr;
+            resource_barrier_t* pass_barrier = nullptr;
+            if (!in_pass && (state.ReadPass == pass_begin)) {
+                for (barrier_batch_t* batch : { &submission_barriers.Barrier, &submission_barriers.EventWait }) {
+                    auto iter = std::find_if(batch->Barriers.begin(), batch->Barriers.end(),
+                        [&invalidate](const resource_barrier_t& barrier) { return barrier.Resource == invalidate.Resource; });
+                    if (iter != batch->Barriers.end()) {
+                        pass_batch = batch;
+                        pass_barrier = &(*iter);
+                    }
+                }
+            }
+
+            if (in_pass) {
+                state.Available |= waits_on_write;
+                if (transition) {
+                    state.VisibleAccess = read_access;
+                    state.VisibleStages = invalidate.Stages;
+                }
+                else if (read_after_write) {
+                    state.VisibleAccess |= read_access;
+                    state.VisibleStages |= invalidate.Stages;
+                }
+            }
+            else if ((pass_barrier != nullptr) && (waits_on_write || write_after_read)) {
+                // Render pass merging keeps the layout the same across subpasses that don't write the resource
+                pass_batch->DstStages |= invalidate.Stages;
+                pass_barrier->DstAccess |= invalidate.AccessFlags;
+                if (write_after_read) {
+                    submission_barriers.Barrier.SrcStages |= earlier_reads;
+                    submission_barriers.Barrier.DstStages |= invalidate.Stages;
+                }
+                state.VisibleAccess |= read_access;
+                state.VisibleStages |= invalidate.Stages;
+            }
+            else if (waits_on_write || write_after_read) {
+                // Only waits on the last writer alone can be split: waits on readers, or chained through an earlier barrier, stay in one pipeline barrier
+                const bool split = !write_after_read && !state.Available && (state.WriteAccess != 0) && (state.Writer != invalid_position) &&
+                    (state.Writer + 1 < pass_begin) && ends_pass(state.Writer);
+                barrier_batch_t& batch = split ? submission_barriers.EventWait : submission_barriers.Barrier;
+                VkAccessFlags src_access = 0;
+                if (waits_on_write && !state.Available) {
+                    src_access = state.WriteAccess;
+                    batch.SrcStages |= state.WriteStages;
+                }
+                else if (waits_on_write) {
+                    batch.SrcStages |= state.VisibleStages;
+                }
+                if (write_after_read) {
+                    batch.SrcStages |= earlier_reads;
+                }
+                batch.DstStages |= invalidate.Stages;
+                if (transition || read_after_write || (src_access != 0)) {
+                    batch.Barriers.emplace_back(resource_barrier_t{ invalidate.Resource, image, state.Layout, invalidate.Layout, src_access, invalidate.AccessFlags });
+                }
+
+                if (split) {
+                    submission_barriers_t& writer = result[state.Writer];
+                    if (writer.SignalEvent == submission_barriers_t::NoEvent) {
+                        writer.SignalEvent = num_events++;
+                    }
+                    writer.SignalStages |= state.WriteStages;
+                    if (std::find(submission_barriers.WaitEvents.cbegin(), submission_barriers.WaitEvents.cend(), writer.SignalEvent) == submission_barriers.WaitEvents.cend()) {
+                        submission_barriers.WaitEvents.emplace_back(writer.SignalEvent);
+                    }
+                }
+
+                state.Available |= (src_access != 0);
+                if (transition || (src_access != 0)) {
+                    state.VisibleAccess = read_access;
+                    state.VisibleStages = invalidate.Stages;
+                }
+                else if (read_after_write) {
+                    state.VisibleAccess |= read_access;
+                    state.VisibleStages |= invalidate.Stages;
+                }
+            }
+
+            state.Layout = invalidate.Layout;
+            if (!writes) {
+                if (state.ReadPass != pass_begin) {
+                    state.ReadStages |= state.PassReadStages;
+                    state.PassReadStages = 0;
+                    state.ReadPass = pass_begin;
+                }
+                state.PassReadStages |= invalidate.Stages;
+            }
+        }
+
+        for (const pipeline_barrier_t& flush : barriers.FlushBarriers) {
+            resource_state_t& state = states[flush.Resource];
+            state.Layout = flush.Layout;
+            state.Writer = position;
+            state.WriteStages = flush.Stages;
+            state.WriteAccess = flush.AccessFlags;
+            state.ReadStages = 0;
+            state.ReadPass = invalid_position;
+            state.PassReadStages = 0;
+            state.VisibleAccess = 0;
+            state.VisibleStages = 0;
+            state.Available = false;
+        }
+
+        // First uses of a resource don't wait on anything
+        for (barrier_batch_t* batch : { &submission_barriers.Barrier, &submission_barriers.EventWait }) {
+            if (!batch->Empty() && (batch->SrcStages == 0)) {
+                batch->SrcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            }
+        }
+    }
+
+    // vkCmdWaitEvents' srcStageMask has to be the union of the stages its events were set with, and each event is
+    // set with the stages of every write any of its waiters need
+    std::vector<VkPipelineStageFlags> event_stages(num_events, 0);
+    for (const submission_barriers_t& barriers : result) {
+        if (barriers.SignalEvent != submission_barriers_t::NoEvent) {
+            event_stages[barriers.SignalEvent] = barriers.SignalStages;
+        }
+    }
+    for (submission_barriers_t& barriers : result) {
+        if (!barriers.WaitEvents.empty()) {
+            barriers.EventWait.SrcStages = 0;
+            for (const size_t event : barriers.WaitEvents) {
+                barriers.EventWait.SrcStages |= event_stages[event];
+            }
+        }
+    }
+
+    return result;
+}
+
+void RecordSubmissionBarriers(VkCommandBuffer cmd, const submission_barriers_t& barriers, const VkEvent* events,
+    const std::function<barrier_image_t(size_t)>& get_image, const std::function<VkBuffer(size_t)>& get_buffer) {
+    if (!barriers.EventWait.Empty()) {
+        std::vector<VkEvent> wait_events;
+        for (const size_t event : barriers.WaitEvents) {
+            wait_events.emplace_back(events[event]);
+        }
+        record_batch(cmd, barriers.EventWait, wait_events, get_image, get_buffer);
+    }
+    if (!barriers.Barrier.Empty()) {
+        record_batch(cmd, barriers.Barrier, std::vector<VkEvent>{}, get_image, get_buffer);
+    }
+}
+
+void RecordSubmissionSignal(VkCommandBuffer cmd, const submission_barriers_t& barriers, const VkEvent* events) {
+    if (barriers.SignalEvent != submission_barriers_t::NoEvent) {
+        vkCmdSetEvent(cmd, events[barriers.SignalEvent], barriers.SignalStages);
+    }
+}
+
+#ifdef VPSK_TESTING_ENABLED
+
+TEST_SUITE("SubmissionBarriers") {
+
+    pipeline_barrier_t color_write(const size_t resource) {
+        return pipeline_barrier_t{ resource, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    }
+
+    pipeline_barrier_t sampled(const size_t resource, const VkPipelineStageFlags stages) {
+        return pipeline_barrier_t{ resource, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, stages };
+    }
+
+    pipeline_barrier_t storage(const size_t resource, const VkAccessFlags access) {
+        return pipeline_barrier_t{ resource, VK_IMAGE_LAYOUT_UNDEFINED, access, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT };
+    }
+
+    std::vector<size_t> sequential_order(const size_t count) {
+        std::vector<size_t> result(count);
+        for (size_t i = 0; i < count; ++i) {
+            result[i] = i;
+        }
+        return result;
+    }
+
+    TEST_CASE("MergesAccessesOfOneResource") {
+        pass_barriers_t barriers;
+        AddResourceAccess(barriers, sampled(0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT), false);
+        AddResourceAccess(barriers, pipeline_barrier_t{ 0, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT }, true);
+        REQUIRE(barriers.InvalidateBarriers.size() == 1);
+        CHECK(barriers.InvalidateBarriers[0].Layout == VK_IMAGE_LAYOUT_GENERAL);
+        CHECK(barriers.InvalidateBarriers[0].AccessFlags == (VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT));
+        CHECK(barriers.InvalidateBarriers[0].Stages == (VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+        REQUIRE(barriers.FlushBarriers.size() == 1);
+        CHECK(barriers.FlushBarriers[0].AccessFlags == VK_ACCESS_SHADER_WRITE_BIT);
+    }
+
+    TEST_CASE("OnlyEmitsWhatStateChangesNeed") {
+        // 0 renders image 0, 1 and 2 sample it in fragment shaders, 3 in a compute shader. Image 1 comes from disk.
+        std::vector<pass_barriers_t> passes(4);
+        AddResourceAccess(passes[0], color_write(0), true);
+        AddResourceAccess(passes[1], sampled(0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT), false);
+        AddResourceAccess(passes[1], sampled(1, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT), false);
+        AddResourceAccess(passes[2], sampled(0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT), false);
+        AddResourceAccess(passes[3], sampled(0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT), false);
+
+        size_t num_events = 0;
+        const auto result = SynthesizeBarriers(passes, sequential_order(4), std::vector<bool>{ true, true }, num_events);
+        CHECK(num_events == 0);
+
+        // First use: transition out of undefined, waiting on nothing
+        REQUIRE(result[0].Barrier.Barriers.size() == 1);
+        CHECK(result[0].Barrier.SrcStages == VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        CHECK(result[0].Barrier.Barriers[0].OldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+
+        REQUIRE(result[1].Barrier.Barriers.size() == 1);
+        const resource_barrier_t& barrier = result[1].Barrier.Barriers[0];
+        CHECK(result[1].Barrier.SrcStages == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        CHECK(result[1].Barrier.DstStages == VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        CHECK(barrier.Resource == 0);
+        CHECK(barrier.OldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        CHECK(barrier.NewLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        CHECK(barrier.SrcAccess == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+        CHECK(barrier.DstAccess == VK_ACCESS_SHADER_READ_BIT);
+
+        // Already visible to fragment shaders, in the same layout
+        CHECK(result[2].Barrier.Empty());
+        // Not yet visible to compute shaders
+        REQUIRE(result[3].Barrier.Barriers.size() == 1);
+        CHECK(result[3].Barrier.DstStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        // The write was made available before 1, so this only has to chain after that barrier
+        CHECK(result[3].Barrier.SrcStages == VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        CHECK(result[3].Barrier.Barriers[0].SrcAccess == 0);
+        CHECK(result[3].Barrier.Barriers[0].OldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        CHECK(result[3].Barrier.Barriers[0].NewLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    TEST_CASE("WriteAfterReadIsExecutionOnly") {
+        std::vector<pass_barriers_t> passes(3);
+        AddResourceAccess(passes[0], storage(0, VK_ACCESS_SHADER_WRITE_BIT), true);
+        AddResourceAccess(passes[1], storage(0, VK_ACCESS_SHADER_READ_BIT), false);
+        AddResourceAccess(passes[2], storage(0, VK_ACCESS_SHADER_WRITE_BIT), true);
+
+        size_t num_events = 0;
+        const auto result = SynthesizeBarriers(passes, sequential_order(3), std::vector<bool>{ false }, num_events);
+        CHECK(result[0].Barrier.Empty());
+        REQUIRE(result[1].Barrier.Barriers.size() == 1);
+        CHECK(result[1].Barrier.Barriers[0].SrcAccess == VK_ACCESS_SHADER_WRITE_BIT);
+        CHECK(result[2].Barrier.SrcStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        CHECK(result[2].Barrier.DstStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        CHECK(result[2].Barrier.Barriers.empty());
+        CHECK(result[2].EventWait.Empty());
+    }
+
+    TEST_CASE("MergesBarriersAndSplitsDistantWaits") {
+        // 0 renders image 0, 1 renders image 1, 2 samples both: the wait on 0 can be split around 1
+        std::vector<pass_barriers_t> passes(3);
+        AddResourceAccess(passes[0], color_write(0), true);
+        AddResourceAccess(passes[1], color_write(1), true);
+        AddResourceAccess(passes[2], sampled(0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT), false);
+        AddResourceAccess(passes[2], sampled(1, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT), false);
+
+        size_t num_events = 0;
+        const auto result = SynthesizeBarriers(passes, sequential_order(3), std::vector<bool>{ true, true }, num_events);
+        CHECK(num_events == 1);
+        CHECK(result[0].SignalEvent == 0);
+        CHECK(result[0].SignalStages == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        CHECK(result[1].SignalEvent == submission_barriers_t::NoEvent);
+        REQUIRE(result[2].WaitEvents.size() == 1);
+        CHECK(result[2].WaitEvents[0] == 0);
+        REQUIRE(result[2].EventWait.Barriers.size() == 1);
+        CHECK(result[2].EventWait.Barriers[0].Resource == 0);
+        REQUIRE(result[2].Barrier.Barriers.size() == 1);
+        CHECK(result[2].Barrier.Barriers[0].Resource == 1);
+
+        // Both in one pipeline barrier when they're both right before
+        std::vector<pass_barriers_t> merged(2);
+        AddResourceAccess(merged[0], color_write(0), true);
+        AddResourceAccess(merged[0], color_write(1), true);
+        AddResourceAccess(merged[1], sampled(0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT), false);
+        AddResourceAccess(merged[1], sampled(1, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT), false);
+        const auto merged_result = SynthesizeBarriers(merged, sequential_order(2), std::vector<bool>{ true, true }, num_events);
+        CHECK(num_events == 0);
+        CHECK(merged_result[1].Barrier.Barriers.size() == 2);
+        CHECK(merged_result[1].EventWait.Empty());
+    }
+
+    TEST_CASE("EventWaitsUseAllStagesTheEventIsSetWith") {
+        // 0 writes buffer 0 in a compute shader and image 1 in a fragment shader, 2 and 3 each read one of them
+        std::vector<pass_barriers_t> passes(4);
+        AddResourceAccess(passes[0], storage(0, VK_ACCESS_SHADER_WRITE_BIT), true);
+        AddResourceAccess(passes[0], pipeline_barrier_t{ 1, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT }, true);
+        AddResourceAccess(passes[1], color_write(2), true);
+        AddResourceAccess(passes[2], storage(0, VK_ACCESS_SHADER_READ_BIT), false);
+        AddResourceAccess(passes[3], pipeline_barrier_t{ 1, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT }, false);
+
+        size_t num_events = 0;
+        const auto result = SynthesizeBarriers(passes, sequential_order(4), std::vector<bool>{ false, true, true }, num_events);
+        CHECK(num_events == 1);
+        const VkPipelineStageFlags write_stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        CHECK(result[0].SignalStages == write_stages);
+        for (const size_t waiter : { size_t(2), size_t(3) }) {
+            REQUIRE(result[waiter].WaitEvents.size() == 1);
+            CHECK(result[waiter].EventWait.SrcStages == write_stages);
+        }
+    }
+
+    TEST_CASE("LaterSubpassReadsJoinTheBarrierBeforeThePass") {
+        // 0 writes image 0 in a compute shader, then 1 and 2 sample it in one render pass: in a fragment shader, then a vertex shader
+        std::vector<pass_barriers_t> passes(3);
+        AddResourceAccess(passes[0], pipeline_barrier_t{ 0, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT }, true);
+        AddResourceAccess(passes[1], sampled(0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT), false);
+        AddResourceAccess(passes[2], sampled(0, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT), false);
+
+        size_t num_events = 0;
+        const auto result = SynthesizeBarriers(passes, sequential_order(3), std::vector<bool>{ true }, num_events, std::vector<size_t>{ 0, 1, 1 });
+        REQUIRE(result[1].Barrier.Barriers.size() == 1);
+        CHECK(result[1].Barrier.SrcStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        CHECK(result[1].Barrier.DstStages == (VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT));
+        CHECK(result[1].Barrier.Barriers[0].SrcAccess == VK_ACCESS_SHADER_WRITE_BIT);
+        CHECK(result[1].Barrier.Barriers[0].DstAccess == VK_ACCESS_SHADER_READ_BIT);
+        CHECK(result[2].Barrier.Empty());
+        CHECK(result[2].EventWait.Empty());
+    }
+
+    TEST_CASE("HistoryReadsSeeLastFrame") {
+        // 0 reads what 1 wrote last frame
+        std::vector<pass_barriers_t> passes(2);
+        pipeline_barrier_t history = sampled(0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        history.History = true;
+        AddResourceAccess(passes[0], history, false);
+        AddResourceAccess(passes[1], color_write(0), true);
+
+        size_t num_events = 0;
+        const auto result = SynthesizeBarriers(passes, sequential_order(2), std::vector<bool>{ true }, num_events);
+        REQUIRE(result[0].Barrier.Barriers.size() == 1);
+        CHECK(result[0].Barrier.Barriers[0].OldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        CHECK(result[0].Barrier.SrcStages == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        // The write has to wait for the history read, and transition back
+        REQUIRE(result[1].Barrier.Barriers.size() == 1);
+        CHECK(result[1].Barrier.SrcStages == VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        CHECK(result[1].Barrier.Barriers[0].SrcAccess == 0);
+        CHECK(result[1].Barrier.Barriers[0].NewLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    }
+}
+
+#endif //!VPSK_TESTING_ENABLED
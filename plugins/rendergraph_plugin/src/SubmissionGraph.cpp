@@ -0,0 +1,339 @@
+#include "SubmissionGraph.hpp"
+#include "easylogging++.h"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+    constexpr size_t invalid_submission = std::numeric_limits<size_t>::max();
+
+    inline size_t count_trailing_zeros(const uint64_t word) noexcept {
+#ifdef _MSC_VER
+        unsigned long result = 0;
+        _BitScanForward64(&result, word);
+        return static_cast<size_t>(result);
+#else
+        return static_cast<size_t>(__builtin_ctzll(word));
+#endif
+    }
+
+    // Calls fn with the index of each set bit in [words, words + num_words), in increasing order
+    template<typename Fn>
+    inline void for_each_set_bit(const uint64_t* words, const size_t num_words, Fn&& fn) {
+        for (size_t i = 0; i < num_words; ++i) {
+            uint64_t word = words[i];
+            while (word != 0) {
+                fn(i * 64 + count_trailing_zeros(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+}
+
+SubmissionGraph::SubmissionGraph(const size_t num_submissions) {
+    Reset(num_submissions);
+}
+
+void SubmissionGraph::Reset(const size_t num_submissions) {
+    numSubmissions = num_submissions;
+    wordsPerRow = (num_submissions + 63) / 64;
+    dependencies.assign(numSubmissions * wordsPerRow, 0);
+    mergeDependencies.assign(numSubmissions * wordsPerRow, 0);
+    reachable.assign(wordsPerRow, 0);
+    order.clear();
+    levels.assign(numSubmissions, invalid_submission);
+    numLevels = 0;
+}
+
+void SubmissionGraph::AddDependency(const size_t submission, const size_t dependency, const bool merge) {
+    if ((submission >= numSubmissions) || (dependency >= numSubmissions)) {
+        throw std::out_of_range("Submission index out of range for submission graph.");
+    }
+    if (submission == dependency) {
+        return;
+    }
+    setBit(dependencies, submission, dependency);
+    if (merge) {
+        setBit(mergeDependencies, submission, dependency);
+    }
+}
+
+void SubmissionGraph::Bake(const std::vector<size_t>& roots) {
+    order.clear();
+    levels.assign(numSubmissions, invalid_submission);
+    numLevels = 0;
+    pruneUnreachable(roots);
+    scheduleReachable();
+}
+
+size_t SubmissionGraph::NumSubmissions() const noexcept {
+    return numSubmissions;
+}
+
+bool SubmissionGraph::DependsOn(const size_t submission, const size_t dependency) const noexcept {
+    return testBit(dependencies, submission, dependency);
+}
+
+bool SubmissionGraph::MergeDependsOn(const size_t submission, const size_t dependency) const noexcept {
+    return testBit(mergeDependencies, submission, dependency);
+}
+
+bool SubmissionGraph::IsReachable(const size_t submission) const noexcept {
+    return (submission < numSubmissions) && ((reachable[submission / 64] >> (submission % 64)) & 1u);
+}
+
+const std::vector<size_t>& SubmissionGraph::Order() const noexcept {
+    return order;
+}
+
+size_t SubmissionGraph::Level(const size_t submission) const noexcept {
+    return submission < numSubmissions ? levels[submission] : invalid_submission;
+}
+
+size_t SubmissionGraph::NumLevels() const noexcept {
+    return numLevels;
+}
+
+const uint64_t* SubmissionGraph::row(const std::vector<uint64_t>& bits, const size_t submission) const noexcept {
+    return bits.data() + submission * wordsPerRow;
+}
+
+void SubmissionGraph::setBit(std::vector<uint64_t>& bits, const size_t submission, const size_t dependency) noexcept {
+    bits[submission * wordsPerRow + dependency / 64] |= uint64_t(1) << (dependency % 64);
+}
+
+bool SubmissionGraph::testBit(const std::vector<uint64_t>& bits, const size_t submission, const size_t dependency) const noexcept {
+    if ((submission >= numSubmissions) || (dependency >= numSubmissions)) {
+        return false;
+    }
+    return (row(bits, submission)[dependency / 64] >> (dependency % 64)) & 1u;
+}
+
+void SubmissionGraph::pruneUnreachable(const std::vector<size_t>& roots) {
+    std::fill(reachable.begin(), reachable.end(), 0);
+    std::vector<size_t> stack;
+    stack.reserve(numSubmissions);
+
+    for (const size_t root : roots) {
+        if (root >= numSubmissions) {
+            throw std::out_of_range("Root submission index out of range for submission graph.");
+        }
+        if (!IsReachable(root)) {
+            reachable[root / 64] |= uint64_t(1) << (root % 64);
+            stack.push_back(root);
+        }
+    }
+
+    while (!stack.empty()) {
+        const uint64_t* submission_dependencies = row(dependencies, stack.back());
+        stack.pop_back();
+        for (size_t i = 0; i < wordsPerRow; ++i) {
+            uint64_t unvisited = submission_dependencies[i] & ~reachable[i];
+            reachable[i] |= unvisited;
+            while (unvisited != 0) {
+                stack.push_back(i * 64 + count_trailing_zeros(unvisited));
+                unvisited &= unvisited - 1;
+            }
+        }
+    }
+}
+
+void SubmissionGraph::scheduleReachable() {
+    // Dependents of each submission, as offsets into one flat array
+    std::vector<size_t> remaining(numSubmissions, 0);
+    std::vector<size_t> dependent_offsets(numSubmissions + 1, 0);
+    size_t num_reachable = 0;
+    for_each_set_bit(reachable.data(), wordsPerRow, [&](const size_t submission) {
+        ++num_reachable;
+        for_each_set_bit(row(dependencies, submission), wordsPerRow, [&](const size_t dependency) {
+            ++remaining[submission];
+            ++dependent_offsets[dependency + 1];
+        });
+    });
+    for (size_t i = 0; i < numSubmissions; ++i) {
+        dependent_offsets[i + 1] += dependent_offsets[i];
+    }
+    std::vector<size_t> dependents(dependent_offsets.back());
+    {
+        std::vector<size_t> fill_offsets(dependent_offsets.begin(), dependent_offsets.end() - 1);
+        for_each_set_bit(reachable.data(), wordsPerRow, [&](const size_t submission) {
+            for_each_set_bit(row(dependencies, submission), wordsPerRow, [&](const size_t dependency) {
+                dependents[fill_offsets[dependency]++] = submission;
+            });
+        });
+    }
+
+    std::vector<size_t> ready;
+    for_each_set_bit(reachable.data(), wordsPerRow, [&](const size_t submission) {
+        if (remaining[submission] == 0) {
+            ready.push_back(submission);
+        }
+    });
+
+    // Position in order of the latest scheduled dependency of each submission
+    std::vector<size_t> latest_dependency(numSubmissions, invalid_submission);
+    std::vector<size_t> dependency_levels(numSubmissions, 0);
+    order.reserve(num_reachable);
+
+    while (!ready.empty()) {
+        const size_t position = order.size();
+        const size_t previous = order.empty() ? invalid_submission : order.back();
+
+        size_t best = 0;
+        bool best_merges = false;
+        size_t best_distance = 0;
+        for (size_t i = 0; i < ready.size(); ++i) {
+            const size_t candidate = ready[i];
+            const bool merges = (previous != invalid_submission) && MergeDependsOn(candidate, previous);
+            const size_t distance = (latest_dependency[candidate] == invalid_submission) ? position + 1 : position - latest_dependency[candidate];
+            bool better = false;
+            if (i == 0) {
+                better = true;
+            }
+            else if (merges != best_merges) {
+                better = merges;
+            }
+            else if (distance != best_distance) {
+                better = distance > best_distance;
+            }
+            else {
+                better = candidate < ready[best];
+            }
+
+            if (better) {
+                best = i;
+                best_merges = merges;
+                best_distance = distance;
+            }
+        }
+
+        const size_t submission = ready[best];
+        ready[best] = ready.back();
+        ready.pop_back();
+
+        order.push_back(submission);
+        levels[submission] = dependency_levels[submission];
+        numLevels = std::max(numLevels, levels[submission] + 1);
+
+        for (size_t i = dependent_offsets[submission]; i < dependent_offsets[submission + 1]; ++i) {
+            const size_t dependent = dependents[i];
+            latest_dependency[dependent] = position;
+            dependency_levels[dependent] = std::max(dependency_levels[dependent], levels[submission] + 1);
+            if (--remaining[dependent] == 0) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+
+    if (order.size() != num_reachable) {
+        LOG(ERROR) << "Found a cycle in submission dependencies: " << num_reachable - order.size() << " submissions can never be scheduled.";
+        throw std::logic_error("Cyclic dependency between submissions.");
+    }
+}
+
+#ifdef VPSK_TESTING_ENABLED
+#include <chrono>
+#include <random>
+
+TEST_SUITE("SubmissionGraph") {
+    size_t position_of(const std::vector<size_t>& order, const size_t submission) {
+        return size_t(std::find(order.begin(), order.end(), submission) - order.begin());
+    }
+
+    TEST_CASE("PrunesSubmissionsTheBackbufferDoesntNeed") {
+        SubmissionGraph graph(5);
+        // 4 writes the backbuffer, reading 2 which reads 0. 1 and 3 produce nothing 4 uses.
+        graph.AddDependency(4, 2);
+        graph.AddDependency(2, 0);
+        graph.AddDependency(3, 1);
+        graph.AddDependency(2, 2);
+        graph.Bake({ 4 });
+        CHECK(graph.IsReachable(0));
+        CHECK_FALSE(graph.IsReachable(1));
+        CHECK(graph.IsReachable(2));
+        CHECK_FALSE(graph.IsReachable(3));
+        CHECK(graph.Order() == std::vector<size_t>({ 0, 2, 4 }));
+        CHECK_FALSE(graph.DependsOn(2, 2));
+        CHECK(graph.Level(4) == 2);
+        CHECK(graph.NumLevels() == 3);
+    }
+
+    TEST_CASE("SpreadsProducersAndConsumersApart") {
+        SubmissionGraph graph(4);
+        // 3 reads 1 and 2, 2 reads 0: 1 is independent work that fits between 0 and 2
+        graph.AddDependency(3, 1);
+        graph.AddDependency(3, 2);
+        graph.AddDependency(2, 0);
+        graph.Bake({ 3 });
+        CHECK(graph.Order() == std::vector<size_t>({ 0, 1, 2, 3 }));
+        CHECK(graph.Level(0) == 0);
+        CHECK(graph.Level(1) == 0);
+        CHECK(graph.Level(2) == 1);
+        CHECK(graph.Level(3) == 2);
+    }
+
+    TEST_CASE("KeepsMergeDependenciesAdjacent") {
+        SubmissionGraph graph(4);
+        // 1 reads attachments 0 wrote, and should follow it directly even though 2 doesn't depend on anything
+        graph.AddDependency(1, 0, true);
+        graph.AddDependency(3, 1);
+        graph.AddDependency(3, 2);
+        graph.Bake({ 3 });
+        CHECK(graph.MergeDependsOn(1, 0));
+        CHECK_FALSE(graph.MergeDependsOn(3, 1));
+        CHECK(graph.Order() == std::vector<size_t>({ 0, 1, 2, 3 }));
+    }
+
+    TEST_CASE("ThrowsOnCycles") {
+        SubmissionGraph graph(3);
+        graph.AddDependency(2, 1);
+        graph.AddDependency(1, 0);
+        graph.AddDependency(0, 1);
+        CHECK_THROWS(graph.Bake({ 2 }));
+        // Cycles the roots don't depend on are pruned before they matter
+        SubmissionGraph pruned(3);
+        pruned.AddDependency(1, 0);
+        pruned.AddDependency(0, 1);
+        CHECK_NOTHROW(pruned.Bake({ 2 }));
+        CHECK(pruned.Order() == std::vector<size_t>({ 2 }));
+        CHECK_THROWS(pruned.AddDependency(3, 0));
+    }
+
+    TEST_CASE("LargeGraphsBakeDeterministically") {
+        constexpr size_t num_submissions = 512;
+        std::mt19937 rng(1234);
+        SubmissionGraph graph(num_submissions);
+        for (size_t i = 1; i < num_submissions; ++i) {
+            const size_t num_dependencies = 1 + rng() % 4;
+            for (size_t j = 0; j < num_dependencies; ++j) {
+                graph.AddDependency(i, rng() % i, (rng() % 8) == 0);
+            }
+        }
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        graph.Bake({ num_submissions - 1 });
+        auto end = std::chrono::high_resolution_clock::now();
+        const std::vector<size_t> first_order = graph.Order();
+
+        bool dependencies_first = true;
+        for (size_t i = 0; i < first_order.size(); ++i) {
+            for (size_t j = i; j < first_order.size(); ++j) {
+                dependencies_first &= !graph.DependsOn(first_order[i], first_order[j]);
+            }
+            dependencies_first &= graph.Level(first_order[i]) < graph.NumLevels();
+        }
+        CHECK(dependencies_first);
+        CHECK(position_of(first_order, num_submissions - 1) == first_order.size() - 1);
+
+        graph.Bake({ num_submissions - 1 });
+        CHECK(graph.Order() == first_order);
+        MESSAGE("Baked " << first_order.size() << " of " << num_submissions << " submissions in " << std::chrono::duration<double, std::micro>(end - begin).count() << "us");
+    }
+}
+#endif // VPSK_TESTING_ENABLED
@@ -0,0 +1,352 @@
+#pragma once
+#ifndef FLAT_MAP_CONTAINER_CLASS_HPP
+#define FLAT_MAP_CONTAINER_CLASS_HPP
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+    Sorted-vector associative containers: far more cache-friendly than node-based maps for the small to medium sized,
+    read-mostly lookup tables we keep all over the place. Single inserts are O(n), so for building a container from
+    scratch either construct it from a (possibly unsorted) range in one go, which is O(n log n), or queue inserts with
+    defer_insert() and merge them all at once with commit(). Deferred inserts aren't visible until committed.
+
+    When duplicate keys are inserted, the first one inserted wins: this holds for bulk construction and commit() too.
+*/
+
+namespace flat_container_detail {
+
+    // Keys that can be searched by comparing raw bits with <, so the tail of a search can be done as a linear count
+    template<typename Key, typename Compare>
+    constexpr bool is_fast_search_key_v = (std::is_integral_v<Key> || std::is_enum_v<Key> || std::is_pointer_v<Key>) &&
+        (std::is_same_v<Compare, std::less<Key>> || std::is_same_v<Compare, std::less<>>);
+
+    template<typename Key>
+    constexpr auto search_bits(const Key& key) noexcept {
+        if constexpr (std::is_pointer_v<Key>) {
+            return reinterpret_cast<uintptr_t>(key);
+        }
+        else if constexpr (std::is_enum_v<Key>) {
+            return static_cast<std::underlying_type_t<Key>>(key);
+        }
+        else {
+            return key;
+        }
+    }
+
+    // Branchless lower_bound: the comparison just selects the next base (compiled to a conditional move), so we
+    // don't pay for mispredicted branches on every level. For integral and pointer keys the last few levels are
+    // replaced by counting the elements less than the key, which the compiler can vectorize.
+    template<typename Iter, typename Key, typename KeyOf, typename Compare>
+    Iter lower_bound(Iter first, Iter last, const Key& key, KeyOf key_of, const Compare& comp) {
+        using key_type = std::decay_t<decltype(key_of(*first))>;
+        constexpr bool fast_keys = is_fast_search_key_v<key_type, Compare>;
+        constexpr size_t linear_threshold = fast_keys ? 16 : 1;
+
+        size_t length = static_cast<size_t>(last - first);
+        if (length == 0) {
+            return first;
+        }
+
+        while (length > linear_threshold) {
+            const size_t half = length / 2;
+            first = comp(key_of(first[half]), key) ? first + half : first;
+            length -= half;
+        }
+
+        size_t count = 0;
+        if constexpr (fast_keys) {
+            const auto key_bits = search_bits(static_cast<key_type>(key));
+            for (size_t i = 0; i < length; ++i) {
+                count += static_cast<size_t>(search_bits(key_of(first[i])) < key_bits);
+            }
+        }
+        else {
+            for (size_t i = 0; i < length; ++i) {
+                count += static_cast<size_t>(comp(key_of(first[i]), key));
+            }
+        }
+
+        return first + count;
+    }
+
+    template<typename Key>
+    struct identity_key {
+        const Key& operator()(const Key& value) const noexcept {
+            return value;
+        }
+    };
+
+    template<typename Pair>
+    struct pair_key {
+        const typename Pair::first_type& operator()(const Pair& value) const noexcept {
+            return value.first;
+        }
+    };
+
+    template<typename Key, typename Value, typename KeyOf, typename Compare, typename Allocator>
+    class flat_tree {
+    public:
+        using key_type = Key;
+        using value_type = Value;
+        using key_compare = Compare;
+        using allocator_type = Allocator;
+        using container_type = std::vector<Value, Allocator>;
+        using size_type = typename container_type::size_type;
+        using difference_type = typename container_type::difference_type;
+        using reference = value_type&;
+        using const_reference = const value_type&;
+        using pointer = typename container_type::pointer;
+        using const_pointer = typename container_type::const_pointer;
+        using iterator = typename container_type::iterator;
+        using const_iterator = typename container_type::const_iterator;
+        using reverse_iterator = typename container_type::reverse_iterator;
+        using const_reverse_iterator = typename container_type::const_reverse_iterator;
+
+        flat_tree() = default;
+        explicit flat_tree(const Compare& comp) : keyCompare(comp) {}
+
+        template<typename InputIt>
+        flat_tree(InputIt first, InputIt last, const Compare& comp = Compare()) : keyCompare(comp) {
+            assign(first, last);
+        }
+
+        flat_tree(std::initializer_list<value_type> init, const Compare& comp = Compare()) : keyCompare(comp) {
+            assign(init.begin(), init.end());
+        }
+
+        // Replaces contents with the given, possibly unsorted, range in O(n log n)
+        template<typename InputIt>
+        void assign(InputIt first, InputIt last) {
+            data.assign(first, last);
+            pending.clear();
+            sortAndUnique(data);
+        }
+
+        iterator begin() noexcept { return data.begin(); }
+        const_iterator begin() const noexcept { return data.begin(); }
+        const_iterator cbegin() const noexcept { return data.cbegin(); }
+        iterator end() noexcept { return data.end(); }
+        const_iterator end() const noexcept { return data.end(); }
+        const_iterator cend() const noexcept { return data.cend(); }
+        reverse_iterator rbegin() noexcept { return data.rbegin(); }
+        const_reverse_iterator rbegin() const noexcept { return data.rbegin(); }
+        const_reverse_iterator crbegin() const noexcept { return data.crbegin(); }
+        reverse_iterator rend() noexcept { return data.rend(); }
+        const_reverse_iterator rend() const noexcept { return data.rend(); }
+        const_reverse_iterator crend() const noexcept { return data.crend(); }
+
+        bool empty() const noexcept { return data.empty(); }
+        size_type size() const noexcept { return data.size(); }
+        size_type max_size() const noexcept { return data.max_size(); }
+        size_type capacity() const noexcept { return data.capacity(); }
+        void reserve(const size_type new_capacity) { data.reserve(new_capacity); }
+        void shrink_to_fit() { data.shrink_to_fit(); }
+        void clear() noexcept { data.clear(); pending.clear(); }
+        key_compare key_comp() const { return keyCompare; }
+
+        template<typename...Args>
+        std::pair<iterator, bool> emplace(Args&&...args) {
+            value_type value(std::forward<Args>(args)...);
+            return insert(std::move(value));
+        }
+
+        std::pair<iterator, bool> insert(const value_type& value) {
+            return insertUnique(value);
+        }
+
+        std::pair<iterator, bool> insert(value_type&& value) {
+            return insertUnique(std::move(value));
+        }
+
+        // Inserts the range in O(n + k log k), instead of k separate O(n) inserts. Also commits any deferred inserts.
+        template<typename InputIt>
+        void insert(InputIt first, InputIt last) {
+            pending.insert(pending.end(), first, last);
+            commit();
+        }
+
+        // Queues an insert that becomes visible on the next call to commit()
+        template<typename...Args>
+        void defer_insert(Args&&...args) {
+            pending.emplace_back(std::forward<Args>(args)...);
+        }
+
+        size_type pending_size() const noexcept {
+            return pending.size();
+        }
+
+        // Sorts deferred inserts, and merges them into the container in linear time
+        void commit() {
+            if (pending.empty()) {
+                return;
+            }
+
+            const size_type old_size = data.size();
+            // Keep the first of any duplicates in pending, before they can get mixed in with existing entries
+            sortAndUnique(pending);
+            data.insert(data.end(), std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.end()));
+            pending.clear();
+
+            auto value_comp = valueCompare();
+            // Stable: existing elements precede newly inserted ones with equal keys, so unique() keeps the existing ones
+            std::inplace_merge(data.begin(), data.begin() + old_size, data.end(), value_comp);
+            data.erase(std::unique(data.begin(), data.end(), [&value_comp](const value_type& lhs, const value_type& rhs) {
+                return !value_comp(lhs, rhs) && !value_comp(rhs, lhs);
+            }), data.end());
+        }
+
+        iterator lower_bound(const key_type& key) {
+            return flat_container_detail::lower_bound(data.begin(), data.end(), key, KeyOf(), keyCompare);
+        }
+
+        const_iterator lower_bound(const key_type& key) const {
+            return flat_container_detail::lower_bound(data.cbegin(), data.cend(), key, KeyOf(), keyCompare);
+        }
+
+        iterator upper_bound(const key_type& key) {
+            iterator iter = lower_bound(key);
+            return ((iter != end()) && !keyCompare(key, KeyOf()(*iter))) ? iter + 1 : iter;
+        }
+
+        const_iterator upper_bound(const key_type& key) const {
+            const_iterator iter = lower_bound(key);
+            return ((iter != end()) && !keyCompare(key, KeyOf()(*iter))) ? iter + 1 : iter;
+        }
+
+        iterator find(const key_type& key) {
+            iterator iter = lower_bound(key);
+            return ((iter != end()) && !keyCompare(key, KeyOf()(*iter))) ? iter : end();
+        }
+
+        const_iterator find(const key_type& key) const {
+            const_iterator iter = lower_bound(key);
+            return ((iter != end()) && !keyCompare(key, KeyOf()(*iter))) ? iter : end();
+        }
+
+        size_type count(const key_type& key) const {
+            return find(key) != end() ? 1 : 0;
+        }
+
+        bool contains(const key_type& key) const {
+            return find(key) != end();
+        }
+
+        iterator erase(const_iterator pos) {
+            return data.erase(pos);
+        }
+
+        iterator erase(const_iterator first, const_iterator last) {
+            return data.erase(first, last);
+        }
+
+        size_type erase(const key_type& key) {
+            const_iterator iter = find(key);
+            if (iter == cend()) {
+                return 0;
+            }
+            data.erase(iter);
+            return 1;
+        }
+
+        void swap(flat_tree& other) noexcept {
+            using std::swap;
+            swap(data, other.data);
+            swap(pending, other.pending);
+            swap(keyCompare, other.keyCompare);
+        }
+
+    protected:
+
+        auto valueCompare() const {
+            return [comp = keyCompare](const value_type& lhs, const value_type& rhs) {
+                return comp(KeyOf()(lhs), KeyOf()(rhs));
+            };
+        }
+
+        void sortAndUnique(container_type& container) {
+            auto value_comp = valueCompare();
+            std::stable_sort(container.begin(), container.end(), value_comp);
+            container.erase(std::unique(container.begin(), container.end(), [&value_comp](const value_type& lhs, const value_type& rhs) {
+                return !value_comp(lhs, rhs) && !value_comp(rhs, lhs);
+            }), container.end());
+        }
+
+        template<typename V>
+        std::pair<iterator, bool> insertUnique(V&& value) {
+            iterator iter = lower_bound(KeyOf()(value));
+            if ((iter != end()) && !keyCompare(KeyOf()(value), KeyOf()(*iter))) {
+                return { iter, false };
+            }
+            return { data.insert(iter, std::forward<V>(value)), true };
+        }
+
+        container_type data;
+        container_type pending;
+        key_compare keyCompare;
+
+    };
+
+}
+
+template<typename Key, typename Compare = std::less<Key>, typename Allocator = std::allocator<Key>>
+class flat_set : public flat_container_detail::flat_tree<Key, Key, flat_container_detail::identity_key<Key>, Compare, Allocator> {
+    using base_t = flat_container_detail::flat_tree<Key, Key, flat_container_detail::identity_key<Key>, Compare, Allocator>;
+public:
+    using value_compare = Compare;
+    using base_t::base_t;
+};
+
+template<typename Key, typename T, typename Compare = std::less<Key>, typename Allocator = std::allocator<std::pair<Key, T>>>
+class flat_map : public flat_container_detail::flat_tree<Key, std::pair<Key, T>, flat_container_detail::pair_key<std::pair<Key, T>>, Compare, Allocator> {
+    using base_t = flat_container_detail::flat_tree<Key, std::pair<Key, T>, flat_container_detail::pair_key<std::pair<Key, T>>, Compare, Allocator>;
+public:
+    using mapped_type = T;
+    using typename base_t::key_type;
+    using typename base_t::value_type;
+    using typename base_t::iterator;
+    using base_t::base_t;
+
+    T& operator[](const key_type& key) {
+        iterator iter = this->lower_bound(key);
+        if ((iter == this->end()) || this->keyCompare(key, iter->first)) {
+            iter = this->data.emplace(iter, key, T());
+        }
+        return iter->second;
+    }
+
+    T& at(const key_type& key) {
+        iterator iter = this->find(key);
+        if (iter == this->end()) {
+            throw std::out_of_range("Key not found in flat_map");
+        }
+        return iter->second;
+    }
+
+    const T& at(const key_type& key) const {
+        auto iter = this->find(key);
+        if (iter == this->end()) {
+            throw std::out_of_range("Key not found in flat_map");
+        }
+        return iter->second;
+    }
+
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj) {
+        iterator iter = this->lower_bound(key);
+        if ((iter == this->end()) || this->keyCompare(key, iter->first)) {
+            return { this->data.emplace(iter, key, std::forward<M>(obj)), true };
+        }
+        iter->second = std::forward<M>(obj);
+        return { iter, false };
+    }
+
+};
+
+#endif //!FLAT_MAP_CONTAINER_CLASS_HPP
@@ -5,13 +5,15 @@
 #include "Allocation.hpp"
 #include "AllocationRequirements.hpp"
 #include "ResourceTypes.hpp"
-#include <unordered_set>
-#include <unordered_map>
+#include "ResourceTable.hpp"
+#include "ResourcePacking.hpp"
 #include <memory>
 #include <string>
 #include <variant>
 #include <vulkan/vulkan.h>
 #include <mutex>
+#include <atomic>
+#include <vector>
 
 class ResourceContext {
     ResourceContext(const ResourceContext&) = delete;
@@ -29,16 +31,43 @@ public:
     VulkanResource* CreateNamedImage(const char* name, const VkImageCreateInfo* info, const VkImageViewCreateInfo* view_info, const size_t num_data, const gpu_image_resource_data_t* initial_data, const memory_type _memory_type, void* user_data = nullptr);
     void SetImageData(VulkanResource* image, const size_t num_data, const gpu_image_resource_data_t* data);
     VulkanResource* CreateSampler(const VkSamplerCreateInfo* info, void* user_data = nullptr);
+    // Batched creation: DEVICE_LOCAL resources are sub-allocated from shared memory blocks, and all initial data is
+    // packed into a single staging buffer uploaded with one set of commands. view_infos, num_data, initial_data and 
+    // user_data may be nullptr, as may individual entries. results must have room for num_buffers/num_images entries.
+    void CreateBuffers(const size_t num_buffers, const VkBufferCreateInfo* infos, const VkBufferViewCreateInfo* const* view_infos, const size_t* num_data, 
+        const gpu_resource_data_t* const* initial_data, const memory_type _memory_type, void* const* user_data, VulkanResource** results);
+    void CreateImages(const size_t num_images, const VkImageCreateInfo* infos, const VkImageViewCreateInfo* const* view_infos, const size_t* num_data,
+        const gpu_image_resource_data_t* const* initial_data, const memory_type _memory_type, void* const* user_data, VulkanResource** results);
+    // Creates DEVICE_LOCAL buffers and images that are only used for part of a frame. Resources whose pass lifetimes 
+    // don't overlap alias the same memory, so contents don't persist between uses: images must be transitioned from 
+    // VK_IMAGE_LAYOUT_UNDEFINED at the start of each use.
+    void CreateTransientResources(const size_t num_resources, const transient_resource_info_t* infos, VulkanResource** results);
     VulkanResource* CreateResourceCopy(VulkanResource* src);
     void CopyResource(VulkanResource* src, VulkanResource* dest);
+    // Invalidates the resource's handle immediately, but the Vulkan objects and memory are only destroyed (and the
+    // handle's slot only re-used) once the current frame has completed: see CompleteFrame()
     void DestroyResource(VulkanResource* resource);
 
     void* MapResourceMemory(VulkanResource* resource, size_t size = 0, size_t offset = 0);
     void UnmapResourceMemory(VulkanResource* resource);
+    // Maps a host-visible resource once: the returned pointer stays valid until the resource is destroyed. Prefer writing
+    // through it with StreamingMemcpy(), and call FlushMappedRange() after writing to HOST_VISIBLE (non-coherent) resources.
+    void* PersistentlyMapResource(VulkanResource* resource);
+    // Queues a range of a mapped resource to be flushed: size of 0 flushes the whole resource. No-op for coherent memory.
+    void FlushMappedRange(VulkanResource* resource, size_t offset = 0, size_t size = 0);
+    // Flushes all queued ranges with a single call. Call once per frame, after writes and before submitting work that reads them.
+    void FlushMappedRanges();
 
-    // Call at start of frame
+    // Call at start of frame: submits recorded transfers and retires completed ones, without blocking
     void Update();
-    // Call at end of frame
+    // Index of the frame currently being recorded: incremented by Update()
+    uint64_t CurrentFrame() const noexcept;
+    // Call once the fence for a frame has signalled: resources destroyed during or before that frame are destroyed in
+    // one batch. Until this is first called, frames are assumed complete SlotRetirementLatency frames after recording.
+    void CompleteFrame(const uint64_t frame);
+    // Blocks until all submitted transfers are complete
+    void WaitForTransfers();
+    // Call at end of frame: frees staging buffers used by completed transfers
     void FlushStagingBuffers();
 
     void Destroy();
@@ -47,33 +76,57 @@ private:
     void setBufferInitialDataHostOnly(VulkanResource * resource, const size_t num_data, const gpu_resource_data_t * initial_data, vpr::Allocation& alloc, memory_type _memory_type);
     void setBufferInitialDataUploadBuffer(VulkanResource* resource, const size_t num_data, const gpu_resource_data_t* initial_data, vpr::Allocation& alloc);
     void setImageInitialData(VulkanResource* resource, const size_t num_data, const gpu_image_resource_data_t* initial_data, vpr::Allocation & alloc);
+    void bindSharedBlocks(const std::vector<uint32_t>& indices, const packing_plan_t& plan, const memory_type _memory_type);
+    void releaseSharedBlock(const uint32_t shared_block);
+    void unmapPersistent(const uint32_t idx);
+    VkMappedMemoryRange alignedMappedRange(const uint32_t idx, const size_t offset, const size_t size);
     vpr::AllocationRequirements getAllocReqs(memory_type _memory_type) const noexcept;
+    vpr::AllocationType imageAllocationType(const VkImageCreateInfo* info) const;
     VkFormatFeatureFlags featureFlagsFromUsage(const VkImageUsageFlags flags) const noexcept;
 
 
-    std::unordered_set<std::unique_ptr<VulkanResource>> resources;
-    using resource_iter_t = decltype(resources)::iterator;
+    bool retireResource(const resource_handle_t handle);
+    void processDestructions(const uint64_t completed_frame);
+    void destroyResource(const uint32_t idx);
+    void destroyBuffer(const uint32_t idx);
+    void destroyImage(const uint32_t idx);
+    void destroySampler(const uint32_t idx);
+    uint32_t resourceIndex(const VulkanResource* resource) const;
 
-    void destroyResource(resource_iter_t iter);
-    void destroyBuffer(resource_iter_t iter);
-    void destroyImage(resource_iter_t iter);
-    void destroySampler(resource_iter_t iter);
+    // Number of frames a destroyed resource's slot is kept out of circulation, so handles aren't re-used while in use
+    constexpr static uint64_t SlotRetirementLatency = 3;
+    ResourceTable resourceTable;
+    std::atomic<uint64_t> frameIndex{ SlotRetirementLatency };
+    std::atomic<uint64_t> completedFrame{ 0 };
+    std::atomic<bool> frameCompletionReported{ false };
 
+    struct pending_destruction_t {
+        uint32_t Index;
+        uint64_t Frame;
+    };
 
-    struct infoStorage {
-        std::unordered_map<VulkanResource*, memory_type> resourceMemoryType;
-        std::unordered_map<VulkanResource*, VkBufferCreateInfo> bufferInfos;
-        std::unordered_map<VulkanResource*, VkBufferViewCreateInfo> bufferViewInfos;
-        std::unordered_map<VulkanResource*, VkImageCreateInfo> imageInfos;
-        std::unordered_map<VulkanResource*, VkImageViewCreateInfo> imageViewInfos;
-        std::unordered_map<VulkanResource*, VkSamplerCreateInfo> samplerInfos;
-    } resourceInfos;
-
-    std::unordered_map<VulkanResource*, std::string> resourceNames;
-    std::unordered_map<VulkanResource*, vpr::Allocation> resourceAllocations;
-    std::unordered_map<VulkanResource*, VkMappedMemoryRange> mappedRanges;
-    std::unordered_map<VulkanResource*, const void*> referencedLoaderAddresses;
+    // Retired resources whose Vulkan objects can't be destroyed until the frame they were retired in completes
+    std::vector<pending_destruction_t> pendingDestructions;
+    std::mutex destructionMutex;
     std::unique_ptr<vpr::Allocator> allocator;
+
+    struct shared_memory_block_t {
+        vpr::Allocation Allocation;
+        // Number of live resources bound to this block: memory is freed once it hits zero
+        uint32_t NumResources{ 0 };
+    };
+
+    // Upper limit on size of blocks batched resources are sub-allocated from. Larger resources get a block of their own.
+    constexpr static VkDeviceSize MaxSharedBlockSize = 64u * 1024u * 1024u;
+    std::vector<shared_memory_block_t> sharedBlocks;
+    std::vector<uint32_t> freeSharedBlocks;
+    std::mutex sharedBlockMutex;
+
+    // Ranges of non-coherent persistently mapped memory written this frame
+    std::vector<VkMappedMemoryRange> pendingFlushes;
+    std::mutex flushMutex;
+    VkDeviceSize nonCoherentAtomSize{ 1 };
+    // Guards staging buffer containers: resource storage is managed by resourceTable
     std::mutex containerMutex;
     const vpr::Device* device;
 
@@ -9,6 +9,7 @@ constexpr static uint32_t RESOURCE_CONTEXT_API_ID = 0x284b106d;
 struct VulkanResource;
 struct gpu_resource_data_t;
 struct gpu_image_resource_data_t;
+struct transient_resource_info_t;
 
 struct ResourceContext_API {
     VulkanResource* (*CreateBuffer)(const struct VkBufferCreateInfo* info, const struct VkBufferViewCreateInfo* view_info, const size_t num_data, const gpu_resource_data_t* initial_data, const uint32_t _memory_type, void* user_data);
@@ -23,6 +24,7 @@ struct ResourceContext_API {
     void (*CopyResource)(VulkanResource* src, VulkanResource* dst);
     // Unlike previous, creates a copy
     VulkanResource* (*CreateResourceCopy)(VulkanResource* src);
+    // Handle is invalid immediately: the underlying objects are destroyed once the current frame completes (see CompleteFrame)
     void (*DestroyResource)(VulkanResource* resource);
     void (*CompletePendingTransfers)(void);
     void (*FlushStagingBuffers)(void);
@@ -36,6 +38,33 @@ struct ResourceContext_API {
     void (*LoadFile)(const char* file_type, const char* file_name, void* requesting_object_ptr, signal_function_t signal_fn, void* user_data);
     void (*UnloadFile)(const char* file_type, const char* fname);
     uint64_t (*GetVkDevice)();
+    // Transfers are submitted in batches, identified by an increasing ID. Retrieve the ID after creating or updating a resource:
+    // the data is on the device once that batch completes. Callbacks are invoked from whichever thread retires the batch.
+    uint64_t (*GetTransferBatchID)(void);
+    bool (*TransferBatchComplete)(uint64_t batch_id);
+    void (*AddTransferCompleteCallback)(uint64_t batch_id, void* requesting_object_ptr, signal_function_t signal_fn, void* user_data);
+    // Batched creation, preferable when creating many resources at once (e.g. loading a scene). DEVICE_LOCAL resources share memory
+    // blocks, and all initial data is uploaded through one staging buffer. Arrays are indexed per-resource: view_infos, num_data, 
+    // initial_data and user_data may be nullptr (as may their entries). Created resources are written to results.
+    void (*CreateBuffers)(const size_t num_buffers, const struct VkBufferCreateInfo* infos, const struct VkBufferViewCreateInfo* const* view_infos, const size_t* num_data,
+        const gpu_resource_data_t* const* initial_data, const uint32_t _memory_type, void* const* user_data, VulkanResource** results);
+    void (*CreateImages)(const size_t num_images, const struct VkImageCreateInfo* infos, const struct VkImageViewCreateInfo* const* view_infos, const size_t* num_data,
+        const gpu_image_resource_data_t* const* initial_data, const uint32_t _memory_type, void* const* user_data, VulkanResource** results);
+    // Declare all transient resources for a frame (e.g. render targets of a post-processing chain) in one call, with the range
+    // of passes each is used in: resources with disjoint lifetimes share memory. Destroy them via DestroyResource as usual.
+    void (*CreateTransientResources)(const size_t num_resources, const transient_resource_info_t* infos, VulkanResource** results);
+    // Persistent mapping for host-visible resources updated frequently (e.g. per-frame uniform or instance data). The returned
+    // pointer is valid until the resource is destroyed. After writing, queue the written range with FlushMappedRange (size 0 
+    // being the whole resource), then call FlushMappedRanges once per frame before submitting work that reads the data.
+    void* (*PersistentlyMapResource)(VulkanResource* resource);
+    void (*FlushMappedRange)(VulkanResource* resource, size_t offset, size_t size);
+    void (*FlushMappedRanges)(void);
+    // memcpy using non-temporal stores, for writing to mapped (write-combined) memory
+    void (*StreamingMemcpy)(void* dst, const void* src, size_t size);
+    // Frame currently being recorded. Store it alongside a frame's fence, and pass it to CompleteFrame once the fence has
+    // signalled: resources destroyed in or before that frame are then freed, without needing to wait for the device to idle.
+    uint64_t (*GetCurrentFrame)(void);
+    void (*CompleteFrame)(uint64_t frame);
 };
 
 #endif //!RESOURCE_CONTEXT_PLUGIN_API_HPP
@@ -12,6 +12,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
+#include "FlatMap.hpp"
 
     using FactoryFunctor = void*(*)(const char* fname, void* user_data);
     using DeleteFunctor = void(*)(void* obj_instance);
@@ -53,8 +54,9 @@
         void workerFunction();
         void waitForPendingRequest(const std::string& absolute_file_path, SignalFunctor signal);
 
-        std::unordered_map<std::string, FactoryFunctor> factories;
-        std::unordered_map<std::string, DeleteFunctor> deleters;
+        // Only a handful of file types are ever registered, but these are hit for every load and unload
+        flat_map<std::string, FactoryFunctor> factories;
+        flat_map<std::string, DeleteFunctor> deleters;
         std::unordered_map<std::string, ResourceData> resources;
         std::unordered_set<std::string> pendingResources;
         std::list<loadRequest> requests;
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef RESOURCE_CONTEXT_RESOURCE_PACKING_HPP
+#define RESOURCE_CONTEXT_RESOURCE_PACKING_HPP
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+    CPU-side planning for batched resource creation. Kept free of any Vulkan calls, so that the
+    decisions made (which block a resource lands in, at what offset) can be tested without a device.
+*/
+
+struct packing_request_t {
+    uint64_t Size{ 0 };
+    uint64_t Alignment{ 1 };
+    // Requests with differing keys never share a block (e.g. memory type bits, linear vs optimal tiling)
+    uint64_t GroupKey{ 0 };
+};
+
+struct packed_range_t {
+    uint32_t Block{ 0 };
+    uint64_t Offset{ 0 };
+    // Size of the request placed here
+    uint64_t Size{ 0 };
+};
+
+struct packing_block_t {
+    uint64_t Size{ 0 };
+    // Largest alignment of any range in the block: the block itself must be allocated with this alignment
+    uint64_t Alignment{ 1 };
+    uint64_t GroupKey{ 0 };
+};
+
+struct packing_plan_t {
+    // One entry per request, in the same order as the requests
+    std::vector<packed_range_t> Ranges;
+    std::vector<packing_block_t> Blocks;
+};
+
+// Packs requests into as few blocks as possible. Requests are placed in order of decreasing alignment, then
+// decreasing size, which keeps padding to a minimum. A max_block_size of 0 means blocks are unbounded: requests
+// larger than max_block_size get a block of their own.
+packing_plan_t PlanResourcePacking(const packing_request_t* requests, const size_t num_requests, const uint64_t max_block_size);
+
+struct transient_packing_request_t {
+    packing_request_t Request;
+    // Inclusive range of passes (or any other monotonic timeline) the resource is used in
+    uint32_t FirstUse{ 0 };
+    uint32_t LastUse{ 0 };
+};
+
+// Aliases transient resources with disjoint lifetimes onto the same memory. Lifetimes form an interval graph, so
+// greedily colouring requests in order of first use yields the minimum number of "slots" (colours): each slot is
+// sized to its largest occupant, and slots are then laid out one after another in a single block per group.
+// Resources whose lifetimes overlap are guaranteed to occupy disjoint ranges of memory.
+packing_plan_t PlanTransientAliasing(const transient_packing_request_t* requests, const size_t num_requests);
+
+#endif //!RESOURCE_CONTEXT_RESOURCE_PACKING_HPP
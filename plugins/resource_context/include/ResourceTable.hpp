@@ -0,0 +1,210 @@
+#pragma once
+#ifndef RESOURCE_CONTEXT_RESOURCE_TABLE_HPP
+#define RESOURCE_CONTEXT_RESOURCE_TABLE_HPP
+#include "Allocation.hpp"
+#include "ResourceTypes.hpp"
+#include <vulkan/vulkan.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using resource_handle_t = uint64_t;
+
+// Where a resource's memory is within its allocation's VkDeviceMemory: resources sharing a block each have their own range of it
+struct resource_memory_range_t {
+    VkDeviceSize Offset{ 0 };
+    VkDeviceSize Size{ 0 };
+};
+
+union resource_info_storage_t {
+    VkBufferCreateInfo Buffer;
+    VkImageCreateInfo Image;
+    VkSamplerCreateInfo Sampler;
+};
+
+union resource_view_info_storage_t {
+    VkBufferViewCreateInfo BufferView;
+    VkImageViewCreateInfo ImageView;
+};
+
+/*
+    Generational slot map holding all resources created by a ResourceContext, along with their metadata.
+    Storage is split into fixed-size chunks that are never moved or freed until the table is destroyed,
+    so VulkanResource pointers stay stable and reads of a live slot don't need to take any locks. Within
+    a chunk data is stored as a structure of arrays, so iterating over (e.g.) just memory types or allocations
+    doesn't drag the rest of the metadata through the cache.
+
+    Handles pack a 32-bit slot index with a 32-bit generation. Retiring a slot bumps the generation, which
+    invalidates outstanding handles immediately, but the slot is only returned to the free list once the frame
+    it was retired in has completed: so readers that grabbed a resource in the meantime never see it reused.
+*/
+class ResourceTable {
+    ResourceTable(const ResourceTable&) = delete;
+    ResourceTable& operator=(const ResourceTable&) = delete;
+public:
+
+    constexpr static uint32_t ChunkShift = 8;
+    constexpr static uint32_t ChunkSize = 1u << ChunkShift;
+    constexpr static uint32_t ChunkMask = ChunkSize - 1u;
+    constexpr static uint32_t MaxChunks = 4096;
+
+    ResourceTable();
+    ~ResourceTable();
+
+    // Returns the index of a fresh, live slot. Metadata in the slot is default-initialized.
+    uint32_t Allocate();
+    // Invalidates handles to the slot: it will be re-used once Reclaim() is called with a frame >= retired_frame.
+    // Returns false, changing nothing, if handle is already stale (e.g. another thread retired it first).
+    bool Retire(const resource_handle_t handle, const uint64_t retired_frame);
+    // Returns slots retired in or before completed_frame to the free list, in a single batch
+    void Reclaim(const uint64_t completed_frame);
+    // Returns all retired slots to the free list, regardless of retirement frame
+    void ReclaimAll();
+
+    bool Valid(const resource_handle_t handle) const noexcept;
+    bool Live(const uint32_t idx) const noexcept;
+    resource_handle_t Handle(const uint32_t idx) const noexcept;
+    uint32_t Capacity() const noexcept;
+
+    static uint32_t Index(const resource_handle_t handle) noexcept;
+    static uint32_t Generation(const resource_handle_t handle) noexcept;
+
+    VulkanResource& Resource(const uint32_t idx) noexcept;
+    memory_type& MemoryType(const uint32_t idx) noexcept;
+    resource_info_storage_t& Info(const uint32_t idx) noexcept;
+    resource_view_info_storage_t& ViewInfo(const uint32_t idx) noexcept;
+    // For resources in a shared block, the whole block's allocation: MemoryRange() is the part the resource is bound to
+    vpr::Allocation& Allocation(const uint32_t idx) noexcept;
+    resource_memory_range_t& MemoryRange(const uint32_t idx) noexcept;
+    VkMappedMemoryRange& MappedRange(const uint32_t idx) noexcept;
+    std::string& Name(const uint32_t idx) noexcept;
+    // Index + 1 of the shared memory block the resource was sub-allocated from: 0 if it owns its allocation
+    uint32_t& SharedBlock(const uint32_t idx) noexcept;
+    // Pointer to the start of the resource's memory, if it has been persistently mapped
+    void*& PersistentMapping(const uint32_t idx) noexcept;
+
+    template<typename Fn>
+    void ForEachLive(Fn&& fn);
+
+private:
+
+    struct chunk_t {
+        std::array<VulkanResource, ChunkSize> resources;
+        std::array<memory_type, ChunkSize> memoryTypes;
+        std::array<resource_info_storage_t, ChunkSize> infos;
+        std::array<resource_view_info_storage_t, ChunkSize> viewInfos;
+        std::array<vpr::Allocation, ChunkSize> allocations;
+        std::array<resource_memory_range_t, ChunkSize> memoryRanges;
+        std::array<VkMappedMemoryRange, ChunkSize> mappedRanges;
+        std::array<std::string, ChunkSize> names;
+        std::array<uint32_t, ChunkSize> sharedBlocks;
+        std::array<void*, ChunkSize> persistentMappings;
+        std::array<std::atomic<uint32_t>, ChunkSize> generations;
+        std::array<std::atomic<bool>, ChunkSize> live;
+    };
+
+    struct retired_slot_t {
+        uint32_t Index;
+        uint64_t Frame;
+    };
+
+    chunk_t& chunk(const uint32_t idx) noexcept;
+    const chunk_t& chunk(const uint32_t idx) const noexcept;
+    void resetSlot(const uint32_t idx);
+
+    std::array<std::atomic<chunk_t*>, MaxChunks> chunks;
+    std::atomic<uint32_t> numSlots{ 0 };
+    std::vector<uint32_t> freeSlots;
+    std::vector<retired_slot_t> retiredSlots;
+    std::mutex allocationMutex;
+
+};
+
+inline uint32_t ResourceTable::Index(const resource_handle_t handle) noexcept {
+    return static_cast<uint32_t>(handle & 0xffffffff);
+}
+
+inline uint32_t ResourceTable::Generation(const resource_handle_t handle) noexcept {
+    return static_cast<uint32_t>(handle >> 32);
+}
+
+inline ResourceTable::chunk_t& ResourceTable::chunk(const uint32_t idx) noexcept {
+    return *chunks[idx >> ChunkShift].load(std::memory_order_acquire);
+}
+
+inline const ResourceTable::chunk_t& ResourceTable::chunk(const uint32_t idx) const noexcept {
+    return *chunks[idx >> ChunkShift].load(std::memory_order_acquire);
+}
+
+inline bool ResourceTable::Live(const uint32_t idx) const noexcept {
+    return (idx < numSlots.load(std::memory_order_acquire)) && chunk(idx).live[idx & ChunkMask].load(std::memory_order_acquire);
+}
+
+inline bool ResourceTable::Valid(const resource_handle_t handle) const noexcept {
+    const uint32_t idx = Index(handle);
+    return Live(idx) && (chunk(idx).generations[idx & ChunkMask].load(std::memory_order_acquire) == Generation(handle));
+}
+
+inline resource_handle_t ResourceTable::Handle(const uint32_t idx) const noexcept {
+    const uint64_t generation = chunk(idx).generations[idx & ChunkMask].load(std::memory_order_acquire);
+    return (generation << 32) | static_cast<uint64_t>(idx);
+}
+
+inline uint32_t ResourceTable::Capacity() const noexcept {
+    return numSlots.load(std::memory_order_acquire);
+}
+
+inline VulkanResource& ResourceTable::Resource(const uint32_t idx) noexcept {
+    return chunk(idx).resources[idx & ChunkMask];
+}
+
+inline memory_type& ResourceTable::MemoryType(const uint32_t idx) noexcept {
+    return chunk(idx).memoryTypes[idx & ChunkMask];
+}
+
+inline resource_info_storage_t& ResourceTable::Info(const uint32_t idx) noexcept {
+    return chunk(idx).infos[idx & ChunkMask];
+}
+
+inline resource_view_info_storage_t& ResourceTable::ViewInfo(const uint32_t idx) noexcept {
+    return chunk(idx).viewInfos[idx & ChunkMask];
+}
+
+inline vpr::Allocation& ResourceTable::Allocation(const uint32_t idx) noexcept {
+    return chunk(idx).allocations[idx & ChunkMask];
+}
+
+inline resource_memory_range_t& ResourceTable::MemoryRange(const uint32_t idx) noexcept {
+    return chunk(idx).memoryRanges[idx & ChunkMask];
+}
+
+inline VkMappedMemoryRange& ResourceTable::MappedRange(const uint32_t idx) noexcept {
+    return chunk(idx).mappedRanges[idx & ChunkMask];
+}
+
+inline std::string& ResourceTable::Name(const uint32_t idx) noexcept {
+    return chunk(idx).names[idx & ChunkMask];
+}
+
+inline uint32_t& ResourceTable::SharedBlock(const uint32_t idx) noexcept {
+    return chunk(idx).sharedBlocks[idx & ChunkMask];
+}
+
+inline void*& ResourceTable::PersistentMapping(const uint32_t idx) noexcept {
+    return chunk(idx).persistentMappings[idx & ChunkMask];
+}
+
+template<typename Fn>
+inline void ResourceTable::ForEachLive(Fn&& fn) {
+    const uint32_t num_slots = numSlots.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < num_slots; ++i) {
+        if (Live(i)) {
+            fn(i);
+        }
+    }
+}
+
+#endif //!RESOURCE_CONTEXT_RESOURCE_TABLE_HPP
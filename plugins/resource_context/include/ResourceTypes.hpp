@@ -37,6 +37,19 @@ struct gpu_image_resource_data_t {
     uint32_t MipLevel{ 0 };
 };
 
+struct transient_resource_info_t {
+    // Only BUFFER and IMAGE are valid
+    resource_type Type{ resource_type::INVALID };
+    // VkBufferCreateInfo or VkImageCreateInfo, according to Type
+    const void* Info{ nullptr };
+    // Optional VkBufferViewCreateInfo or VkImageViewCreateInfo
+    const void* ViewInfo{ nullptr };
+    // Inclusive range of passes the resource is used in
+    uint32_t FirstPass{ 0 };
+    uint32_t LastPass{ 0 };
+    void* UserData{ nullptr };
+};
+
 struct VulkanResource {
     resource_type Type{ resource_type::INVALID };
     uint64_t Handle{ VK_NULL_HANDLE };
@@ -44,7 +57,9 @@ struct VulkanResource {
     uint64_t ViewHandle{ VK_NULL_HANDLE };
     void* ViewInfo{ nullptr };
     const char* Name{ nullptr };
-    void* UserData;
+    void* UserData{ nullptr };
+    // Generational handle into the owning ResourceContext's resource table
+    uint64_t SlotHandle{ 0 };
 };
 
 #endif //!RESOURCE_CONTEXT_RESOURCE_TYPES_HPP
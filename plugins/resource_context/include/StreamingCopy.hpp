@@ -0,0 +1,14 @@
+#pragma once
+#ifndef RESOURCE_CONTEXT_STREAMING_COPY_HPP
+#define RESOURCE_CONTEXT_STREAMING_COPY_HPP
+#include <cstddef>
+
+/*
+    memcpy replacement for writing into write-combined (host-visible, uncached) memory. Uses non-temporal
+    stores, so the destination isn't pulled into the cache only to be evicted again: with regular stores partial
+    cache line writes to write-combined memory can be very slow. Reading back from the destination is just as
+    slow as ever, so don't. Falls back to memcpy where streaming stores aren't available.
+*/
+void StreamingMemcpy(void* dst, const void* src, const size_t size) noexcept;
+
+#endif //!RESOURCE_CONTEXT_STREAMING_COPY_HPP
@@ -5,7 +5,17 @@
 #include <vulkan/vulkan.h>
 #include <memory>
 #include <atomic>
+#include <array>
+#include <vector>
+#include <mutex>
 
+/*
+    Transfers are recorded into a ring of batches. Each thread that records transfers gets its own
+    command pool (and thus command buffers), so recording threads only contend with the submitting thread.
+    Submitted batches are retired by polling their fences: the only time we block is when every batch
+    in the ring is still in-flight. Batches are identified by a monotonically increasing ID, in the
+    manner of a timeline semaphore value: batch N being complete implies all batches before N are too.
+*/
 class ResourceTransferSystem {
 
     ResourceTransferSystem(const ResourceTransferSystem&) = delete;
@@ -16,11 +26,15 @@ class ResourceTransferSystem {
         void lock();
         bool try_lock();
         void unlock();
-    } copyQueueLock;
+    };
+
+    struct transferRecorder;
 
     struct transferSpinLockGuard {
         transferSpinLock& lck;
-        transferSpinLockGuard(transferSpinLock& _lock);
+        // ID of the batch that commands recorded under this guard will be submitted as part of
+        uint64_t BatchID;
+        transferSpinLockGuard(transferSpinLock& _lock, const std::atomic<uint64_t>& batch_id);
         ~transferSpinLockGuard();
     };
 
@@ -29,19 +43,65 @@ class ResourceTransferSystem {
 
 public:
 
+    constexpr static size_t NumBatches = 3;
+    using completion_callback_t = void(*)(void* state, void* data);
+
     static ResourceTransferSystem& GetTransferSystem();
 
     void Initialize(const vpr::Device* device);
+    void Destroy();
+    // Submits the currently recording batch (if anything was recorded) and retires completed batches. Doesn't block,
+    // unless the ring of in-flight batches is full.
     void CompleteTransfers();
+    // Blocks until all submitted batches have completed and been retired.
+    void WaitForTransfers();
+    // Must be held for the duration of recording into the buffer returned by TransferCmdBuffer()
     transferSpinLockGuard AcquireSpinLock();
+    // Returns the calling thread's command buffer for the batch currently being recorded.
     VkCommandBuffer TransferCmdBuffer();
 
+    // ID of the batch currently being recorded into. Reading this after recording a transfer is conservative:
+    // the transfer is part of this batch or one before it.
+    uint64_t CurrentBatchID() const noexcept;
+    uint64_t LastCompletedBatchID() const noexcept;
+    bool BatchComplete(const uint64_t batch_id) const noexcept;
+    // Called (from the thread retiring the batch) once the given batch completes. Called immediately if it already has.
+    // Throws std::logic_error for batches after CurrentBatchID().
+    void AddCompletionCallback(const uint64_t batch_id, completion_callback_t fn, void* state, void* data);
+
 private:
 
-    std::atomic<bool> cmdBufferDirty = false;
+    struct completion_callback_entry_t {
+        completion_callback_t Function;
+        void* State;
+        void* Data;
+    };
+
+    struct transferBatch {
+        std::unique_ptr<vpr::Fence> fence;
+        std::vector<completion_callback_entry_t> callbacks;
+        uint64_t id{ 0 };
+        bool inFlight{ false };
+    };
+
+    transferRecorder* getThreadRecorder();
+    bool pollBatch(transferBatch& batch);
+    // Retires completed batches and submits the recording one. Callbacks of retired batches are added to completed,
+    // to be run once submitMutex is released: they may record or wait on transfers themselves.
+    void submitBatch(std::vector<completion_callback_entry_t>& completed);
+    void retireBatch(transferBatch& batch, std::vector<completion_callback_entry_t>& completed);
+    void runCallbacks(const std::vector<completion_callback_entry_t>& completed);
+
+    std::array<transferBatch, NumBatches> batches;
+    std::vector<std::unique_ptr<transferRecorder>> recorders;
+    // Guards recorders container, and registration of new recorders
+    std::mutex recordersMutex;
+    // Guards batch state, submission, and the transfer queue itself
+    std::mutex submitMutex;
+    transferSpinLock callbackLock;
+    std::atomic<uint64_t> recordingBatch{ 1 };
+    std::atomic<uint64_t> completedBatch{ 0 };
     bool initialized = false;
-    std::unique_ptr<vpr::CommandPool> transferPool;
-    std::unique_ptr<vpr::Fence> fence;
     const vpr::Device* device;
 
 };
@@ -70,6 +70,8 @@ namespace vpsk {
         material_parameters_t& Parameters() noexcept;
         const material_parameters_t& Parameters() const noexcept;
 
+        bool operator==(const Material& other) const noexcept;
+
     private:
         material_textures_t texturePtrs;
         material_texture_flags_t textureFlags;
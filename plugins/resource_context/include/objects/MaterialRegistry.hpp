@@ -0,0 +1,80 @@
+#pragma once
+#ifndef VPSK_MATERIAL_REGISTRY_HPP
+#define VPSK_MATERIAL_REGISTRY_HPP
+#include "Material.hpp"
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace vpsk {
+
+    using material_id_t = uint32_t;
+    constexpr static material_id_t InvalidMaterialID = std::numeric_limits<material_id_t>::max();
+
+    /** Layout of one material in the GPU material table: matches an std430 array of
+     *  struct { vec4 ambient, diffuse, specular, transmittance, emission; float shininess, alpha, roughness, metallic;
+     *  bool flags[6]; } - padded to the 16 byte array stride std430 gives it.
+    */
+    struct gpu_material_t {
+        material_parameters_t Parameters;
+        material_texture_flags_t Flags;
+        uint32_t Padding[2]{ 0, 0 };
+    };
+
+    static_assert(sizeof(gpu_material_t) == 128, "gpu_material_t no longer matches the std430 layout used in shaders!");
+
+    struct material_hash_t {
+        size_t operator()(const Material& material) const noexcept;
+    };
+
+    // Byte range of the material table that has changed since the last call to ConsumeDirtyRanges()
+    struct material_dirty_range_t {
+        VkDeviceSize Offset;
+        VkDeviceSize Size;
+    };
+
+    /** Deduplicates materials and keeps a contiguous table of their parameters and flags, indexed by material ID,
+     *  ready to be copied as-is into a storage buffer. Identical materials share an ID, so draws can be sorted
+     *  and batched by it (see DrawSortKey), and only the parts of the table that have changed need re-uploading.
+    */
+    class MaterialRegistry {
+    public:
+
+        // Returns the ID of an identical material if one has already been registered
+        material_id_t Register(const Material& material);
+        // Changes the material for every user of the ID: the ID's table entry is marked dirty
+        void Update(const material_id_t id, const Material& material);
+        // Returns InvalidMaterialID if no identical material has been registered
+        material_id_t Find(const Material& material) const noexcept;
+
+        const Material& Get(const material_id_t id) const;
+        size_t Count() const noexcept;
+
+        const gpu_material_t* TableData() const noexcept;
+        VkDeviceSize TableSize() const noexcept;
+        bool Dirty() const noexcept;
+        // Returns merged, sorted ranges of the table needing upload and clears the dirty state
+        std::vector<material_dirty_range_t> ConsumeDirtyRanges();
+
+        // Material in the upper bits, so sorting by key groups draws by material first
+        static uint64_t DrawSortKey(const material_id_t material, const uint32_t draw_id) noexcept;
+
+    private:
+
+        void markDirty(const material_id_t id);
+
+        std::unordered_map<Material, material_id_t, material_hash_t> materialIDs;
+        std::vector<Material> materials;
+        std::vector<gpu_material_t> table;
+        std::vector<material_id_t> dirtyIDs;
+        std::vector<bool> dirtyFlags;
+    };
+
+    inline uint64_t MaterialRegistry::DrawSortKey(const material_id_t material, const uint32_t draw_id) noexcept {
+        return (static_cast<uint64_t>(material) << 32) | static_cast<uint64_t>(draw_id);
+    }
+
+}
+
+#endif //!VPSK_MATERIAL_REGISTRY_HPP
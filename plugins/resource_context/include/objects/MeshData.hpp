@@ -19,6 +19,8 @@ namespace vpsk {
     };
     /**All mesh objects should use this mesh data format. They don't have to bind or use
      * all fields at drawtime, but this helps standardize things considerably. 
+     * Streams can either get a buffer each (CreateBuffers), or be packed one after another into a single
+     * buffer with a single staging copy (CreatePackedBuffers), optionally shared by a whole batch of meshes.
      */
     struct MeshData {
 
@@ -38,17 +40,47 @@ namespace vpsk {
         std::unique_ptr<vpr::Buffer> VBO1;
         std::unique_ptr<vpr::Buffer> EBO;
 
+        // Holds every stream of this mesh (and of any meshes packed in the same batch) when packed
+        std::shared_ptr<vpr::Buffer> PackedBuffer;
+        // Offset of each vertex stream in PackedBuffer, in binding order
+        std::vector<VkDeviceSize> PackedVertexOffsets;
+        VkDeviceSize PackedIndexOffset{ 0 };
+
         virtual void CreateBuffers(const vpr::Device* device);
+        // Packs all streams into one buffer: equivalent to CreatePackedBuffers() with a batch of one
+        void CreatePackedBuffer(const vpr::Device* device);
         virtual void TransferToDevice(VkCommandBuffer cmd);
         virtual void FreeStagingBuffers();
 
         virtual std::vector<VkBuffer> GetVertexBuffers() const;
+        std::vector<VkDeviceSize> GetVertexBufferOffsets() const;
+        bool Packed() const noexcept;
+
+        // Packs the streams of all the given meshes into one device-local buffer, staged through one host buffer
+        // Throws std::invalid_argument if the meshes are all empty
+        static void CreatePackedBuffers(const vpr::Device* device, MeshData* const* meshes, const size_t num_meshes);
+        // Records a single copy for a batch created by CreatePackedBuffers()
+        static void TransferPackedBuffers(VkCommandBuffer cmd, MeshData* const* meshes, const size_t num_meshes);
+
+    protected:
+
+        struct host_stream_t {
+            const void* Data;
+            VkDeviceSize Size;
+        };
+
+        // Vertex streams in binding order: derived meshes append their own streams
+        virtual std::vector<host_stream_t> getVertexStreams() const;
 
     private:
 
         std::unique_ptr<vpr::Buffer> vboStaging0;
         std::unique_ptr<vpr::Buffer> vboStaging1;
         std::unique_ptr<vpr::Buffer> eboStaging;
+        std::shared_ptr<vpr::Buffer> packedStaging;
+        // Range of PackedBuffer (and packedStaging) belonging to this mesh
+        VkDeviceSize packedOffset{ 0 };
+        VkDeviceSize packedSize{ 0 };
     };
 
     
@@ -73,6 +105,8 @@ namespace vpsk {
         void FreeStagingBuffers() final;
 
         std::vector<VkBuffer> GetVertexBuffers() const final;
+    protected:
+        std::vector<host_stream_t> getVertexStreams() const final;
     private:
         std::unique_ptr<vpr::Buffer> vboStaging2;
     };
@@ -2,10 +2,10 @@
 #ifndef VPSK_BUFFER_RESOURCE_CACHE_HPP
 #define VPSK_BUFFER_RESOURCE_CACHE_HPP
 #include "ForwardDecl.hpp"
+#include "systems/NameInterner.hpp"
 #include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
 
 namespace st {
     class ShaderGroup;
@@ -17,6 +17,9 @@ namespace vpsk {
 
     /** Represents resources that won't be loaded into or read from by the host. Shader-only buffer resources, effectively.
      *  Thus they exist a bit outside of our usual loader system.
+     *  Group and resource names are interned into dense IDs as resources are added: fetch the ID once with
+     *  ResourceID() (or keep the one returned by AddResource()), then use the ID overloads on hot paths. The
+     *  string overloads are slow-path wrappers around them.
     */
     class BufferResourceCache {
         BufferResourceCache(const BufferResourceCache&) = delete;
@@ -26,19 +29,31 @@ namespace vpsk {
         BufferResourceCache(const vpr::Device* dvc);
         ~BufferResourceCache();
         void AddResources(const std::vector<const st::ShaderResource*>& resources);
-        void AddResource(const st::ShaderResource* resource);
+        resource_cache_id_t AddResource(const st::ShaderResource* resource);
+        // Returns an invalid ID if the resource hasn't been added to this cache
+        resource_cache_id_t ResourceID(const std::string& group_name, const std::string& name) const noexcept;
+
+        vpr::Buffer* at(const resource_cache_id_t id);
+        vpr::Buffer* find(const resource_cache_id_t id) noexcept;
+        bool HasResource(const resource_cache_id_t id) const noexcept;
+
         vpr::Buffer* at(const std::string& group_name, const std::string& name);
         vpr::Buffer* find(const std::string& group_name, const std::string& name) noexcept;
         bool HasResource(const std::string& group_name, const std::string& name) const noexcept;
 
     private:
-        void createTexelBuffer(const st::ShaderResource * texel_buffer, bool storage);
-        void createUniformBuffer(const st::ShaderResource * uniform_buffer);
-        void createStorageBuffer(const st::ShaderResource * storage_buffer);
+        std::unique_ptr<vpr::Buffer> createTexelBuffer(const st::ShaderResource * texel_buffer, bool storage);
+        std::unique_ptr<vpr::Buffer> createUniformBuffer(const st::ShaderResource * uniform_buffer);
+        std::unique_ptr<vpr::Buffer> createStorageBuffer(const st::ShaderResource * storage_buffer);
         void createResources(const std::vector<const st::ShaderResource*>& resources);
-        void createResource(const st::ShaderResource * rsrc);
+        resource_cache_id_t createResource(const st::ShaderResource * rsrc);
+        resource_cache_id_t internName(const std::string& group_name, const std::string& name);
         const vpr::Device* device;
-        std::unordered_map<std::string, std::unordered_map<std::string, std::unique_ptr<vpr::Buffer>>> buffers;
+        NameInterner groupNames;
+        // Indexed by group ID: each group interns the names of its own resources
+        std::vector<NameInterner> resourceNames;
+        // Indexed by [group ID][resource ID]
+        std::vector<std::vector<std::unique_ptr<vpr::Buffer>>> buffers;
     };
 
 }
@@ -2,10 +2,11 @@
 #ifndef VPSK_IMAGE_RESOURCE_CACHE_HPP
 #define VPSK_IMAGE_RESOURCE_CACHE_HPP
 #include "ForwardDecl.hpp"
+#include "systems/NameInterner.hpp"
 #include <vulkan/vulkan.h>
-#include <unordered_map>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace st {
     class ResourceUsage;
@@ -17,6 +18,10 @@ namespace vpsk {
 
     class Texture;
 
+    /** Images and samplers for shader resources not loaded from file. Names are interned into dense IDs as
+     *  resources are added, shared between images and samplers (so a combined image sampler has one ID): use
+     *  ResourceID() once and the ID overloads on hot paths, the string overloads are slow-path wrappers.
+    */
     class ImageResourceCache {
         ImageResourceCache(const ImageResourceCache&) = delete;
         ImageResourceCache& operator=(const ImageResourceCache&) = delete;
@@ -29,7 +34,16 @@ namespace vpsk {
         //vpr::Sampler* CreateSampler(const std::string& name, const VkSamplerCreateInfo& sampler_info);
 
         void AddResources(const std::vector<const st::ShaderResource*>& resources);
-        void AddResource(const st::ShaderResource* rsrc);
+        resource_cache_id_t AddResource(const st::ShaderResource* rsrc);
+        // Returns an invalid ID if no image or sampler has been added under the given name
+        resource_cache_id_t ResourceID(const std::string& group_name, const std::string& rsrc_name) const noexcept;
+
+        vpr::Image* FindImage(const resource_cache_id_t id) noexcept;
+        vpr::Sampler* FindSampler(const resource_cache_id_t id) noexcept;
+        vpr::Image* Image(const resource_cache_id_t id);
+        vpr::Sampler* Sampler(const resource_cache_id_t id);
+        bool HasImage(const resource_cache_id_t id) const noexcept;
+        bool HasSampler(const resource_cache_id_t id) const noexcept;
 
         vpr::Image* FindImage(const std::string& group_name, const std::string & rsrc_name);
         vpr::Sampler* FindSampler(const std::string& group_name, const std::string & rsrc_name);
@@ -41,14 +55,19 @@ namespace vpsk {
         
     private:
 
-        void createResource(const st::ShaderResource* rsrc);
-        void createCombinedImageSampler(const st::ShaderResource* rsrc);
-        void createSampler(const st::ShaderResource* rsrc);
-        void createSampledImage(const st::ShaderResource* rsrc);
+        resource_cache_id_t createResource(const st::ShaderResource* rsrc);
+        resource_cache_id_t createCombinedImageSampler(const st::ShaderResource* rsrc);
+        resource_cache_id_t createSampler(const st::ShaderResource* rsrc);
+        resource_cache_id_t createSampledImage(const st::ShaderResource* rsrc);
+        resource_cache_id_t internName(const std::string& group_name, const std::string& rsrc_name);
+        bool inRange(const resource_cache_id_t id) const noexcept;
 
         const vpr::Device* device;
-        std::unordered_map<std::string, std::unordered_map<std::string, std::unique_ptr<vpr::Sampler>>> samplers;
-        std::unordered_map<std::string, std::unordered_map<std::string, std::unique_ptr<vpr::Image>>> images;
+        NameInterner groupNames;
+        std::vector<NameInterner> resourceNames;
+        // Both indexed by [group ID][resource ID]: entries are null when a name only has an image, or only a sampler
+        std::vector<std::vector<std::unique_ptr<vpr::Sampler>>> samplers;
+        std::vector<std::vector<std::unique_ptr<vpr::Image>>> images;
 
     };
 
@@ -0,0 +1,63 @@
+#pragma once
+#ifndef VPSK_NAME_INTERNER_HPP
+#define VPSK_NAME_INTERNER_HPP
+#include "FlatMap.hpp"
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace vpsk {
+
+    /** Maps strings to small, dense integer IDs (in order of first interning), so that hot paths can index
+     *  arrays instead of hashing strings. Interning and lookups by string are the slow path: do them once,
+     *  e.g. when registering resources, and keep the IDs.
+    */
+    class NameInterner {
+    public:
+        constexpr static uint32_t InvalidID = std::numeric_limits<uint32_t>::max();
+
+        uint32_t Intern(const std::string& name) {
+            auto iter = ids.lower_bound(name);
+            if ((iter != ids.end()) && (iter->first == name)) {
+                return iter->second;
+            }
+            const uint32_t id = static_cast<uint32_t>(names.size());
+            names.emplace_back(name);
+            ids.emplace(name, id);
+            return id;
+        }
+
+        uint32_t Find(const std::string& name) const noexcept {
+            auto iter = ids.find(name);
+            return (iter != ids.end()) ? iter->second : InvalidID;
+        }
+
+        const std::string& Name(const uint32_t id) const {
+            return names.at(id);
+        }
+
+        size_t size() const noexcept {
+            return names.size();
+        }
+
+    private:
+        flat_map<std::string, uint32_t> ids;
+        std::vector<std::string> names;
+    };
+
+    // Identifies a resource within a resource cache: Group indexes the cache's groups, Name indexes resources within that group
+    struct resource_cache_id_t {
+        uint32_t Group{ NameInterner::InvalidID };
+        uint32_t Name{ NameInterner::InvalidID };
+        bool Valid() const noexcept {
+            return (Group != NameInterner::InvalidID) && (Name != NameInterner::InvalidID);
+        }
+        bool operator==(const resource_cache_id_t& other) const noexcept {
+            return (Group == other.Group) && (Name == other.Name);
+        }
+    };
+
+}
+
+#endif //!VPSK_NAME_INTERNER_HPP
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef VPSK_TEXTURE_RESIDENCY_HPP
+#define VPSK_TEXTURE_RESIDENCY_HPP
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace vpsk {
+
+    using texture_residency_id_t = uint32_t;
+    constexpr static texture_residency_id_t InvalidTextureResidencyID = std::numeric_limits<texture_residency_id_t>::max();
+
+    struct texture_residency_desc_t {
+        uint32_t Width{ 1 };
+        uint32_t Height{ 1 };
+        uint32_t MipLevels{ 1 };
+        // Average over the format's blocks for compressed formats: e.g. 4 for BC1, 8 for BC7
+        uint32_t BitsPerTexel{ 32 };
+    };
+
+    struct texture_residency_config_t {
+        uint64_t BudgetBytes{ 256ull * 1024ull * 1024ull };
+        // Smallest mips that together fit within this are the "tail": loaded on registration and never evicted
+        uint64_t MipTailBytes{ 64ull * 1024ull };
+        // Textures not requested for this many updates drop back down to their mip tail
+        uint32_t IdleFrames{ 120 };
+    };
+
+    // Mips [NewTopMip, MipLevels) are resident after the change. Loads should be streamed from OldTopMip - 1
+    // down to NewTopMip (coarse to fine), evictions just drop mips [OldTopMip, NewTopMip).
+    struct texture_residency_change_t {
+        texture_residency_id_t Texture;
+        uint32_t OldTopMip;
+        uint32_t NewTopMip;
+        bool IsLoad() const noexcept {
+            return NewTopMip < OldTopMip;
+        }
+    };
+
+    /** Decides which mips of which textures should be resident, given the screen-space size they are requested
+     *  at and a memory budget. Textures get a stable index on registration, suitable for indexing a bindless
+     *  descriptor array. Purely CPU-side and deterministic: the same sequence of calls always produces the same
+     *  changes, so the GPU side just applies the changes returned by Update().
+     *
+     *  Each Update() lowers textures that need less than is resident, then raises textures in priority order
+     *  (largest shortfall, then largest requested size, then lowest index), evicting mips from the least
+     *  recently requested textures when over budget. Textures requested in the current frame are never evicted
+     *  to make room for others, and mip tails are never evicted at all.
+    */
+    class TextureResidencyManager {
+    public:
+
+        TextureResidencyManager(const texture_residency_config_t& config = texture_residency_config_t{});
+
+        texture_residency_id_t Register(const texture_residency_desc_t& desc);
+        void Unregister(const texture_residency_id_t id);
+
+        // Screen-space size (in pixels, along the texture's largest dimension) a texture is about to be drawn at
+        void RequestScreenSize(const texture_residency_id_t id, const float screen_size);
+        // Returns the changes to apply, in the order they were decided. Advances the frame.
+        std::vector<texture_residency_change_t> Update();
+
+        uint32_t ResidentTopMip(const texture_residency_id_t id) const;
+        uint32_t MipTailStart(const texture_residency_id_t id) const;
+        uint64_t ResidentBytes() const noexcept;
+        uint64_t BudgetBytes() const noexcept;
+        void SetBudgetBytes(const uint64_t budget);
+
+        static uint64_t MipBytes(const texture_residency_desc_t& desc, const uint32_t mip) noexcept;
+
+    private:
+
+        struct texture_state_t {
+            texture_residency_desc_t Desc;
+            uint32_t TailMip{ 0 };
+            uint32_t ResidentMip{ 0 };
+            uint32_t DesiredMip{ 0 };
+            float RequestedSize{ 0.0f };
+            uint64_t LastRequestFrame{ 0 };
+            bool Live{ false };
+        };
+
+        uint32_t targetMip(const texture_state_t& texture) const noexcept;
+        uint64_t bytesBetween(const texture_state_t& texture, const uint32_t first_mip, const uint32_t end_mip) const noexcept;
+        bool evictOneMip(const texture_residency_id_t protected_id, std::vector<texture_residency_change_t>& changes);
+        void setResidentMip(const texture_residency_id_t id, const uint32_t mip, std::vector<texture_residency_change_t>& changes);
+
+        texture_residency_config_t config;
+        std::vector<texture_state_t> textures;
+        std::vector<texture_residency_id_t> freeIDs;
+        std::vector<texture_residency_change_t> pendingChanges;
+        // Textures raised during the current Update(): not eligible for eviction until the next one
+        std::vector<bool> raisedThisUpdate;
+        uint64_t residentBytes{ 0 };
+        uint64_t frame{ 1 };
+    };
+
+}
+
+#endif //!VPSK_TEXTURE_RESIDENCY_HPP
@@ -0,0 +1,141 @@
+#include "FlatMap.hpp"
+#include "doctest/doctest.h"
+
+#ifdef VPSK_TESTING_ENABLED
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+TEST_SUITE("FlatMap") {
+    TEST_CASE("BulkConstructionSortsAndKeepsFirstDuplicate") {
+        const std::vector<std::pair<int, int>> values{ { 5, 0 }, { 1, 1 }, { 3, 2 }, { 5, 3 }, { 1, 4 } };
+        flat_map<int, int> map(values.begin(), values.end());
+        REQUIRE(map.size() == 3);
+        CHECK(std::is_sorted(map.begin(), map.end()));
+        CHECK(map.at(5) == 0);
+        CHECK(map.at(1) == 1);
+        CHECK(map.find(2) == map.end());
+        CHECK_THROWS(map.at(2));
+    }
+
+    TEST_CASE("SingleInserts") {
+        flat_set<uint32_t> set;
+        CHECK(set.emplace(10u).second);
+        CHECK(set.emplace(2u).second);
+        CHECK_FALSE(set.emplace(10u).second);
+        CHECK(set.insert(7u).second);
+        CHECK(set.size() == 3);
+        CHECK(*set.begin() == 2u);
+        CHECK(set.erase(7u) == 1);
+        CHECK(set.erase(7u) == 0);
+        CHECK_FALSE(set.contains(7u));
+    }
+
+    TEST_CASE("DeferredInserts") {
+        flat_map<std::string, int> map{ { "existing", 0 } };
+        map.defer_insert("zeta", 1);
+        map.defer_insert("alpha", 2);
+        map.defer_insert("existing", 3);
+        map.defer_insert("alpha", 4);
+        CHECK(map.pending_size() == 4);
+        CHECK_FALSE(map.contains("zeta"));
+        map.commit();
+        CHECK(map.pending_size() == 0);
+        REQUIRE(map.size() == 3);
+        CHECK(map.at("existing") == 0);
+        CHECK(map.at("alpha") == 2);
+        CHECK(map.at("zeta") == 1);
+        CHECK(map.begin()->first == "alpha");
+    }
+
+    TEST_CASE("MapAccessors") {
+        flat_map<int, std::string> map;
+        map[3] = "three";
+        map[1] = "one";
+        CHECK(map[3] == "three");
+        CHECK(map.insert_or_assign(1, std::string("uno")).second == false);
+        CHECK(map.at(1) == "uno");
+        CHECK(map.size() == 2);
+    }
+
+    TEST_CASE("LowerBoundMatchesStd") {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int64_t> dist(-1000, 1000);
+        for (size_t count : { 0, 1, 2, 15, 16, 17, 33, 100, 1000 }) {
+            std::vector<int64_t> values(count);
+            for (auto& value : values) {
+                value = dist(rng);
+            }
+            flat_set<int64_t> set(values.begin(), values.end());
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+            for (int64_t key = -1005; key <= 1005; key += 7) {
+                const auto expected = std::lower_bound(values.begin(), values.end(), key) - values.begin();
+                CHECK((set.lower_bound(key) - set.begin()) == expected);
+            }
+        }
+    }
+
+    TEST_CASE("PointerKeys") {
+        std::vector<int> storage(64);
+        std::vector<const int*> pointers;
+        for (auto& value : storage) {
+            pointers.emplace_back(&value);
+        }
+        std::shuffle(pointers.begin(), pointers.end(), std::mt19937(7));
+        flat_set<const int*> set(pointers.begin(), pointers.end());
+        for (auto& value : storage) {
+            CHECK(set.contains(&value));
+        }
+        CHECK_FALSE(set.contains(nullptr));
+    }
+
+    TEST_CASE("LookupBenchmark") {
+        // Not a pass/fail test: reports lookup timings against the node-based containers we're replacing
+        constexpr size_t num_keys = 4096;
+        constexpr size_t num_lookups = 1u << 20;
+        std::mt19937_64 rng(1234);
+        std::vector<uint64_t> keys(num_keys);
+        for (auto& key : keys) {
+            key = rng();
+        }
+
+        std::vector<std::pair<uint64_t, uint32_t>> values;
+        for (size_t i = 0; i < num_keys; ++i) {
+            values.emplace_back(keys[i], static_cast<uint32_t>(i));
+        }
+
+        auto build_begin = std::chrono::high_resolution_clock::now();
+        flat_map<uint64_t, uint32_t> flat(values.begin(), values.end());
+        auto build_end = std::chrono::high_resolution_clock::now();
+        std::unordered_map<uint64_t, uint32_t> hashed(values.begin(), values.end());
+        std::map<uint64_t, uint32_t> tree(values.begin(), values.end());
+
+        std::vector<uint64_t> lookups(num_lookups);
+        for (auto& lookup : lookups) {
+            lookup = keys[rng() % num_keys];
+        }
+
+        auto time_lookups = [&lookups](auto& container) {
+            uint64_t checksum = 0;
+            auto begin = std::chrono::high_resolution_clock::now();
+            for (const auto& key : lookups) {
+                checksum += container.find(key)->second;
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            return std::make_pair(std::chrono::duration<double, std::milli>(end - begin).count(), checksum);
+        };
+
+        const auto flat_result = time_lookups(flat);
+        const auto hashed_result = time_lookups(hashed);
+        const auto tree_result = time_lookups(tree);
+        CHECK(flat_result.second == hashed_result.second);
+        CHECK(flat_result.second == tree_result.second);
+        const double build_time = std::chrono::duration<double, std::milli>(build_end - build_begin).count();
+        MESSAGE("flat_map bulk build of " << num_keys << " keys: " << build_time << "ms");
+        MESSAGE(num_lookups << " lookups: flat_map " << flat_result.first << "ms, unordered_map " << hashed_result.first << "ms, map " << tree_result.first << "ms");
+    }
+}
+#endif // VPSK_TESTING_ENABLED
@@ -8,11 +8,21 @@
 #include "PhysicalDevice.hpp"
 #include "vkAssert.hpp"
 #include "UploadBuffer.hpp"
+#include "ResourcePacking.hpp"
+#include "StreamingCopy.hpp"
 #include <vector>
 #include <algorithm>
+#include <limits>
+#include <numeric>
 #include "easylogging++.h"
 
-static std::vector<std::unique_ptr<UploadBuffer>> uploadBuffers;
+struct pending_upload_buffer_t {
+    // Transfer batch the upload was recorded into: we can free the buffer once this completes
+    uint64_t BatchID;
+    std::unique_ptr<UploadBuffer> Buffer;
+};
+
+static std::vector<pending_upload_buffer_t> uploadBuffers;
 
 static VkAccessFlags accessFlagsFromBufferUsage(VkBufferUsageFlags usage_flags) {
     if (usage_flags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
@@ -61,6 +71,53 @@ static VkAccessFlags accessFlagsFromImageUsage(const VkImageUsageFlags usage_fla
     }
 }
 
+// Bytes per texel, or per block for compressed formats. Depth/stencil formats are copied one aspect at a time, so
+// they report the size of the depth aspect.
+static VkDeviceSize texelBlockSize(const VkFormat format) {
+    auto in_range = [format](const VkFormat first, const VkFormat last) {
+        return (format >= first) && (format <= last);
+    };
+
+    if ((format == VK_FORMAT_R4G4_UNORM_PACK8) || in_range(VK_FORMAT_R8_UNORM, VK_FORMAT_R8_SRGB) || (format == VK_FORMAT_S8_UINT)) {
+        return 1;
+    }
+    else if (in_range(VK_FORMAT_R4G4B4A4_UNORM_PACK16, VK_FORMAT_A1R5G5B5_UNORM_PACK16) || in_range(VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8_SRGB) ||
+        in_range(VK_FORMAT_R16_UNORM, VK_FORMAT_R16_SFLOAT) || (format == VK_FORMAT_D16_UNORM) || (format == VK_FORMAT_D16_UNORM_S8_UINT)) {
+        return 2;
+    }
+    else if (in_range(VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_B8G8R8_SRGB)) {
+        return 3;
+    }
+    else if (in_range(VK_FORMAT_R16G16B16_UNORM, VK_FORMAT_R16G16B16_SFLOAT)) {
+        return 6;
+    }
+    else if (in_range(VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16B16A16_SFLOAT) || in_range(VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32_SFLOAT) ||
+        in_range(VK_FORMAT_R64_UINT, VK_FORMAT_R64_SFLOAT) || in_range(VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_SRGB_BLOCK) ||
+        in_range(VK_FORMAT_BC4_UNORM_BLOCK, VK_FORMAT_BC4_SNORM_BLOCK) || in_range(VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK) ||
+        in_range(VK_FORMAT_EAC_R11_UNORM_BLOCK, VK_FORMAT_EAC_R11_SNORM_BLOCK)) {
+        return 8;
+    }
+    else if (in_range(VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32_SFLOAT)) {
+        return 12;
+    }
+    else if (in_range(VK_FORMAT_R32G32B32A32_UINT, VK_FORMAT_R32G32B32A32_SFLOAT) || in_range(VK_FORMAT_R64G64_UINT, VK_FORMAT_R64G64_SFLOAT) ||
+        in_range(VK_FORMAT_BC2_UNORM_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK) || in_range(VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK) ||
+        in_range(VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK) || in_range(VK_FORMAT_EAC_R11G11_UNORM_BLOCK, VK_FORMAT_EAC_R11G11_SNORM_BLOCK) ||
+        in_range(VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ASTC_12x12_SRGB_BLOCK)) {
+        return 16;
+    }
+    else if (in_range(VK_FORMAT_R64G64B64_UINT, VK_FORMAT_R64G64B64_SFLOAT)) {
+        return 24;
+    }
+    else if (in_range(VK_FORMAT_R64G64B64A64_UINT, VK_FORMAT_R64G64B64A64_SFLOAT)) {
+        return 32;
+    }
+    else {
+        // Remaining formats are 4 byte packed formats, 32 bit depth and the 8 bit RGBA formats
+        return 4;
+    }
+}
+
 static VkImageLayout imageLayoutFromUsage(const VkImageUsageFlags usage_flags) {
     if (usage_flags & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) {
         return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -76,6 +133,12 @@ static VkImageLayout imageLayoutFromUsage(const VkImageUsageFlags usage_flags) {
     }
 }
 
+static packing_request_t makePackingRequest(const VkMemoryRequirements& reqs, const vpr::AllocationType alloc_type) {
+    // Resources of differing allocation types (buffer, linear, tiled) may not share memory without respecting
+    // bufferImageGranularity, so we just keep them apart entirely
+    return packing_request_t{ reqs.size, reqs.alignment, (static_cast<uint64_t>(alloc_type) << 32) | static_cast<uint64_t>(reqs.memoryTypeBits) };
+}
+
 static vpr::Allocator::allocation_extensions getExtensionFlags(const vpr::Device* device) {
     return device->DedicatedAllocationExtensionsEnabled() ? vpr::Allocator::allocation_extensions::DedicatedAllocations : vpr::Allocator::allocation_extensions::None;
 }
@@ -83,6 +146,7 @@ static vpr::Allocator::allocation_extensions getExtensionFlags(const vpr::Device
 ResourceContext::ResourceContext(vpr::Device* _device, vpr::PhysicalDevice* physical_device) : device(_device), allocator(std::make_unique<vpr::Allocator>(_device->vkHandle(), physical_device->vkHandle(), getExtensionFlags(_device))) {
     auto& transfer_system = ResourceTransferSystem::GetTransferSystem();
     transfer_system.Initialize(_device);
+    nonCoherentAtomSize = physical_device->GetProperties().limits.nonCoherentAtomSize;
 }
 
 ResourceContext::~ResourceContext() {
@@ -90,16 +154,14 @@ ResourceContext::~ResourceContext() {
 }
 
 VulkanResource* ResourceContext::CreateBuffer(const VkBufferCreateInfo* info, const VkBufferViewCreateInfo* view_info, const size_t num_data, const gpu_resource_data_t* initial_data, const memory_type _memory_type, void* user_data) {
-    VulkanResource* resource = nullptr;
-    {
-        std::lock_guard<std::mutex> emplaceGuard(containerMutex);
-        auto iter = resources.emplace(std::make_unique<VulkanResource>());
-        resource = iter.first->get();
-        auto info_iter = resourceInfos.bufferInfos.emplace(resource, *info);
-        resource->Type = resource_type::BUFFER;
-        resource->Info = &info_iter.first->second;
-        resource->UserData = user_data;
-    }
+    const uint32_t idx = resourceTable.Allocate();
+    VulkanResource* resource = &resourceTable.Resource(idx);
+    resourceTable.Info(idx).Buffer = *info;
+    resourceTable.MemoryType(idx) = _memory_type;
+    resource->Type = resource_type::BUFFER;
+    resource->Info = &resourceTable.Info(idx).Buffer;
+    resource->UserData = user_data;
+    resource->SlotHandle = resourceTable.Handle(idx);
 
     if ((_memory_type == memory_type::DEVICE_LOCAL) && (num_data != 0)) {
         // Device local buffer that will be transferred into, make sure it has the requisite flag.
@@ -113,14 +175,13 @@ VulkanResource* ResourceContext::CreateBuffer(const VkBufferCreateInfo* info, co
     VkResult result = vkCreateBuffer(device->vkHandle(), reinterpret_cast<VkBufferCreateInfo*>(resource->Info), nullptr, reinterpret_cast<VkBuffer*>(&resource->Handle));
     VkAssert(result);
 
-    resourceInfos.resourceMemoryType.emplace(resource, _memory_type);
-    auto alloc_iter = resourceAllocations.emplace(resource, vpr::Allocation());
-    vpr::Allocation& alloc = alloc_iter.first->second;
+    vpr::Allocation& alloc = resourceTable.Allocation(idx);
     allocator->AllocateForBuffer(reinterpret_cast<VkBuffer&>(resource->Handle), getAllocReqs(_memory_type), vpr::AllocationType::Buffer, alloc);
+    resourceTable.MemoryRange(idx) = resource_memory_range_t{ alloc.Offset(), alloc.Size };
 
     if (view_info) {
-        auto view_iter = resourceInfos.bufferViewInfos.emplace(resource, *view_info);
-        resource->ViewInfo = &view_iter.first->second;
+        resourceTable.ViewInfo(idx).BufferView = *view_info;
+        resource->ViewInfo = &resourceTable.ViewInfo(idx).BufferView;
         VkBufferViewCreateInfo* local_view_info = reinterpret_cast<VkBufferViewCreateInfo*>(resource->ViewInfo);
         local_view_info->buffer = (VkBuffer)resource->Handle;
         result = vkCreateBufferView(device->vkHandle(), local_view_info, nullptr, reinterpret_cast<VkBufferView*>(&resource->ViewHandle));
@@ -141,18 +202,30 @@ VulkanResource* ResourceContext::CreateBuffer(const VkBufferCreateInfo* info, co
 
 VulkanResource* ResourceContext::CreateNamedBuffer(const char* name, const VkBufferCreateInfo* info, const VkBufferViewCreateInfo* view_info, const size_t num_data, const gpu_resource_data_t* initial_data, const memory_type _memory_type, void* user_data) {
     VulkanResource* result = CreateBuffer(info, view_info, num_data, initial_data, _memory_type, user_data);
-    auto iter = resourceNames.emplace(result, std::string(name));
-    result->Name = iter.first->second.c_str();
+    std::string& stored_name = resourceTable.Name(resourceIndex(result));
+    stored_name = name;
+    result->Name = stored_name.c_str();
     return result;
 }
 
 void ResourceContext::SetBufferData(VulkanResource* dest_buffer, const size_t num_data, const gpu_resource_data_t* data) {
-    memory_type mem_type = resourceInfos.resourceMemoryType.at(dest_buffer);
-    if ((mem_type == memory_type::HOST_VISIBLE) || (mem_type == memory_type::HOST_VISIBLE_AND_COHERENT)) {
-        setBufferInitialDataHostOnly(dest_buffer, num_data, data, resourceAllocations.at(dest_buffer), mem_type);
+    const uint32_t idx = resourceIndex(dest_buffer);
+    memory_type mem_type = resourceTable.MemoryType(idx);
+    void* persistent_mapping = resourceTable.PersistentMapping(idx);
+    if (persistent_mapping != nullptr) {
+        // Already mapped: skip the map/unmap, and batch the flush with the rest of this frame's
+        size_t offset = 0;
+        for (size_t i = 0; i < num_data; ++i) {
+            StreamingMemcpy(reinterpret_cast<uint8_t*>(persistent_mapping) + offset, data[i].Data, data[i].DataSize);
+            offset += data[i].DataSize;
+        }
+        FlushMappedRange(dest_buffer, 0, offset);
+    }
+    else if ((mem_type == memory_type::HOST_VISIBLE) || (mem_type == memory_type::HOST_VISIBLE_AND_COHERENT)) {
+        setBufferInitialDataHostOnly(dest_buffer, num_data, data, resourceTable.Allocation(idx), mem_type);
     }
     else {
-        setBufferInitialDataUploadBuffer(dest_buffer, num_data, data, resourceAllocations.at(dest_buffer));
+        setBufferInitialDataUploadBuffer(dest_buffer, num_data, data, resourceTable.Allocation(idx));
     }
 }
 
@@ -164,18 +237,14 @@ void ResourceContext::FillBuffer(VulkanResource * dest_buffer, const uint32_t va
 }
 
 VulkanResource* ResourceContext::CreateImage(const VkImageCreateInfo* info, const VkImageViewCreateInfo* view_info, const size_t num_data, const gpu_image_resource_data_t* initial_data, const memory_type _memory_type, void* user_data) {
-    VulkanResource* resource = nullptr;
-
-    {
-        std::lock_guard<std::mutex> emplaceGuard(containerMutex);
-        auto iter = resources.emplace(std::make_unique<VulkanResource>());
-        resource = iter.first->get();
-        auto info_iter = resourceInfos.imageInfos.emplace(resource, *info);
-        resource->Type = resource_type::IMAGE;
-        resource->Info = &info_iter.first->second;
-        resource->UserData = user_data;
-        resourceInfos.resourceMemoryType.emplace(resource, _memory_type);
-    }
+    const uint32_t idx = resourceTable.Allocate();
+    VulkanResource* resource = &resourceTable.Resource(idx);
+    resourceTable.Info(idx).Image = *info;
+    resourceTable.MemoryType(idx) = _memory_type;
+    resource->Type = resource_type::IMAGE;
+    resource->Info = &resourceTable.Info(idx).Image;
+    resource->UserData = user_data;
+    resource->SlotHandle = resourceTable.Handle(idx);
 
     // This probably isn't ideal but it's a reasonable assumption to make.
     VkImageCreateInfo* create_info = reinterpret_cast<VkImageCreateInfo*>(resource->Info);
@@ -183,26 +252,14 @@ VulkanResource* ResourceContext::CreateImage(const VkImageCreateInfo* info, cons
     VkResult result = vkCreateImage(device->vkHandle(), create_info, nullptr, reinterpret_cast<VkImage*>(&resource->Handle));
     VkAssert(result);
 
-    vpr::AllocationType alloc_type;
-    VkImageTiling format_tiling = device->GetFormatTiling(info->format, featureFlagsFromUsage(info->usage));
-    if (format_tiling == VK_IMAGE_TILING_LINEAR) {
-        alloc_type = vpr::AllocationType::ImageLinear;
-    }
-    else if (format_tiling == VK_IMAGE_TILING_OPTIMAL) {
-        alloc_type = vpr::AllocationType::ImageTiled;
-    }
-    else {
-        alloc_type = vpr::AllocationType::Unknown;
-    }
-
-    auto alloc_iter = resourceAllocations.emplace(resource, vpr::Allocation());
-    vpr::Allocation& alloc = alloc_iter.first->second;
-    allocator->AllocateForImage(reinterpret_cast<VkImage&>(resource->Handle), getAllocReqs(_memory_type), alloc_type, alloc);
+    vpr::Allocation& alloc = resourceTable.Allocation(idx);
+    allocator->AllocateForImage(reinterpret_cast<VkImage&>(resource->Handle), getAllocReqs(_memory_type), imageAllocationType(info), alloc);
+    resourceTable.MemoryRange(idx) = resource_memory_range_t{ alloc.Offset(), alloc.Size };
 
 
     if (view_info) {
-        auto view_iter = resourceInfos.imageViewInfos.emplace(resource, *view_info);
-        resource->ViewInfo = &view_iter.first->second;
+        resourceTable.ViewInfo(idx).ImageView = *view_info;
+        resource->ViewInfo = &resourceTable.ViewInfo(idx).ImageView;
         VkImageViewCreateInfo* local_view_info = reinterpret_cast<VkImageViewCreateInfo*>(resource->ViewInfo);
         local_view_info->image = (VkImage)resource->Handle;
         result = vkCreateImageView(device->vkHandle(), local_view_info, nullptr, reinterpret_cast<VkImageView*>(&resource->ViewHandle));
@@ -218,27 +275,24 @@ VulkanResource* ResourceContext::CreateImage(const VkImageCreateInfo* info, cons
 
 VulkanResource* ResourceContext::CreateNamedImage(const char* name, const VkImageCreateInfo* info, const VkImageViewCreateInfo* view_info, const size_t num_data, const gpu_image_resource_data_t* initial_data, const memory_type _memory_type, void* user_data) {
     VulkanResource* resource = CreateImage(info, view_info, num_data, initial_data, _memory_type, user_data);
-    auto iter = resourceNames.emplace(resource, std::string(name));
-    resource->Name = iter.first->second.c_str();
+    std::string& stored_name = resourceTable.Name(resourceIndex(resource));
+    stored_name = name;
+    resource->Name = stored_name.c_str();
     return resource;
 }
 
 void ResourceContext::SetImageData(VulkanResource* image, const size_t num_data, const gpu_image_resource_data_t* data) {
-    setImageInitialData(image, num_data, data, resourceAllocations.at(image));
+    setImageInitialData(image, num_data, data, resourceTable.Allocation(resourceIndex(image)));
 }
 
 VulkanResource* ResourceContext::CreateSampler(const VkSamplerCreateInfo* info, void* user_data) {
-    VulkanResource* resource = nullptr; 
-    {
-        std::lock_guard<std::mutex> empalceGuard(containerMutex);
-        auto iter = resources.emplace(std::make_unique<VulkanResource>());
-        resource = iter.first->get();
-    }
-
-    auto info_iter = resourceInfos.samplerInfos.emplace(resource, *info);
+    const uint32_t idx = resourceTable.Allocate();
+    VulkanResource* resource = &resourceTable.Resource(idx);
+    resourceTable.Info(idx).Sampler = *info;
     resource->Type = resource_type::SAMPLER;
-    resource->Info = &info_iter.first->second;
+    resource->Info = &resourceTable.Info(idx).Sampler;
     resource->UserData = user_data;
+    resource->SlotHandle = resourceTable.Handle(idx);
 
     VkResult result = vkCreateSampler(device->vkHandle(), info, nullptr, reinterpret_cast<VkSampler*>(&resource->Handle));
     VkAssert(result);
@@ -246,6 +300,387 @@ VulkanResource* ResourceContext::CreateSampler(const VkSamplerCreateInfo* info,
     return resource;
 }
 
+void ResourceContext::CreateBuffers(const size_t num_buffers, const VkBufferCreateInfo* infos, const VkBufferViewCreateInfo* const* view_infos, const size_t* num_data,
+    const gpu_resource_data_t* const* initial_data, const memory_type _memory_type, void* const* user_data, VulkanResource** results) {
+
+    if (_memory_type != memory_type::DEVICE_LOCAL) {
+        // Host-visible buffers are written and mapped individually, so there's nothing to gain by sharing memory or staging
+        for (size_t i = 0; i < num_buffers; ++i) {
+            results[i] = CreateBuffer(&infos[i], view_infos ? view_infos[i] : nullptr, num_data ? num_data[i] : 0, initial_data ? initial_data[i] : nullptr, _memory_type, user_data ? user_data[i] : nullptr);
+        }
+        return;
+    }
+
+    std::vector<uint32_t> indices(num_buffers);
+    std::vector<packing_request_t> packing_requests(num_buffers);
+
+    for (size_t i = 0; i < num_buffers; ++i) {
+        const uint32_t idx = resourceTable.Allocate();
+        indices[i] = idx;
+        VulkanResource* resource = &resourceTable.Resource(idx);
+        VkBufferCreateInfo& buffer_info = resourceTable.Info(idx).Buffer;
+        buffer_info = infos[i];
+        resourceTable.MemoryType(idx) = _memory_type;
+        resource->Type = resource_type::BUFFER;
+        resource->Info = &buffer_info;
+        resource->UserData = user_data ? user_data[i] : nullptr;
+        resource->SlotHandle = resourceTable.Handle(idx);
+
+        if (initial_data && initial_data[i]) {
+            buffer_info.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        }
+
+        VkResult result = vkCreateBuffer(device->vkHandle(), &buffer_info, nullptr, reinterpret_cast<VkBuffer*>(&resource->Handle));
+        VkAssert(result);
+        VkMemoryRequirements memory_reqs;
+        vkGetBufferMemoryRequirements(device->vkHandle(), (VkBuffer)resource->Handle, &memory_reqs);
+        packing_requests[i] = makePackingRequest(memory_reqs, vpr::AllocationType::Buffer);
+        results[i] = resource;
+    }
+
+    bindSharedBlocks(indices, PlanResourcePacking(packing_requests.data(), packing_requests.size(), MaxSharedBlockSize), _memory_type);
+
+    std::vector<packing_request_t> staging_requests;
+    for (size_t i = 0; i < num_buffers; ++i) {
+        VulkanResource* resource = results[i];
+        if (view_infos && view_infos[i]) {
+            VkBufferViewCreateInfo& local_view_info = resourceTable.ViewInfo(indices[i]).BufferView;
+            local_view_info = *view_infos[i];
+            local_view_info.buffer = (VkBuffer)resource->Handle;
+            resource->ViewInfo = &local_view_info;
+            VkResult result = vkCreateBufferView(device->vkHandle(), &local_view_info, nullptr, reinterpret_cast<VkBufferView*>(&resource->ViewHandle));
+            VkAssert(result);
+        }
+
+        if (initial_data && initial_data[i]) {
+            for (size_t j = 0; j < (num_data ? num_data[i] : 0); ++j) {
+                if (initial_data[i][j].DataSize != 0) {
+                    staging_requests.emplace_back(packing_request_t{ initial_data[i][j].DataSize, 4, 0 });
+                }
+            }
+        }
+    }
+
+    // Zero-sized staging buffers aren't valid, and there would be nothing to copy anyways
+    if (staging_requests.empty()) {
+        return;
+    }
+
+    // All initial data goes into one staging buffer: the plan is only used for offsets within it
+    const packing_plan_t staging_plan = PlanResourcePacking(staging_requests.data(), staging_requests.size(), 0);
+    auto upload_buffer = std::make_unique<UploadBuffer>(device, allocator.get(), staging_plan.Blocks.front().Size);
+
+    std::vector<upload_copy_t> upload_copies;
+    upload_copies.reserve(staging_requests.size());
+    std::vector<VkBufferMemoryBarrier> pre_barriers;
+    std::vector<VkBufferMemoryBarrier> post_barriers;
+    std::vector<std::vector<VkBufferCopy>> buffer_copies(num_buffers);
+
+    size_t staging_idx = 0;
+    for (size_t i = 0; i < num_buffers; ++i) {
+        if (!initial_data || !initial_data[i]) {
+            continue;
+        }
+
+        VkDeviceSize dst_offset = 0;
+        for (size_t j = 0; j < (num_data ? num_data[i] : 0); ++j) {
+            if (initial_data[i][j].DataSize == 0) {
+                continue;
+            }
+            const VkDeviceSize src_offset = staging_plan.Ranges[staging_idx++].Offset;
+            upload_copies.emplace_back(upload_copy_t{ initial_data[i][j].Data, initial_data[i][j].DataSize, src_offset });
+            buffer_copies[i].emplace_back(VkBufferCopy{ src_offset, dst_offset, initial_data[i][j].DataSize });
+            dst_offset += initial_data[i][j].DataSize;
+        }
+        if (buffer_copies[i].empty()) {
+            continue;
+        }
+
+        const VkBufferCreateInfo* p_info = reinterpret_cast<VkBufferCreateInfo*>(results[i]->Info);
+        pre_barriers.emplace_back(VkBufferMemoryBarrier{
+            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            nullptr,
+            0,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            (VkBuffer)results[i]->Handle,
+            0,
+            p_info->size
+        });
+        post_barriers.emplace_back(VkBufferMemoryBarrier{
+            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            nullptr,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            accessFlagsFromBufferUsage(p_info->usage),
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            (VkBuffer)results[i]->Handle,
+            0,
+            p_info->size
+        });
+    }
+
+    upload_buffer->SetData(upload_copies.data(), upload_copies.size());
+
+    auto& transfer_system = ResourceTransferSystem::GetTransferSystem();
+    uint64_t batch_id = 0;
+    {
+        auto guard = transfer_system.AcquireSpinLock();
+        batch_id = guard.BatchID;
+        VkCommandBuffer cmd = transfer_system.TransferCmdBuffer();
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, static_cast<uint32_t>(pre_barriers.size()), pre_barriers.data(), 0, nullptr);
+        for (size_t i = 0; i < num_buffers; ++i) {
+            if (buffer_copies[i].empty()) {
+                continue;
+            }
+            vkCmdCopyBuffer(cmd, upload_buffer->Buffer, (VkBuffer)results[i]->Handle, static_cast<uint32_t>(buffer_copies[i].size()), buffer_copies[i].data());
+        }
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, static_cast<uint32_t>(post_barriers.size()), post_barriers.data(), 0, nullptr);
+    }
+
+    {
+        std::lock_guard<std::mutex> emplaceGuard(containerMutex);
+        uploadBuffers.emplace_back(pending_upload_buffer_t{ batch_id, std::move(upload_buffer) });
+    }
+}
+
+void ResourceContext::CreateImages(const size_t num_images, const VkImageCreateInfo* infos, const VkImageViewCreateInfo* const* view_infos, const size_t* num_data,
+    const gpu_image_resource_data_t* const* initial_data, const memory_type _memory_type, void* const* user_data, VulkanResource** results) {
+
+    if (_memory_type != memory_type::DEVICE_LOCAL) {
+        for (size_t i = 0; i < num_images; ++i) {
+            results[i] = CreateImage(&infos[i], view_infos ? view_infos[i] : nullptr, num_data ? num_data[i] : 0, initial_data ? initial_data[i] : nullptr, _memory_type, user_data ? user_data[i] : nullptr);
+        }
+        return;
+    }
+
+    std::vector<uint32_t> indices(num_images);
+    std::vector<packing_request_t> packing_requests(num_images);
+
+    for (size_t i = 0; i < num_images; ++i) {
+        const uint32_t idx = resourceTable.Allocate();
+        indices[i] = idx;
+        VulkanResource* resource = &resourceTable.Resource(idx);
+        VkImageCreateInfo& image_info = resourceTable.Info(idx).Image;
+        image_info = infos[i];
+        image_info.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        resourceTable.MemoryType(idx) = _memory_type;
+        resource->Type = resource_type::IMAGE;
+        resource->Info = &image_info;
+        resource->UserData = user_data ? user_data[i] : nullptr;
+        resource->SlotHandle = resourceTable.Handle(idx);
+
+        VkResult result = vkCreateImage(device->vkHandle(), &image_info, nullptr, reinterpret_cast<VkImage*>(&resource->Handle));
+        VkAssert(result);
+        VkMemoryRequirements memory_reqs;
+        vkGetImageMemoryRequirements(device->vkHandle(), (VkImage)resource->Handle, &memory_reqs);
+        packing_requests[i] = makePackingRequest(memory_reqs, imageAllocationType(&image_info));
+        results[i] = resource;
+    }
+
+    bindSharedBlocks(indices, PlanResourcePacking(packing_requests.data(), packing_requests.size(), MaxSharedBlockSize), _memory_type);
+
+    // Texel block sizes aren't always powers of two (e.g. 12 bytes for R32G32B32), which resource packing requires:
+    // the offsets into the single staging buffer are simply laid out in order instead
+    std::vector<VkDeviceSize> staging_offsets;
+    VkDeviceSize staging_size = 0;
+    for (size_t i = 0; i < num_images; ++i) {
+        VulkanResource* resource = results[i];
+        if (view_infos && view_infos[i]) {
+            VkImageViewCreateInfo& local_view_info = resourceTable.ViewInfo(indices[i]).ImageView;
+            local_view_info = *view_infos[i];
+            local_view_info.image = (VkImage)resource->Handle;
+            resource->ViewInfo = &local_view_info;
+            VkResult result = vkCreateImageView(device->vkHandle(), &local_view_info, nullptr, reinterpret_cast<VkImageView*>(&resource->ViewHandle));
+            VkAssert(result);
+        }
+
+        if (initial_data && initial_data[i]) {
+            // bufferOffset must be a multiple of both 4 and the texel block size
+            const VkDeviceSize alignment = std::lcm(VkDeviceSize(4), texelBlockSize(infos[i].format));
+            for (size_t j = 0; j < (num_data ? num_data[i] : 0); ++j) {
+                if (initial_data[i][j].DataSize == 0) {
+                    continue;
+                }
+                staging_size = ((staging_size + alignment - 1) / alignment) * alignment;
+                staging_offsets.emplace_back(staging_size);
+                staging_size += initial_data[i][j].DataSize;
+            }
+        }
+    }
+
+    // As with buffers: an empty staging buffer isn't valid
+    if (staging_offsets.empty()) {
+        return;
+    }
+
+    auto upload_buffer = std::make_unique<UploadBuffer>(device, allocator.get(), staging_size);
+
+    std::vector<upload_copy_t> upload_copies;
+    upload_copies.reserve(staging_offsets.size());
+    std::vector<VkImageMemoryBarrier> pre_barriers;
+    std::vector<VkImageMemoryBarrier> post_barriers;
+    std::vector<std::vector<VkBufferImageCopy>> image_copies(num_images);
+
+    size_t staging_idx = 0;
+    for (size_t i = 0; i < num_images; ++i) {
+        if (!initial_data || !initial_data[i]) {
+            continue;
+        }
+
+        const VkImageCreateInfo* info = reinterpret_cast<VkImageCreateInfo*>(results[i]->Info);
+        for (size_t j = 0; j < (num_data ? num_data[i] : 0); ++j) {
+            const gpu_image_resource_data_t& data = initial_data[i][j];
+            if (data.DataSize == 0) {
+                continue;
+            }
+#ifndef NDEBUG
+            assert(data.MipLevel < info->mipLevels);
+            assert(data.ArrayLayer < info->arrayLayers);
+#endif // DEBUG
+            const VkDeviceSize src_offset = staging_offsets[staging_idx++];
+            upload_copies.emplace_back(upload_copy_t{ data.Data, data.DataSize, src_offset });
+            image_copies[i].emplace_back(VkBufferImageCopy{
+                src_offset,
+                0,
+                0,
+                VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, data.MipLevel, data.ArrayLayer, data.NumLayers },
+                VkOffset3D{ 0, 0, 0 },
+                VkExtent3D{ data.Width, data.Height, 1 }
+            });
+        }
+        if (image_copies[i].empty()) {
+            continue;
+        }
+
+        pre_barriers.emplace_back(VkImageMemoryBarrier{
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            nullptr,
+            0,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            device->QueueFamilyIndices().Transfer,
+            device->QueueFamilyIndices().Transfer,
+            (VkImage)results[i]->Handle,
+            VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, info->mipLevels, 0, info->arrayLayers }
+        });
+        post_barriers.emplace_back(VkImageMemoryBarrier{
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            nullptr,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            accessFlagsFromImageUsage(info->usage),
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            imageLayoutFromUsage(info->usage),
+            device->QueueFamilyIndices().Transfer,
+            device->QueueFamilyIndices().Graphics,
+            (VkImage)results[i]->Handle,
+            VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, info->mipLevels, 0, info->arrayLayers }
+        });
+    }
+
+    upload_buffer->SetData(upload_copies.data(), upload_copies.size());
+
+    auto& transfer_system = ResourceTransferSystem::GetTransferSystem();
+    uint64_t batch_id = 0;
+    {
+        auto guard = transfer_system.AcquireSpinLock();
+        batch_id = guard.BatchID;
+        VkCommandBuffer cmd = transfer_system.TransferCmdBuffer();
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(pre_barriers.size()), pre_barriers.data());
+        for (size_t i = 0; i < num_images; ++i) {
+            if (image_copies[i].empty()) {
+                continue;
+            }
+            vkCmdCopyBufferToImage(cmd, upload_buffer->Buffer, (VkImage)results[i]->Handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(image_copies[i].size()), image_copies[i].data());
+        }
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(post_barriers.size()), post_barriers.data());
+    }
+
+    {
+        std::lock_guard<std::mutex> emplaceGuard(containerMutex);
+        uploadBuffers.emplace_back(pending_upload_buffer_t{ batch_id, std::move(upload_buffer) });
+    }
+}
+
+void ResourceContext::CreateTransientResources(const size_t num_resources, const transient_resource_info_t* infos, VulkanResource** results) {
+    std::vector<uint32_t> indices(num_resources);
+    std::vector<transient_packing_request_t> packing_requests(num_resources);
+
+    for (size_t i = 0; i < num_resources; ++i) {
+        if ((infos[i].Type != resource_type::BUFFER) && (infos[i].Type != resource_type::IMAGE)) {
+            LOG(ERROR) << "Transient resources must be buffers or images!";
+            throw std::invalid_argument("Transient resources must be buffers or images!");
+        }
+        if (infos[i].LastPass < infos[i].FirstPass) {
+            LOG(ERROR) << "Transient resource has a lifetime that ends before it begins!";
+            throw std::invalid_argument("Transient resource LastPass must not precede FirstPass!");
+        }
+    }
+
+    for (size_t i = 0; i < num_resources; ++i) {
+        const transient_resource_info_t& transient_info = infos[i];
+        const uint32_t idx = resourceTable.Allocate();
+        indices[i] = idx;
+        VulkanResource* resource = &resourceTable.Resource(idx);
+        resourceTable.MemoryType(idx) = memory_type::DEVICE_LOCAL;
+        resource->Type = transient_info.Type;
+        resource->UserData = transient_info.UserData;
+        resource->SlotHandle = resourceTable.Handle(idx);
+
+        VkMemoryRequirements memory_reqs;
+        vpr::AllocationType alloc_type;
+        if (transient_info.Type == resource_type::BUFFER) {
+            VkBufferCreateInfo& buffer_info = resourceTable.Info(idx).Buffer;
+            buffer_info = *reinterpret_cast<const VkBufferCreateInfo*>(transient_info.Info);
+            resource->Info = &buffer_info;
+            VkResult result = vkCreateBuffer(device->vkHandle(), &buffer_info, nullptr, reinterpret_cast<VkBuffer*>(&resource->Handle));
+            VkAssert(result);
+            vkGetBufferMemoryRequirements(device->vkHandle(), (VkBuffer)resource->Handle, &memory_reqs);
+            alloc_type = vpr::AllocationType::Buffer;
+        }
+        else {
+            VkImageCreateInfo& image_info = resourceTable.Info(idx).Image;
+            image_info = *reinterpret_cast<const VkImageCreateInfo*>(transient_info.Info);
+            resource->Info = &image_info;
+            VkResult result = vkCreateImage(device->vkHandle(), &image_info, nullptr, reinterpret_cast<VkImage*>(&resource->Handle));
+            VkAssert(result);
+            vkGetImageMemoryRequirements(device->vkHandle(), (VkImage)resource->Handle, &memory_reqs);
+            alloc_type = imageAllocationType(&image_info);
+        }
+
+        packing_requests[i] = transient_packing_request_t{ makePackingRequest(memory_reqs, alloc_type), transient_info.FirstPass, transient_info.LastPass };
+        results[i] = resource;
+    }
+
+    bindSharedBlocks(indices, PlanTransientAliasing(packing_requests.data(), packing_requests.size()), memory_type::DEVICE_LOCAL);
+
+    for (size_t i = 0; i < num_resources; ++i) {
+        if (infos[i].ViewInfo == nullptr) {
+            continue;
+        }
+
+        VulkanResource* resource = results[i];
+        if (resource->Type == resource_type::BUFFER) {
+            VkBufferViewCreateInfo& local_view_info = resourceTable.ViewInfo(indices[i]).BufferView;
+            local_view_info = *reinterpret_cast<const VkBufferViewCreateInfo*>(infos[i].ViewInfo);
+            local_view_info.buffer = (VkBuffer)resource->Handle;
+            resource->ViewInfo = &local_view_info;
+            VkResult result = vkCreateBufferView(device->vkHandle(), &local_view_info, nullptr, reinterpret_cast<VkBufferView*>(&resource->ViewHandle));
+            VkAssert(result);
+        }
+        else {
+            VkImageViewCreateInfo& local_view_info = resourceTable.ViewInfo(indices[i]).ImageView;
+            local_view_info = *reinterpret_cast<const VkImageViewCreateInfo*>(infos[i].ViewInfo);
+            local_view_info.image = (VkImage)resource->Handle;
+            resource->ViewInfo = &local_view_info;
+            VkResult result = vkCreateImageView(device->vkHandle(), &local_view_info, nullptr, reinterpret_cast<VkImageView*>(&resource->ViewHandle));
+            VkAssert(result);
+        }
+    }
+}
+
 VulkanResource * ResourceContext::CreateResourceCopy(VulkanResource * src) {
     return nullptr;
 }
@@ -255,68 +690,181 @@ void ResourceContext::CopyResource(VulkanResource * src, VulkanResource * dest)
 }
 
 void ResourceContext::DestroyResource(VulkanResource * rsrc) {
-    std::lock_guard<std::mutex> eraseGuard(containerMutex);
-    auto iter = std::find_if(std::begin(resources), std::end(resources), [rsrc](const decltype(resources)::value_type& entry) {
-        return entry.get() == rsrc;
-    });
-    if (iter == std::end(resources)) {
+    // Retiring fails on stale handles, so only one of several threads destroying the same resource queues it
+    if ((rsrc == nullptr) || !retireResource(rsrc->SlotHandle)) {
         LOG(ERROR) << "Tried to erase resource that isn't in internal containers!";
         throw std::runtime_error("Tried to erase resource that isn't in internal containers!");
     }
-    else {
-        destroyResource(iter);
-    }
 }
 
 void* ResourceContext::MapResourceMemory(VulkanResource* resource, size_t size, size_t offset) {
     void* mapped_ptr = nullptr;
-    auto& alloc = resourceAllocations.at(resource);
-    if (resourceInfos.resourceMemoryType.at(resource) == memory_type::HOST_VISIBLE) {
-        mappedRanges[resource] = VkMappedMemoryRange{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, nullptr, alloc.Memory(), alloc.Offset() + offset, size == 0 ? alloc.Size : size }; 
-        VkResult result = vkInvalidateMappedMemoryRanges(device->vkHandle(), 1, &mappedRanges[resource]);
+    const uint32_t idx = resourceIndex(resource);
+    if (resourceTable.PersistentMapping(idx) != nullptr) {
+        return reinterpret_cast<uint8_t*>(resourceTable.PersistentMapping(idx)) + offset;
+    }
+    auto& alloc = resourceTable.Allocation(idx);
+    const resource_memory_range_t& memory_range = resourceTable.MemoryRange(idx);
+    if (resourceTable.MemoryType(idx) == memory_type::HOST_VISIBLE) {
+        VkMappedMemoryRange& mapped_range = resourceTable.MappedRange(idx);
+        mapped_range = alignedMappedRange(idx, offset, size);
+        VkResult result = vkInvalidateMappedMemoryRanges(device->vkHandle(), 1, &mapped_range);
         VkAssert(result);
     }
-    alloc.Map(size == 0 ? alloc.Size : size, alloc.Offset() + offset, &mapped_ptr);
+    alloc.Map(size == 0 ? (memory_range.Size - offset) : size, memory_range.Offset + offset, &mapped_ptr);
     return mapped_ptr;
 }
 
 void ResourceContext::UnmapResourceMemory(VulkanResource* resource) {
-    resourceAllocations.at(resource).Unmap();
-    if (resourceInfos.resourceMemoryType.at(resource) == memory_type::HOST_VISIBLE) {
-        VkResult result = vkFlushMappedMemoryRanges(device->vkHandle(), 1, &mappedRanges[resource]);
+    const uint32_t idx = resourceIndex(resource);
+    if (resourceTable.PersistentMapping(idx) != nullptr) {
+        // Stays mapped: just make sure whatever range was mapped gets flushed
+        if (resourceTable.MemoryType(idx) == memory_type::HOST_VISIBLE) {
+            std::lock_guard<std::mutex> flushGuard(flushMutex);
+            pendingFlushes.emplace_back(resourceTable.MappedRange(idx));
+        }
+        return;
+    }
+    resourceTable.Allocation(idx).Unmap();
+    if (resourceTable.MemoryType(idx) == memory_type::HOST_VISIBLE) {
+        VkResult result = vkFlushMappedMemoryRanges(device->vkHandle(), 1, &resourceTable.MappedRange(idx));
         VkAssert(result);
     }
 }
 
+void* ResourceContext::PersistentlyMapResource(VulkanResource* resource) {
+    const uint32_t idx = resourceIndex(resource);
+    const memory_type mem_type = resourceTable.MemoryType(idx);
+    if ((mem_type != memory_type::HOST_VISIBLE) && (mem_type != memory_type::HOST_VISIBLE_AND_COHERENT)) {
+        LOG(ERROR) << "Tried to persistently map a resource that isn't host-visible!";
+        throw std::runtime_error("Only host-visible resources can be persistently mapped.");
+    }
+
+    void*& mapping = resourceTable.PersistentMapping(idx);
+    if (mapping == nullptr) {
+        // Same offsets as MapResourceMemory(), so both point at where the resource starts within a shared block
+        const resource_memory_range_t& memory_range = resourceTable.MemoryRange(idx);
+        resourceTable.Allocation(idx).Map(memory_range.Size, memory_range.Offset, &mapping);
+        // Used by UnmapResourceMemory(), so that callers still using Map/Unmap get their writes flushed too
+        resourceTable.MappedRange(idx) = alignedMappedRange(idx, 0, 0);
+    }
+
+    return mapping;
+}
+
+void ResourceContext::FlushMappedRange(VulkanResource* resource, size_t offset, size_t size) {
+    const uint32_t idx = resourceIndex(resource);
+    if (resourceTable.MemoryType(idx) != memory_type::HOST_VISIBLE) {
+        return;
+    }
+
+    const VkMappedMemoryRange range = alignedMappedRange(idx, offset, size);
+    std::lock_guard<std::mutex> flushGuard(flushMutex);
+    pendingFlushes.emplace_back(range);
+}
+
+void ResourceContext::FlushMappedRanges() {
+    std::vector<VkMappedMemoryRange> ranges;
+    {
+        std::lock_guard<std::mutex> flushGuard(flushMutex);
+        ranges.swap(pendingFlushes);
+    }
+
+    if (ranges.empty()) {
+        return;
+    }
+
+    // Merge overlapping and adjacent ranges in the same memory object, so resources updated in pieces get a single range
+    std::sort(std::begin(ranges), std::end(ranges), [](const VkMappedMemoryRange& lhs, const VkMappedMemoryRange& rhs) {
+        if (lhs.memory != rhs.memory) {
+            return lhs.memory < rhs.memory;
+        }
+        return lhs.offset < rhs.offset;
+    });
+
+    std::vector<VkMappedMemoryRange> merged_ranges;
+    merged_ranges.reserve(ranges.size());
+    for (const auto& range : ranges) {
+        if (!merged_ranges.empty()) {
+            VkMappedMemoryRange& prev = merged_ranges.back();
+            // Ranges running to the end of the memory object (VK_WHOLE_SIZE) absorb everything after them
+            if ((prev.memory == range.memory) && ((prev.size == VK_WHOLE_SIZE) || (range.offset <= prev.offset + prev.size))) {
+                if ((prev.size == VK_WHOLE_SIZE) || (range.size == VK_WHOLE_SIZE)) {
+                    prev.size = VK_WHOLE_SIZE;
+                }
+                else {
+                    prev.size = std::max(prev.offset + prev.size, range.offset + range.size) - prev.offset;
+                }
+                continue;
+            }
+        }
+        merged_ranges.emplace_back(range);
+    }
+
+    VkResult result = vkFlushMappedMemoryRanges(device->vkHandle(), static_cast<uint32_t>(merged_ranges.size()), merged_ranges.data());
+    VkAssert(result);
+}
+
 void ResourceContext::Update() {
+    FlushMappedRanges();
     auto& transfer_system = ResourceTransferSystem::GetTransferSystem();
     transfer_system.CompleteTransfers();
+    const uint64_t current_frame = ++frameIndex;
+    if (!frameCompletionReported) {
+        processDestructions(current_frame - SlotRetirementLatency);
+    }
+}
+
+uint64_t ResourceContext::CurrentFrame() const noexcept {
+    return frameIndex;
+}
+
+void ResourceContext::CompleteFrame(const uint64_t frame) {
+    frameCompletionReported = true;
+    uint64_t prev_completed = completedFrame.load();
+    while ((frame > prev_completed) && !completedFrame.compare_exchange_weak(prev_completed, frame)) {}
+    processDestructions(completedFrame);
+}
+
+void ResourceContext::WaitForTransfers() {
+    auto& transfer_system = ResourceTransferSystem::GetTransferSystem();
+    transfer_system.WaitForTransfers();
 }
 
 void ResourceContext::FlushStagingBuffers() {
+    std::lock_guard<std::mutex> eraseGuard(containerMutex);
     
     if (uploadBuffers.empty()) {
         return;
     }
 
-    for (auto& buff : uploadBuffers) {
-        allocator->FreeMemory(&buff->alloc);
-        vkDestroyBuffer(device->vkHandle(), buff->Buffer, nullptr);
-        buff.reset();
+    // Only free buffers used by batches that have completed: the rest are still being read from
+    auto& transfer_system = ResourceTransferSystem::GetTransferSystem();
+    auto first_pending = std::partition(std::begin(uploadBuffers), std::end(uploadBuffers), [&transfer_system](const pending_upload_buffer_t& upload) {
+        return transfer_system.BatchComplete(upload.BatchID);
+    });
+
+    for (auto iter = std::begin(uploadBuffers); iter != first_pending; ++iter) {
+        allocator->FreeMemory(&iter->Buffer->alloc);
+        vkDestroyBuffer(device->vkHandle(), iter->Buffer->Buffer, nullptr);
+        iter->Buffer.reset();
     }
 
-    uploadBuffers.clear(); uploadBuffers.shrink_to_fit();
+    uploadBuffers.erase(std::begin(uploadBuffers), first_pending);
 }
 
 void ResourceContext::Destroy() {
-    for (auto& rsrc : resources) {
-        DestroyResource(rsrc.get());
-    }
+    WaitForTransfers();
+    FlushStagingBuffers();
+    resourceTable.ForEachLive([this](const uint32_t idx) {
+        retireResource(resourceTable.Handle(idx));
+    });
+    processDestructions(std::numeric_limits<uint64_t>::max());
 }
 
 void ResourceContext::setBufferInitialDataHostOnly(VulkanResource* resource, const size_t num_data, const gpu_resource_data_t* initial_data, vpr::Allocation& alloc, memory_type _memory_type) {
     void* mapped_address = nullptr;
-    alloc.Map(alloc.Size, 0, &mapped_address);
+    alloc.Map(alloc.Size, alloc.Offset(), &mapped_address);
     size_t offset = 0;
     for (size_t i = 0; i < num_data; ++i) {
         void* curr_address = (void*)((size_t)mapped_address + offset);
@@ -334,13 +882,8 @@ void ResourceContext::setBufferInitialDataHostOnly(VulkanResource* resource, con
 void ResourceContext::setBufferInitialDataUploadBuffer(VulkanResource* resource, const size_t num_data, const gpu_resource_data_t* initial_data, vpr::Allocation& alloc) {
     // first copy user data into another buffer: we don't know how long the users data will persist, and we
     // need it to last until this submission completes. so lets take care of that ourself.
-    UploadBuffer* upload_buffer = nullptr;
-    {
-        std::lock_guard<std::mutex> emplaceGuard(containerMutex);
-        uploadBuffers.emplace_back(std::make_unique<UploadBuffer>(device, allocator.get(), reinterpret_cast<VkBufferCreateInfo*>(resource->Info)->size));
-        upload_buffer = uploadBuffers.back().get();
-    }
-    
+    auto upload_buffer = std::make_unique<UploadBuffer>(device, allocator.get(), reinterpret_cast<VkBufferCreateInfo*>(resource->Info)->size);
+
     {
         size_t offset = 0;
         for (size_t i = 0; i < num_data; ++i) {
@@ -350,8 +893,10 @@ void ResourceContext::setBufferInitialDataUploadBuffer(VulkanResource* resource,
     }
 
     auto& transfer_system = ResourceTransferSystem::GetTransferSystem();
+    uint64_t batch_id = 0;
     {
         auto guard = transfer_system.AcquireSpinLock();
+        batch_id = guard.BatchID;
         auto cmd = transfer_system.TransferCmdBuffer();        
         const VkBufferCreateInfo* p_info = reinterpret_cast<VkBufferCreateInfo*>(resource->Info);
         const VkBufferMemoryBarrier memory_barrier0 {
@@ -388,16 +933,21 @@ void ResourceContext::setBufferInitialDataUploadBuffer(VulkanResource* resource,
         };
         vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &memory_barrier1, 0, nullptr);
     }
+
+    {
+        std::lock_guard<std::mutex> emplaceGuard(containerMutex);
+        uploadBuffers.emplace_back(pending_upload_buffer_t{ batch_id, std::move(upload_buffer) });
+    }
 }
 
 void ResourceContext::setImageInitialData(VulkanResource* resource, const size_t num_data, const gpu_image_resource_data_t* initial_data, vpr::Allocation& alloc) {
 
-    UploadBuffer* upload_buffer = nullptr;
-    {
-        std::lock_guard<std::mutex> emplaceGuard(containerMutex);
-        uploadBuffers.emplace_back(std::make_unique<UploadBuffer>(device, allocator.get(), alloc.Size));
-        upload_buffer = uploadBuffers.back().get();
+    // Size staging from the data itself: alloc may be a shared block, much larger than this image
+    VkDeviceSize staging_size = 0;
+    for (size_t i = 0; i < num_data; ++i) {
+        staging_size += initial_data[i].DataSize;
     }
+    auto upload_buffer = std::make_unique<UploadBuffer>(device, allocator.get(), staging_size);
 
     const VkImageCreateInfo* info = reinterpret_cast<VkImageCreateInfo*>(resource->Info);
     std::vector<VkBufferImageCopy> buffer_image_copies;
@@ -422,8 +972,10 @@ void ResourceContext::setImageInitialData(VulkanResource* resource, const size_t
 
 
     auto& transfer_system = ResourceTransferSystem::GetTransferSystem();
+    uint64_t batch_id = 0;
     {
         auto guard = transfer_system.AcquireSpinLock();
+        batch_id = guard.BatchID;
         VkCommandBuffer cmd = transfer_system.TransferCmdBuffer();
         const VkImageMemoryBarrier barrier0{
             VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -454,6 +1006,11 @@ void ResourceContext::setImageInitialData(VulkanResource* resource, const size_t
         vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier1);
     }
 
+    {
+        std::lock_guard<std::mutex> emplaceGuard(containerMutex);
+        uploadBuffers.emplace_back(pending_upload_buffer_t{ batch_id, std::move(upload_buffer) });
+    }
+
 }
 
 vpr::AllocationRequirements ResourceContext::getAllocReqs(memory_type _memory_type) const noexcept {
@@ -476,6 +1033,99 @@ vpr::AllocationRequirements ResourceContext::getAllocReqs(memory_type _memory_ty
     return alloc_reqs;
 }
 
+void ResourceContext::bindSharedBlocks(const std::vector<uint32_t>& indices, const packing_plan_t& plan, const memory_type _memory_type) {
+    std::vector<uint32_t> block_ids(plan.Blocks.size());
+    std::vector<vpr::Allocation> block_allocs(plan.Blocks.size());
+
+    {
+        std::lock_guard<std::mutex> blockGuard(sharedBlockMutex);
+        for (size_t i = 0; i < plan.Blocks.size(); ++i) {
+            const packing_block_t& block = plan.Blocks[i];
+            if (!freeSharedBlocks.empty()) {
+                block_ids[i] = freeSharedBlocks.back();
+                freeSharedBlocks.pop_back();
+            }
+            else {
+                block_ids[i] = static_cast<uint32_t>(sharedBlocks.size());
+                sharedBlocks.emplace_back(shared_memory_block_t{});
+            }
+
+            const VkMemoryRequirements block_reqs{ block.Size, block.Alignment, static_cast<uint32_t>(block.GroupKey & 0xffffffff) };
+            const vpr::AllocationType block_type = static_cast<vpr::AllocationType>(block.GroupKey >> 32);
+            shared_memory_block_t& shared_block = sharedBlocks[block_ids[i]];
+            allocator->AllocateMemory(block_reqs, getAllocReqs(_memory_type), block_type, shared_block.Allocation);
+            block_allocs[i] = shared_block.Allocation;
+        }
+
+        for (const auto& range : plan.Ranges) {
+            ++sharedBlocks[block_ids[range.Block]].NumResources;
+        }
+    }
+
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const uint32_t idx = indices[i];
+        const packed_range_t& range = plan.Ranges[i];
+        const vpr::Allocation& block_alloc = block_allocs[range.Block];
+        VulkanResource& resource = resourceTable.Resource(idx);
+        VkResult result = VK_SUCCESS;
+        if (resource.Type == resource_type::BUFFER) {
+            result = vkBindBufferMemory(device->vkHandle(), (VkBuffer)resource.Handle, block_alloc.Memory(), block_alloc.Offset() + range.Offset);
+        }
+        else {
+            result = vkBindImageMemory(device->vkHandle(), (VkImage)resource.Handle, block_alloc.Memory(), block_alloc.Offset() + range.Offset);
+        }
+        VkAssert(result);
+        resourceTable.Allocation(idx) = block_alloc;
+        resourceTable.MemoryRange(idx) = resource_memory_range_t{ block_alloc.Offset() + range.Offset, range.Size };
+        resourceTable.SharedBlock(idx) = block_ids[range.Block] + 1;
+    }
+}
+
+void ResourceContext::releaseSharedBlock(const uint32_t shared_block) {
+    std::lock_guard<std::mutex> blockGuard(sharedBlockMutex);
+    shared_memory_block_t& block = sharedBlocks[shared_block - 1];
+    if (--block.NumResources == 0) {
+        allocator->FreeMemory(&block.Allocation);
+        block.Allocation = vpr::Allocation();
+        freeSharedBlocks.emplace_back(shared_block - 1);
+    }
+}
+
+VkMappedMemoryRange ResourceContext::alignedMappedRange(const uint32_t idx, const size_t offset, const size_t size) {
+    // Flushed ranges must be aligned to nonCoherentAtomSize
+    const vpr::Allocation& alloc = resourceTable.Allocation(idx);
+    const resource_memory_range_t& memory_range = resourceTable.MemoryRange(idx);
+    const VkDeviceSize range_begin = memory_range.Offset + offset;
+    const VkDeviceSize range_end = memory_range.Offset + ((size == 0) ? memory_range.Size : (offset + size));
+    const VkDeviceSize aligned_begin = (range_begin / nonCoherentAtomSize) * nonCoherentAtomSize;
+    const VkDeviceSize aligned_end = ((range_end + nonCoherentAtomSize - 1) / nonCoherentAtomSize) * nonCoherentAtomSize;
+    // Rounding up past the end of the allocation could run past the end of the memory object, if the allocation
+    // sits at the end of its block: the allocator doesn't tell us how big that is, so flush to the end of it instead
+    const VkDeviceSize aligned_size = (aligned_end > alloc.Offset() + alloc.Size) ? VK_WHOLE_SIZE : (aligned_end - aligned_begin);
+    return VkMappedMemoryRange{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, nullptr, alloc.Memory(), aligned_begin, aligned_size };
+}
+
+void ResourceContext::unmapPersistent(const uint32_t idx) {
+    void*& mapping = resourceTable.PersistentMapping(idx);
+    if (mapping != nullptr) {
+        resourceTable.Allocation(idx).Unmap();
+        mapping = nullptr;
+    }
+}
+
+vpr::AllocationType ResourceContext::imageAllocationType(const VkImageCreateInfo* info) const {
+    VkImageTiling format_tiling = device->GetFormatTiling(info->format, featureFlagsFromUsage(info->usage));
+    if (format_tiling == VK_IMAGE_TILING_LINEAR) {
+        return vpr::AllocationType::ImageLinear;
+    }
+    else if (format_tiling == VK_IMAGE_TILING_OPTIMAL) {
+        return vpr::AllocationType::ImageTiled;
+    }
+    else {
+        return vpr::AllocationType::Unknown;
+    }
+}
+
 VkFormatFeatureFlags ResourceContext::featureFlagsFromUsage(const VkImageUsageFlags flags) const noexcept {
     VkFormatFeatureFlags result = 0;
     if (flags & VK_IMAGE_USAGE_SAMPLED_BIT) {
@@ -493,16 +1143,54 @@ VkFormatFeatureFlags ResourceContext::featureFlagsFromUsage(const VkImageUsageFl
     return result;
 }
 
-void ResourceContext::destroyResource(resource_iter_t iter) {
-    switch (iter->get()->Type) {
+uint32_t ResourceContext::resourceIndex(const VulkanResource* resource) const {
+    if ((resource == nullptr) || !resourceTable.Valid(resource->SlotHandle)) {
+        LOG(ERROR) << "Used a resource handle that is invalid, or refers to a destroyed resource!";
+        throw std::runtime_error("Invalid or stale resource handle.");
+    }
+    return ResourceTable::Index(resource->SlotHandle);
+}
+
+bool ResourceContext::retireResource(const resource_handle_t handle) {
+    // Handle is invalidated right away: the slot (and so its contents) stays untouched until the frame completes
+    const uint64_t retired_frame = frameIndex;
+    if (!resourceTable.Retire(handle, retired_frame)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> destructionGuard(destructionMutex);
+    pendingDestructions.emplace_back(pending_destruction_t{ ResourceTable::Index(handle), retired_frame });
+    return true;
+}
+
+void ResourceContext::processDestructions(const uint64_t completed_frame) {
+    std::vector<pending_destruction_t> ready;
+    {
+        std::lock_guard<std::mutex> destructionGuard(destructionMutex);
+        auto first_pending = std::partition(std::begin(pendingDestructions), std::end(pendingDestructions), [completed_frame](const pending_destruction_t& entry) {
+            return entry.Frame <= completed_frame;
+        });
+        ready.assign(std::begin(pendingDestructions), first_pending);
+        pendingDestructions.erase(std::begin(pendingDestructions), first_pending);
+    }
+
+    for (const auto& entry : ready) {
+        destroyResource(entry.Index);
+    }
+
+    // Slots are only handed out again after their resources are gone
+    resourceTable.Reclaim(completed_frame);
+}
+
+void ResourceContext::destroyResource(const uint32_t idx) {
+    switch (resourceTable.Resource(idx).Type) {
     case resource_type::BUFFER:
-        destroyBuffer(iter);
+        destroyBuffer(idx);
         break;
     case resource_type::IMAGE:
-        destroyImage(iter);
+        destroyImage(idx);
         break;
     case resource_type::SAMPLER:
-        destroySampler(iter);
+        destroySampler(idx);
         break;
     case resource_type::INVALID:
         [[fallthrough]];
@@ -511,35 +1199,39 @@ void ResourceContext::destroyResource(resource_iter_t iter) {
     }
 }
 
-void ResourceContext::destroyBuffer(resource_iter_t iter) {
-    VulkanResource* rsrc = iter->get();
+void ResourceContext::destroyBuffer(const uint32_t idx) {
+    VulkanResource* rsrc = &resourceTable.Resource(idx);
     if (rsrc->ViewHandle != 0) {
         vkDestroyBufferView(device->vkHandle(), (VkBufferView)rsrc->ViewHandle, nullptr);
     }
     vkDestroyBuffer(device->vkHandle(), (VkBuffer)rsrc->Handle, nullptr);
-    allocator->FreeMemory(&resourceAllocations.at(rsrc)); 
-    resources.erase(iter);
-    resourceInfos.bufferInfos.erase(rsrc);
-    resourceInfos.bufferViewInfos.erase(rsrc);
-    resourceAllocations.erase(rsrc);
+    unmapPersistent(idx);
+    const uint32_t shared_block = resourceTable.SharedBlock(idx);
+    if (shared_block != 0) {
+        releaseSharedBlock(shared_block);
+    }
+    else {
+        allocator->FreeMemory(&resourceTable.Allocation(idx));
+    }
 }
 
-void ResourceContext::destroyImage(resource_iter_t iter) {
-    VulkanResource* rsrc = iter->get();
+void ResourceContext::destroyImage(const uint32_t idx) {
+    VulkanResource* rsrc = &resourceTable.Resource(idx);
     if (rsrc->ViewHandle != 0) {
         vkDestroyImageView(device->vkHandle(), (VkImageView)rsrc->ViewHandle, nullptr);
     }
     vkDestroyImage(device->vkHandle(), (VkImage)rsrc->Handle, nullptr);
-    allocator->FreeMemory(&resourceAllocations.at(rsrc));
-    resources.erase(iter);
-    resourceInfos.imageInfos.erase(rsrc);
-    resourceInfos.imageViewInfos.erase(rsrc);
-    resourceAllocations.erase(rsrc);
+    unmapPersistent(idx);
+    const uint32_t shared_block = resourceTable.SharedBlock(idx);
+    if (shared_block != 0) {
+        releaseSharedBlock(shared_block);
+    }
+    else {
+        allocator->FreeMemory(&resourceTable.Allocation(idx));
+    }
 }
 
-void ResourceContext::destroySampler(resource_iter_t iter) {
-    VulkanResource* rsrc = iter->get();
+void ResourceContext::destroySampler(const uint32_t idx) {
+    VulkanResource* rsrc = &resourceTable.Resource(idx);
     vkDestroySampler(device->vkHandle(), (VkSampler)rsrc->Handle, nullptr);
-    resourceInfos.samplerInfos.erase(rsrc);
-    resources.erase(iter);
 }
@@ -6,6 +6,8 @@
 #include "renderer_context/include/core/RendererContext.hpp"
 #include "ResourceContext.hpp"
 #include "ResourceLoader.hpp"
+#include "TransferSystem.hpp"
+#include "StreamingCopy.hpp"
 #include "Allocator.hpp"
 #include "PipelineCache.hpp"
 #include "PhysicalDevice.hpp"
@@ -20,7 +22,7 @@ static ResourceContext* resourceContext = nullptr;
 static void BeginResizeCallback(uint64_t handle, uint32_t w, uint32_t h) {
     auto& loader = ResourceLoader::GetResourceLoader();
     loader.Stop();
-    resourceContext->Update();
+    resourceContext->WaitForTransfers();
     resourceContext->FlushStagingBuffers();
 }
 
@@ -68,6 +70,7 @@ static void Unload() {
     if (resourceContext) {
         delete resourceContext;
     }
+    ResourceTransferSystem::GetTransferSystem().Destroy();
 }
 
 static void LogicalUpdate() {
@@ -166,6 +169,56 @@ uint64_t GetVkDevice() {
     return (uint64_t)rendererContext->LogicalDevice;
 }
 
+uint64_t GetTransferBatchID() {
+    return ResourceTransferSystem::GetTransferSystem().CurrentBatchID();
+}
+
+bool TransferBatchComplete(uint64_t batch_id) {
+    return ResourceTransferSystem::GetTransferSystem().BatchComplete(batch_id);
+}
+
+void AddTransferCompleteCallback(uint64_t batch_id, void* requester, ResourceContext_API::signal_function_t signal_fn, void* user_data) {
+    ResourceTransferSystem::GetTransferSystem().AddCompletionCallback(batch_id, signal_fn, requester, user_data);
+}
+
+void CreateBuffers(const size_t num_buffers, const struct VkBufferCreateInfo* infos, const struct VkBufferViewCreateInfo* const* view_infos, const size_t* num_data,
+    const gpu_resource_data_t* const* initial_data, const uint32_t _memory_type, void* const* user_data, VulkanResource** results) {
+    resourceContext->CreateBuffers(num_buffers, infos, view_infos, num_data, initial_data, convertToMemoryType(_memory_type), user_data, results);
+}
+
+void CreateImages(const size_t num_images, const struct VkImageCreateInfo* infos, const struct VkImageViewCreateInfo* const* view_infos, const size_t* num_data,
+    const gpu_image_resource_data_t* const* initial_data, const uint32_t _memory_type, void* const* user_data, VulkanResource** results) {
+    resourceContext->CreateImages(num_images, infos, view_infos, num_data, initial_data, convertToMemoryType(_memory_type), user_data, results);
+}
+
+void CreateTransientResources(const size_t num_resources, const transient_resource_info_t* infos, VulkanResource** results) {
+    resourceContext->CreateTransientResources(num_resources, infos, results);
+}
+
+void* PersistentlyMapResource(VulkanResource* resource) {
+    return resourceContext->PersistentlyMapResource(resource);
+}
+
+void FlushMappedRange(VulkanResource* resource, size_t offset, size_t size) {
+    resourceContext->FlushMappedRange(resource, offset, size);
+}
+
+void FlushMappedRanges() {
+    resourceContext->FlushMappedRanges();
+}
+
+void StreamingCopy(void* dst, const void* src, size_t size) {
+    StreamingMemcpy(dst, src, size);
+}
+
+uint64_t GetCurrentFrame() {
+    return resourceContext->CurrentFrame();
+}
+
+void CompleteFrame(uint64_t frame) {
+    resourceContext->CompleteFrame(frame);
+}
+
 static Plugin_API* GetCoreAPI() {
     static Plugin_API api{ nullptr };
     api.PluginID = GetID;
@@ -194,6 +247,18 @@ static ResourceContext_API* GetResourceAPI() {
     api.LoadFile = LoadFile;
     api.UnloadFile = UnloadFile;
     api.GetVkDevice = GetVkDevice;
+    api.GetTransferBatchID = GetTransferBatchID;
+    api.TransferBatchComplete = TransferBatchComplete;
+    api.AddTransferCompleteCallback = AddTransferCompleteCallback;
+    api.CreateBuffers = CreateBuffers;
+    api.CreateImages = CreateImages;
+    api.CreateTransientResources = CreateTransientResources;
+    api.PersistentlyMapResource = PersistentlyMapResource;
+    api.FlushMappedRange = FlushMappedRange;
+    api.FlushMappedRanges = FlushMappedRanges;
+    api.StreamingMemcpy = StreamingCopy;
+    api.GetCurrentFrame = GetCurrentFrame;
+    api.CompleteFrame = CompleteFrame;
     return &api;
 }
 
@@ -0,0 +1,311 @@
+#include "ResourcePacking.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <limits>
+#include "doctest/doctest.h"
+
+namespace {
+
+    constexpr uint64_t alignUp(const uint64_t value, const uint64_t alignment) noexcept {
+        return ((value + alignment - 1) / alignment) * alignment;
+    }
+
+    constexpr bool isPowerOfTwo(const uint64_t value) noexcept {
+        return (value != 0) && ((value & (value - 1)) == 0);
+    }
+
+}
+
+packing_plan_t PlanResourcePacking(const packing_request_t* requests, const size_t num_requests, const uint64_t max_block_size) {
+    packing_plan_t result;
+    result.Ranges.resize(num_requests);
+
+    std::vector<size_t> order(num_requests);
+    std::iota(std::begin(order), std::end(order), 0);
+    // Group first, so each group is packed contiguously: then biggest alignment and size first
+    std::stable_sort(std::begin(order), std::end(order), [requests](const size_t lhs, const size_t rhs) {
+        const packing_request_t& l = requests[lhs];
+        const packing_request_t& r = requests[rhs];
+        if (l.GroupKey != r.GroupKey) {
+            return l.GroupKey < r.GroupKey;
+        }
+        if (l.Alignment != r.Alignment) {
+            return l.Alignment > r.Alignment;
+        }
+        return l.Size > r.Size;
+    });
+
+    // Index of the block currently being filled for the current group
+    size_t current_block = std::numeric_limits<size_t>::max();
+
+    for (const size_t idx : order) {
+        const packing_request_t& request = requests[idx];
+        if (!isPowerOfTwo(request.Alignment)) {
+            throw std::invalid_argument("Resource packing request alignment must be a non-zero power of two!");
+        }
+
+        bool needs_new_block = (current_block == std::numeric_limits<size_t>::max()) || (result.Blocks[current_block].GroupKey != request.GroupKey);
+        uint64_t offset = 0;
+        if (!needs_new_block) {
+            offset = alignUp(result.Blocks[current_block].Size, request.Alignment);
+            needs_new_block = (max_block_size != 0) && (offset + request.Size > max_block_size);
+        }
+
+        if (needs_new_block) {
+            result.Blocks.emplace_back(packing_block_t{ 0, 1, request.GroupKey });
+            current_block = result.Blocks.size() - 1;
+            offset = 0;
+        }
+
+        packing_block_t& block = result.Blocks[current_block];
+        block.Size = offset + request.Size;
+        block.Alignment = std::max(block.Alignment, request.Alignment);
+        result.Ranges[idx] = packed_range_t{ static_cast<uint32_t>(current_block), offset, request.Size };
+    }
+
+    return result;
+}
+
+packing_plan_t PlanTransientAliasing(const transient_packing_request_t* requests, const size_t num_requests) {
+    packing_plan_t result;
+    result.Ranges.resize(num_requests);
+
+    struct alias_slot_t {
+        uint64_t Size{ 0 };
+        uint64_t Alignment{ 1 };
+        uint32_t LastUse{ 0 };
+        uint64_t Offset{ 0 };
+    };
+
+    std::vector<size_t> order(num_requests);
+    std::iota(std::begin(order), std::end(order), 0);
+    std::stable_sort(std::begin(order), std::end(order), [requests](const size_t lhs, const size_t rhs) {
+        const transient_packing_request_t& l = requests[lhs];
+        const transient_packing_request_t& r = requests[rhs];
+        if (l.Request.GroupKey != r.Request.GroupKey) {
+            return l.Request.GroupKey < r.Request.GroupKey;
+        }
+        if (l.FirstUse != r.FirstUse) {
+            return l.FirstUse < r.FirstUse;
+        }
+        return l.Request.Size > r.Request.Size;
+    });
+
+    std::vector<alias_slot_t> slots;
+    // Slot each request was assigned to, used to fix up offsets once slot sizes are final
+    std::vector<size_t> request_slots(num_requests);
+    size_t group_begin = 0;
+
+    auto finalize_group = [&](const size_t group_end) {
+        if (group_begin == group_end) {
+            return;
+        }
+
+        packing_block_t block{ 0, 1, requests[order[group_begin]].Request.GroupKey };
+        for (auto& slot : slots) {
+            slot.Offset = alignUp(block.Size, slot.Alignment);
+            block.Size = slot.Offset + slot.Size;
+            block.Alignment = std::max(block.Alignment, slot.Alignment);
+        }
+
+        const uint32_t block_idx = static_cast<uint32_t>(result.Blocks.size());
+        result.Blocks.emplace_back(block);
+        for (size_t i = group_begin; i < group_end; ++i) {
+            result.Ranges[order[i]] = packed_range_t{ block_idx, slots[request_slots[order[i]]].Offset, requests[order[i]].Request.Size };
+        }
+
+        slots.clear();
+        group_begin = group_end;
+    };
+
+    for (size_t i = 0; i < num_requests; ++i) {
+        const size_t idx = order[i];
+        const transient_packing_request_t& request = requests[idx];
+        if (!isPowerOfTwo(request.Request.Alignment)) {
+            throw std::invalid_argument("Resource packing request alignment must be a non-zero power of two!");
+        }
+        if (request.LastUse < request.FirstUse) {
+            throw std::invalid_argument("Transient resource lifetime ends before it begins!");
+        }
+
+        if ((i != group_begin) && (requests[order[i - 1]].Request.GroupKey != request.Request.GroupKey)) {
+            finalize_group(i);
+        }
+
+        // Of the slots free by the time this request is first used, prefer the smallest that already fits: failing that,
+        // grow the largest so the least memory is added.
+        size_t best_fit = std::numeric_limits<size_t>::max();
+        size_t largest_free = std::numeric_limits<size_t>::max();
+        for (size_t j = 0; j < slots.size(); ++j) {
+            const alias_slot_t& slot = slots[j];
+            if (slot.LastUse >= request.FirstUse) {
+                continue;
+            }
+            if ((slot.Size >= request.Request.Size) && ((best_fit == std::numeric_limits<size_t>::max()) || (slot.Size < slots[best_fit].Size))) {
+                best_fit = j;
+            }
+            if ((largest_free == std::numeric_limits<size_t>::max()) || (slot.Size > slots[largest_free].Size)) {
+                largest_free = j;
+            }
+        }
+
+        size_t chosen_slot = (best_fit != std::numeric_limits<size_t>::max()) ? best_fit : largest_free;
+        if (chosen_slot == std::numeric_limits<size_t>::max()) {
+            slots.emplace_back(alias_slot_t{});
+            chosen_slot = slots.size() - 1;
+        }
+
+        alias_slot_t& slot = slots[chosen_slot];
+        slot.Size = std::max(slot.Size, request.Request.Size);
+        slot.Alignment = std::max(slot.Alignment, request.Request.Alignment);
+        slot.LastUse = request.LastUse;
+        request_slots[idx] = chosen_slot;
+    }
+
+    finalize_group(num_requests);
+    return result;
+}
+
+#ifdef VPSK_TESTING_ENABLED
+namespace {
+
+    bool rangesOverlap(const packing_plan_t& plan, const std::vector<packing_request_t>& requests) {
+        for (size_t i = 0; i < requests.size(); ++i) {
+            for (size_t j = i + 1; j < requests.size(); ++j) {
+                if (plan.Ranges[i].Block != plan.Ranges[j].Block) {
+                    continue;
+                }
+                const uint64_t i_begin = plan.Ranges[i].Offset;
+                const uint64_t j_begin = plan.Ranges[j].Offset;
+                if ((i_begin < j_begin + requests[j].Size) && (j_begin < i_begin + requests[i].Size)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+}
+
+TEST_SUITE("ResourcePacking") {
+    TEST_CASE("RespectsAlignmentWithoutOverlap") {
+        const std::vector<packing_request_t> requests{
+            { 100, 4, 0 }, { 256, 256, 0 }, { 3, 1, 0 }, { 1000, 64, 0 }, { 17, 16, 0 }
+        };
+        packing_plan_t plan = PlanResourcePacking(requests.data(), requests.size(), 0);
+        REQUIRE(plan.Blocks.size() == 1);
+        CHECK(plan.Blocks[0].Alignment == 256);
+        for (size_t i = 0; i < requests.size(); ++i) {
+            CHECK(plan.Ranges[i].Offset % requests[i].Alignment == 0);
+            CHECK(plan.Ranges[i].Offset + requests[i].Size <= plan.Blocks[0].Size);
+            CHECK(plan.Ranges[i].Size == requests[i].Size);
+        }
+        CHECK_FALSE(rangesOverlap(plan, requests));
+    }
+
+    TEST_CASE("LargestAlignmentPlacedFirst") {
+        const std::vector<packing_request_t> requests{ { 4, 4, 0 }, { 512, 512, 0 } };
+        packing_plan_t plan = PlanResourcePacking(requests.data(), requests.size(), 0);
+        CHECK(plan.Ranges[1].Offset == 0);
+        CHECK(plan.Ranges[0].Offset == 512);
+        CHECK(plan.Blocks[0].Size == 516);
+    }
+
+    TEST_CASE("GroupsNeverShareBlocks") {
+        const std::vector<packing_request_t> requests{ { 64, 16, 1 }, { 64, 16, 2 }, { 64, 16, 1 } };
+        packing_plan_t plan = PlanResourcePacking(requests.data(), requests.size(), 0);
+        REQUIRE(plan.Blocks.size() == 2);
+        CHECK(plan.Ranges[0].Block == plan.Ranges[2].Block);
+        CHECK(plan.Ranges[0].Block != plan.Ranges[1].Block);
+        CHECK(plan.Blocks[plan.Ranges[1].Block].GroupKey == 2);
+    }
+
+    TEST_CASE("BlockSizeLimit") {
+        const std::vector<packing_request_t> requests{ { 600, 1, 0 }, { 600, 1, 0 }, { 2048, 1, 0 }, { 300, 1, 0 } };
+        packing_plan_t plan = PlanResourcePacking(requests.data(), requests.size(), 1024);
+        for (const auto& block : plan.Blocks) {
+            const bool single_oversized = (block.Size > 1024);
+            if (single_oversized) {
+                CHECK(block.Size == 2048);
+            }
+        }
+        CHECK(plan.Ranges[0].Block != plan.Ranges[1].Block);
+        CHECK_FALSE(rangesOverlap(plan, requests));
+        CHECK(plan.Blocks.size() == 3);
+    }
+
+    TEST_CASE("EmptyRequests") {
+        packing_plan_t plan = PlanResourcePacking(nullptr, 0, 0);
+        CHECK(plan.Blocks.empty());
+        CHECK(plan.Ranges.empty());
+    }
+
+    TEST_CASE("InvalidAlignmentThrows") {
+        const packing_request_t request{ 16, 3, 0 };
+        CHECK_THROWS(PlanResourcePacking(&request, 1, 0));
+    }
+
+    TEST_CASE("TransientChainAliases") {
+        // Post-processing style chain: each target is read by the pass after the one that writes it
+        constexpr uint64_t target_size = 8u * 1024u * 1024u;
+        const std::vector<transient_packing_request_t> requests{
+            { { target_size, 256, 0 }, 0, 1 },
+            { { target_size, 256, 0 }, 1, 2 },
+            { { target_size, 256, 0 }, 2, 3 },
+            { { target_size, 256, 0 }, 3, 4 },
+            { { target_size, 256, 0 }, 4, 5 }
+        };
+        packing_plan_t plan = PlanTransientAliasing(requests.data(), requests.size());
+        REQUIRE(plan.Blocks.size() == 1);
+        CHECK(plan.Blocks[0].Size == 2 * target_size);
+        CHECK(plan.Ranges[0].Offset == plan.Ranges[2].Offset);
+        CHECK(plan.Ranges[0].Offset != plan.Ranges[1].Offset);
+    }
+
+    TEST_CASE("TransientOverlappingLifetimesDisjoint") {
+        const std::vector<transient_packing_request_t> requests{
+            { { 1024, 64, 0 }, 0, 3 },
+            { { 4096, 256, 0 }, 1, 1 },
+            { { 512, 16, 0 }, 2, 5 },
+            { { 2048, 64, 0 }, 2, 2 },
+            { { 4096, 256, 0 }, 4, 6 },
+            { { 100, 4, 0 }, 6, 6 }
+        };
+        packing_plan_t plan = PlanTransientAliasing(requests.data(), requests.size());
+        REQUIRE(plan.Blocks.size() == 1);
+        uint64_t unaliased_size = 0;
+        for (size_t i = 0; i < requests.size(); ++i) {
+            unaliased_size += requests[i].Request.Size;
+            CHECK(plan.Ranges[i].Offset % requests[i].Request.Alignment == 0);
+            CHECK(plan.Ranges[i].Offset + requests[i].Request.Size <= plan.Blocks[0].Size);
+            for (size_t j = i + 1; j < requests.size(); ++j) {
+                const bool lifetimes_overlap = (requests[i].FirstUse <= requests[j].LastUse) && (requests[j].FirstUse <= requests[i].LastUse);
+                if (!lifetimes_overlap) {
+                    continue;
+                }
+                const uint64_t i_begin = plan.Ranges[i].Offset;
+                const uint64_t j_begin = plan.Ranges[j].Offset;
+                const bool memory_overlaps = (i_begin < j_begin + requests[j].Request.Size) && (j_begin < i_begin + requests[i].Request.Size);
+                CHECK_FALSE(memory_overlaps);
+            }
+        }
+        CHECK(plan.Blocks[0].Size < unaliased_size);
+    }
+
+    TEST_CASE("TransientGroupsNeverAlias") {
+        const std::vector<transient_packing_request_t> requests{
+            { { 256, 16, 1 }, 0, 0 },
+            { { 256, 16, 2 }, 1, 1 }
+        };
+        packing_plan_t plan = PlanTransientAliasing(requests.data(), requests.size());
+        REQUIRE(plan.Blocks.size() == 2);
+        CHECK(plan.Ranges[0].Block != plan.Ranges[1].Block);
+    }
+
+    TEST_CASE("TransientInvalidLifetimeThrows") {
+        const transient_packing_request_t request{ { 16, 4, 0 }, 3, 1 };
+        CHECK_THROWS(PlanTransientAliasing(&request, 1));
+    }
+}
+#endif // VPSK_TESTING_ENABLED
@@ -0,0 +1,132 @@
+#include "ResourceTable.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include "doctest/doctest.h"
+
+ResourceTable::ResourceTable() {
+    for (auto& chunk_ptr : chunks) {
+        chunk_ptr.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+ResourceTable::~ResourceTable() {
+    for (auto& chunk_ptr : chunks) {
+        chunk_t* ptr = chunk_ptr.exchange(nullptr);
+        if (ptr != nullptr) {
+            delete ptr;
+        }
+    }
+}
+
+uint32_t ResourceTable::Allocate() {
+    uint32_t idx = 0;
+    {
+        std::lock_guard<std::mutex> allocation_guard(allocationMutex);
+        if (!freeSlots.empty()) {
+            idx = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            idx = numSlots.load(std::memory_order_relaxed);
+            const uint32_t chunk_idx = idx >> ChunkShift;
+            if (chunk_idx >= MaxChunks) {
+                throw std::out_of_range("Exceeded maximum number of resources that can be held by a ResourceTable!");
+            }
+
+            if (chunks[chunk_idx].load(std::memory_order_relaxed) == nullptr) {
+                chunk_t* new_chunk = new chunk_t();
+                for (uint32_t i = 0; i < ChunkSize; ++i) {
+                    // generation 0 is reserved, so that a zeroed handle is never valid
+                    new_chunk->generations[i].store(1, std::memory_order_relaxed);
+                    new_chunk->live[i].store(false, std::memory_order_relaxed);
+                }
+                chunks[chunk_idx].store(new_chunk, std::memory_order_release);
+            }
+
+            numSlots.store(idx + 1, std::memory_order_release);
+        }
+    }
+
+    chunk(idx).live[idx & ChunkMask].store(true, std::memory_order_release);
+    return idx;
+}
+
+bool ResourceTable::Retire(const resource_handle_t handle, const uint64_t retired_frame) {
+    const uint32_t idx = Index(handle);
+    // Handles from another table, or garbage, can point past the slots this one has
+    if (idx >= numSlots.load(std::memory_order_acquire)) {
+        return false;
+    }
+    chunk_t& retired_chunk = chunk(idx);
+    uint32_t generation = Generation(handle);
+    uint32_t next_generation = generation + 1u;
+    if (next_generation == 0) {
+        next_generation = 1;
+    }
+    // Only one of several threads retiring the same handle gets to bump the generation: the others see it changed
+    if (!retired_chunk.generations[idx & ChunkMask].compare_exchange_strong(generation, next_generation, std::memory_order_acq_rel)) {
+        return false;
+    }
+    retired_chunk.live[idx & ChunkMask].store(false, std::memory_order_release);
+
+    std::lock_guard<std::mutex> allocation_guard(allocationMutex);
+    retiredSlots.emplace_back(retired_slot_t{ idx, retired_frame });
+    return true;
+}
+
+void ResourceTable::Reclaim(const uint64_t completed_frame) {
+    std::lock_guard<std::mutex> allocation_guard(allocationMutex);
+    auto first_pending = std::partition(std::begin(retiredSlots), std::end(retiredSlots), [completed_frame](const retired_slot_t& slot) {
+        return slot.Frame <= completed_frame;
+    });
+
+    for (auto iter = std::begin(retiredSlots); iter != first_pending; ++iter) {
+        resetSlot(iter->Index);
+        freeSlots.emplace_back(iter->Index);
+    }
+
+    retiredSlots.erase(std::begin(retiredSlots), first_pending);
+}
+
+void ResourceTable::ReclaimAll() {
+    Reclaim(std::numeric_limits<uint64_t>::max());
+}
+
+void ResourceTable::resetSlot(const uint32_t idx) {
+    chunk_t& slot_chunk = chunk(idx);
+    const uint32_t local_idx = idx & ChunkMask;
+    slot_chunk.resources[local_idx] = VulkanResource{};
+    slot_chunk.memoryTypes[local_idx] = memory_type::INVALID_MEMORY_TYPE;
+    slot_chunk.infos[local_idx] = resource_info_storage_t{};
+    slot_chunk.viewInfos[local_idx] = resource_view_info_storage_t{};
+    slot_chunk.allocations[local_idx] = vpr::Allocation();
+    slot_chunk.memoryRanges[local_idx] = resource_memory_range_t{};
+    slot_chunk.mappedRanges[local_idx] = VkMappedMemoryRange{};
+    slot_chunk.names[local_idx].clear();
+    slot_chunk.sharedBlocks[local_idx] = 0;
+    slot_chunk.persistentMappings[local_idx] = nullptr;
+}
+
+#ifdef VPSK_TESTING_ENABLED
+
+TEST_SUITE("ResourceTable") {
+    TEST_CASE("RetiresEachHandleOnce") {
+        ResourceTable table;
+        const resource_handle_t handle = table.Handle(table.Allocate());
+        CHECK(table.Retire(handle, 0));
+        CHECK_FALSE(table.Valid(handle));
+        CHECK_FALSE(table.Retire(handle, 0));
+    }
+
+    TEST_CASE("RetiringOutOfRangeHandleFails") {
+        ResourceTable table;
+        const resource_handle_t handle = table.Handle(table.Allocate());
+        const resource_handle_t past_end = (handle & ~uint64_t(0xffffffff)) | uint64_t(table.Capacity());
+        CHECK_FALSE(table.Retire(past_end, 0));
+        CHECK_FALSE(table.Retire(~resource_handle_t(0), 0));
+        CHECK(table.Valid(handle));
+    }
+}
+
+#endif // VPSK_TESTING_ENABLED
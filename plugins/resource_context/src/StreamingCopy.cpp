@@ -0,0 +1,78 @@
+#include "StreamingCopy.hpp"
+#include <cstring>
+#include <cstdint>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define RESOURCE_CONTEXT_STREAMING_STORES
+#include <emmintrin.h>
+#endif
+#include "doctest/doctest.h"
+
+void StreamingMemcpy(void* dst, const void* src, const size_t size) noexcept {
+#ifdef RESOURCE_CONTEXT_STREAMING_STORES
+    uint8_t* dst_bytes = reinterpret_cast<uint8_t*>(dst);
+    const uint8_t* src_bytes = reinterpret_cast<const uint8_t*>(src);
+    size_t remaining = size;
+
+    // Streaming stores need a 16 byte aligned destination: copy the unaligned head normally
+    const size_t head = (16 - (reinterpret_cast<uintptr_t>(dst_bytes) & 15)) & 15;
+    if (head >= remaining) {
+        memcpy(dst_bytes, src_bytes, remaining);
+        return;
+    }
+    memcpy(dst_bytes, src_bytes, head);
+    dst_bytes += head;
+    src_bytes += head;
+    remaining -= head;
+
+    // Four registers at a time fills a whole 64 byte write-combining buffer per iteration
+    while (remaining >= 64) {
+        const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_bytes));
+        const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_bytes + 16));
+        const __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_bytes + 32));
+        const __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_bytes + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst_bytes), r0);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst_bytes + 16), r1);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst_bytes + 32), r2);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst_bytes + 48), r3);
+        dst_bytes += 64;
+        src_bytes += 64;
+        remaining -= 64;
+    }
+
+    while (remaining >= 16) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst_bytes), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_bytes)));
+        dst_bytes += 16;
+        src_bytes += 16;
+        remaining -= 16;
+    }
+
+    memcpy(dst_bytes, src_bytes, remaining);
+    // Streaming stores are weakly ordered: make sure they're visible before anything that follows (e.g. a flush or submit)
+    _mm_sfence();
+#else
+    memcpy(dst, src, size);
+#endif
+}
+
+#ifdef VPSK_TESTING_ENABLED
+#include <vector>
+TEST_SUITE("StreamingCopy") {
+    TEST_CASE("MatchesMemcpy") {
+        std::vector<uint8_t> src(4096 + 64);
+        for (size_t i = 0; i < src.size(); ++i) {
+            src[i] = static_cast<uint8_t>((i * 31u) ^ (i >> 3));
+        }
+
+        const size_t sizes[] = { 0, 1, 15, 16, 17, 63, 64, 65, 200, 4096 };
+        for (size_t dst_offset = 0; dst_offset < 16; ++dst_offset) {
+            for (const size_t size : sizes) {
+                std::vector<uint8_t> dst(4096 + 64, 0xcd);
+                std::vector<uint8_t> expected(dst);
+                StreamingMemcpy(dst.data() + dst_offset, src.data() + 3, size);
+                memcpy(expected.data() + dst_offset, src.data() + 3, size);
+                CHECK(dst == expected);
+            }
+        }
+    }
+}
+#endif // VPSK_TESTING_ENABLED
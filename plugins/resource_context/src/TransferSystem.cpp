@@ -4,6 +4,34 @@
 #include "Fence.hpp"
 #include "Semaphore.hpp"
 #include "vkAssert.hpp"
+#include "easylogging++.h"
+
+struct ResourceTransferSystem::transferRecorder {
+    transferSpinLock lock;
+    std::unique_ptr<vpr::CommandPool> pool;
+    // Whether the command buffer for a batch slot has begun recording, but not yet been submitted
+    std::array<bool, NumBatches> recording{};
+};
+
+namespace {
+
+    struct thread_recorder_cache_t {
+        void* Recorder{ nullptr };
+        uint32_t Generation{ 0 };
+    };
+
+    // Incremented whenever recorders are destroyed, so that threads don't use stale cached recorders
+    std::atomic<uint32_t> recorderGeneration{ 1 };
+    thread_local thread_recorder_cache_t threadRecorder;
+
+    constexpr static VkCommandBufferBeginInfo transfer_begin_info{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        nullptr,
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        nullptr
+    };
+
+}
 
 VkCommandPoolCreateInfo getCreateInfo(const vpr::Device* device) {
     constexpr static VkCommandPoolCreateInfo pool_info{
@@ -17,7 +45,7 @@ VkCommandPoolCreateInfo getCreateInfo(const vpr::Device* device) {
     return result;
 }
 
-ResourceTransferSystem::ResourceTransferSystem() : transferPool(nullptr), device(nullptr), fence(nullptr) {}
+ResourceTransferSystem::ResourceTransferSystem() : device(nullptr) {}
 
 ResourceTransferSystem::~ResourceTransferSystem() {}
 
@@ -28,26 +56,37 @@ void ResourceTransferSystem::Initialize(const vpr::Device * dvc) {
     }
 
     device = dvc;
-    transferPool = std::make_unique<vpr::CommandPool>(dvc->vkHandle(), getCreateInfo(dvc));
-    transferPool->AllocateCmdBuffers(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
-    fence = std::make_unique<vpr::Fence>(dvc->vkHandle(), 0); 
-    
-    constexpr static VkCommandBufferBeginInfo begin_info{
-        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        nullptr,
-        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
-        nullptr
-    };
+    for (auto& batch : batches) {
+        batch.fence = std::make_unique<vpr::Fence>(dvc->vkHandle(), 0);
+        batch.inFlight = false;
+    }
 
-    VkResult result = vkBeginCommandBuffer(transferPool->GetCmdBuffer(0), &begin_info);
-    VkAssert(result);
     initialized = true;
 }
 
+void ResourceTransferSystem::Destroy() {
+    if (!initialized) {
+        return;
+    }
+
+    WaitForTransfers();
+
+    {
+        std::lock_guard<std::mutex> recorders_guard(recordersMutex);
+        recorders.clear();
+        ++recorderGeneration;
+    }
+
+    for (auto& batch : batches) {
+        batch.fence.reset();
+    }
+
+    initialized = false;
+}
+
 ResourceTransferSystem & ResourceTransferSystem::GetTransferSystem() {
     static ResourceTransferSystem transfer_system;
     return transfer_system;
-    // TODO: insert return statement here
 }
 
 void ResourceTransferSystem::CompleteTransfers() {
@@ -55,59 +94,211 @@ void ResourceTransferSystem::CompleteTransfers() {
         throw std::runtime_error("Transfer system was not properly initialized!");
     }
 
-    if (!cmdBufferDirty) {
-        return;
+    std::vector<completion_callback_entry_t> completed;
+    submitBatch(completed);
+    runCallbacks(completed);
+}
+
+void ResourceTransferSystem::submitBatch(std::vector<completion_callback_entry_t>& completed) {
+    std::lock_guard<std::mutex> submit_guard(submitMutex);
+
+    // Retire completed batches in submission order, stopping at the first still in-flight
+    for (uint64_t id = completedBatch + 1; id < recordingBatch; ++id) {
+        transferBatch& batch = batches[id % NumBatches];
+        if (!batch.inFlight || (batch.id != id) || !pollBatch(batch)) {
+            break;
+        }
+        retireBatch(batch, completed);
     }
 
-    auto guard = AcquireSpinLock();
+    const uint64_t current_id = recordingBatch;
+    const size_t current_slot = current_id % NumBatches;
 
-    auto& pool = *transferPool;
-    if (vkEndCommandBuffer(pool[0]) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to end Transfer command buffer!");
+    bool has_callbacks = false;
+    {
+        transferSpinLockGuard callback_guard(callbackLock, recordingBatch);
+        has_callbacks = !batches[current_slot].callbacks.empty();
+    }
+
+    // Next batch will re-use this slot: if it's still in-flight the ring is full, and we have to wait on it.
+    transferBatch& next_batch = batches[(current_id + 1) % NumBatches];
+    if (next_batch.inFlight) {
+        VkResult result = vkWaitForFences(device->vkHandle(), 1, &next_batch.fence->vkHandle(), VK_TRUE, UINT64_MAX);
+        VkAssert(result);
+        retireBatch(next_batch, completed);
+    }
+
+    std::vector<VkCommandBuffer> cmd_buffers;
+    {
+        std::lock_guard<std::mutex> recorders_guard(recordersMutex);
+        for (auto& recorder : recorders) {
+            recorder->lock.lock();
+        }
+
+        for (auto& recorder : recorders) {
+            if (recorder->recording[current_slot]) {
+                VkCommandBuffer cmd = (*recorder->pool)[current_slot];
+                if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to end Transfer command buffer!");
+                }
+                recorder->recording[current_slot] = false;
+                cmd_buffers.emplace_back(cmd);
+            }
+        }
+
+        // Recorders acquire the batch ID while holding their lock, so they can't observe a partial advance
+        if (!cmd_buffers.empty() || has_callbacks) {
+            recordingBatch = current_id + 1;
+        }
+
+        for (auto& recorder : recorders) {
+            recorder->lock.unlock();
+        }
+    }
+
+    if (cmd_buffers.empty() && !has_callbacks) {
+        return;
     }
 
-    VkSubmitInfo submission{
+    transferBatch& batch = batches[current_slot];
+    batch.id = current_id;
+    batch.inFlight = true;
+
+    const VkSubmitInfo submission{
         VK_STRUCTURE_TYPE_SUBMIT_INFO,
         nullptr,
         0,
         nullptr,
         nullptr,
-        1,
-        &pool[0],
+        static_cast<uint32_t>(cmd_buffers.size()),
+        cmd_buffers.data(),
         0,
         nullptr
     };
 
-    VkResult result = vkQueueSubmit(device->TransferQueue(), 1, &submission, fence->vkHandle());
-    VkAssert(result);
-    result = vkWaitForFences(device->vkHandle(), 1, &fence->vkHandle(), VK_TRUE, UINT64_MAX);
-    VkAssert(result);
-    result = vkResetFences(device->vkHandle(), 1, &fence->vkHandle());
+    VkResult result = vkQueueSubmit(device->TransferQueue(), 1, &submission, batch.fence->vkHandle());
     VkAssert(result);
 
-    transferPool->ResetCmdBuffer(0);
-
-    constexpr static VkCommandBufferBeginInfo begin_info{
-        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        nullptr,
-        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
-        nullptr
-    };
+}
 
-    result = vkBeginCommandBuffer(pool[0], &begin_info);
-    VkAssert(result);
-    cmdBufferDirty = false;
+void ResourceTransferSystem::WaitForTransfers() {
+    CompleteTransfers();
 
+    std::vector<completion_callback_entry_t> completed;
+    {
+        std::lock_guard<std::mutex> submit_guard(submitMutex);
+        for (uint64_t id = completedBatch + 1; id < recordingBatch; ++id) {
+            transferBatch& batch = batches[id % NumBatches];
+            if (!batch.inFlight || (batch.id != id)) {
+                continue;
+            }
+            VkResult result = vkWaitForFences(device->vkHandle(), 1, &batch.fence->vkHandle(), VK_TRUE, UINT64_MAX);
+            VkAssert(result);
+            retireBatch(batch, completed);
+        }
+    }
+    runCallbacks(completed);
 }
 
 ResourceTransferSystem::transferSpinLockGuard ResourceTransferSystem::AcquireSpinLock() {
-    return ResourceTransferSystem::transferSpinLockGuard(copyQueueLock);
+    transferRecorder* recorder = getThreadRecorder();
+    return ResourceTransferSystem::transferSpinLockGuard(recorder->lock, recordingBatch);
 }
 
 VkCommandBuffer ResourceTransferSystem::TransferCmdBuffer() {
-    cmdBufferDirty = true;
-    auto& pool = *transferPool;
-    return pool[0];
+    transferRecorder* recorder = getThreadRecorder();
+    const size_t slot = recordingBatch % NumBatches;
+    VkCommandBuffer cmd = (*recorder->pool)[slot];
+    if (!recorder->recording[slot]) {
+        VkResult result = vkBeginCommandBuffer(cmd, &transfer_begin_info);
+        VkAssert(result);
+        recorder->recording[slot] = true;
+    }
+    return cmd;
+}
+
+uint64_t ResourceTransferSystem::CurrentBatchID() const noexcept {
+    return recordingBatch;
+}
+
+uint64_t ResourceTransferSystem::LastCompletedBatchID() const noexcept {
+    return completedBatch;
+}
+
+bool ResourceTransferSystem::BatchComplete(const uint64_t batch_id) const noexcept {
+    return batch_id <= completedBatch;
+}
+
+void ResourceTransferSystem::AddCompletionCallback(const uint64_t batch_id, completion_callback_t fn, void* state, void* data) {
+    {
+        transferSpinLockGuard guard(callbackLock, recordingBatch);
+        if (batch_id > recordingBatch) {
+            // Would alias the ring slot of a batch still in flight, and be called when that one completes
+            LOG(ERROR) << "Tried to add a completion callback for batch " << batch_id << ", which hasn't started recording yet!";
+            throw std::logic_error("Completion callback added for a batch that doesn't exist yet");
+        }
+        if (batch_id > completedBatch) {
+            batches[batch_id % NumBatches].callbacks.emplace_back(completion_callback_entry_t{ fn, state, data });
+            return;
+        }
+    }
+    fn(state, data);
+}
+
+ResourceTransferSystem::transferRecorder* ResourceTransferSystem::getThreadRecorder() {
+    if ((threadRecorder.Recorder != nullptr) && (threadRecorder.Generation == recorderGeneration)) {
+        return reinterpret_cast<transferRecorder*>(threadRecorder.Recorder);
+    }
+
+    std::lock_guard<std::mutex> recorders_guard(recordersMutex);
+    auto recorder = std::make_unique<transferRecorder>();
+    recorder->pool = std::make_unique<vpr::CommandPool>(device->vkHandle(), getCreateInfo(device));
+    recorder->pool->AllocateCmdBuffers(static_cast<uint32_t>(NumBatches), VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    recorders.emplace_back(std::move(recorder));
+
+    threadRecorder.Recorder = recorders.back().get();
+    threadRecorder.Generation = recorderGeneration;
+    return recorders.back().get();
+}
+
+bool ResourceTransferSystem::pollBatch(transferBatch& batch) {
+    VkResult result = vkGetFenceStatus(device->vkHandle(), batch.fence->vkHandle());
+    if (result == VK_NOT_READY) {
+        return false;
+    }
+    VkAssert(result);
+    return true;
+}
+
+void ResourceTransferSystem::retireBatch(transferBatch& batch, std::vector<completion_callback_entry_t>& completed) {
+    const size_t slot = batch.id % NumBatches;
+
+    VkResult result = vkResetFences(device->vkHandle(), 1, &batch.fence->vkHandle());
+    VkAssert(result);
+
+    {
+        std::lock_guard<std::mutex> recorders_guard(recordersMutex);
+        for (auto& recorder : recorders) {
+            recorder->lock.lock();
+            recorder->pool->ResetCmdBuffer(slot);
+            recorder->lock.unlock();
+        }
+    }
+
+    {
+        transferSpinLockGuard guard(callbackLock, recordingBatch);
+        completedBatch = batch.id;
+        completed.insert(completed.end(), batch.callbacks.cbegin(), batch.callbacks.cend());
+        batch.callbacks.clear();
+    }
+
+    batch.inFlight = false;
+}
+
+void ResourceTransferSystem::runCallbacks(const std::vector<completion_callback_entry_t>& completed) {
+    for (const auto& callback : completed) {
+        callback.Function(callback.State, callback.Data);
+    }
 }
 
 void ResourceTransferSystem::transferSpinLock::lock() {
@@ -124,8 +315,9 @@ void ResourceTransferSystem::transferSpinLock::unlock() {
     lockFlag.clear(std::memory_order_release);
 }
 
-ResourceTransferSystem::transferSpinLockGuard::transferSpinLockGuard(transferSpinLock & _lock) : lck(_lock) {
+ResourceTransferSystem::transferSpinLockGuard::transferSpinLockGuard(transferSpinLock & _lock, const std::atomic<uint64_t>& batch_id) : lck(_lock) {
     lck.lock();
+    BatchID = batch_id;
 }
 
 ResourceTransferSystem::transferSpinLockGuard::~transferSpinLockGuard() {
@@ -19,6 +19,12 @@ constexpr static VkBufferCreateInfo staging_buffer_create_info{
     nullptr
 };
 
+struct upload_copy_t {
+    const void* Data;
+    size_t DataSize;
+    VkDeviceSize Offset;
+};
+
 struct UploadBuffer {
     UploadBuffer(const UploadBuffer&) = delete;
     UploadBuffer& operator=(const UploadBuffer&) = delete;
@@ -26,6 +32,8 @@ struct UploadBuffer {
     UploadBuffer(UploadBuffer&& other) noexcept;
     UploadBuffer& operator=(UploadBuffer&& other) noexcept;
     void SetData(const void* data, size_t data_size, size_t offset);
+    // Writes all copies under a single map and flush
+    void SetData(const upload_copy_t* copies, const size_t num_copies);
     VkBuffer Buffer;
     vpr::Allocation alloc;
     const vpr::Device* device;
@@ -62,4 +70,15 @@ inline void UploadBuffer::SetData(const void* data, size_t data_size, size_t off
     vkFlushMappedMemoryRanges(device->vkHandle(), 1, &mapped_memory);
 }
 
+inline void UploadBuffer::SetData(const upload_copy_t* copies, const size_t num_copies) {
+    VkMappedMemoryRange mapped_memory{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, nullptr, alloc.Memory(), alloc.Offset(), VK_WHOLE_SIZE };
+    void* mapped_address = nullptr;
+    alloc.Map(alloc.Size, 0, &mapped_address);
+    for (size_t i = 0; i < num_copies; ++i) {
+        memcpy(reinterpret_cast<char*>(mapped_address) + copies[i].Offset, copies[i].Data, copies[i].DataSize);
+    }
+    alloc.Unmap();
+    vkFlushMappedMemoryRanges(device->vkHandle(), 1, &mapped_memory);
+}
+
 #endif //!RESOURCE_CONTEXT_UPLOAD_BUFFER_HPP
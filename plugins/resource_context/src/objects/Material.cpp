@@ -2,6 +2,32 @@
 
 namespace vpsk {
 
+    material_textures_t& Material::Textures() noexcept {
+        return texturePtrs;
+    }
 
+    const material_textures_t& Material::Textures() const noexcept {
+        return texturePtrs;
+    }
+
+    material_texture_flags_t& Material::Flags() noexcept {
+        return textureFlags;
+    }
+
+    const material_texture_flags_t& Material::Flags() const noexcept {
+        return textureFlags;
+    }
+
+    material_parameters_t& Material::Parameters() noexcept {
+        return parameters;
+    }
+
+    const material_parameters_t& Material::Parameters() const noexcept {
+        return parameters;
+    }
+
+    bool Material::operator==(const Material& other) const noexcept {
+        return (texturePtrs == other.texturePtrs) && (textureFlags == other.textureFlags) && (parameters == other.parameters);
+    }
 
 }
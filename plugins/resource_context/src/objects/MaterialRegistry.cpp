@@ -0,0 +1,249 @@
+#include "objects/MaterialRegistry.hpp"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include "doctest/doctest.h"
+
+namespace vpsk {
+
+    namespace {
+
+        inline void hash_combine(size_t& seed, const size_t value) noexcept {
+            seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+
+        inline void hash_float(size_t& seed, const float value) noexcept {
+            // operator== treats 0.0f and -0.0f as equal, so they have to hash the same
+            uint32_t bits = 0;
+            if (value != 0.0f) {
+                std::memcpy(&bits, &value, sizeof(float));
+            }
+            hash_combine(seed, std::hash<uint32_t>()(bits));
+        }
+
+        inline void hash_vec4(size_t& seed, const glm::vec4& value) noexcept {
+            hash_float(seed, value.x);
+            hash_float(seed, value.y);
+            hash_float(seed, value.z);
+            hash_float(seed, value.w);
+        }
+
+        gpu_material_t make_table_entry(const Material& material) noexcept {
+            gpu_material_t result;
+            result.Parameters = material.Parameters();
+            result.Flags = material.Flags();
+            return result;
+        }
+
+    }
+
+    size_t material_hash_t::operator()(const Material& material) const noexcept {
+        size_t result = 0;
+        const material_textures_t& textures = material.Textures();
+        std::hash<const void*> ptr_hash;
+        hash_combine(result, ptr_hash(textures.Diffuse));
+        hash_combine(result, ptr_hash(textures.Normal));
+        hash_combine(result, ptr_hash(textures.AmbientOcclusion));
+        hash_combine(result, ptr_hash(textures.Roughness));
+        hash_combine(result, ptr_hash(textures.Metallic));
+        hash_combine(result, ptr_hash(textures.Emissive));
+
+        const material_texture_flags_t& flags = material.Flags();
+        const uint32_t packed_flags = (flags.Diffuse ? 1u : 0u) | (flags.Normal ? 2u : 0u) | (flags.AmbientOcclusion ? 4u : 0u) |
+            (flags.Roughness ? 8u : 0u) | (flags.Metallic ? 16u : 0u) | (flags.Emissive ? 32u : 0u);
+        hash_combine(result, std::hash<uint32_t>()(packed_flags));
+
+        const material_parameters_t& params = material.Parameters();
+        hash_vec4(result, params.ambient);
+        hash_vec4(result, params.diffuse);
+        hash_vec4(result, params.specular);
+        hash_vec4(result, params.transmittance);
+        hash_vec4(result, params.emission);
+        hash_float(result, params.shininess);
+        hash_float(result, params.alpha);
+        hash_float(result, params.roughness);
+        hash_float(result, params.metallic);
+        return result;
+    }
+
+    material_id_t MaterialRegistry::Register(const Material& material) {
+        auto iter = materialIDs.find(material);
+        if (iter != materialIDs.end()) {
+            return iter->second;
+        }
+
+        const material_id_t id = static_cast<material_id_t>(materials.size());
+        materials.emplace_back(material);
+        table.emplace_back(make_table_entry(material));
+        dirtyFlags.emplace_back(false);
+        materialIDs.emplace(material, id);
+        markDirty(id);
+        return id;
+    }
+
+    void MaterialRegistry::Update(const material_id_t id, const Material& material) {
+        if (id >= materials.size()) {
+            throw std::out_of_range("Invalid material ID passed to MaterialRegistry::Update!");
+        }
+
+        const Material previous = materials[id];
+        materials[id] = material;
+        table[id] = make_table_entry(material);
+        markDirty(id);
+
+        // Lookups of the previous material went to this ID: hand them to another ID holding it, if there is one
+        auto iter = materialIDs.find(previous);
+        if ((iter != materialIDs.end()) && (iter->second == id)) {
+            materialIDs.erase(iter);
+            auto duplicate = std::find(std::begin(materials), std::end(materials), previous);
+            if (duplicate != std::end(materials)) {
+                materialIDs.emplace(previous, static_cast<material_id_t>(std::distance(std::begin(materials), duplicate)));
+            }
+        }
+
+        // IDs stay valid for their users, so an update identical to another ID's material keeps both entries:
+        // lookups keep going to the ID that already had it
+        if (materialIDs.find(material) == materialIDs.end()) {
+            materialIDs.emplace(material, id);
+        }
+    }
+
+    material_id_t MaterialRegistry::Find(const Material& material) const noexcept {
+        auto iter = materialIDs.find(material);
+        return (iter != materialIDs.cend()) ? iter->second : InvalidMaterialID;
+    }
+
+    const Material& MaterialRegistry::Get(const material_id_t id) const {
+        return materials.at(id);
+    }
+
+    size_t MaterialRegistry::Count() const noexcept {
+        return materials.size();
+    }
+
+    const gpu_material_t* MaterialRegistry::TableData() const noexcept {
+        return table.data();
+    }
+
+    VkDeviceSize MaterialRegistry::TableSize() const noexcept {
+        return static_cast<VkDeviceSize>(sizeof(gpu_material_t) * table.size());
+    }
+
+    bool MaterialRegistry::Dirty() const noexcept {
+        return !dirtyIDs.empty();
+    }
+
+    std::vector<material_dirty_range_t> MaterialRegistry::ConsumeDirtyRanges() {
+        std::vector<material_dirty_range_t> result;
+        std::sort(std::begin(dirtyIDs), std::end(dirtyIDs));
+
+        constexpr VkDeviceSize entry_size = static_cast<VkDeviceSize>(sizeof(gpu_material_t));
+        for (const material_id_t id : dirtyIDs) {
+            const VkDeviceSize offset = entry_size * id;
+            if (!result.empty() && (result.back().Offset + result.back().Size == offset)) {
+                result.back().Size += entry_size;
+            }
+            else {
+                result.emplace_back(material_dirty_range_t{ offset, entry_size });
+            }
+            dirtyFlags[id] = false;
+        }
+
+        dirtyIDs.clear();
+        return result;
+    }
+
+    void MaterialRegistry::markDirty(const material_id_t id) {
+        if (!dirtyFlags[id]) {
+            dirtyFlags[id] = true;
+            dirtyIDs.emplace_back(id);
+        }
+    }
+
+}
+
+#ifdef VPSK_TESTING_ENABLED
+TEST_SUITE("MaterialRegistry") {
+    using namespace vpsk;
+
+    static Material make_material(const float roughness, Texture* diffuse = nullptr) {
+        Material result;
+        result.Parameters().roughness = roughness;
+        result.Parameters().diffuse = glm::vec4(1.0f, 0.5f, 0.25f, 1.0f);
+        result.Textures().Diffuse = diffuse;
+        result.Flags().Diffuse = (diffuse != nullptr) ? VK_TRUE : VK_FALSE;
+        return result;
+    }
+
+    TEST_CASE("IdenticalMaterialsShareID") {
+        MaterialRegistry registry;
+        const material_id_t id0 = registry.Register(make_material(0.5f));
+        const material_id_t id1 = registry.Register(make_material(0.5f));
+        const material_id_t id2 = registry.Register(make_material(0.75f));
+        CHECK(id0 == id1);
+        CHECK(id0 != id2);
+        CHECK(registry.Count() == 2);
+        CHECK(registry.TableSize() == 2 * sizeof(gpu_material_t));
+        CHECK(registry.TableData()[id2].Parameters.roughness == 0.75f);
+    }
+    TEST_CASE("TexturesDistinguishMaterials") {
+        MaterialRegistry registry;
+        Texture* fake_texture = reinterpret_cast<Texture*>(uintptr_t(0x1000));
+        const material_id_t id0 = registry.Register(make_material(0.5f));
+        const material_id_t id1 = registry.Register(make_material(0.5f, fake_texture));
+        CHECK(id0 != id1);
+        CHECK(registry.TableData()[id1].Flags.Diffuse == VK_TRUE);
+    }
+    TEST_CASE("SignedZeroHashesEqual") {
+        MaterialRegistry registry;
+        const material_id_t id0 = registry.Register(make_material(0.0f));
+        const material_id_t id1 = registry.Register(make_material(-0.0f));
+        CHECK(id0 == id1);
+    }
+    TEST_CASE("DirtyRangesMerge") {
+        MaterialRegistry registry;
+        for (uint32_t i = 0; i < 8; ++i) {
+            registry.Register(make_material(float(i)));
+        }
+        auto initial = registry.ConsumeDirtyRanges();
+        REQUIRE(initial.size() == 1);
+        CHECK(initial[0].Offset == 0);
+        CHECK(initial[0].Size == 8 * sizeof(gpu_material_t));
+        CHECK_FALSE(registry.Dirty());
+
+        registry.Update(5, make_material(50.0f));
+        registry.Update(1, make_material(10.0f));
+        registry.Update(2, make_material(20.0f));
+        registry.Update(1, make_material(11.0f));
+        auto updates = registry.ConsumeDirtyRanges();
+        REQUIRE(updates.size() == 2);
+        CHECK(updates[0].Offset == 1 * sizeof(gpu_material_t));
+        CHECK(updates[0].Size == 2 * sizeof(gpu_material_t));
+        CHECK(updates[1].Offset == 5 * sizeof(gpu_material_t));
+        CHECK(updates[1].Size == sizeof(gpu_material_t));
+        CHECK(registry.Find(make_material(11.0f)) == 1);
+        CHECK(registry.Find(make_material(1.0f)) == InvalidMaterialID);
+    }
+    TEST_CASE("UpdatesToDuplicatesKeepLookupsConsistent") {
+        MaterialRegistry registry;
+        const material_id_t id0 = registry.Register(make_material(0.5f));
+        const material_id_t id1 = registry.Register(make_material(0.75f));
+
+        registry.Update(id1, make_material(0.5f));
+        CHECK(registry.Count() == 2);
+        CHECK(registry.Find(make_material(0.5f)) == id0);
+        CHECK(registry.Find(make_material(0.75f)) == InvalidMaterialID);
+        CHECK(registry.Register(make_material(0.5f)) == id0);
+        CHECK(registry.TableData()[id1].Parameters.roughness == 0.5f);
+
+        // id1 still holds the material id0 moved away from
+        registry.Update(id0, make_material(0.25f));
+        CHECK(registry.Find(make_material(0.5f)) == id1);
+        CHECK(registry.Find(make_material(0.25f)) == id0);
+    }
+    TEST_CASE("SortKeysGroupByMaterial") {
+        CHECK(MaterialRegistry::DrawSortKey(1, 0xffffffff) < MaterialRegistry::DrawSortKey(2, 0));
+    }
+}
+#endif //!VPSK_TESTING_ENABLED
@@ -1,7 +1,17 @@
 #include "resources/MeshData.hpp"
 #include "resource/Buffer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 namespace vpsk {
 
+    // Covers the alignment of every vertex attribute format we use, as well as the 4 bytes index offsets require
+    constexpr static VkDeviceSize PackedStreamAlignment = 16;
+
+    constexpr static VkDeviceSize align_stream(const VkDeviceSize offset) {
+        return (offset + PackedStreamAlignment - 1) & ~(PackedStreamAlignment - 1);
+    }
+
     void MeshData::CreateBuffers(const vpr::Device * device) {
         
         VBO0 = std::make_unique<vpr::Buffer>(device);
@@ -18,7 +28,89 @@ namespace vpsk {
 
     }
 
+    void MeshData::CreatePackedBuffer(const vpr::Device* device) {
+        MeshData* self = this;
+        CreatePackedBuffers(device, &self, 1);
+    }
+
+    void MeshData::CreatePackedBuffers(const vpr::Device* device, MeshData* const* meshes, const size_t num_meshes) {
+        // Lay out every stream of every mesh up front, so the host-side data is gathered into one block in one pass
+        VkDeviceSize total_size = 0;
+        std::vector<std::vector<host_stream_t>> mesh_streams(num_meshes);
+        for (size_t i = 0; i < num_meshes; ++i) {
+            MeshData* mesh = meshes[i];
+            mesh_streams[i] = mesh->getVertexStreams();
+            mesh->packedOffset = total_size;
+            mesh->PackedVertexOffsets.resize(mesh_streams[i].size());
+            for (size_t j = 0; j < mesh_streams[i].size(); ++j) {
+                mesh->PackedVertexOffsets[j] = total_size;
+                total_size = align_stream(total_size + mesh_streams[i][j].Size);
+            }
+            mesh->PackedIndexOffset = total_size;
+            total_size = align_stream(total_size + static_cast<VkDeviceSize>(sizeof(uint32_t) * mesh->Indices.size()));
+            mesh->packedSize = total_size - mesh->packedOffset;
+        }
+
+        // Nothing would be packed, leaving the meshes without any buffer to bind or copy into
+        if (total_size == 0) {
+            throw std::invalid_argument("Can't create packed buffers for meshes without any vertices or indices");
+        }
+
+        std::vector<uint8_t> staging_data(static_cast<size_t>(total_size), 0);
+        for (size_t i = 0; i < num_meshes; ++i) {
+            const MeshData* mesh = meshes[i];
+            for (size_t j = 0; j < mesh_streams[i].size(); ++j) {
+                if (mesh_streams[i][j].Size != 0) {
+                    std::memcpy(staging_data.data() + mesh->PackedVertexOffsets[j], mesh_streams[i][j].Data, static_cast<size_t>(mesh_streams[i][j].Size));
+                }
+            }
+            if (!mesh->Indices.empty()) {
+                std::memcpy(staging_data.data() + mesh->PackedIndexOffset, mesh->Indices.data(), sizeof(uint32_t) * mesh->Indices.size());
+            }
+        }
+
+        std::shared_ptr<vpr::Buffer> staging(vpr::Buffer::CreateStagingBuffer(device, staging_data.data(), total_size));
+        auto packed_buffer = std::make_shared<vpr::Buffer>(device);
+        constexpr VkBufferUsageFlags packed_usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        packed_buffer->CreateBuffer(packed_usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, total_size);
+
+        for (size_t i = 0; i < num_meshes; ++i) {
+            meshes[i]->PackedBuffer = packed_buffer;
+            meshes[i]->packedStaging = staging;
+        }
+    }
+
+    void MeshData::TransferPackedBuffers(VkCommandBuffer cmd, MeshData* const* meshes, const size_t num_meshes) {
+        // Meshes are normally all from one batch: runs of meshes sharing a buffer are merged into a single copy
+        size_t i = 0;
+        while (i < num_meshes) {
+            const MeshData* first = meshes[i];
+            if (!first->Packed() || !first->packedStaging) {
+                ++i;
+                continue;
+            }
+
+            VkDeviceSize range_begin = first->packedOffset;
+            VkDeviceSize range_end = first->packedOffset + first->packedSize;
+            size_t j = i + 1;
+            while ((j < num_meshes) && (meshes[j]->PackedBuffer == first->PackedBuffer) && (meshes[j]->packedStaging == first->packedStaging)) {
+                range_begin = std::min(range_begin, meshes[j]->packedOffset);
+                range_end = std::max(range_end, meshes[j]->packedOffset + meshes[j]->packedSize);
+                ++j;
+            }
+
+            const VkBufferCopy copy{ range_begin, range_begin, range_end - range_begin };
+            vkCmdCopyBuffer(cmd, first->packedStaging->vkHandle(), first->PackedBuffer->vkHandle(), 1, &copy);
+            i = j;
+        }
+    }
+
     void MeshData::TransferToDevice(VkCommandBuffer cmd) {
+        if (Packed()) {
+            MeshData* self = this;
+            TransferPackedBuffers(cmd, &self, 1);
+            return;
+        }
         VBO0->CopyTo(vboStaging0.get(), cmd, 0);
         VBO1->CopyTo(vboStaging1.get(), cmd, 0);
         EBO->CopyTo(eboStaging.get(), cmd, 0);
@@ -28,21 +120,45 @@ namespace vpsk {
         vboStaging0.reset();
         vboStaging1.reset();
         eboStaging.reset();
+        packedStaging.reset();
         Positions.clear(); Positions.shrink_to_fit();
         Vertices.clear(); Vertices.shrink_to_fit();
         Indices.clear(); Indices.shrink_to_fit();
     }
 
     std::vector<VkBuffer> MeshData::GetVertexBuffers() const {
+        if (Packed()) {
+            return std::vector<VkBuffer>(PackedVertexOffsets.size(), PackedBuffer->vkHandle());
+        }
         return std::vector<VkBuffer>{ VBO0->vkHandle(), VBO1->vkHandle() };
     }
 
+    std::vector<VkDeviceSize> MeshData::GetVertexBufferOffsets() const {
+        if (Packed()) {
+            return PackedVertexOffsets;
+        }
+        return std::vector<VkDeviceSize>(GetVertexBuffers().size(), VkDeviceSize(0));
+    }
+
+    bool MeshData::Packed() const noexcept {
+        return PackedBuffer != nullptr;
+    }
+
+    std::vector<MeshData::host_stream_t> MeshData::getVertexStreams() const {
+        return std::vector<host_stream_t>{
+            host_stream_t{ Positions.data(), static_cast<VkDeviceSize>(sizeof(glm::vec3) * Positions.size()) },
+            host_stream_t{ Vertices.data(), static_cast<VkDeviceSize>(sizeof(vertex_data_t) * Vertices.size()) }
+        };
+    }
+
     MeshData::MeshData() noexcept : VBO0{ nullptr }, VBO1{ nullptr }, EBO{ nullptr }, vboStaging0{ nullptr }, vboStaging1{ nullptr }, eboStaging{ nullptr } {}
 
     MeshData::~MeshData() {}
 
     MeshData::MeshData(MeshData && other) noexcept : VBO0(std::move(other.VBO0)), VBO1(std::move(other.VBO1)), EBO(std::move(other.EBO)), Positions(std::move(other.Positions)),
-        Vertices(std::move(other.Vertices)), Indices(std::move(other.Indices)), vboStaging0(std::move(other.vboStaging0)), vboStaging1(std::move(other.vboStaging1)), eboStaging(std::move(other.eboStaging)) { }
+        Vertices(std::move(other.Vertices)), Indices(std::move(other.Indices)), vboStaging0(std::move(other.vboStaging0)), vboStaging1(std::move(other.vboStaging1)), eboStaging(std::move(other.eboStaging)),
+        PackedBuffer(std::move(other.PackedBuffer)), PackedVertexOffsets(std::move(other.PackedVertexOffsets)), PackedIndexOffset(other.PackedIndexOffset), packedStaging(std::move(other.packedStaging)),
+        packedOffset(other.packedOffset), packedSize(other.packedSize) { }
 
     MeshData& MeshData::operator=(MeshData && other) noexcept {
         VBO0 = std::move(other.VBO0);
@@ -54,14 +170,23 @@ namespace vpsk {
         vboStaging0 = std::move(other.vboStaging0);
         vboStaging1 = std::move(other.vboStaging1);
         eboStaging = std::move(other.eboStaging);
+        PackedBuffer = std::move(other.PackedBuffer);
+        PackedVertexOffsets = std::move(other.PackedVertexOffsets);
+        PackedIndexOffset = other.PackedIndexOffset;
+        packedStaging = std::move(other.packedStaging);
+        packedOffset = other.packedOffset;
+        packedSize = other.packedSize;
         return *this;
     }
 
     MeshData::operator VertexBufferComponent() const {
-        return VertexBufferComponent(GetVertexBuffers());
+        return VertexBufferComponent(GetVertexBuffers(), GetVertexBufferOffsets());
     }
 
     MeshData::operator IndexBufferComponent() const {
+        if (Packed()) {
+            return IndexBufferComponent(PackedBuffer->vkHandle(), PackedIndexOffset);
+        }
         return IndexBufferComponent(EBO->vkHandle());
     }
 
@@ -70,7 +195,7 @@ namespace vpsk {
     AnimatedMeshData::~AnimatedMeshData() {}
 
     AnimatedMeshData::AnimatedMeshData(AnimatedMeshData&& other) noexcept : MeshData(std::move(other)), VBO2(std::move(other.VBO2)),
-        vboStaging2(std::move(other.vboStaging2)), AnimationData(std::move(AnimationData)) {}
+        vboStaging2(std::move(other.vboStaging2)), AnimationData(std::move(other.AnimationData)) {}
 
     AnimatedMeshData& AnimatedMeshData::operator=(AnimatedMeshData&& other) noexcept {
         MeshData::operator=(std::move(other));
@@ -93,6 +218,9 @@ namespace vpsk {
 
     void AnimatedMeshData::TransferToDevice(VkCommandBuffer cmd) {
         MeshData::TransferToDevice(cmd);
+        if (Packed()) {
+            return;
+        }
         VBO2->CopyTo(vboStaging2.get(), cmd, 0);
     }
 
@@ -103,7 +231,16 @@ namespace vpsk {
     }
 
     std::vector<VkBuffer> AnimatedMeshData::GetVertexBuffers() const {
+        if (Packed()) {
+            return MeshData::GetVertexBuffers();
+        }
         return std::vector<VkBuffer>{ VBO0->vkHandle(), VBO1->vkHandle(), VBO2->vkHandle() };
     }
-    
+
+    std::vector<MeshData::host_stream_t> AnimatedMeshData::getVertexStreams() const {
+        std::vector<host_stream_t> streams = MeshData::getVertexStreams();
+        streams.emplace_back(host_stream_t{ AnimationData.data(), static_cast<VkDeviceSize>(sizeof(vertex_animation_data_t) * AnimationData.size()) });
+        return streams;
+    }
+
 }
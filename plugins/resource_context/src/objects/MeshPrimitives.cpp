@@ -2,10 +2,88 @@
 #include "resources/MeshData.hpp"
 #include <array>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <thread>
 #include "glm/glm.hpp"
 #include "doctest/doctest.h"
+#ifdef VPSK_TESTING_ENABLED
+#include <chrono>
+#include <string>
+#endif
 namespace vpsk {
 
+    namespace {
+
+        // Splits [0, count) into contiguous ranges run across hardware threads, calling fn(begin, end) for each.
+        // Ranges smaller than min_per_thread aren't worth a thread, so small meshes just run inline.
+        template<typename Fn>
+        void parallel_for(const size_t count, const size_t min_per_thread, Fn&& fn) {
+            const size_t max_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+            const size_t num_threads = std::min(max_threads, count / std::max<size_t>(min_per_thread, 1));
+            if (num_threads <= 1) {
+                fn(size_t(0), count);
+                return;
+            }
+
+            const size_t per_thread = (count + num_threads - 1) / num_threads;
+            std::vector<std::future<void>> futures;
+            futures.reserve(num_threads - 1);
+            for (size_t begin = per_thread; begin < count; begin += per_thread) {
+                const size_t end = std::min(begin + per_thread, count);
+                futures.emplace_back(std::async(std::launch::async, [&fn, begin, end]() { fn(begin, end); }));
+            }
+            fn(size_t(0), std::min(per_thread, count));
+
+            for (auto& future : futures) {
+                future.get();
+            }
+        }
+
+        constexpr size_t MinVerticesPerThread = 16384;
+
+        // Maps an edge to the vertex created at its midpoint, so the two triangles sharing an edge also share
+        // that vertex. Open addressed with linear probing: node-based maps spent most of their time allocating.
+        class edge_midpoint_cache_t {
+        public:
+            void Reset(const size_t num_edges) {
+                size_t capacity = 16;
+                while (capacity < num_edges * 2) {
+                    capacity <<= 1;
+                }
+                keys.assign(capacity, EmptyKey);
+                values.resize(capacity);
+                mask = capacity - 1;
+            }
+
+            // Returns the slot for the edge: if it was empty it's claimed, and inserted is set
+            uint32_t& FindOrInsert(const uint32_t i0, const uint32_t i1, bool& inserted) {
+                const uint64_t key = (i0 < i1) ? ((uint64_t(i0) << 32) | i1) : ((uint64_t(i1) << 32) | i0);
+                size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+                while (keys[slot] != key) {
+                    if (keys[slot] == EmptyKey) {
+                        keys[slot] = key;
+                        inserted = true;
+                        return values[slot];
+                    }
+                    slot = (slot + 1) & mask;
+                }
+                inserted = false;
+                return values[slot];
+            }
+
+        private:
+            // Can't collide with a real edge, since an edge's first index is always less than its second
+            constexpr static uint64_t EmptyKey = std::numeric_limits<uint64_t>::max();
+            std::vector<uint64_t> keys;
+            std::vector<uint32_t> values;
+            size_t mask{ 0 };
+        };
+
+    }
+
     static const std::array<glm::vec3, 8> BOX_POSITIONS {
         glm::vec3(-1.0f, -1.0f, +1.0f), 
         glm::vec3(+1.0f, -1.0f, +1.0f), 
@@ -132,12 +210,16 @@ namespace vpsk {
         auto build_face = [&](const size_t& face_idx) {
             vertex_t v0, v1, v2, v3;
             get_face_vertices(face_idx, v0, v1, v2, v3);
-            result->Indices.emplace_back(add_vertex(std::move(v0)));
-            result->Indices.emplace_back(add_vertex(std::move(v1)));
-            result->Indices.emplace_back(add_vertex(std::move(v2)));
-            result->Indices.emplace_back(add_vertex(std::move(v3)));
+            const uint32_t i0 = add_vertex(std::move(v0));
+            const uint32_t i1 = add_vertex(std::move(v1));
+            const uint32_t i2 = add_vertex(std::move(v2));
+            const uint32_t i3 = add_vertex(std::move(v3));
+            result->Indices.insert(result->Indices.end(), { i0, i1, i2, i0, i2, i3 });
         };
-        
+
+        result->Positions.reserve(24);
+        result->Vertices.reserve(24);
+        result->Indices.reserve(36);
         for (size_t i = 0; i < 6; ++i) {
             build_face(i);
         }
@@ -150,76 +232,109 @@ namespace vpsk {
     }
 
     std::unique_ptr<MeshData> CreateIcosphere(const size_t detail_level, const ExtraFeatures features) {
-        
+
         std::unique_ptr<MeshData> result = std::make_unique<MeshData>();
-        result->Indices.assign(ICOSPHERE_INDICES.cbegin(), ICOSPHERE_INDICES.cend());
-        result->Positions.assign(ICOSPHERE_POSITIONS.cbegin(), ICOSPHERE_POSITIONS.cend());
+        auto& positions = result->Positions;
+        auto& indices = result->Indices;
+
+        // Each level splits every face into 4. With shared midpoints, V - E + F = 2 gives the vertex count.
+        const size_t final_num_triangles = size_t(20) << (2 * detail_level);
+        const size_t final_num_vertices = final_num_triangles / 2 + 2;
+        positions.reserve(final_num_vertices);
         for (const auto& vert : ICOSPHERE_POSITIONS) {
-            result->Vertices.emplace_back(vertex_data_t{ vert, glm::vec3(0.0f), glm::vec3(0.0f) });
+            positions.emplace_back(glm::normalize(vert));
         }
 
+        indices.assign(ICOSPHERE_INDICES.cbegin(), ICOSPHERE_INDICES.cend());
+        std::vector<uint32_t> subdivided_indices;
+        subdivided_indices.reserve(final_num_triangles * 3);
+        indices.reserve(final_num_triangles * 3);
+
+        edge_midpoint_cache_t edge_midpoints;
+        auto get_midpoint = [&](const uint32_t i0, const uint32_t i1)->uint32_t {
+            bool inserted = false;
+            uint32_t& midpoint_idx = edge_midpoints.FindOrInsert(i0, i1, inserted);
+            if (inserted) {
+                midpoint_idx = static_cast<uint32_t>(positions.size());
+                const glm::vec3 midpoint = glm::normalize(positions[i0] + positions[i1]);
+                positions.emplace_back(midpoint);
+            }
+            return midpoint_idx;
+        };
+
         for (size_t i = 0; i < detail_level; ++i) {
-            const size_t num_triangles = result->Indices.size();
+            const size_t num_triangles = indices.size() / 3;
+            edge_midpoints.Reset(num_triangles * 3 / 2);
+            subdivided_indices.resize(num_triangles * 12);
 
             for (size_t j = 0; j < num_triangles; ++j) {
-                const uint32_t i0 = result->Indices[j * 3 + 0];
-                const uint32_t i1 = result->Indices[j * 3 + 1];
-                const uint32_t i2 = result->Indices[j * 3 + 2];
-
-                const uint32_t i3 = static_cast<uint32_t>(result->Positions.size());
-                const uint32_t i4 = i3 + 1;
-                const uint32_t i5 = i4 + 1;
-
-                result->Indices[j * 3 + 1] = i3;
-                result->Indices[j * 3 + 2] = i5;
-
-                result->Indices.insert(result->Indices.end(), { i3, i1, i4, i5, i3, i4, i5, i4, i2 });
-                result->Positions.emplace_back(0.5f * (result->Positions[i0] + result->Positions[i1]));
-                result->Vertices.emplace_back(vertex_data_t{ result->Positions.back(), glm::vec3(0.0f), glm::vec3(0.0f) });
-                result->Positions.emplace_back(0.5f * (result->Positions[i1] + result->Positions[i2]));
-                result->Vertices.emplace_back(vertex_data_t{ result->Positions.back(), glm::vec3(0.0f), glm::vec3(0.0f) });
-                result->Positions.emplace_back(0.5f * (result->Positions[i2] + result->Positions[i0]));
-                result->Vertices.emplace_back(vertex_data_t{ result->Positions.back(), glm::vec3(0.0f), glm::vec3(0.0f) });
+                const uint32_t i0 = indices[j * 3 + 0];
+                const uint32_t i1 = indices[j * 3 + 1];
+                const uint32_t i2 = indices[j * 3 + 2];
+                const uint32_t i3 = get_midpoint(i0, i1);
+                const uint32_t i4 = get_midpoint(i1, i2);
+                const uint32_t i5 = get_midpoint(i2, i0);
+
+                uint32_t* dst = subdivided_indices.data() + j * 12;
+                dst[0] = i0; dst[1] = i3; dst[2] = i5;
+                dst[3] = i3; dst[4] = i1; dst[5] = i4;
+                dst[6] = i5; dst[7] = i3; dst[8] = i4;
+                dst[9] = i5; dst[10] = i4; dst[11] = i2;
             }
-        }
-
-        for (size_t i = 0; i < result->Positions.size(); ++i) {
-            result->Positions[i] = glm::normalize(result->Positions[i]);
-            result->Vertices[i].Normal = glm::normalize(result->Vertices[i].Normal);
-        }
 
-        for(size_t i = 0; i < result->Positions.size(); ++i) {
-            const glm::vec3& norm = result->Vertices[i].Normal;
-            result->Vertices[i].UV.x = (glm::atan((float)norm.x, -norm.z) / FLOAT_PI) * 0.5f + 0.5f;
-            result->Vertices[i].UV.y = -norm.y * 0.5f + 0.5f;
+            indices.swap(subdivided_indices);
         }
 
-        auto add_vertex_w_uv = [&](const size_t& i, const glm::vec3& uv) {
-            const uint32_t idx = result->Indices[i];
-            result->Vertices[idx].UV = uv;
+        // Positions are already on the unit sphere, so they double as normals
+        const size_t num_shared_vertices = positions.size();
+        result->Vertices.resize(num_shared_vertices);
+        parallel_for(num_shared_vertices, MinVerticesPerThread, [&](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const glm::vec3& norm = positions[i];
+                vertex_data_t& vert = result->Vertices[i];
+                vert.Normal = norm;
+                vert.Tangent = glm::vec3(0.0f);
+                vert.Bitangent = glm::vec3(0.0f);
+                vert.UV.x = (std::atan2(norm.x, -norm.z) / FLOAT_PI) * 0.5f + 0.5f;
+                vert.UV.y = -norm.y * 0.5f + 0.5f;
+                vert.UV.z = 0.0f;
+            }
+        });
+
+        // Triangles straddling the UV seam have corners on both sides of u = 0/1: those on the low side get a
+        // copy of their vertex with u shifted by one. Copies are cached, so each seam vertex is duplicated once.
+        std::vector<uint32_t> wrapped_vertices(num_shared_vertices, std::numeric_limits<uint32_t>::max());
+        auto get_wrapped_vertex = [&](const uint32_t idx)->uint32_t {
+            if (wrapped_vertices[idx] == std::numeric_limits<uint32_t>::max()) {
+                wrapped_vertices[idx] = static_cast<uint32_t>(positions.size());
+                vertex_data_t wrapped = result->Vertices[idx];
+                wrapped.UV.x += 1.0f;
+                const glm::vec3 position = positions[idx];
+                positions.emplace_back(position);
+                result->Vertices.emplace_back(wrapped);
+            }
+            return wrapped_vertices[idx];
         };
 
-        const size_t num_triangles = result->Indices.size() / 3;
-        auto& vertexData = result->Vertices;
-        auto& indices = result->Indices;
-
-        for(size_t i = 0; i < num_triangles; ++i) {
-            const glm::vec3& uv0 = vertexData[indices[i * 3]].UV;
-            const glm::vec3& uv1 = vertexData[indices[i * 3 + 1]].UV;
-            const glm::vec3& uv2 = vertexData[indices[i * 3 + 2]].UV;
-            const float d1 = uv1.x - uv0.x;
-            const float d2 = uv2.x - uv0.x;
-            if(std::abs(d1) > 0.5f && std::abs(d2) > 0.5f){
-                add_vertex_w_uv(i * 3, uv0 + glm::vec3((d1 > 0.0f) ? 1.0f : -1.0f, 0.0f, 0.0f));
-            }
-            else if(std::abs(d1) > 0.5f) {
-                add_vertex_w_uv(i * 3 + 1, uv1 + glm::vec3((d1 < 0.0f) ? 1.0f : -1.0f, 0.0f, 0.0f));
+        const size_t num_triangles = indices.size() / 3;
+        for (size_t i = 0; i < num_triangles; ++i) {
+            uint32_t* tri = indices.data() + i * 3;
+            const float u0 = result->Vertices[tri[0]].UV.x;
+            const float u1 = result->Vertices[tri[1]].UV.x;
+            const float u2 = result->Vertices[tri[2]].UV.x;
+            const float max_u = std::max(u0, std::max(u1, u2));
+            const float min_u = std::min(u0, std::min(u1, u2));
+            if (max_u - min_u <= 0.5f) {
+                continue;
             }
-            else if(std::abs(d2) > 0.5f) {
-                add_vertex_w_uv(i * 3 + 2, uv2 + glm::vec3((d2 < 0.0f) ? 1.0f : -1.0f, 0.0f, 0.0f));
+
+            for (size_t j = 0; j < 3; ++j) {
+                if (result->Vertices[tri[j]].UV.x < 0.5f) {
+                    tri[j] = get_wrapped_vertex(tri[j]);
+                }
             }
         }
-        
+
         if (features == ExtraFeatures::GenerateTangents) {
             GenerateTangentVectors(result.get());
         }
@@ -228,47 +343,95 @@ namespace vpsk {
     }
 
     void GenerateTangentVectors(MeshData* mesh) {
-        // From https://github.com/mlimper/tgen/
-        const size_t num_corners = mesh->Indices.size();
-
-        glm::vec3 edge3D[3];
-        glm::vec2 edgeUV[3];
-
-        for (size_t i = 0; i < num_corners; i += 3) {
-            const uint32_t indices[3] = { mesh->Indices[i + 0], 
-                                          mesh->Indices[i + 1],
-                                          mesh->Indices[i + 2] };
-            
-            for (size_t j = 0; j < 3; ++j) {
-                const size_t next = (j + 1) % 3;
-                const uint32_t& v0_idx = indices[j];
-                const uint32_t& v1_idx = indices[next];
+        // Per-face tangent frames (Lengyel's method, as in https://github.com/mlimper/tgen/), accumulated onto
+        // vertices then orthonormalized against the vertex normal.
+        const size_t num_triangles = mesh->Indices.size() / 3;
+        const size_t num_vertices = mesh->Positions.size();
+        const uint32_t* indices = mesh->Indices.data();
+        const glm::vec3* positions = mesh->Positions.data();
+        vertex_data_t* vertices = mesh->Vertices.data();
+
+        // Face frames are kept as separate float streams, so the face loop has no interleaved stores and the
+        // vertex loop reads each component contiguously
+        std::array<std::vector<float>, 3> face_tangents;
+        std::array<std::vector<float>, 3> face_bitangents;
+        for (size_t i = 0; i < 3; ++i) {
+            face_tangents[i].resize(num_triangles);
+            face_bitangents[i].resize(num_triangles);
+        }
 
-                edge3D[j] = mesh->Positions[v1_idx] - mesh->Positions[v0_idx];
-                edgeUV[j] = mesh->Vertices[v1_idx].UV - mesh->Vertices[v0_idx].UV;
+        parallel_for(num_triangles, MinVerticesPerThread, [&](const size_t begin, const size_t end) {
+            float* tx = face_tangents[0].data();
+            float* ty = face_tangents[1].data();
+            float* tz = face_tangents[2].data();
+            float* bx = face_bitangents[0].data();
+            float* by = face_bitangents[1].data();
+            float* bz = face_bitangents[2].data();
+            for (size_t i = begin; i < end; ++i) {
+                const uint32_t i0 = indices[i * 3 + 0];
+                const uint32_t i1 = indices[i * 3 + 1];
+                const uint32_t i2 = indices[i * 3 + 2];
+
+                const glm::vec3 e1 = positions[i1] - positions[i0];
+                const glm::vec3 e2 = positions[i2] - positions[i0];
+                const float du1 = vertices[i1].UV.x - vertices[i0].UV.x;
+                const float dv1 = vertices[i1].UV.y - vertices[i0].UV.y;
+                const float du2 = vertices[i2].UV.x - vertices[i0].UV.x;
+                const float dv2 = vertices[i2].UV.y - vertices[i0].UV.y;
+
+                // Mirrored UVs give a negative determinant, which is still a valid frame: only skip degenerate ones
+                const float denom = du1 * dv2 - du2 * dv1;
+                const float r = std::abs(denom) > std::numeric_limits<float>::epsilon() ? 1.0f / denom : 0.0f;
+
+                tx[i] = (e1.x * dv2 - e2.x * dv1) * r;
+                ty[i] = (e1.y * dv2 - e2.y * dv1) * r;
+                tz[i] = (e1.z * dv2 - e2.z * dv1) * r;
+                bx[i] = (e2.x * du1 - e1.x * du2) * r;
+                by[i] = (e2.y * du1 - e1.y * du2) * r;
+                bz[i] = (e2.z * du1 - e1.z * du2) * r;
             }
+        });
 
-            for (size_t j = 0; j < 3; ++j) {
-                const size_t prev = (j + 2) % 3;
-
-                const glm::vec3& pos0 = edge3D[j];
-                const glm::vec3& pos1 = edge3D[prev];
-                const glm::vec2& uv0 = edgeUV[j];
-                const glm::vec2& uv1 = edgeUV[prev];
-
-                const float denom = (uv0.x * -uv1.y - uv0.y * -uv1.x);
-                const float r = denom > std::numeric_limits<float>::epsilon() ? 1.0f / denom : 0.0f;
-
-                glm::vec3 tmp0 = pos0 * (-uv1.y * r);
-                glm::vec3 tmp1 = pos1 * (-uv0.y * r);
-                mesh->Vertices[indices[j]].Tangent = tmp0 - tmp1;
-
-                tmp0 = pos1 * (-uv0.x * r);
-                tmp1 = pos0 * (-uv1.x * r);
-                mesh->Vertices[indices[j]].Bitangent = tmp0 - tmp1;
-
+        // Vertex -> face adjacency (compressed rows), so each vertex sums its own faces: no two threads ever
+        // write the same vertex, and no atomics are needed
+        std::vector<uint32_t> face_offsets(num_vertices + 1, 0);
+        for (size_t i = 0; i < num_triangles * 3; ++i) {
+            ++face_offsets[indices[i] + 1];
+        }
+        for (size_t i = 0; i < num_vertices; ++i) {
+            face_offsets[i + 1] += face_offsets[i];
+        }
+        std::vector<uint32_t> vertex_faces(num_triangles * 3);
+        {
+            std::vector<uint32_t> fill_offsets(face_offsets.begin(), face_offsets.end() - 1);
+            for (size_t i = 0; i < num_triangles * 3; ++i) {
+                vertex_faces[fill_offsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
             }
         }
+
+        parallel_for(num_vertices, MinVerticesPerThread, [&](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                glm::vec3 tangent(0.0f);
+                glm::vec3 bitangent(0.0f);
+                for (uint32_t j = face_offsets[i]; j < face_offsets[i + 1]; ++j) {
+                    const uint32_t face = vertex_faces[j];
+                    tangent += glm::vec3(face_tangents[0][face], face_tangents[1][face], face_tangents[2][face]);
+                    bitangent += glm::vec3(face_bitangents[0][face], face_bitangents[1][face], face_bitangents[2][face]);
+                }
+
+                // Gram-Schmidt: zero-length results (no faces, or only degenerate ones) are left as zero
+                const glm::vec3& normal = vertices[i].Normal;
+                tangent -= normal * glm::dot(normal, tangent);
+                const float tangent_length = glm::length(tangent);
+                tangent = tangent_length > std::numeric_limits<float>::epsilon() ? tangent / tangent_length : glm::vec3(0.0f);
+                bitangent -= normal * glm::dot(normal, bitangent) + tangent * glm::dot(tangent, bitangent);
+                const float bitangent_length = glm::length(bitangent);
+                bitangent = bitangent_length > std::numeric_limits<float>::epsilon() ? bitangent / bitangent_length : glm::vec3(0.0f);
+
+                vertices[i].Tangent = tangent;
+                vertices[i].Bitangent = bitangent;
+            }
+        });
     }
 
 }
@@ -283,9 +446,60 @@ TEST_SUITE("MeshPrimitives") {
     }
     TEST_CASE("GenerateIcosphere") {
         std::unique_ptr<vpsk::MeshData> icosphere_mesh = vpsk::CreateIcosphere(3);
+        // 20 * 4^3 faces, and 10 * 4^3 + 2 vertices shared between them before the UV seam is split
+        CHECK(icosphere_mesh->Indices.size() == 1280 * 3);
+        CHECK(icosphere_mesh->Positions.size() >= 642);
+        CHECK(icosphere_mesh->Positions.size() == icosphere_mesh->Vertices.size());
+        for (const auto& idx : icosphere_mesh->Indices) {
+            REQUIRE(idx < icosphere_mesh->Positions.size());
+        }
+        for (const auto& position : icosphere_mesh->Positions) {
+            CHECK(std::abs(glm::length(position) - 1.0f) < 1e-4f);
+        }
+        // Midpoints are shared, so the only vertices with the same position are seam copies with different UVs
+        size_t num_duplicates = 0;
+        for (size_t i = 0; i < icosphere_mesh->Positions.size(); ++i) {
+            for (size_t j = i + 1; j < icosphere_mesh->Positions.size(); ++j) {
+                if ((icosphere_mesh->Positions[i] == icosphere_mesh->Positions[j]) &&
+                    (icosphere_mesh->Vertices[i].UV == icosphere_mesh->Vertices[j].UV)) {
+                    ++num_duplicates;
+                }
+            }
+        }
+        CHECK(num_duplicates == 0);
     }
     TEST_CASE("GenerateIcosphereWithTangents") {
         std::unique_ptr<vpsk::MeshData> icosphere_mesh_tangents = vpsk::CreateIcosphere(3, vpsk::ExtraFeatures::GenerateTangents);
+        for (const auto& vert : icosphere_mesh_tangents->Vertices) {
+            const float tangent_length = glm::length(vert.Tangent);
+            if (tangent_length != 0.0f) {
+                CHECK(std::abs(tangent_length - 1.0f) < 1e-3f);
+                CHECK(std::abs(glm::dot(vert.Tangent, vert.Normal)) < 1e-3f);
+            }
+        }
+    }
+    TEST_CASE("IcosphereIndexCounts") {
+        for (size_t level = 0; level <= 2; ++level) {
+            std::unique_ptr<vpsk::MeshData> mesh = vpsk::CreateIcosphere(level);
+            CHECK(mesh->Indices.size() == (size_t(60) << (2 * level)));
+        }
+    }
+    TEST_CASE("IcosphereBenchmark" * doctest::skip()) {
+        // Not a pass/fail test, and slow at the higher levels: run with --no-skip to get generation timings at each
+        // detail level, with and without tangents
+        for (size_t level = 0; level <= 8; ++level) {
+            auto begin = std::chrono::high_resolution_clock::now();
+            std::unique_ptr<vpsk::MeshData> mesh = vpsk::CreateIcosphere(level);
+            auto mid = std::chrono::high_resolution_clock::now();
+            vpsk::GenerateTangentVectors(mesh.get());
+            auto end = std::chrono::high_resolution_clock::now();
+            CHECK(mesh->Indices.size() == (size_t(60) << (2 * level)));
+            const std::string timings = "Icosphere detail level " + std::to_string(level) + ": " +
+                std::to_string(mesh->Positions.size()) + " vertices, generation " +
+                std::to_string(std::chrono::duration<double, std::milli>(mid - begin).count()) + "ms, tangents " +
+                std::to_string(std::chrono::duration<double, std::milli>(end - mid).count()) + "ms";
+            MESSAGE(timings);
+        }
     }
 }
 #endif //!VPSK_TESTING_ENABLED
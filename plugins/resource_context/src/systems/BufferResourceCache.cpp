@@ -1,6 +1,7 @@
 #include "systems/BufferResourceCache.hpp"
 #include "core/ShaderResource.hpp"
 #include "resource/Buffer.hpp"
+#include <stdexcept>
 
 namespace vpsk {
 
@@ -12,100 +13,120 @@ namespace vpsk {
         createResources(resources);
     }
 
-    void BufferResourceCache::AddResource(const st::ShaderResource* resource) {
-        if (!HasResource(resource->ParentGroupName(), resource->Name())) {
-            createResource(resource);
+    resource_cache_id_t BufferResourceCache::AddResource(const st::ShaderResource* resource) {
+        const resource_cache_id_t existing = ResourceID(resource->ParentGroupName(), resource->Name());
+        if (existing.Valid()) {
+            return existing;
         }
+        return createResource(resource);
+    }
+
+    resource_cache_id_t BufferResourceCache::ResourceID(const std::string& group, const std::string& name) const noexcept {
+        resource_cache_id_t result;
+        result.Group = groupNames.Find(group);
+        if (result.Group != NameInterner::InvalidID) {
+            result.Name = resourceNames[result.Group].Find(name);
+        }
+        return result;
+    }
+
+    vpr::Buffer* BufferResourceCache::at(const resource_cache_id_t id) {
+        if (!HasResource(id)) {
+            throw std::out_of_range("Invalid resource ID passed to BufferResourceCache!");
+        }
+        return buffers[id.Group][id.Name].get();
+    }
+
+    vpr::Buffer* BufferResourceCache::find(const resource_cache_id_t id) noexcept {
+        return HasResource(id) ? buffers[id.Group][id.Name].get() : nullptr;
+    }
+
+    bool BufferResourceCache::HasResource(const resource_cache_id_t id) const noexcept {
+        return (id.Group < buffers.size()) && (id.Name < buffers[id.Group].size());
     }
 
     vpr::Buffer* BufferResourceCache::at(const std::string& group, const std::string& name) {
-        return buffers.at(group).at(name).get();
+        return at(ResourceID(group, name));
     }
 
     vpr::Buffer* BufferResourceCache::find(const std::string& group, const std::string& name) noexcept {
-        auto group_iter = buffers.find(group);
-        if (group_iter != buffers.end()) {
-            auto rsrc_iter = group_iter->second.find(name);
-            if (rsrc_iter != group_iter->second.end()) {
-                return rsrc_iter->second.get();
-            }
-            else {
-                return nullptr;
-            }
-        }
-        else {
-            return nullptr;
-        }
+        return find(ResourceID(group, name));
     }
 
     bool BufferResourceCache::HasResource(const std::string& group, const std::string& name) const noexcept {
-        if (buffers.count(group) == 0) {
-            return false;
-        }
-        else if (buffers.at(group).count(name) != 0) {
-            return true;
-        }
-        else {
-            return false;
-        }
+        return HasResource(ResourceID(group, name));
     }
 
-    void BufferResourceCache::createTexelBuffer(const st::ShaderResource* texel_buffer, bool storage) {
-        auto& group = buffers[texel_buffer->ParentGroupName()];
+    std::unique_ptr<vpr::Buffer> BufferResourceCache::createTexelBuffer(const st::ShaderResource* texel_buffer, bool storage) {
         auto buffer = std::make_unique<vpr::Buffer>(device);
         auto flags = storage ? VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT;
         buffer->CreateBuffer(flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texel_buffer->MemoryRequired());
         buffer->CreateView(texel_buffer->Format(), buffer->Size(), 0);
-        group.emplace(texel_buffer->Name(), std::move(buffer));
+        return buffer;
     }
 
-    void BufferResourceCache::createUniformBuffer(const st::ShaderResource* uniform_buffer) {
-        auto& group = buffers[uniform_buffer->ParentGroupName()];
+    std::unique_ptr<vpr::Buffer> BufferResourceCache::createUniformBuffer(const st::ShaderResource* uniform_buffer) {
         auto buffer = std::make_unique<vpr::Buffer>(device);
         auto flags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
         buffer->CreateBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, flags, uniform_buffer->MemoryRequired());
-        group.emplace(uniform_buffer->Name(), std::move(buffer));
+        return buffer;
     }
 
-    void BufferResourceCache::createStorageBuffer(const st::ShaderResource* storage_buffer) {
-        auto& group = buffers[storage_buffer->ParentGroupName()];
+    std::unique_ptr<vpr::Buffer> BufferResourceCache::createStorageBuffer(const st::ShaderResource* storage_buffer) {
         auto buffer = std::make_unique<vpr::Buffer>(device);
         buffer->CreateBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, storage_buffer->MemoryRequired());
-        group.emplace(storage_buffer->Name(), std::move(buffer));
+        return buffer;
     }
 
     void BufferResourceCache::createResources(const std::vector<const st::ShaderResource*>& resources) {
         for (const auto& rsrc : resources) {
-            if (!HasResource(rsrc->ParentGroupName(), rsrc->Name())) {
-                createResource(rsrc);
-            }
+            AddResource(rsrc);
         }
     }
 
-    void BufferResourceCache::createResource(const st::ShaderResource* rsrc) {
+    resource_cache_id_t BufferResourceCache::createResource(const st::ShaderResource* rsrc) {
+        std::unique_ptr<vpr::Buffer> buffer;
         switch (rsrc->DescriptorType()) {
         case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
-            createTexelBuffer(rsrc, false);
+            buffer = createTexelBuffer(rsrc, false);
             break;
         case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
-            createTexelBuffer(rsrc, true);
+            buffer = createTexelBuffer(rsrc, true);
             break;
         case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-            createUniformBuffer(rsrc);
+            buffer = createUniformBuffer(rsrc);
             break;
         case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-            createStorageBuffer(rsrc);
+            buffer = createStorageBuffer(rsrc);
             break;
         case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
-            createUniformBuffer(rsrc);
+            buffer = createUniformBuffer(rsrc);
             break;
         case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
-            createStorageBuffer(rsrc);
+            buffer = createStorageBuffer(rsrc);
             break;
         default:
-            break;
+            // Not a buffer: don't intern the name, so lookups for it keep failing
+            return resource_cache_id_t{};
         }
+
+        const resource_cache_id_t id = internName(rsrc->ParentGroupName(), rsrc->Name());
+        buffers[id.Group][id.Name] = std::move(buffer);
+        return id;
     }
 
-}
+    resource_cache_id_t BufferResourceCache::internName(const std::string& group_name, const std::string& name) {
+        resource_cache_id_t result;
+        result.Group = groupNames.Intern(group_name);
+        if (result.Group >= buffers.size()) {
+            resourceNames.resize(result.Group + 1);
+            buffers.resize(result.Group + 1);
+        }
+        result.Name = resourceNames[result.Group].Intern(name);
+        if (result.Name >= buffers[result.Group].size()) {
+            buffers[result.Group].resize(result.Name + 1);
+        }
+        return result;
+    }
 
+}
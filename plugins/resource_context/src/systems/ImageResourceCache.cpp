@@ -3,6 +3,7 @@
 #include "resource/Sampler.hpp"
 #include "resources/Texture.hpp"
 #include "core/ShaderResource.hpp"
+#include <stdexcept>
 namespace vpsk {
 
     ImageResourceCache::ImageResourceCache(const vpr::Device * dvc) : device(dvc) {}
@@ -15,133 +16,140 @@ namespace vpsk {
         }
     }
 
-    void ImageResourceCache::AddResource(const st::ShaderResource * rsrc) {
-        createResource(rsrc);
+    resource_cache_id_t ImageResourceCache::AddResource(const st::ShaderResource * rsrc) {
+        return createResource(rsrc);
     }
 
-    vpr::Image* ImageResourceCache::FindImage(const std::string& group_name, const std::string & rsrc_name) {
-        auto group_iter = images.find(group_name);
-        if (group_iter == images.end()) {
-            return nullptr;
-        }
-        else {
-            auto rsrc_iter = group_iter->second.find(rsrc_name);
-            if (rsrc_iter == group_iter->second.end()) {
-                return nullptr;
-            }
-            else {
-                return rsrc_iter->second.get();
-            }
+    resource_cache_id_t ImageResourceCache::ResourceID(const std::string& group_name, const std::string& rsrc_name) const noexcept {
+        resource_cache_id_t result;
+        result.Group = groupNames.Find(group_name);
+        if (result.Group != NameInterner::InvalidID) {
+            result.Name = resourceNames[result.Group].Find(rsrc_name);
         }
+        return result;
     }
 
-    vpr::Sampler* ImageResourceCache::FindSampler(const std::string& group_name, const std::string & rsrc_name) {
-        auto group_iter = samplers.find(group_name);
-        if (group_iter == samplers.end()) {
-            return nullptr;
+    vpr::Image* ImageResourceCache::FindImage(const resource_cache_id_t id) noexcept {
+        return inRange(id) ? images[id.Group][id.Name].get() : nullptr;
+    }
+
+    vpr::Sampler* ImageResourceCache::FindSampler(const resource_cache_id_t id) noexcept {
+        return inRange(id) ? samplers[id.Group][id.Name].get() : nullptr;
+    }
+
+    vpr::Image* ImageResourceCache::Image(const resource_cache_id_t id) {
+        vpr::Image* result = FindImage(id);
+        if (result == nullptr) {
+            throw std::out_of_range("No image exists in ImageResourceCache for given resource ID!");
         }
-        else {
-            auto rsrc_iter = group_iter->second.find(rsrc_name);
-            if (rsrc_iter == group_iter->second.end()) {
-                return nullptr;
-            }
-            else {
-                return rsrc_iter->second.get();
-            }
+        return result;
+    }
+
+    vpr::Sampler* ImageResourceCache::Sampler(const resource_cache_id_t id) {
+        vpr::Sampler* result = FindSampler(id);
+        if (result == nullptr) {
+            throw std::out_of_range("No sampler exists in ImageResourceCache for given resource ID!");
         }
+        return result;
+    }
+
+    bool ImageResourceCache::HasImage(const resource_cache_id_t id) const noexcept {
+        return inRange(id) && (images[id.Group][id.Name] != nullptr);
+    }
+
+    bool ImageResourceCache::HasSampler(const resource_cache_id_t id) const noexcept {
+        return inRange(id) && (samplers[id.Group][id.Name] != nullptr);
+    }
+
+    vpr::Image* ImageResourceCache::FindImage(const std::string& group_name, const std::string & rsrc_name) {
+        return FindImage(ResourceID(group_name, rsrc_name));
+    }
+
+    vpr::Sampler* ImageResourceCache::FindSampler(const std::string& group_name, const std::string & rsrc_name) {
+        return FindSampler(ResourceID(group_name, rsrc_name));
     }
 
     vpr::Image* ImageResourceCache::Image(const std::string& group_name, const std::string & rsrc_name) {
-        return images.at(group_name).at(rsrc_name).get();
+        return Image(ResourceID(group_name, rsrc_name));
     }
 
     vpr::Sampler* ImageResourceCache::Sampler(const std::string& group_name, const std::string & rsrc_name) {
-        return samplers.at(group_name).at(rsrc_name).get();
+        return Sampler(ResourceID(group_name, rsrc_name));
     }
 
     bool ImageResourceCache::HasImage(const std::string & group_name, const std::string & rsrc_name) const noexcept {
-        if (images.count(group_name) == 0) {
-            return false;
-        }
-        else {
-            if (images.at(group_name).count(rsrc_name) != 0) {
-                return true;
-            }
-            else {
-                return false;
-            }
-        }
+        return HasImage(ResourceID(group_name, rsrc_name));
     }
 
     bool ImageResourceCache::HasSampler(const std::string & group_name, const std::string & rsrc_name) const noexcept {
-        if (samplers.count(group_name) == 0) {
-            return false;
-        }
-        else {
-            if (samplers.at(group_name).count(rsrc_name) != 0) {
-                return true;
-            }
-            else {
-                return false;
-            }
-        }
+        return HasSampler(ResourceID(group_name, rsrc_name));
     }
 
-    void ImageResourceCache::createResource(const st::ShaderResource * rsrc) {
+    resource_cache_id_t ImageResourceCache::createResource(const st::ShaderResource * rsrc) {
         switch (rsrc->DescriptorType()) {
         case VK_DESCRIPTOR_TYPE_SAMPLER:
-            createSampler(rsrc);
-            break;
+            return createSampler(rsrc);
         case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
-            createSampledImage(rsrc);
-            break;
+            return createSampledImage(rsrc);
         case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-            createCombinedImageSampler(rsrc);
-            break;
+            return createCombinedImageSampler(rsrc);
         case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
-            createSampledImage(rsrc);
-            break;
+            return createSampledImage(rsrc);
         case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-            createCombinedImageSampler(rsrc);
-            break;
+            return createCombinedImageSampler(rsrc);
         default:
             // Probably just a resource type we don't care about.
-            break;
+            return resource_cache_id_t{};
         }
     }
 
-    void ImageResourceCache::createCombinedImageSampler(const st::ShaderResource * rsrc) {
+    resource_cache_id_t ImageResourceCache::createCombinedImageSampler(const st::ShaderResource * rsrc) {
         createSampler(rsrc);
-        createSampledImage(rsrc);
+        return createSampledImage(rsrc);
     }
 
-    void ImageResourceCache::createSampler(const st::ShaderResource * rsrc) {
-        const char* group_name = rsrc->ParentGroupName();
-        const char* rsrc_name = rsrc->Name();
-        if (!HasSampler(group_name, rsrc_name)) {
-            auto emplaced = samplers[group_name].emplace(rsrc_name, std::make_unique<vpr::Sampler>(device, rsrc->SamplerInfo()));
-            if (!emplaced.second) {
-                throw std::runtime_error("Failed to create sampler resource.");
-            }
-        }   
+    resource_cache_id_t ImageResourceCache::createSampler(const st::ShaderResource * rsrc) {
+        const resource_cache_id_t id = internName(rsrc->ParentGroupName(), rsrc->Name());
+        auto& sampler = samplers[id.Group][id.Name];
+        if (!sampler) {
+            sampler = std::make_unique<vpr::Sampler>(device, rsrc->SamplerInfo());
+        }
+        return id;
     }
 
-    void ImageResourceCache::createSampledImage(const st::ShaderResource * rsrc) {
+    resource_cache_id_t ImageResourceCache::createSampledImage(const st::ShaderResource * rsrc) {
+        const resource_cache_id_t id = internName(rsrc->ParentGroupName(), rsrc->Name());
         if (rsrc->FromFile()) {
-            return;
+            return id;
+        }
+
+        auto& image = images[id.Group][id.Name];
+        if (!image) {
+            image = std::make_unique<vpr::Image>(device);
+            image->Create(rsrc->ImageInfo());
+            image->CreateView(rsrc->ImageViewInfo());
         }
+        return id;
+    }
 
-        const char* group_name = rsrc->ParentGroupName();
-        const char* rsrc_name = rsrc->Name();
-        
-        if (!HasImage(group_name, rsrc_name)) {
-            auto emplaced = images[group_name].emplace(rsrc_name, std::make_unique<vpr::Image>(device));
-            if (!emplaced.second) {
-                throw std::runtime_error("Failed to create sampler resource");
-            }
-            emplaced.first->second->Create(rsrc->ImageInfo());
-            emplaced.first->second->CreateView(rsrc->ImageViewInfo());
+    resource_cache_id_t ImageResourceCache::internName(const std::string& group_name, const std::string& rsrc_name) {
+        resource_cache_id_t result;
+        result.Group = groupNames.Intern(group_name);
+        if (result.Group >= resourceNames.size()) {
+            resourceNames.resize(result.Group + 1);
+            samplers.resize(result.Group + 1);
+            images.resize(result.Group + 1);
         }
+        result.Name = resourceNames[result.Group].Intern(rsrc_name);
+        if (result.Name >= images[result.Group].size()) {
+            samplers[result.Group].resize(result.Name + 1);
+            images[result.Group].resize(result.Name + 1);
+        }
+        return result;
+    }
+
+    bool ImageResourceCache::inRange(const resource_cache_id_t id) const noexcept {
+        return (id.Group < images.size()) && (id.Name < images[id.Group].size());
     }
 
 }
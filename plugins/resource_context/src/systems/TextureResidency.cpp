@@ -0,0 +1,388 @@
+#include "systems/TextureResidency.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "doctest/doctest.h"
+
+namespace vpsk {
+
+    TextureResidencyManager::TextureResidencyManager(const texture_residency_config_t& _config) : config(_config) {}
+
+    texture_residency_id_t TextureResidencyManager::Register(const texture_residency_desc_t& desc) {
+        if ((desc.Width == 0) || (desc.Height == 0) || (desc.MipLevels == 0)) {
+            throw std::invalid_argument("Texture registered for residency management has zero extent or no mips!");
+        }
+
+        texture_residency_id_t id = 0;
+        if (!freeIDs.empty()) {
+            id = freeIDs.back();
+            freeIDs.pop_back();
+        }
+        else {
+            id = static_cast<texture_residency_id_t>(textures.size());
+            textures.emplace_back();
+        }
+
+        texture_state_t& texture = textures[id];
+        texture = texture_state_t{};
+        texture.Desc = desc;
+        texture.Live = true;
+
+        // Smallest mip is always part of the tail, even if it alone exceeds the tail size
+        texture.TailMip = desc.MipLevels - 1;
+        uint64_t tail_bytes = MipBytes(desc, texture.TailMip);
+        while ((texture.TailMip > 0) && (tail_bytes + MipBytes(desc, texture.TailMip - 1) <= config.MipTailBytes)) {
+            --texture.TailMip;
+            tail_bytes += MipBytes(desc, texture.TailMip);
+        }
+
+        texture.DesiredMip = texture.TailMip;
+        texture.ResidentMip = desc.MipLevels;
+        setResidentMip(id, texture.TailMip, pendingChanges);
+        return id;
+    }
+
+    void TextureResidencyManager::Unregister(const texture_residency_id_t id) {
+        if ((id >= textures.size()) || !textures[id].Live) {
+            throw std::out_of_range("Invalid texture ID passed to TextureResidencyManager::Unregister!");
+        }
+
+        texture_state_t& texture = textures[id];
+        residentBytes -= bytesBetween(texture, texture.ResidentMip, texture.Desc.MipLevels);
+        texture.Live = false;
+        pendingChanges.erase(std::remove_if(std::begin(pendingChanges), std::end(pendingChanges), [id](const texture_residency_change_t& change) {
+            return change.Texture == id;
+        }), std::end(pendingChanges));
+        freeIDs.emplace_back(id);
+    }
+
+    void TextureResidencyManager::RequestScreenSize(const texture_residency_id_t id, const float screen_size) {
+        if ((id >= textures.size()) || !textures[id].Live) {
+            throw std::out_of_range("Invalid texture ID passed to TextureResidencyManager::RequestScreenSize!");
+        }
+        if (std::isnan(screen_size)) {
+            throw std::invalid_argument("NaN screen size passed to TextureResidencyManager::RequestScreenSize!");
+        }
+
+        texture_state_t& texture = textures[id];
+        const float max_dim = static_cast<float>(std::max(texture.Desc.Width, texture.Desc.Height));
+        uint32_t mip = texture.TailMip;
+        if (screen_size > 0.0f) {
+            // Tiny sizes give infinite ratios: clamp to the tail before converting, as that's out of uint32_t's range
+            const float ratio = max_dim / screen_size;
+            const float level = (ratio <= 1.0f) ? 0.0f : std::min(std::floor(std::log2(ratio)), static_cast<float>(texture.TailMip));
+            mip = static_cast<uint32_t>(level);
+        }
+
+        // Within a frame, the largest request wins
+        if (texture.LastRequestFrame != frame) {
+            texture.DesiredMip = mip;
+            texture.RequestedSize = screen_size;
+            texture.LastRequestFrame = frame;
+        }
+        else {
+            texture.DesiredMip = std::min(texture.DesiredMip, mip);
+            texture.RequestedSize = std::max(texture.RequestedSize, screen_size);
+        }
+    }
+
+    std::vector<texture_residency_change_t> TextureResidencyManager::Update() {
+        std::vector<texture_residency_change_t> changes;
+        changes.swap(pendingChanges);
+        raisedThisUpdate.assign(textures.size(), false);
+
+        const texture_residency_id_t num_textures = static_cast<texture_residency_id_t>(textures.size());
+        for (texture_residency_id_t i = 0; i < num_textures; ++i) {
+            if (textures[i].Live && (textures[i].ResidentMip < targetMip(textures[i]))) {
+                setResidentMip(i, targetMip(textures[i]), changes);
+            }
+        }
+
+        // Budget may have shrunk since the last update
+        while ((residentBytes > config.BudgetBytes) && evictOneMip(InvalidTextureResidencyID, changes)) {}
+
+        std::vector<texture_residency_id_t> candidates;
+        for (texture_residency_id_t i = 0; i < num_textures; ++i) {
+            if (textures[i].Live && (targetMip(textures[i]) < textures[i].ResidentMip)) {
+                candidates.emplace_back(i);
+            }
+        }
+
+        std::sort(std::begin(candidates), std::end(candidates), [this](const texture_residency_id_t lhs, const texture_residency_id_t rhs) {
+            const texture_state_t& l = textures[lhs];
+            const texture_state_t& r = textures[rhs];
+            const uint32_t l_shortfall = l.ResidentMip - targetMip(l);
+            const uint32_t r_shortfall = r.ResidentMip - targetMip(r);
+            if (l_shortfall != r_shortfall) {
+                return l_shortfall > r_shortfall;
+            }
+            if (l.RequestedSize != r.RequestedSize) {
+                return l.RequestedSize > r.RequestedSize;
+            }
+            return lhs < rhs;
+        });
+
+        for (const texture_residency_id_t id : candidates) {
+            texture_state_t& texture = textures[id];
+            const uint32_t target = targetMip(texture);
+            uint32_t new_top = texture.ResidentMip;
+
+            // Coarse to fine: if the budget runs out partway, the texture still gets as many mips as fit
+            while (new_top > target) {
+                const uint64_t mip_bytes = MipBytes(texture.Desc, new_top - 1);
+                while ((residentBytes + mip_bytes > config.BudgetBytes) && evictOneMip(id, changes)) {}
+                if (residentBytes + mip_bytes > config.BudgetBytes) {
+                    break;
+                }
+                residentBytes += mip_bytes;
+                --new_top;
+            }
+
+            if (new_top != texture.ResidentMip) {
+                changes.emplace_back(texture_residency_change_t{ id, texture.ResidentMip, new_top });
+                texture.ResidentMip = new_top;
+                raisedThisUpdate[id] = true;
+            }
+        }
+
+        ++frame;
+        return changes;
+    }
+
+    uint32_t TextureResidencyManager::ResidentTopMip(const texture_residency_id_t id) const {
+        return textures.at(id).ResidentMip;
+    }
+
+    uint32_t TextureResidencyManager::MipTailStart(const texture_residency_id_t id) const {
+        return textures.at(id).TailMip;
+    }
+
+    uint64_t TextureResidencyManager::ResidentBytes() const noexcept {
+        return residentBytes;
+    }
+
+    uint64_t TextureResidencyManager::BudgetBytes() const noexcept {
+        return config.BudgetBytes;
+    }
+
+    void TextureResidencyManager::SetBudgetBytes(const uint64_t budget) {
+        config.BudgetBytes = budget;
+    }
+
+    uint64_t TextureResidencyManager::MipBytes(const texture_residency_desc_t& desc, const uint32_t mip) noexcept {
+        const uint64_t width = std::max(desc.Width >> mip, 1u);
+        const uint64_t height = std::max(desc.Height >> mip, 1u);
+        return (width * height * desc.BitsPerTexel + 7) / 8;
+    }
+
+    uint32_t TextureResidencyManager::targetMip(const texture_state_t& texture) const noexcept {
+        if ((texture.LastRequestFrame == 0) || (frame - texture.LastRequestFrame > config.IdleFrames)) {
+            return texture.TailMip;
+        }
+        return texture.DesiredMip;
+    }
+
+    uint64_t TextureResidencyManager::bytesBetween(const texture_state_t& texture, const uint32_t first_mip, const uint32_t end_mip) const noexcept {
+        uint64_t result = 0;
+        for (uint32_t mip = first_mip; mip < end_mip; ++mip) {
+            result += MipBytes(texture.Desc, mip);
+        }
+        return result;
+    }
+
+    bool TextureResidencyManager::evictOneMip(const texture_residency_id_t protected_id, std::vector<texture_residency_change_t>& changes) {
+        // Least recently requested first, ties broken by index so the choice is deterministic
+        texture_residency_id_t victim = InvalidTextureResidencyID;
+        const texture_residency_id_t num_textures = static_cast<texture_residency_id_t>(textures.size());
+        for (texture_residency_id_t i = 0; i < num_textures; ++i) {
+            const texture_state_t& texture = textures[i];
+            if (!texture.Live || (i == protected_id) || (texture.LastRequestFrame == frame) || raisedThisUpdate[i] ||
+                (texture.ResidentMip >= texture.TailMip)) {
+                continue;
+            }
+            if ((victim == InvalidTextureResidencyID) || (texture.LastRequestFrame < textures[victim].LastRequestFrame)) {
+                victim = i;
+            }
+        }
+
+        if (victim == InvalidTextureResidencyID) {
+            return false;
+        }
+
+        setResidentMip(victim, textures[victim].ResidentMip + 1, changes);
+        return true;
+    }
+
+    void TextureResidencyManager::setResidentMip(const texture_residency_id_t id, const uint32_t mip, std::vector<texture_residency_change_t>& changes) {
+        texture_state_t& texture = textures[id];
+        if (mip == texture.ResidentMip) {
+            return;
+        }
+
+        if (mip < texture.ResidentMip) {
+            residentBytes += bytesBetween(texture, mip, texture.ResidentMip);
+        }
+        else {
+            residentBytes -= bytesBetween(texture, texture.ResidentMip, mip);
+        }
+
+        // Successive evictions of one texture are reported as a single change
+        const bool is_load = mip < texture.ResidentMip;
+        if (!changes.empty() && (changes.back().Texture == id) && (changes.back().IsLoad() == is_load)) {
+            changes.back().NewTopMip = mip;
+        }
+        else {
+            changes.emplace_back(texture_residency_change_t{ id, texture.ResidentMip, mip });
+        }
+        texture.ResidentMip = mip;
+    }
+
+}
+
+#ifdef VPSK_TESTING_ENABLED
+TEST_SUITE("TextureResidency") {
+    using namespace vpsk;
+
+    // 1024x1024 RGBA8: 4MiB top mip, 11 mips. With a 64KiB tail, mips 4-10 (~21KiB) form the tail.
+    constexpr texture_residency_desc_t test_texture{ 1024, 1024, 11, 32 };
+
+    TEST_CASE("MipTailLoadedOnRegistration") {
+        TextureResidencyManager manager;
+        const texture_residency_id_t id = manager.Register(test_texture);
+        CHECK(manager.MipTailStart(id) == 4);
+        auto changes = manager.Update();
+        REQUIRE(changes.size() == 1);
+        CHECK(changes[0].IsLoad());
+        CHECK(changes[0].OldTopMip == 11);
+        CHECK(changes[0].NewTopMip == 4);
+        CHECK(manager.ResidentBytes() == 21844);
+    }
+    TEST_CASE("ScreenSizeSelectsMip") {
+        TextureResidencyManager manager;
+        const texture_residency_id_t id = manager.Register(test_texture);
+        manager.Update();
+        manager.RequestScreenSize(id, 256.0f);
+        auto changes = manager.Update();
+        REQUIRE(changes.size() == 1);
+        CHECK(changes[0].OldTopMip == 4);
+        CHECK(changes[0].NewTopMip == 2);
+        CHECK(manager.ResidentTopMip(id) == 2);
+
+        manager.RequestScreenSize(id, 64.0f);
+        changes = manager.Update();
+        REQUIRE(changes.size() == 1);
+        CHECK_FALSE(changes[0].IsLoad());
+        CHECK(manager.ResidentTopMip(id) == 4);
+    }
+    TEST_CASE("DegenerateScreenSizes") {
+        TextureResidencyManager manager;
+        const texture_residency_id_t id = manager.Register(test_texture);
+        manager.Update();
+        CHECK_THROWS(manager.RequestScreenSize(id, std::numeric_limits<float>::quiet_NaN()));
+        manager.RequestScreenSize(id, std::numeric_limits<float>::denorm_min());
+        manager.Update();
+        CHECK(manager.ResidentTopMip(id) == 4);
+        manager.RequestScreenSize(id, std::numeric_limits<float>::infinity());
+        manager.Update();
+        CHECK(manager.ResidentTopMip(id) == 0);
+    }
+    TEST_CASE("EvictsLeastRecentlyUsedUnderBudget") {
+        texture_residency_config_t config;
+        // Room for the tails plus one full-resolution texture, but not two
+        config.BudgetBytes = 2 * 21844 + 4 * 1024 * 1024 + 1024 * 1024 + 256 * 1024 + 64 * 1024;
+        TextureResidencyManager manager(config);
+        const texture_residency_id_t a = manager.Register(test_texture);
+        const texture_residency_id_t b = manager.Register(test_texture);
+        manager.Update();
+
+        manager.RequestScreenSize(a, 1024.0f);
+        manager.Update();
+        CHECK(manager.ResidentTopMip(a) == 0);
+
+        // B in view, A out of view: A is evicted a mip at a time until B fits
+        manager.RequestScreenSize(b, 1024.0f);
+        auto changes = manager.Update();
+        CHECK(manager.ResidentTopMip(b) == 0);
+        CHECK(manager.ResidentTopMip(a) > 0);
+        CHECK(manager.ResidentBytes() <= config.BudgetBytes);
+        REQUIRE(changes.size() == 2);
+        CHECK(changes[0].Texture == a);
+        CHECK_FALSE(changes[0].IsLoad());
+        CHECK(changes[1].Texture == b);
+        CHECK(changes[1].IsLoad());
+    }
+    TEST_CASE("RequestedTexturesAreNotEvicted") {
+        texture_residency_config_t config;
+        // Room for A at full resolution, plus mips 3 and 2 of B
+        config.BudgetBytes = 2 * 21844 + 4 * 1024 * 1024 + 2 * (1024 * 1024 + 256 * 1024 + 64 * 1024) - 1024 * 1024;
+        TextureResidencyManager manager(config);
+        const texture_residency_id_t a = manager.Register(test_texture);
+        const texture_residency_id_t b = manager.Register(test_texture);
+        manager.Update();
+
+        manager.RequestScreenSize(a, 1024.0f);
+        manager.RequestScreenSize(b, 1024.0f);
+        manager.Update();
+        CHECK(manager.ResidentTopMip(a) == 0);
+        // B only gets what fits, coarse mips first: A isn't evicted as it's in view too
+        CHECK(manager.ResidentTopMip(b) == 2);
+        CHECK(manager.ResidentBytes() <= config.BudgetBytes);
+    }
+    TEST_CASE("IdleTexturesDropToTail") {
+        texture_residency_config_t config;
+        config.IdleFrames = 2;
+        TextureResidencyManager manager(config);
+        const texture_residency_id_t id = manager.Register(test_texture);
+        manager.RequestScreenSize(id, 1024.0f);
+        manager.Update();
+        CHECK(manager.ResidentTopMip(id) == 0);
+        manager.Update();
+        manager.Update();
+        CHECK(manager.ResidentTopMip(id) == 0);
+        manager.Update();
+        CHECK(manager.ResidentTopMip(id) == manager.MipTailStart(id));
+        CHECK(manager.ResidentBytes() == 21844);
+    }
+    TEST_CASE("StableReusedIndices") {
+        TextureResidencyManager manager;
+        const texture_residency_id_t a = manager.Register(test_texture);
+        const texture_residency_id_t b = manager.Register(test_texture);
+        manager.Unregister(a);
+        CHECK(manager.Register(test_texture) == a);
+        CHECK(manager.Register(test_texture) == b + 1);
+        CHECK_THROWS(manager.RequestScreenSize(100, 1.0f));
+    }
+    TEST_CASE("Deterministic") {
+        auto run = []() {
+            texture_residency_config_t config;
+            config.BudgetBytes = 8 * 1024 * 1024;
+            TextureResidencyManager manager(config);
+            std::vector<texture_residency_change_t> all_changes;
+            std::vector<texture_residency_id_t> ids;
+            for (uint32_t i = 0; i < 16; ++i) {
+                ids.emplace_back(manager.Register(test_texture));
+            }
+            for (uint32_t frame = 0; frame < 32; ++frame) {
+                for (uint32_t i = 0; i < 16; ++i) {
+                    if (((i + frame) % 3) == 0) {
+                        manager.RequestScreenSize(ids[i], float(64u << ((i + frame) % 5)));
+                    }
+                }
+                auto changes = manager.Update();
+                all_changes.insert(all_changes.end(), changes.begin(), changes.end());
+                CHECK(manager.ResidentBytes() <= config.BudgetBytes);
+            }
+            return all_changes;
+        };
+        auto first = run();
+        auto second = run();
+        REQUIRE(first.size() == second.size());
+        for (size_t i = 0; i < first.size(); ++i) {
+            CHECK(first[i].Texture == second[i].Texture);
+            CHECK(first[i].OldTopMip == second[i].OldTopMip);
+            CHECK(first[i].NewTopMip == second[i].NewTopMip);
+        }
+    }
+}
+#endif //!VPSK_TESTING_ENABLED